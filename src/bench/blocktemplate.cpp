@@ -0,0 +1,62 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "main.h"
+#include "miner.h"
+#include "txmempool.h"
+#include "utiltime.h"
+
+static const int BLOCK_TEMPLATE_BENCH_TXS = 50000;
+
+static void FillPool(CTxMemPool& pool)
+{
+    for (int i = 0; i < BLOCK_TEMPLATE_BENCH_TXS; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(ArithToUint256(arith_uint256(i + 1)), 0);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1;
+        tx.vout[0].nValue = 10 * COIN;
+        CTransaction txn(tx);
+        CAmount nFee = 1000 + (i % 997) * 10;
+        pool.addUnchecked(txn.GetHash(), CTxMemPoolEntry(txn, nFee, 0, 0, 1, true, 10 * COIN + nFee, false, 1, LockPoints()), false);
+    }
+}
+
+// Select a block from a 50k transaction mempool, what every CreateNewBlock
+// call paid before selections were reused
+static void BlockTemplateSelect(benchmark::State& state)
+{
+    CTxMemPool pool(CFeeRate(0));
+    FillPool(pool);
+    int64_t nLockTimeCutoff = GetTime();
+
+    while (state.KeepRunning()) {
+        CBlockTxSelection selection;
+        LOCK(pool.cs);
+        SelectBlockTransactions(pool, 2, nLockTimeCutoff, selection);
+    }
+}
+
+// The copy GetBlockTransactions hands out while the selection is reused
+static void BlockTemplateCopySelection(benchmark::State& state)
+{
+    CTxMemPool pool(CFeeRate(0));
+    FillPool(pool);
+    CBlockTxSelection selection;
+    {
+        LOCK(pool.cs);
+        SelectBlockTransactions(pool, 2, GetTime(), selection);
+    }
+
+    while (state.KeepRunning()) {
+        CBlockTxSelection copy = selection;
+    }
+}
+
+BENCHMARK(BlockTemplateSelect);
+BENCHMARK(BlockTemplateCopySelection);
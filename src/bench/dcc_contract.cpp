@@ -0,0 +1,99 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "dcccontract.h"
+#include "podc.h"
+#include "util.h"
+#include "utilstrencodings.h"
+
+#include <stdlib.h>
+
+#include <boost/algorithm/string/case_conv.hpp>
+
+/** A day's input on the scale of the current network: 2000 researchers among 40000 project users */
+static CDCCContractInput MakeContractInput()
+{
+    const int nResearchers = 2000;
+    CDCCContractInput input;
+    input.params.nHeight = 33440;
+    input.params.dReqSPM = 500;
+    input.params.dTeamRequired = 15044;
+    input.params.dTeamBackupProject = 30191;
+    input.params.dBackupProjectFactor = 0.65;
+    input.params.dNonBiblepayTeamPercentage = 0.30;
+    std::set<std::string> setCPIDs;
+    for (int i = 0; i < nResearchers; i++) {
+        std::string sCPID = strprintf("%032x", i * 7919 + 17);
+        CDCCResearcherWeights weights;
+        weights.dUTXOWeight = (i % 9) * 1250;
+        weights.dTaskWeight = i % 6 == 0 ? 0 : 100;
+        input.vEligibleCPIDs.push_back(sCPID);
+        CDCCContractResearcher researcher;
+        researcher.sCPID = sCPID;
+        researcher.sPublicKey = strprintf("B%033x", i);
+        researcher.dRosettaID = 1000 + i;
+        input.vResearchers.push_back(researcher);
+        boost::to_upper(sCPID);
+        setCPIDs.insert(sCPID);
+        input.mapWeights[sCPID] = weights;
+    }
+    for (int nProject = 1; nProject <= 2; nProject++) {
+        CDCCResearcherFilter filter(setCPIDs);
+        for (int i = 0; i < (nProject == 1 ? 30000 : 10000); i++) {
+            filter.ProcessLine("<user>");
+            filter.ProcessLine(" <id>" + itostr(i) + "</id>");
+            filter.ProcessLine(" <name>user " + itostr(i) + "</name>");
+            filter.ProcessLine(strprintf(" <expavg_credit>%d.%06d</expavg_credit>", i % 5000, (i * 7919) % 1000000));
+            filter.ProcessLine(strprintf(" <cpid>%032x</cpid>", (i % 3000) * 7919 + 17));
+            filter.ProcessLine(" <url>http://example.com/" + itostr(i) + "</url>");
+            filter.ProcessLine(i % 4 == 0 ? " <teamid>0</teamid>" : (nProject == 1 ? " <teamid>15044</teamid>" : " <teamid>30191</teamid>"));
+            filter.ProcessLine("</user>");
+        }
+        filter.Finish();
+        (nProject == 1 ? input.vProject1 : input.vProject2).swap(filter.vRecords);
+    }
+    return input;
+}
+
+// A dccinputs file saved by a sanctuary in BIBLEPAY_DCC_INPUTS replays that
+// day instead of the generated one
+static bool GetContractInput(CDCCContractInput& input)
+{
+    const char* pszInputs = getenv("BIBLEPAY_DCC_INPUTS");
+    if (pszInputs == NULL) {
+        input = MakeContractInput();
+        return true;
+    }
+    std::string sError;
+    return ReadDCCContractInput(pszInputs, input, sError);
+}
+
+// The daily magnitude contract on one thread
+static void DCCContractOneThread(benchmark::State& state)
+{
+    CDCCContractInput input;
+    if (!GetContractInput(input)) return;
+
+    while (state.KeepRunning()) {
+        CDCCContract contract;
+        ComputeDCCContract(input, contract, 1);
+    }
+}
+
+// The same contract on every core
+static void DCCContractAllCores(benchmark::State& state)
+{
+    CDCCContractInput input;
+    if (!GetContractInput(input)) return;
+    int nThreads = std::max(GetNumCores(), 2);
+
+    while (state.KeepRunning()) {
+        CDCCContract contract;
+        ComputeDCCContract(input, contract, nThreads);
+    }
+}
+
+BENCHMARK(DCCContractOneThread);
+BENCHMARK(DCCContractAllCores);
@@ -0,0 +1,71 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "main.h"
+#include "policy/fees.h"
+#include "txmempool.h"
+
+#include <boost/scoped_ptr.hpp>
+
+// Replay a synthetic 10k block confirmation history through the fee
+// estimator, one block per iteration, so the time reported is the cost of a
+// block: 10 transactions enter per block and higher fee transactions confirm
+// sooner.  The entering and confirmed entries of every block are built up
+// front, so only the estimator calls run inside KeepRunning().  Once the
+// history is used up it starts over on a new estimator, and the runs go on
+// for as many blocks as the time allows (a 100k block history built up front
+// would take close to 300MB).
+static void FeeEstimatorReplay(benchmark::State& state)
+{
+    const int nBlocks = 10000;
+    const int nTxsPerBlock = 10;
+    const int nTxPool = 4096;
+    const int nMaxDelay = 10;
+
+    std::vector<CTransactionRef> vTxs;
+    vTxs.reserve(nTxPool);
+    for (int i = 0; i < nTxPool; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(ArithToUint256(arith_uint256(i + 1)), 0);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1;
+        tx.vout[0].nValue = COIN;
+        vTxs.push_back(MakeTransactionRef(tx));
+    }
+
+    std::vector<std::vector<CTxMemPoolEntry> > vEntering(nBlocks + 1);
+    std::vector<std::vector<CTxMemPoolEntry> > vConfirmed(nBlocks + nMaxDelay + 1);
+    int nTx = 0;
+    for (int nHeight = 1; nHeight <= nBlocks; nHeight++) {
+        for (int i = 0; i < nTxsPerBlock; i++, nTx++) {
+            CAmount nFee = 1000 + (nTx % 97) * 500;
+            CTxMemPoolEntry entry(vTxs[nTx % nTxPool], nFee, 0, 0, nHeight - 1, true, COIN + nFee, false, 1, LockPoints());
+            vEntering[nHeight].push_back(entry);
+            int nDelay = 1 + (int)((96 - (nFee - 1000) / 500) * nMaxDelay / 97);
+            vConfirmed[nHeight + nDelay].push_back(entry);
+        }
+    }
+
+    boost::scoped_ptr<CBlockPolicyEstimator> estimator;
+    int nHeight = nBlocks;
+    while (state.KeepRunning()) {
+        if (nHeight == nBlocks) {
+            estimator.reset(new CBlockPolicyEstimator(CFeeRate(1000)));
+            nHeight = 0;
+        }
+        nHeight++;
+        BOOST_FOREACH(const CTxMemPoolEntry& entry, vEntering[nHeight])
+            estimator->processTransaction(entry, true);
+        estimator->processBlock(nHeight, vConfirmed[nHeight], true);
+        BOOST_FOREACH(const CTxMemPoolEntry& entry, vConfirmed[nHeight])
+            estimator->removeTx(entry.GetTx().GetHash());
+        estimator->estimateFee(2);
+    }
+}
+
+BENCHMARK(FeeEstimatorReplay);
@@ -0,0 +1,191 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "compat.h"
+#include "httpclient.h"
+#include "netbase.h"
+#include "utilstrencodings.h"
+
+#include <string.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <openssl/bn.h>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+/** Local TLS server with a throwaway self-signed certificate, answering every request with a small pool style reply */
+class CTLSStandinServer
+{
+public:
+    int nPort;
+
+    CTLSStandinServer() : nPort(0), ctx(NULL)
+    {
+        SSL_library_init();
+        ctx = SSL_CTX_new(SSLv23_server_method());
+        EVP_PKEY* pkey = EVP_PKEY_new();
+        RSA* rsa = RSA_new();
+        BIGNUM* e = BN_new();
+        BN_set_word(e, RSA_F4);
+        RSA_generate_key_ex(rsa, 2048, e, NULL);
+        BN_free(e);
+        EVP_PKEY_assign_RSA(pkey, rsa);
+        X509* x509 = X509_new();
+        ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+        X509_gmtime_adj(X509_get_notBefore(x509), 0);
+        X509_gmtime_adj(X509_get_notAfter(x509), 3600);
+        X509_set_pubkey(x509, pkey);
+        X509_NAME_add_entry_by_txt(X509_get_subject_name(x509), "CN", MBSTRING_ASC, (const unsigned char*)"127.0.0.1", -1, -1, 0);
+        X509_set_issuer_name(x509, X509_get_subject_name(x509));
+        X509_sign(x509, pkey, EVP_sha256());
+        SSL_CTX_use_certificate(ctx, x509);
+        SSL_CTX_use_PrivateKey(ctx, pkey);
+        X509_free(x509);
+        EVP_PKEY_free(pkey);
+
+        hListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        if (bind(hListen, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+            listen(hListen, 64) == SOCKET_ERROR ||
+            getsockname(hListen, (struct sockaddr*)&addr, &len) == SOCKET_ERROR)
+            return;
+        nPort = ntohs(addr.sin_port);
+        acceptThread = boost::thread(boost::bind(&CTLSStandinServer::AcceptLoop, this));
+    }
+
+    ~CTLSStandinServer()
+    {
+#ifndef WIN32
+        shutdown(hListen, SHUT_RDWR);
+#endif
+        CloseSocket(hListen);
+        if (acceptThread.joinable()) acceptThread.join();
+        threads.join_all();
+        SSL_CTX_free(ctx);
+    }
+
+private:
+    SOCKET hListen;
+    SSL_CTX* ctx;
+    boost::thread acceptThread;
+    boost::thread_group threads;
+
+    void AcceptLoop()
+    {
+        while (true) {
+            SOCKET hSocket = accept(hListen, NULL, NULL);
+            if (hSocket == INVALID_SOCKET) return;
+            threads.create_thread(boost::bind(&CTLSStandinServer::Serve, this, hSocket));
+        }
+    }
+
+    void Serve(SOCKET hSocket)
+    {
+        SSL* ssl = SSL_new(ctx);
+        SSL_set_fd(ssl, hSocket);
+        if (SSL_accept(ssl) == 1) {
+            const std::string sBody = "<RESPONSE>" + std::string(400, 'x') + "</RESPONSE><END>";
+            std::string sPending;
+            char buf[4096];
+            while (true) {
+                size_t nEnd;
+                while ((nEnd = sPending.find("\r\n\r\n")) == std::string::npos) {
+                    int n = SSL_read(ssl, buf, sizeof(buf));
+                    if (n <= 0) break;
+                    sPending.append(buf, n);
+                }
+                if (nEnd == std::string::npos) break;
+                bool fClose = sPending.substr(0, nEnd).find("Connection: close") != std::string::npos;
+                sPending.erase(0, nEnd + 4);
+                std::string sResponse = "HTTP/1.1 200 OK\r\nContent-Length: " + itostr(sBody.size()) + "\r\n\r\n" + sBody;
+                if (SSL_write(ssl, sResponse.data(), sResponse.size()) <= 0 || fClose) break;
+            }
+        }
+        SSL_free(ssl);
+        CloseSocket(hSocket);
+    }
+};
+
+static CHTTPClientRequest MakeBenchRequest(const CTLSStandinServer& server)
+{
+    CHTTPClientRequest request;
+    request.sMethod = "POST";
+    request.sHost = "127.0.0.1";
+    request.nPort = server.nPort;
+    request.fTLS = true;
+    request.sPath = "/Action.aspx";
+    request.mapHeaders["Action"] = "PostSpeed";
+    return request;
+}
+
+static void ClientRequests(CHTTPClient* pclient, CHTTPClientRequest request, int nRequests)
+{
+    for (int i = 0; i < nRequests; i++) {
+        CHTTPClientResponse response;
+        pclient->Request(request, response);
+    }
+}
+
+// One small request to a local TLS server on a fresh connection with a full
+// handshake, as the pool and BOINC calls used to make them
+static void HTTPSClientNewConnection(benchmark::State& state)
+{
+    CTLSStandinServer server;
+    if (server.nPort == 0) return;
+    CHTTPClient client;
+    CHTTPClientRequest request = MakeBenchRequest(server);
+    request.fKeepAlive = false;
+
+    while (state.KeepRunning()) {
+        CHTTPClientResponse response;
+        client.Request(request, response);
+    }
+}
+
+// The same request over the pooled keep-alive connection
+static void HTTPSClientPooled(benchmark::State& state)
+{
+    CTLSStandinServer server;
+    if (server.nPort == 0) return;
+    CHTTPClient client;
+    CHTTPClientRequest request = MakeBenchRequest(server);
+    ClientRequests(&client, request, 1);
+
+    while (state.KeepRunning()) {
+        CHTTPClientResponse response;
+        client.Request(request, response);
+    }
+}
+
+// 200 requests spread over 8 threads sharing the pool
+static void HTTPSClientPooledThreads(benchmark::State& state)
+{
+    const int nRequests = 200;
+    const int nThreads = 8;
+    CTLSStandinServer server;
+    if (server.nPort == 0) return;
+    CHTTPClient client;
+    CHTTPClientRequest request = MakeBenchRequest(server);
+
+    while (state.KeepRunning()) {
+        boost::thread_group threadGroup;
+        for (int i = 0; i < nThreads; i++)
+            threadGroup.create_thread(boost::bind(&ClientRequests, &client, request, nRequests / nThreads));
+        threadGroup.join_all();
+    }
+}
+
+BENCHMARK(HTTPSClientNewConnection);
+BENCHMARK(HTTPSClientPooled);
+BENCHMARK(HTTPSClientPooledThreads);
@@ -0,0 +1,173 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "activemasternode.h"
+#include "arith_uint256.h"
+#include "chain.h"
+#include "coins.h"
+#include "key.h"
+#include "main.h"
+#include "instantx.h"
+#include "masternodeman.h"
+#include "utiltime.h"
+
+#include <iostream>
+
+// The first two benches treat votes as already validated, the same way
+// ProcessMessage hands them over after the signature and rank checks.
+
+// 100k votes (10k txs, 1000 masternodes) arriving before their lock requests
+static void InstantSendOrphanVotes(benchmark::State& state)
+{
+    const int nTxs = 10000;
+    const int nMasternodes = 1000;
+    const int nVotes = 100000;
+
+    std::vector<CTxLockVote> vVotes;
+    vVotes.reserve(nVotes);
+    for (int i = 0; i < nVotes; i++) {
+        uint256 txHash = ArithToUint256(arith_uint256(i % nTxs + 1));
+        COutPoint outpoint(txHash, 0);
+        COutPoint outpointMasternode(ArithToUint256(arith_uint256(nTxs + i % nMasternodes + 1)), 0);
+        vVotes.push_back(CTxLockVote(txHash, outpoint, outpointMasternode));
+    }
+
+    while (state.KeepRunning()) {
+        CInstantSend instantSendBench;
+        // no wallet is loaded here, so cs_wallet is not needed
+        LOCK2(cs_main, instantSendBench.cs_instantsend);
+        for (int i = 0; i < nVotes; i++)
+            instantSendBench.ProcessTxLockVote(NULL, vVotes[i], true);
+    }
+}
+
+// 10k lock requests, then 5 votes on each from different masternodes; one
+// short of SIGNATURES_REQUIRED, so every vote takes the candidate path
+// without finalizing a lock against the (absent) chain state
+static void InstantSendCandidateVotes(benchmark::State& state)
+{
+    const int nTxs = 10000;
+    const int nVotesPerTx = COutPointLock::SIGNATURES_REQUIRED - 1;
+
+    std::vector<CTxLockRequestRef> vRequests;
+    std::vector<CTxLockVote> vVotes;
+    vRequests.reserve(nTxs);
+    vVotes.reserve(nTxs * nVotesPerTx);
+    for (int i = 0; i < nTxs; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(ArithToUint256(arith_uint256(i + 1)), 0);
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1;
+        tx.vout[0].nValue = COIN;
+        vRequests.push_back(MakeTxLockRequestRef(CTransaction(tx)));
+    }
+    for (int j = 0; j < nVotesPerTx; j++) {
+        for (int i = 0; i < nTxs; i++) {
+            COutPoint outpointMasternode(ArithToUint256(arith_uint256(nTxs + j * nTxs + i + 1)), 0);
+            vVotes.push_back(CTxLockVote(vRequests[i]->GetHash(), vRequests[i]->vin[0].prevout, outpointMasternode));
+        }
+    }
+
+    while (state.KeepRunning()) {
+        CInstantSend instantSendBench;
+        LOCK2(cs_main, instantSendBench.cs_instantsend);
+        for (int i = 0; i < nTxs; i++)
+            instantSendBench.CreateTxLockCandidate(vRequests[i], true);
+        for (unsigned int i = 0; i < vVotes.size(); i++)
+            instantSendBench.ProcessTxLockVote(NULL, vVotes[i], true);
+    }
+}
+
+// 1000 txs with 5 signed votes each from the top ranked masternodes, taken the
+// way ProcessMessage takes a vote off the wire: CTxLockVote::IsValid, which
+// looks up the masternode, the UTXO and the rank and verifies the signature,
+// then the bookkeeping under cs_main and cs_instantsend.  The masternode list,
+// the UTXOs and a short chain for the rank are stand-ins set up here.
+static void InstantSendUnvalidatedVotes(benchmark::State& state)
+{
+    const int nTxs = 1000;
+    const int nMasternodes = COutPointLock::SIGNATURES_TOTAL;
+    const int nVotesPerTx = COutPointLock::SIGNATURES_REQUIRED - 1;
+    const int nInputHeight = 1;
+
+    // Blocks up to the height the ranks are taken at, nInputHeight + 4
+    std::vector<uint256> vBlockHashes(nInputHeight + 5);
+    std::vector<CBlockIndex> vBlockIndex(vBlockHashes.size());
+    for (unsigned int i = 0; i < vBlockIndex.size(); i++) {
+        vBlockHashes[i] = ArithToUint256(arith_uint256(1000000 + i));
+        vBlockIndex[i].phashBlock = &vBlockHashes[i];
+        vBlockIndex[i].nHeight = i;
+        vBlockIndex[i].pprev = i > 0 ? &vBlockIndex[i - 1] : NULL;
+    }
+
+    CCoinsView coinsDummy;
+    CCoinsViewCache coinsBench(&coinsDummy);
+    std::vector<CKey> vKeys(nMasternodes);
+    std::vector<CTxLockVote> vVotes;
+    vVotes.reserve(nTxs * nVotesPerTx);
+    {
+        LOCK(cs_main);
+        chainActive.SetTip(&vBlockIndex.back());
+        pcoinsTip = &coinsBench;
+    }
+    for (int j = 0; j < nMasternodes; j++) {
+        vKeys[j].MakeNewKey(true);
+        COutPoint outpointMasternode(ArithToUint256(arith_uint256(nTxs + j + 1)), 0);
+        CMasternode mn(CService(), CTxIn(outpointMasternode), vKeys[j].GetPubKey(), vKeys[j].GetPubKey(), PROTOCOL_VERSION);
+        mnodeman.Add(mn);
+    }
+    // CTxLockVote::Sign signs with the active masternode key
+    CKey keyActive = activeMasternode.keyMasternode;
+    CPubKey pubKeyActive = activeMasternode.pubKeyMasternode;
+    for (int i = 0; i < nTxs; i++) {
+        uint256 txHash = ArithToUint256(arith_uint256(i + 1));
+        COutPoint outpoint(ArithToUint256(arith_uint256(2 * nTxs + i + 1)), 0);
+        CCoinsModifier coins = coinsBench.ModifyCoins(outpoint.hash);
+        coins->nHeight = nInputHeight;
+        coins->vout.resize(1);
+        coins->vout[0].nValue = COIN;
+        coins->vout[0].scriptPubKey = CScript() << OP_1;
+        for (int j = 0; j < nVotesPerTx; j++) {
+            activeMasternode.keyMasternode = vKeys[j];
+            activeMasternode.pubKeyMasternode = vKeys[j].GetPubKey();
+            CTxLockVote vote(txHash, outpoint, COutPoint(ArithToUint256(arith_uint256(nTxs + j + 1)), 0));
+            vote.Sign();
+            vVotes.push_back(vote);
+        }
+    }
+    activeMasternode.keyMasternode = keyActive;
+    activeMasternode.pubKeyMasternode = pubKeyActive;
+
+    int64_t nVotesChecked = 0;
+    int64_t nVotesRejected = 0;
+    int64_t nTimeStart = GetTimeMicros();
+    while (state.KeepRunning()) {
+        CInstantSend instantSendBench;
+        for (unsigned int i = 0; i < vVotes.size(); i++) {
+            nVotesChecked++;
+            if (!vVotes[i].IsValid(NULL)) {
+                nVotesRejected++;
+                continue;
+            }
+            LOCK2(cs_main, instantSendBench.cs_instantsend);
+            instantSendBench.ProcessTxLockVote(NULL, vVotes[i], true);
+        }
+    }
+    int64_t nTimeElapsed = GetTimeMicros() - nTimeStart;
+    if (nVotesRejected > 0)
+        std::cout << "InstantSendUnvalidatedVotes: " << nVotesRejected << " votes rejected, the stand-in setup is broken\n";
+    if (nTimeElapsed > 0)
+        std::cout << "InstantSendUnvalidatedVotes: " << nVotesChecked * 1000000 / nTimeElapsed << " votes/sec\n";
+
+    mnodeman.Clear();
+    LOCK(cs_main);
+    pcoinsTip = NULL;
+    chainActive.SetTip(NULL);
+}
+
+BENCHMARK(InstantSendOrphanVotes);
+BENCHMARK(InstantSendCandidateVotes);
+BENCHMARK(InstantSendUnvalidatedVotes);
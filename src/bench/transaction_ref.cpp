@@ -0,0 +1,77 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "main.h"
+#include "txmempool.h"
+
+static const int MEMPOOL_BENCH_TXS = 10000;
+
+// Mempool transactions carrying two 3000 byte output messages
+static void FillPool(CTxMemPool& pool, std::vector<uint256>& vHashes)
+{
+    for (int i = 0; i < MEMPOOL_BENCH_TXS; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(ArithToUint256(arith_uint256(i + 1)), 0);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vout.resize(2);
+        for (unsigned int j = 0; j < tx.vout.size(); j++) {
+            tx.vout[j].scriptPubKey = CScript() << OP_1;
+            tx.vout[j].nValue = COIN;
+            tx.vout[j].sTxOutMessage = std::string(3000, 'a' + j);
+        }
+        CTransactionRef ptx = MakeTransactionRef(tx);
+        pool.addUnchecked(ptx->GetHash(), CTxMemPoolEntry(ptx, 1000, 0, 0, 1, true, 2 * COIN + 1000, false, 1, LockPoints()), false);
+        vHashes.push_back(ptx->GetHash());
+    }
+}
+
+// Fetch every transaction the way relay used to: lookup() deep copies it
+static void MempoolLookupCopy(benchmark::State& state)
+{
+    CTxMemPool pool(CFeeRate(0));
+    std::vector<uint256> vHashes;
+    FillPool(pool, vHashes);
+
+    while (state.KeepRunning()) {
+        for (int i = 0; i < MEMPOOL_BENCH_TXS; i++) {
+            CTransaction tx;
+            pool.lookup(vHashes[i], tx);
+        }
+    }
+}
+
+// The same fetches through get(), which hands out the shared transaction
+static void MempoolGetShared(benchmark::State& state)
+{
+    CTxMemPool pool(CFeeRate(0));
+    std::vector<uint256> vHashes;
+    FillPool(pool, vHashes);
+
+    while (state.KeepRunning()) {
+        for (int i = 0; i < MEMPOOL_BENCH_TXS; i++)
+            CTransactionRef ptx = pool.get(vHashes[i]);
+    }
+}
+
+// Copies of the entries, as made when staging a block for the fee estimator
+static void MempoolEntryCopies(benchmark::State& state)
+{
+    CTxMemPool pool(CFeeRate(0));
+    std::vector<uint256> vHashes;
+    FillPool(pool, vHashes);
+
+    while (state.KeepRunning()) {
+        std::vector<CTxMemPoolEntry> entries;
+        LOCK(pool.cs);
+        for (CTxMemPool::indexed_transaction_set::const_iterator it = pool.mapTx.begin(); it != pool.mapTx.end(); ++it)
+            entries.push_back(*it);
+    }
+}
+
+BENCHMARK(MempoolLookupCopy);
+BENCHMARK(MempoolGetShared);
+BENCHMARK(MempoolEntryCopies);
@@ -0,0 +1,111 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "podc.h"
+#include "tinyformat.h"
+#include "utilstrencodings.h"
+
+static const int XML_BENCH_PAYLOADS = 2000;
+
+// The fields GetTxMessage reads out of prayer and CPIDTASKS output messages,
+// and the fields the DCC contract reads out of each project user row
+static const char* XML_MESSAGE_TAGS = "MT,MK,MV,MS,NONCE,SPORKSIG,BOSIG,BOSIGNER,ipfshash,ipfssize,cpidsig,PODC_TASKS";
+static const char* XML_USER_TAGS = "teamid,utxoweight,taskweight,unbanked,cpid,expavg_credit";
+
+static std::string GetBenchCPID(int i)
+{
+    return strprintf("%032x", i * 7919 + 17);
+}
+
+static std::vector<std::string> MakePrayers()
+{
+    std::vector<std::string> vPrayers;
+    for (int i = 0; i < XML_BENCH_PAYLOADS; i++)
+        vPrayers.push_back("<MT>PRAYER</MT><MK>Healing (" + itostr(i) + ")</MK><MV>Please pray for the healing of my family member, "
+            "who has been in the hospital for " + itostr(i % 30) + " days.  Thank you and God bless.</MV><NONCE>" + itostr(1519056000 + i) + "</NONCE>");
+    return vPrayers;
+}
+
+static std::vector<std::string> MakeTasks()
+{
+    std::vector<std::string> vTasks;
+    for (int i = 0; i < XML_BENCH_PAYLOADS; i++) {
+        std::string sTaskList;
+        for (int j = 0; j < 40; j++)
+            sTaskList += (j > 0 ? "," : "") + itostr(975000000 + i * 40 + j) + "=" + itostr(1519056000 + j);
+        std::string sCPID = GetBenchCPID(i);
+        vTasks.push_back("<MT>CPIDTASKS</MT><MK>" + sCPID + "</MK><MV>" + sTaskList + "</MV><cpidsig>" + sCPID + ";"
+            + strprintf("%064x", i) + ";BAddress" + itostr(i) + ";" + std::string(88, 'S') + "</cpidsig><PODC_TASKS>" + sTaskList + "</PODC_TASKS>");
+    }
+    return vTasks;
+}
+
+static std::vector<std::string> MakeUsers()
+{
+    std::vector<std::string> vUsers;
+    for (int i = 0; i < XML_BENCH_PAYLOADS; i++)
+        vUsers.push_back("<user><id>" + itostr(i) + "</id><name>user " + itostr(i) + "</name><expavg_credit>" + itostr(i % 5000)
+            + ".125000</expavg_credit><cpid>" + GetBenchCPID(i) + "</cpid><url>http://example.com/" + itostr(i) + "</url><teamid>15044</teamid>"
+            + "<utxoweight>" + itostr((i % 9) * 1250) + "</utxoweight><taskweight>100</taskweight><unbanked>0</unbanked></user>");
+    return vUsers;
+}
+
+// One ExtractXML call per tag, as the callers used to read them
+static void ExtractEachTag(benchmark::State& state, const std::vector<std::string>& vPayloads, const char* pszTags)
+{
+    XMLTagList vTags = GetXMLTagList(pszTags);
+    while (state.KeepRunning()) {
+        for (unsigned int i = 0; i < vPayloads.size(); i++)
+            for (unsigned int j = 0; j < vTags.size(); j++)
+                ExtractXML(vPayloads[i], vTags[j].first, vTags[j].second);
+    }
+}
+
+// All the tags in one call
+static void ExtractAllTags(benchmark::State& state, const std::vector<std::string>& vPayloads, const char* pszTags)
+{
+    XMLTagList vTags = GetXMLTagList(pszTags);
+    while (state.KeepRunning()) {
+        for (unsigned int i = 0; i < vPayloads.size(); i++)
+            ExtractXMLFields(vPayloads[i], vTags);
+    }
+}
+
+static void XMLExtractPrayers(benchmark::State& state)
+{
+    ExtractEachTag(state, MakePrayers(), XML_MESSAGE_TAGS);
+}
+
+static void XMLExtractFieldsPrayers(benchmark::State& state)
+{
+    ExtractAllTags(state, MakePrayers(), XML_MESSAGE_TAGS);
+}
+
+static void XMLExtractTasks(benchmark::State& state)
+{
+    ExtractEachTag(state, MakeTasks(), XML_MESSAGE_TAGS);
+}
+
+static void XMLExtractFieldsTasks(benchmark::State& state)
+{
+    ExtractAllTags(state, MakeTasks(), XML_MESSAGE_TAGS);
+}
+
+static void XMLExtractUsers(benchmark::State& state)
+{
+    ExtractEachTag(state, MakeUsers(), XML_USER_TAGS);
+}
+
+static void XMLExtractFieldsUsers(benchmark::State& state)
+{
+    ExtractAllTags(state, MakeUsers(), XML_USER_TAGS);
+}
+
+BENCHMARK(XMLExtractPrayers);
+BENCHMARK(XMLExtractFieldsPrayers);
+BENCHMARK(XMLExtractTasks);
+BENCHMARK(XMLExtractFieldsTasks);
+BENCHMARK(XMLExtractUsers);
+BENCHMARK(XMLExtractFieldsUsers);
@@ -422,19 +422,19 @@ public:
 class CDarksendBroadcastTx
 {
 public:
-    CTransaction tx;
+    CTransactionRef tx; //! Shared, so copies into mapDarksendBroadcastTxes do not copy the transaction
     CTxIn vin;
     std::vector<unsigned char> vchSig;
     int64_t sigTime;
 
     CDarksendBroadcastTx() :
-        tx(CTransaction()),
+        tx(MakeTransactionRef()),
         vin(CTxIn()),
         vchSig(std::vector<unsigned char>()),
         sigTime(0)
         {}
 
-    CDarksendBroadcastTx(CTransaction tx, CTxIn vin, int64_t sigTime) :
+    CDarksendBroadcastTx(const CTransactionRef& tx, CTxIn vin, int64_t sigTime) :
         tx(tx),
         vin(vin),
         vchSig(std::vector<unsigned char>()),
@@ -445,7 +445,13 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
-        READWRITE(tx);
+        if (ser_action.ForRead()) {
+            boost::shared_ptr<CTransaction> ptx = boost::make_shared<CTransaction>();
+            READWRITE(*ptx);
+            tx = ptx;
+        } else {
+            READWRITE(*const_cast<CTransaction*>(tx.get()));
+        }
         READWRITE(vin);
         READWRITE(vchSig);
         READWRITE(sigTime);
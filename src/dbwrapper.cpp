@@ -3,9 +3,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "dbwrapper.h"
+#include "sync.h"
 #include "util.h"
 #include "random.h"
+#include <atomic>
+#include <set>
+
 #include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
 #include <leveldb/filter_policy.h>
@@ -28,14 +33,57 @@ void HandleError(const leveldb::Status& status) throw(dbwrapper_error)
     throw dbwrapper_error("Unknown database error");
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+void CDBProfile::ApplyArgs()
+{
+    if (strName.empty())
+        return;
+    BOOST_FOREACH(const std::string& strTune, mapMultiArgs["-dbtune"]) {
+        std::string::size_type nColon = strTune.find(':');
+        std::string::size_type nEquals = strTune.find('=');
+        if (nColon == std::string::npos || nEquals == std::string::npos || nEquals < nColon || strTune.substr(0, nColon) != strName)
+            continue;
+        std::string strSetting = strTune.substr(nColon + 1, nEquals - nColon - 1);
+        int64_t nValue = atoi64(strTune.substr(nEquals + 1));
+        if (strSetting == "blocksize" && nValue >= 1024)
+            nBlockSize = nValue;
+        else if (strSetting == "compression")
+            fCompression = nValue != 0;
+        else if (strSetting == "bloombits" && nValue >= 0)
+            nBloomBits = nValue;
+        else if (strSetting == "maxopenfiles" && nValue >= 16)
+            nMaxOpenFiles = nValue;
+        else if (strSetting == "writebuffer" && nValue > 0 && nValue <= 50)
+            nWriteBufferPercent = nValue;
+        else
+            LogPrintf("%s: ignoring -dbtune=%s\n", __func__, strTune);
+    }
+}
+
+CDBProfile CDBProfile::Chainstate()
+{
+    return CDBProfile("chainstate", 4096, false, 10, 64, 25);
+}
+
+CDBProfile CDBProfile::BlockIndex()
+{
+    return CDBProfile("blockindex", 4096, false, 10, 64, 25);
+}
+
+CDBProfile CDBProfile::Indexes()
+{
+    // Larger compressed blocks suit the range scans of the address and timestamp indexes
+    return CDBProfile("indexes", 16384, true, 10, 256, 25);
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBProfile& profile)
 {
     leveldb::Options options;
     options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    options.write_buffer_size = nCacheSize * profile.nWriteBufferPercent / 100; // up to two write buffers may be held in memory simultaneously
+    options.filter_policy = profile.nBloomBits > 0 ? leveldb::NewBloomFilterPolicy(profile.nBloomBits) : NULL;
+    options.compression = profile.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.block_size = profile.nBlockSize;
+    options.max_open_files = profile.nMaxOpenFiles;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
@@ -44,14 +92,23 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
+// Open databases with a named profile, for getdbstats
+static CCriticalSection cs_openDatabases;
+static std::set<const CDBWrapper*> setOpenDatabases;
+
+// Counts synced writes of all databases, so that their order can be checked
+static std::atomic<uint64_t> nSyncCounter(0);
+
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSizeIn, bool fMemory, bool fWipe, bool obfuscate,
+                       const CDBProfile& profileIn) : profile(profileIn), strPath(path.string()), nCacheSize(nCacheSizeIn), nLastSync(0)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    profile.ApplyArgs();
+    options = GetOptions(nCacheSize, profile);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -87,10 +144,19 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
     }
 
     LogPrintf("Using obfuscation key for %s: %s\n", path.string(), GetObfuscateKeyHex());
+
+    if (!profile.strName.empty()) {
+        LOCK(cs_openDatabases);
+        setOpenDatabases.insert(this);
+    }
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        LOCK(cs_openDatabases);
+        setOpenDatabases.erase(this);
+    }
     delete pdb;
     pdb = NULL;
     delete options.filter_policy;
@@ -105,6 +171,8 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync) throw(dbwrapper_error)
 {
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     HandleError(status);
+    if (fSync)
+        nLastSync = ++nSyncCounter;
     return true;
 }
 
@@ -145,6 +213,40 @@ std::string CDBWrapper::GetObfuscateKeyHex() const
     return HexStr(obfuscate_key);
 }
 
+CDBStats CDBWrapper::GetStats() const
+{
+    CDBStats stats;
+    stats.strPath = strPath;
+    stats.profile = profile;
+    stats.nCacheSize = nCacheSize;
+    stats.nLastSync = nLastSync;
+    pdb->GetProperty("leveldb.stats", &stats.strLevelDBStats);
+
+    // Every table keys its entries by a leading type byte
+    const std::string strEnd(4, '\xff');
+    leveldb::Range rangeAll("", strEnd);
+    pdb->GetApproximateSizes(&rangeAll, 1, &stats.nApproximateSize);
+    for (int ch = 0x21; ch < 0x7f; ch++) {
+        std::string strBegin(1, (char)ch), strLimit(1, (char)(ch + 1));
+        leveldb::Range range(strBegin, strLimit);
+        uint64_t nSize = 0;
+        pdb->GetApproximateSizes(&range, 1, &nSize);
+        if (nSize > 0)
+            stats.mapPrefixSizes[(char)ch] = nSize;
+    }
+    return stats;
+}
+
+std::vector<CDBStats> GetDBStats()
+{
+    std::vector<CDBStats> vStats;
+    LOCK(cs_openDatabases);
+    BOOST_FOREACH(const CDBWrapper* pdbw, setOpenDatabases) {
+        vStats.push_back(pdbw->GetStats());
+    }
+    return vStats;
+}
+
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
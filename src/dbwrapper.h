@@ -14,6 +14,9 @@
 //#include "config/biblepay-config.h"
 
 
+#include <map>
+#include <vector>
+
 #include <boost/filesystem/path.hpp>
 
 #include <leveldb/db.h>
@@ -27,6 +30,52 @@ public:
 
 void HandleError(const leveldb::Status& status) throw(dbwrapper_error);
 
+/**
+ * LevelDB settings of one database.  Each database opens with the profile
+ * that suits how it is used; -dbtune=<name>:<setting>=<value> overrides a
+ * single setting of a named profile (blocksize, compression, bloombits,
+ * maxopenfiles, writebuffer).
+ */
+struct CDBProfile
+{
+    std::string strName;        //! empty for databases that are not tunable or reported
+    size_t nBlockSize;          //! bytes of user data per LevelDB block
+    bool fCompression;          //! snappy compress blocks
+    int nBloomBits;             //! bloom filter bits per key, 0 for no filter
+    int nMaxOpenFiles;
+    int nWriteBufferPercent;    //! percent of the cache per write buffer; up to two may be held at once
+
+    CDBProfile() : nBlockSize(4096), fCompression(false), nBloomBits(10), nMaxOpenFiles(64), nWriteBufferPercent(25) {}
+    CDBProfile(const std::string& strNameIn, size_t nBlockSizeIn, bool fCompressionIn, int nBloomBitsIn, int nMaxOpenFilesIn, int nWriteBufferPercentIn) :
+        strName(strNameIn), nBlockSize(nBlockSizeIn), fCompression(fCompressionIn), nBloomBits(nBloomBitsIn),
+        nMaxOpenFiles(nMaxOpenFilesIn), nWriteBufferPercent(nWriteBufferPercentIn) {}
+
+    /** Apply the -dbtune overrides for this profile */
+    void ApplyArgs();
+
+    /** UTXO set: point lookups of random keys, values are small and incompressible */
+    static CDBProfile Chainstate();
+    /** Block index, file info and flags: small, read whole at startup */
+    static CDBProfile BlockIndex();
+    /** tx, address, spent and timestamp indexes: large, append mostly, scanned by key range */
+    static CDBProfile Indexes();
+};
+
+/** Internal state of an open database as reported by getdbstats */
+struct CDBStats
+{
+    std::string strPath;
+    CDBProfile profile;
+    size_t nCacheSize;
+    uint64_t nApproximateSize;
+    std::map<char, uint64_t> mapPrefixSizes;    //! approximate bytes per leading key byte
+    std::string strLevelDBStats;                //! the "leveldb.stats" property
+    uint64_t nLastSync;                         //! order of the last synced write among all databases, 0 for none
+};
+
+/** Stats of every open database with a named profile */
+std::vector<CDBStats> GetDBStats();
+
 /** Batch of changes queued to be written to a CDBWrapper */
 class CDBBatch
 {
@@ -143,6 +192,14 @@ private:
     //! database options used
     leveldb::Options options;
 
+    //! settings the options were built from, kept for getdbstats
+    CDBProfile profile;
+    std::string strPath;
+    size_t nCacheSize;
+
+    //! order of the last synced write among all databases, 0 for none
+    uint64_t nLastSync;
+
     //! options used when reading from the database
     leveldb::ReadOptions readoptions;
 
@@ -178,9 +235,13 @@ public:
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
      */
-    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false,
+               const CDBProfile& profile = CDBProfile());
     ~CDBWrapper();
 
+    /** Snapshot of the database's LevelDB properties and approximate sizes */
+    CDBStats GetStats() const;
+
     template <typename K, typename V>
     bool Read(const K& key, V& value) const throw(dbwrapper_error)
     {
@@ -0,0 +1,343 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "dcccontract.h"
+
+#include "clientversion.h"
+#include "podc.h"
+#include "streams.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <stdexcept>
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+
+/** Items a worker claims at a time */
+static const size_t DCC_CONTRACT_CHUNK = 64;
+
+/** One <user> record of an export, with the weights of its researcher added, as the quorum used to write it to the filtered file */
+struct CDCCUserRecord
+{
+    std::string sCPID;
+    double dAvgCredit;
+    double dTeam;
+    /** What each <user> element of the record adds to the project RAC, in file order */
+    std::vector<double> vCredits;
+    CDCCUserRecord() : dAvgCredit(0), dTeam(0) {}
+};
+
+/** A researcher's credit in one project */
+struct CDCCProjectCredit
+{
+    double dRAC;
+    bool fFound;
+    /** Team of the last record found */
+    double dTeam;
+    CDCCProjectCredit() : dRAC(0), fFound(false), dTeam(0) {}
+};
+
+class CDCCParallelRun
+{
+public:
+    CDCCParallelRun(size_t nItemsIn, const boost::function<void(size_t)>& fnIn) : nItems(nItemsIn), nNext(0), nFailed(nItemsIn), fn(fnIn) {}
+
+    void Run(int nThreads)
+    {
+        boost::thread_group threadGroup;
+        for (int i = 1; i < nThreads && (size_t)i * DCC_CONTRACT_CHUNK < nItems; i++)
+            threadGroup.create_thread(boost::bind(&CDCCParallelRun::Work, this));
+        Work();
+        threadGroup.join_all();
+        // The error of the first failed item, as a single thread would have reported it
+        if (nFailed < nItems) throw std::runtime_error(sError);
+    }
+
+private:
+    size_t nItems;
+    size_t nNext;
+    size_t nFailed;
+    std::string sError;
+    boost::mutex mutex;
+    boost::function<void(size_t)> fn;
+
+    void Work()
+    {
+        while (true) {
+            size_t nBegin;
+            {
+                boost::lock_guard<boost::mutex> lock(mutex);
+                if (nNext >= nItems) return;
+                nBegin = nNext;
+                nNext = std::min(nItems, nNext + DCC_CONTRACT_CHUNK);
+            }
+            for (size_t i = nBegin; i < nBegin + DCC_CONTRACT_CHUNK && i < nItems; i++) {
+                try {
+                    fn(i);
+                } catch (const std::exception& e) {
+                    boost::lock_guard<boost::mutex> lock(mutex);
+                    if (i < nFailed) {
+                        nFailed = i;
+                        sError = e.what();
+                    }
+                    break;
+                }
+            }
+        }
+    }
+};
+
+static void ParallelFor(size_t nItems, int nThreads, const boost::function<void(size_t)>& fn)
+{
+    CDCCParallelRun run(nItems, fn);
+    run.Run(nThreads);
+}
+
+static CDCCResearcherWeights GetWeights(const CDCCContractInput& input, std::string sCPID)
+{
+    boost::to_upper(sCPID);
+    std::map<std::string, CDCCResearcherWeights>::const_iterator it = input.mapWeights.find(sCPID);
+    return it == input.mapWeights.end() ? CDCCResearcherWeights() : it->second;
+}
+
+/** Phase 1 and 2 for one record: add the weights, then take it apart as the filtered file was read back */
+static void AssessRecord(const CDCCContractInput& input, const CDCCResearcherFilter::Record& record, double dTeamRequired,
+    const std::string& sConcatCPIDs, CDCCUserRecord& user)
+{
+    const CDCCContractParams& params = input.params;
+    CDCCResearcherWeights weights = GetWeights(input, record.sCPID);
+    std::string sExtra = "<utxoweight>" + RoundToString(weights.dUTXOWeight, 0)
+        + "</utxoweight>\r\n<taskweight>"
+        + RoundToString(weights.dTaskWeight, 0) + "</taskweight><unbanked>" + RoundToString(weights.dUnbanked, 0) + "</unbanked>\r\n";
+    std::string sData = FilterBoincData(record.sBuffer, "<user>", "</user>", sExtra);
+    if (sData.empty()) return;
+    // The file was read back a line at a time, which drops the line feeds
+    std::string sUser;
+    sUser.reserve(sData.size());
+    for (size_t i = 0; i < sData.size(); i++)
+        if (sData[i] != '\n') sUser += sData[i];
+
+    static const XMLTagList vUserTags = GetXMLTagList("cpid,expavg_credit,teamid");
+    std::vector<std::string> vUser = ExtractXMLFields(sUser, vUserTags);
+    user.sCPID = vUser[0];
+    boost::to_upper(user.sCPID);
+    user.dAvgCredit = cdbl(vUser[1], 4);
+    user.dTeam = cdbl(vUser[2], 0);
+
+    static const XMLTagList vRowTags = GetXMLTagList("teamid,utxoweight,taskweight,unbanked,cpid,expavg_credit");
+    std::vector<std::string> vRows = Split(sUser, "<user>");
+    for (int i = 0; i < (int)vRows.size(); i++) {
+        std::vector<std::string> vRow = ExtractXMLFields(vRows[i], vRowTags);
+        double dTeam = cdbl(vRow[0], 0);
+        double dUTXOWeight = cdbl(vRow[1], 0);
+        double dTaskWeight = cdbl(vRow[2], 0);
+        double dUnbanked = cdbl(vRow[3], 0);
+        std::string sCPID = vRow[4];
+        boost::to_upper(sCPID);
+        if (!Contains(sConcatCPIDs, sCPID)) continue;
+        double dTeamPercentage = GetTeamPercentage(dTeam, dTeamRequired, params.sTeamBlacklist, params.dNonBiblepayTeamPercentage);
+        if (dTeamPercentage <= 0) continue;
+        double dAvgCredit = cdbl(vRow[5], 2);
+        user.vCredits.push_back(GetResearcherCredit(params.dDRMode, dAvgCredit, dUTXOWeight, dTaskWeight, dUnbanked, 0,
+            params.dReqSPM, params.dReqSPR, params.dRACThreshhold, dTeamPercentage));
+    }
+}
+
+static void AssessProjectRecord(const CDCCContractInput* pinput, const std::vector<CDCCResearcherFilter::Record>* pvRecords, double dTeamRequired,
+    const std::string* psConcatCPIDs, std::vector<CDCCUserRecord>* pvUsers, size_t i)
+{
+    AssessRecord(*pinput, (*pvRecords)[i], dTeamRequired, *psConcatCPIDs, (*pvUsers)[i]);
+}
+
+/** Phase 3 for one researcher in one project: the records with their CPID, in export order */
+static CDCCProjectCredit GetProjectCredit(const CDCCContractInput& input, const std::vector<CDCCUserRecord>& vUsers,
+    const std::map<std::string, std::vector<size_t> >& mapRecords, const std::string& sCPID, const CDCCResearcherWeights& weights,
+    double dTeamRequired, double dProjectFactor)
+{
+    const CDCCContractParams& params = input.params;
+    CDCCProjectCredit credit;
+    std::string sUpper = sCPID;
+    boost::to_upper(sUpper);
+    std::map<std::string, std::vector<size_t> >::const_iterator it = mapRecords.find(sUpper);
+    if (it == mapRecords.end()) return credit;
+    for (size_t j = 0; j < it->second.size(); j++) {
+        const CDCCUserRecord& user = vUsers[it->second[j]];
+        credit.fFound = true;
+        credit.dTeam = user.dTeam;
+        double dPercent = GetTeamPercentage(user.dTeam, dTeamRequired, params.sTeamBlacklist, params.dNonBiblepayTeamPercentage);
+        // DR mode 3, so that the UTXO level is applied once to the total of both projects below
+        credit.dRAC += GetResearcherCredit(3, user.dAvgCredit, weights.dUTXOWeight, weights.dTaskWeight, weights.dUnbanked, 0,
+            params.dReqSPM, params.dReqSPR, params.dRACThreshhold, dPercent) * dProjectFactor;
+    }
+    return credit;
+}
+
+static void AssessResearcher(const CDCCContractInput* pinput, const std::vector<CDCCUserRecord>* pvUsers1, const std::map<std::string, std::vector<size_t> >* pmapRecords1,
+    const std::vector<CDCCUserRecord>* pvUsers2, const std::map<std::string, std::vector<size_t> >* pmapRecords2,
+    std::vector<CDCCProjectCredit>* pvCredits1, std::vector<CDCCProjectCredit>* pvCredits2, size_t i)
+{
+    const CDCCContractParams& params = pinput->params;
+    const std::string& sCPID = pinput->vResearchers[i].sCPID;
+    CDCCResearcherWeights weights = GetWeights(*pinput, sCPID);
+    if (params.dTeamBackupProject > 0)
+        (*pvCredits2)[i] = GetProjectCredit(*pinput, *pvUsers2, *pmapRecords2, sCPID, weights, params.dTeamBackupProject, params.dBackupProjectFactor);
+    (*pvCredits1)[i] = GetProjectCredit(*pinput, *pvUsers1, *pmapRecords1, sCPID, weights, params.dTeamRequired, 1.0);
+}
+
+static double SumProjectRAC(const std::vector<CDCCUserRecord>& vUsers)
+{
+    double dTotal = 0;
+    for (size_t i = 0; i < vUsers.size(); i++)
+        for (size_t j = 0; j < vUsers[i].vCredits.size(); j++)
+            dTotal += vUsers[i].vCredits[j];
+    return dTotal;
+}
+
+static void IndexRecords(const std::vector<CDCCUserRecord>& vUsers, std::map<std::string, std::vector<size_t> >& mapRecords)
+{
+    for (size_t i = 0; i < vUsers.size(); i++)
+        if (!vUsers[i].sCPID.empty()) mapRecords[vUsers[i].sCPID].push_back(i);
+}
+
+bool ComputeDCCContract(const CDCCContractInput& input, CDCCContract& contract, int nThreads)
+{
+    int64_t nStart = GetTimeMillis();
+    const CDCCContractParams& params = input.params;
+    contract = CDCCContract();
+    if (nThreads < 1) nThreads = 1;
+
+    std::string sConcatCPIDs;
+    for (size_t i = 0; i < input.vEligibleCPIDs.size(); i++)
+        if (!input.vEligibleCPIDs[i].empty()) sConcatCPIDs += input.vEligibleCPIDs[i] + ",";
+    boost::to_upper(sConcatCPIDs);
+
+    // Phase 1 and 2: weigh every record and add up each project's RAC
+    std::vector<CDCCUserRecord> vUsers1(input.vProject1.size());
+    std::vector<CDCCUserRecord> vUsers2(input.vProject2.size());
+    ParallelFor(vUsers1.size(), nThreads, boost::bind(&AssessProjectRecord, &input, &input.vProject1, params.dTeamRequired, &sConcatCPIDs, &vUsers1, _1));
+    ParallelFor(vUsers2.size(), nThreads, boost::bind(&AssessProjectRecord, &input, &input.vProject2, params.dTeamBackupProject, &sConcatCPIDs, &vUsers2, _1));
+    contract.dProject1RAC = SumProjectRAC(vUsers1);
+    contract.dProject2RAC = SumProjectRAC(vUsers2);
+    contract.dTotalRAC = contract.dProject1RAC + contract.dProject2RAC;
+    if (contract.dTotalRAC < 10) {
+        contract.sError = "Total DC credit less than the project minimum.  Unable to calculate magnitudes.";
+        contract.nElapsedMillis = GetTimeMillis() - nStart;
+        return false;
+    }
+    double dTotalRAC = contract.dTotalRAC + 100; // Ensure magnitude never exceeds 1000 due to rounding errors.
+    contract.dTotalRAC = dTotalRAC;
+
+    // Phase 3: each researcher's RAC in both projects
+    std::map<std::string, std::vector<size_t> > mapRecords1;
+    std::map<std::string, std::vector<size_t> > mapRecords2;
+    IndexRecords(vUsers1, mapRecords1);
+    IndexRecords(vUsers2, mapRecords2);
+    std::vector<CDCCProjectCredit> vCredits1(input.vResearchers.size());
+    std::vector<CDCCProjectCredit> vCredits2(input.vResearchers.size());
+    ParallelFor(input.vResearchers.size(), nThreads, boost::bind(&AssessResearcher, &input, &vUsers1, &mapRecords1, &vUsers2, &mapRecords2, &vCredits1, &vCredits2, _1));
+
+    // A researcher without records is listed with the team of the researcher before them
+    std::vector<double> vRAHTeam(input.vResearchers.size());
+    std::vector<double> vWCGTeam(input.vResearchers.size());
+    double dRAHTeam = 0;
+    double dWCGTeam = 0;
+    for (size_t i = 0; i < input.vResearchers.size(); i++) {
+        if (vCredits1[i].fFound) dRAHTeam = vCredits1[i].dTeam;
+        if (vCredits2[i].fFound) dWCGTeam = vCredits2[i].dTeam;
+        vRAHTeam[i] = dRAHTeam;
+        vWCGTeam[i] = dWCGTeam;
+    }
+
+    // Leaderboard format: Biblepay-Public-Key-Compressed, DCC-CPID, DCC-Magnitude <rowdelimiter>
+    // Should the magnitudes add up to 1000 or more due to rounding errors, all of them are lowered by 2% and the contract is assembled again
+    double dGlobalMagnitudeFactor = 1;
+    while (true) {
+        contract.nTries++;
+        if (contract.nTries > DCC_CONTRACT_MAX_TRIES) {
+            contract.nTries = DCC_CONTRACT_MAX_TRIES;
+            break;
+        }
+        contract.sContract = "";
+        contract.dTotalMagnitude = 0;
+        contract.nRows = 0;
+        double dTotalRosetta = 0;
+        double dTotalWCG = 0;
+        for (size_t i = 0; i < input.vResearchers.size(); i++) {
+            const CDCCContractResearcher& researcher = input.vResearchers[i];
+            if (researcher.sCPID.empty()) continue;
+            CDCCResearcherWeights weights = GetWeights(input, researcher.sCPID);
+            double dRosettaRAC = vCredits1[i].dRAC;
+            double dWCGRAC = vCredits2[i].dRAC;
+            dTotalRosetta += dRosettaRAC;
+            dTotalWCG += dWCGRAC;
+            double dModifiedCredit = GetResearcherCredit(params.dDRMode, dRosettaRAC + dWCGRAC, weights.dUTXOWeight, weights.dTaskWeight, weights.dUnbanked, dTotalRAC,
+                params.dReqSPM, params.dReqSPR, params.dRACThreshhold, 1);
+            // Researchers with adjusted credit, or with RAC but no UTXO weight (so they can diagnose it in the superblock view), are listed
+            if ((dModifiedCredit > 0 || (dRosettaRAC + dWCGRAC > 9)) && !researcher.sPublicKey.empty()) {
+                double dMagnitude = (dModifiedCredit / dTotalRAC) * 999 * dGlobalMagnitudeFactor;
+                double dUTXO = GetUTXOLevel(weights.dUTXOWeight, dTotalRAC, dRosettaRAC + dWCGRAC, params.dReqSPM, params.dReqSPR, params.dRACThreshhold);
+                contract.sContract += researcher.sPublicKey + "," + researcher.sCPID + "," + RoundToString(dMagnitude, 3) + ","
+                    + RoundToString(researcher.dRosettaID, 0) + "," + RoundToString(vRAHTeam[i], 0)
+                    + "," + RoundToString(weights.dUTXOWeight, 0) + "," + RoundToString(weights.dTaskWeight, 0)
+                    + "," + RoundToString(dTotalRAC, 0) + ","
+                    + RoundToString(weights.dUnbanked, 0) + "," + RoundToString(dUTXO, 2) + "," + RoundToString(dRosettaRAC, 0) + ","
+                    + RoundToString(dModifiedCredit, 0) + "," + RoundToString(params.nHeight, 0) + ","
+                    + RoundToString(dWCGRAC, 0) + "," + RoundToString(vWCGTeam[i], 0) + "\n<ROW>";
+                contract.dTotalMagnitude += dMagnitude;
+                contract.nRows++;
+            } else if (contract.nTries == 1) {
+                LogPrint("podc", "ComputeDCCContract -- not included: CPID %s, RosettaRAC %f, WCGRAC %f, UTXO Weight %f, Task Weight %f, Public Key %s\n",
+                    researcher.sCPID, dRosettaRAC, dWCGRAC, weights.dUTXOWeight, weights.dTaskWeight, researcher.sPublicKey);
+            }
+        }
+        if (contract.dTotalMagnitude < 1000) break;
+        dGlobalMagnitudeFactor -= .02;
+        LogPrint("podc", "ComputeDCCContract -- attempt %d, magnitude factor %f, total magnitude %f, total Rosetta %f, total WCG %f\n",
+            contract.nTries, dGlobalMagnitudeFactor, contract.dTotalMagnitude, dTotalRosetta, dTotalWCG);
+    }
+    contract.dGlobalMagnitudeFactor = dGlobalMagnitudeFactor;
+    contract.nElapsedMillis = GetTimeMillis() - nStart;
+    LogPrint("podc", "ComputeDCCContract -- %d researchers, %d + %d records, %d threads, %dms\n",
+        input.vResearchers.size(), input.vProject1.size(), input.vProject2.size(), nThreads, contract.nElapsedMillis);
+    return true;
+}
+
+bool WriteDCCContractInput(const std::string& sPath, const CDCCContractInput& input)
+{
+    CAutoFile fileout(fopen(sPath.c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull()) return false;
+    try {
+        fileout << DCC_CONTRACT_INPUT_VERSION;
+        fileout << input;
+    } catch (const std::exception& e) {
+        LogPrintf("WriteDCCContractInput -- %s: %s\n", sPath, e.what());
+        return false;
+    }
+    return true;
+}
+
+bool ReadDCCContractInput(const std::string& sPath, CDCCContractInput& input, std::string& sError)
+{
+    CAutoFile filein(fopen(sPath.c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        sError = "Unable to open " + sPath;
+        return false;
+    }
+    try {
+        int nVersion = 0;
+        filein >> nVersion;
+        if (nVersion != DCC_CONTRACT_INPUT_VERSION) {
+            sError = strprintf("Unsupported DCC input version %d", nVersion);
+            return false;
+        }
+        filein >> input;
+    } catch (const std::exception& e) {
+        sError = std::string("DCC input file is corrupt: ") + e.what();
+        return false;
+    }
+    return true;
+}
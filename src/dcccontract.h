@@ -0,0 +1,155 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DCCCONTRACT_H
+#define DCCCONTRACT_H
+
+#include "dccstream.h"
+#include "serialize.h"
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Version of the captured input file written by the sanctuary quorum */
+static const int DCC_CONTRACT_INPUT_VERSION = 1;
+/** Attempts at a contract below 1000 total magnitude, lowering every magnitude by 2% each time */
+static const int DCC_CONTRACT_MAX_TRIES = 70;
+
+/** The spork settings of one contract run */
+struct CDCCContractParams
+{
+    int nHeight;
+    double dDRMode;
+    double dReqSPM;
+    double dReqSPR;
+    double dRACThreshhold;
+    double dTeamRequired;
+    double dTeamBackupProject;
+    double dBackupProjectFactor;
+    double dNonBiblepayTeamPercentage;
+    std::string sTeamBlacklist;
+
+    CDCCContractParams() : nHeight(0), dDRMode(0), dReqSPM(0), dReqSPR(0), dRACThreshhold(0), dTeamRequired(0),
+        dTeamBackupProject(0), dBackupProjectFactor(0), dNonBiblepayTeamPercentage(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(nHeight);
+        READWRITE(dDRMode);
+        READWRITE(dReqSPM);
+        READWRITE(dReqSPR);
+        READWRITE(dRACThreshhold);
+        READWRITE(dTeamRequired);
+        READWRITE(dTeamBackupProject);
+        READWRITE(dBackupProjectFactor);
+        READWRITE(dNonBiblepayTeamPercentage);
+        READWRITE(sTeamBlacklist);
+    }
+};
+
+/** The mature UTXO and task weights and the unbanked flag of a CPID */
+struct CDCCResearcherWeights
+{
+    double dUTXOWeight;
+    double dTaskWeight;
+    double dUnbanked;
+
+    CDCCResearcherWeights() : dUTXOWeight(0), dTaskWeight(0), dUnbanked(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(dUTXOWeight);
+        READWRITE(dTaskWeight);
+        READWRITE(dUnbanked);
+    }
+};
+
+/** A DCC whose signature checked out (or that need not be signed because it is unbanked) */
+struct CDCCContractResearcher
+{
+    std::string sCPID;
+    std::string sPublicKey;
+    double dRosettaID;
+
+    CDCCContractResearcher() : dRosettaID(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(sCPID);
+        READWRITE(sPublicKey);
+        READWRITE(dRosettaID);
+    }
+};
+
+/**
+ * Everything the daily magnitude contract is computed from.  The quorum
+ * gathers it from the caches and the project exports; nothing else is read
+ * while the contract is computed, so a captured input replays to the same
+ * contract anywhere.
+ */
+struct CDCCContractInput
+{
+    CDCCContractParams params;
+    /** The DCCs in GetListOfDCCS order; each one is a row candidate */
+    std::vector<CDCCContractResearcher> vResearchers;
+    /** CPIDs whose credit counts towards the total RAC, in GetListOfDCCS order */
+    std::vector<std::string> vEligibleCPIDs;
+    /** Weights by upper cased CPID */
+    std::map<std::string, CDCCResearcherWeights> mapWeights;
+    /** The BiblePay researcher records kept from each project export */
+    std::vector<CDCCResearcherFilter::Record> vProject1;
+    std::vector<CDCCResearcherFilter::Record> vProject2;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(params);
+        READWRITE(vResearchers);
+        READWRITE(vEligibleCPIDs);
+        READWRITE(mapWeights);
+        READWRITE(vProject1);
+        READWRITE(vProject2);
+    }
+};
+
+struct CDCCContract
+{
+    std::string sContract;
+    int nRows;
+    double dTotalMagnitude;
+    double dProject1RAC;
+    double dProject2RAC;
+    /** The RAC magnitudes are relative to (both projects plus 100) */
+    double dTotalRAC;
+    double dGlobalMagnitudeFactor;
+    int nTries;
+    int64_t nElapsedMillis;
+    std::string sError;
+
+    CDCCContract() : nRows(0), dTotalMagnitude(0), dProject1RAC(0), dProject2RAC(0), dTotalRAC(0),
+        dGlobalMagnitudeFactor(1), nTries(0), nElapsedMillis(0) {}
+};
+
+/**
+ * Compute the daily magnitude contract.  The researcher records and CPIDs
+ * are assessed on nThreads threads; every total is then added up in export
+ * and DCC order, so the contract is byte for byte the same whatever the
+ * thread count or timing.
+ */
+bool ComputeDCCContract(const CDCCContractInput& input, CDCCContract& contract, int nThreads);
+
+/** Save the input of a contract run so that it can be replayed */
+bool WriteDCCContractInput(const std::string& sPath, const CDCCContractInput& input);
+bool ReadDCCContractInput(const std::string& sPath, CDCCContractInput& input, std::string& sError);
+
+#endif // DCCCONTRACT_H
@@ -0,0 +1,202 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "dccregistry.h"
+
+#include "podc.h"
+#include "util.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <boost/algorithm/string/case_conv.hpp>
+
+bool CheckStakeSignature(std::string sBitcoinAddress, std::string sSignature, std::string strMessage, std::string& strError);
+
+// A DCC has at least CPID;HexCode;PubKey;ResearcherID;Sig
+static const size_t DCC_MIN_ELEMENTS = 5;
+
+std::string CDCCRegistry::Entry::GetElement(int iElement, bool fRequireSig) const
+{
+    if (vElements.size() < DCC_MIN_ELEMENTS || vElements.size() < (size_t)(iElement + 1)) return "";
+    if (fRequireSig && !fSigned) return "";
+    return vElements[iElement];
+}
+
+static double CastElement(const std::vector<std::string>& vElements, size_t nElement)
+{
+    if (vElements.size() <= nElement) return 0;
+    try
+    {
+        return cdbl(vElements[nElement], 0);
+    }
+    catch(...)
+    {
+        // cdbl keeps digits, '.' and '-' only; a value such as "1.2.3" cannot be cast
+        return 0;
+    }
+}
+
+void CDCCRegistry::Memorize(const std::string& sKey, const std::string& sValue, int64_t nTime)
+{
+    if (sValue.empty())
+    {
+        Forget(sKey);
+        return;
+    }
+    {
+        LOCK(cs);
+        std::map<std::string, Entry>::iterator it = mapEntries.find(sKey);
+        // Re-memorizing the same message (the chain replay does this) keeps the checked signature
+        if (it != mapEntries.end() && it->second.sValue == sValue)
+        {
+            it->second.nTime = nTime;
+            return;
+        }
+    }
+    Entry entry;
+    entry.sKey = sKey;
+    entry.sValue = sValue;
+    entry.vElements = Split(sValue.c_str(), ";");
+    entry.nTime = nTime;
+    if (entry.vElements.size() >= DCC_MIN_ELEMENTS)
+    {
+        const std::vector<std::string>& v = entry.vElements;
+        entry.dRosettaID = CastElement(v, 3);
+        entry.dUnbanked = CastElement(v, 5);
+        std::string sMessage = v[0] + ";" + v[1] + ";" + v[2] + ";" + v[3];
+        std::string sError;
+        entry.fSigned = CheckStakeSignature(v[2], v[4], sMessage, sError);
+    }
+
+    LOCK(cs);
+    std::map<std::string, Entry>::iterator it = mapEntries.find(sKey);
+    if (it != mapEntries.end()) Unindex(it->second);
+    mapEntries[sKey] = entry;
+    if (entry.vElements.size() < DCC_MIN_ELEMENTS) return;
+    std::string sCPID = entry.vElements[0];
+    std::string sAddress = entry.vElements[2];
+    boost::to_upper(sCPID);
+    boost::to_upper(sAddress);
+    if (!sCPID.empty())
+    {
+        mapByCPID[sCPID].insert(sKey);
+        mapByRosettaID[entry.dRosettaID].insert(sKey);
+    }
+    if (!sAddress.empty()) mapByAddress[sAddress].insert(sKey);
+}
+
+void CDCCRegistry::Forget(const std::string& sKey)
+{
+    LOCK(cs);
+    std::map<std::string, Entry>::iterator it = mapEntries.find(sKey);
+    if (it == mapEntries.end()) return;
+    Unindex(it->second);
+    mapEntries.erase(it);
+}
+
+template <typename K>
+static void RemoveFromIndex(boost::unordered_map<K, std::set<std::string> >& mapIndex, const K& key, const std::string& sKey)
+{
+    typename boost::unordered_map<K, std::set<std::string> >::iterator it = mapIndex.find(key);
+    if (it == mapIndex.end()) return;
+    it->second.erase(sKey);
+    if (it->second.empty()) mapIndex.erase(it);
+}
+
+void CDCCRegistry::Unindex(const Entry& entry)
+{
+    if (entry.vElements.size() < DCC_MIN_ELEMENTS) return;
+    std::string sCPID = entry.vElements[0];
+    std::string sAddress = entry.vElements[2];
+    boost::to_upper(sCPID);
+    boost::to_upper(sAddress);
+    if (!sCPID.empty())
+    {
+        RemoveFromIndex(mapByCPID, sCPID, entry.sKey);
+        RemoveFromIndex(mapByRosettaID, entry.dRosettaID, entry.sKey);
+    }
+    if (!sAddress.empty()) RemoveFromIndex(mapByAddress, sAddress, entry.sKey);
+}
+
+void CDCCRegistry::CollectEntries(const KeySet& setKeys, bool fRequireSig, std::vector<Entry>& vEntries) const
+{
+    for (KeySet::const_iterator it = setKeys.begin(); it != setKeys.end(); ++it)
+    {
+        std::map<std::string, Entry>::const_iterator itEntry = mapEntries.find(*it);
+        if (itEntry == mapEntries.end()) continue;
+        if (fRequireSig && !itEntry->second.fSigned) continue;
+        vEntries.push_back(itEntry->second);
+    }
+}
+
+std::vector<CDCCRegistry::Entry> CDCCRegistry::GetList(bool fRequireSig) const
+{
+    std::vector<Entry> vEntries;
+    LOCK(cs);
+    for (std::map<std::string, Entry>::const_iterator it = mapEntries.begin(); it != mapEntries.end(); ++it)
+    {
+        if (!it->second.GetCPID(fRequireSig).empty()) vEntries.push_back(it->second);
+    }
+    return vEntries;
+}
+
+std::vector<CDCCRegistry::Entry> CDCCRegistry::Find(const std::string& sSearch, bool fRequireSig) const
+{
+    if (sSearch.empty()) return GetList(fRequireSig);
+    std::string sUpper = sSearch;
+    boost::to_upper(sUpper);
+    std::vector<Entry> vEntries;
+    LOCK(cs);
+    boost::unordered_map<std::string, KeySet>::const_iterator itCPID = mapByCPID.find(sUpper);
+    boost::unordered_map<std::string, KeySet>::const_iterator itAddress = mapByAddress.find(sUpper);
+    if (itCPID != mapByCPID.end() && itAddress != mapByAddress.end())
+    {
+        KeySet setKeys;
+        std::set_union(itCPID->second.begin(), itCPID->second.end(), itAddress->second.begin(), itAddress->second.end(),
+            std::inserter(setKeys, setKeys.end()));
+        CollectEntries(setKeys, fRequireSig, vEntries);
+    }
+    else if (itCPID != mapByCPID.end())
+    {
+        CollectEntries(itCPID->second, fRequireSig, vEntries);
+    }
+    else if (itAddress != mapByAddress.end())
+    {
+        CollectEntries(itAddress->second, fRequireSig, vEntries);
+    }
+    return vEntries;
+}
+
+bool CDCCRegistry::GetByKey(const std::string& sKey, Entry& entry) const
+{
+    LOCK(cs);
+    std::map<std::string, Entry>::const_iterator it = mapEntries.find(sKey);
+    if (it == mapEntries.end()) return false;
+    entry = it->second;
+    return true;
+}
+
+bool CDCCRegistry::GetByRosettaID(double dRosettaID, Entry& entry) const
+{
+    LOCK(cs);
+    boost::unordered_map<double, KeySet>::const_iterator it = mapByRosettaID.find(dRosettaID);
+    if (it == mapByRosettaID.end() || it->second.empty()) return false;
+    std::map<std::string, Entry>::const_iterator itEntry = mapEntries.find(*it->second.begin());
+    if (itEntry == mapEntries.end()) return false;
+    entry = itEntry->second;
+    return true;
+}
+
+size_t CDCCRegistry::Size() const
+{
+    LOCK(cs);
+    return mapEntries.size();
+}
+
+CDCCRegistry& GetDCCRegistry()
+{
+    static CDCCRegistry dccRegistry;
+    return dccRegistry;
+}
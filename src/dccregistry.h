@@ -0,0 +1,80 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DCCREGISTRY_H
+#define DCCREGISTRY_H
+
+#include "sync.h"
+
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+/**
+ * Parsed view of the DCC messages (CPID associations) memorized from the chain.
+ *
+ * The application cache stores each association as a raw string under
+ * "DCC;<CPID>": CPID;HexCode;PubKey;ResearcherID;Sig(base64)[;Unbanked].
+ * Looking a researcher up used to concatenate and re-split every DCC and
+ * check its signature on each call.  Here a DCC is split and its signature
+ * checked once, when it is memorized, and the entries are indexed by CPID,
+ * address and Rosetta ID.  Lists are returned in cache key order, the order
+ * the application cache was walked in before.
+ */
+class CDCCRegistry
+{
+public:
+    struct Entry
+    {
+        std::string sKey;                    // the cache key without the "DCC;" section
+        std::string sValue;                  // the DCC exactly as memorized
+        std::vector<std::string> vElements;  // sValue split on ';'
+        double dRosettaID;                   // element 3
+        double dUnbanked;                    // element 5, 1 for an unbanked researcher
+        bool fSigned;                        // the signature in element 4 checks out
+        int64_t nTime;
+
+        Entry() : dRosettaID(0), dUnbanked(0), fSigned(false), nTime(0) {}
+
+        /** Same result as GetDCCElement(sValue, iElement, fRequireSig) */
+        std::string GetElement(int iElement, bool fRequireSig) const;
+        std::string GetCPID(bool fRequireSig) const { return GetElement(0, fRequireSig); }
+        std::string GetAddress(bool fRequireSig) const { return GetElement(2, fRequireSig); }
+    };
+
+    /** Store a memorized DCC; an empty value forgets it */
+    void Memorize(const std::string& sKey, const std::string& sValue, int64_t nTime);
+    void Forget(const std::string& sKey);
+
+    /** Every DCC with a CPID (a signed one if fRequireSig), in key order */
+    std::vector<Entry> GetList(bool fRequireSig) const;
+    /** The DCCs whose upper cased CPID or address is sSearch (upper cased), in key order */
+    std::vector<Entry> Find(const std::string& sSearch, bool fRequireSig) const;
+    /** The DCC memorized under a key (the CPID it was sent for) */
+    bool GetByKey(const std::string& sKey, Entry& entry) const;
+    /** The first DCC in key order that carries this Rosetta ID */
+    bool GetByRosettaID(double dRosettaID, Entry& entry) const;
+    size_t Size() const;
+
+private:
+    typedef std::set<std::string> KeySet;
+
+    mutable CCriticalSection cs;
+    std::map<std::string, Entry> mapEntries;
+    boost::unordered_map<std::string, KeySet> mapByCPID;
+    boost::unordered_map<std::string, KeySet> mapByAddress;
+    boost::unordered_map<double, KeySet> mapByRosettaID;
+
+    void Unindex(const Entry& entry);
+    /** Append the entries named in setKeys to vEntries, signed ones only if fRequireSig */
+    void CollectEntries(const KeySet& setKeys, bool fRequireSig, std::vector<Entry>& vEntries) const;
+};
+
+CDCCRegistry& GetDCCRegistry();
+
+#endif // DCCREGISTRY_H
@@ -0,0 +1,299 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "dccstream.h"
+
+#include "clientversion.h"
+#include "httpclient.h"
+#include "podc.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+
+#include <string.h>
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/thread.hpp>
+
+#include <zlib.h>
+
+static const size_t DCC_INFLATE_CHUNK = 256 * 1024;
+static const int MAX_DCC_REDIRECTS = 5;
+
+CGzipLineReader::CGzipLineReader(const std::vector<CDCCLineSink*>& vSinksIn) :
+    vSinks(vSinksIn), pstream(new z_stream), vOut(DCC_INFLATE_CHUNK), fMemberEnd(false), fTrailing(false),
+    nCompressedBytes(0), nInflatedBytes(0), nLines(0)
+{
+    memset(pstream, 0, sizeof(z_stream));
+    // 16 + MAX_WBITS: expect a gzip header and trailer rather than a raw zlib stream
+    if (inflateInit2(pstream, 16 + MAX_WBITS) != Z_OK)
+        sError = "inflateInit2 failed";
+}
+
+CGzipLineReader::~CGzipLineReader()
+{
+    inflateEnd(pstream);
+    delete pstream;
+}
+
+void CGzipLineReader::SplitLines(const char* pch, size_t nSize)
+{
+    const char* pend = pch + nSize;
+    while (pch < pend) {
+        const char* pnl = (const char*)memchr(pch, '\n', pend - pch);
+        if (pnl == NULL) {
+            sPartial.append(pch, pend - pch);
+            if (sPartial.size() > MAX_DCC_LINE_LENGTH)
+                sError = "line exceeds " + RoundToString(MAX_DCC_LINE_LENGTH, 0) + " bytes";
+            return;
+        }
+        if (sPartial.empty()) {
+            sLine.assign(pch, pnl - pch);
+        } else {
+            sPartial.append(pch, pnl - pch);
+            sLine.swap(sPartial);
+            sPartial.clear();
+        }
+        nLines++;
+        BOOST_FOREACH(CDCCLineSink* psink, vSinks)
+            psink->ProcessLine(sLine);
+        pch = pnl + 1;
+    }
+}
+
+bool CGzipLineReader::Write(const char* pch, size_t nSize)
+{
+    if (!sError.empty()) return false;
+    nCompressedBytes += nSize;
+    if (fTrailing) return true;
+
+    pstream->next_in = (Bytef*)pch;
+    pstream->avail_in = nSize;
+    while (pstream->avail_in > 0) {
+        if (fMemberEnd) {
+            // gzip allows several members back to back; gunzip ignores anything else after the first one
+            if (pstream->next_in[0] != 0x1f) {
+                fTrailing = true;
+                return true;
+            }
+            if (inflateReset(pstream) != Z_OK) {
+                sError = "inflateReset failed";
+                return false;
+            }
+            fMemberEnd = false;
+        }
+        pstream->next_out = (Bytef*)&vOut[0];
+        pstream->avail_out = vOut.size();
+        int ret = inflate(pstream, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END) {
+            sError = strprintf("inflate failed (%d): %s", ret, pstream->msg ? pstream->msg : "no more progress");
+            return false;
+        }
+        size_t nHave = vOut.size() - pstream->avail_out;
+        nInflatedBytes += nHave;
+        SplitLines(&vOut[0], nHave);
+        if (!sError.empty()) return false;
+        if (ret == Z_STREAM_END) fMemberEnd = true;
+    }
+    return true;
+}
+
+bool CGzipLineReader::Finish()
+{
+    if (!sError.empty()) return false;
+    if (!fMemberEnd) {
+        sError = nCompressedBytes == 0 ? "empty stream" : "truncated gzip stream";
+        return false;
+    }
+    if (!sPartial.empty()) {
+        nLines++;
+        BOOST_FOREACH(CDCCLineSink* psink, vSinks)
+            psink->ProcessLine(sPartial);
+        sPartial.clear();
+    }
+    BOOST_FOREACH(CDCCLineSink* psink, vSinks)
+        psink->Finish();
+    return true;
+}
+
+CDCCResearcherFilter::CDCCResearcherFilter(const std::set<std::string>& setCPIDsIn) : setCPIDs(setCPIDsIn), nPendingLines(0)
+{
+}
+
+void CDCCResearcherFilter::ProcessLine(const std::string& sLine)
+{
+    sBuffer.append(sLine).append("<ROW>");
+    if (nPendingLines > 0) {
+        // The url and team lines follow the cpid
+        if (--nPendingLines == 0) Finish();
+        return;
+    }
+    if (sLine.find("<cpid>") == std::string::npos) return;
+    std::string sCpid = ExtractXML(sLine, "<cpid>", "</cpid>");
+    if (sCpid.empty()) return;
+    boost::to_upper(sCpid);
+    if (setCPIDs.count(sCpid)) {
+        sPendingCPID = sCpid;
+        nPendingLines = 2;
+    } else {
+        sBuffer.clear();
+    }
+}
+
+void CDCCResearcherFilter::Finish()
+{
+    if (sPendingCPID.empty()) return;
+    Record record;
+    record.sCPID = sPendingCPID;
+    record.sBuffer.swap(sBuffer);
+    vRecords.push_back(record);
+    sPendingCPID.clear();
+    sBuffer.clear();
+    nPendingLines = 0;
+}
+
+CDCCTeamFilter::CDCCTeamFilter(const std::string& sTargetPathIn, double dTargetTeamIn) :
+    nRows(0), sTargetPath(sTargetPathIn), sTempPath(sTargetPathIn + ".new"), dTargetTeam(dTargetTeamIn)
+{
+    outFile = fopen(sTempPath.c_str(), "w");
+}
+
+CDCCTeamFilter::~CDCCTeamFilter()
+{
+    if (outFile) {
+        // Not committed, the download failed
+        fclose(outFile);
+        remove(sTempPath.c_str());
+    }
+}
+
+bool CDCCTeamFilter::Commit()
+{
+    if (!outFile) return false;
+    bool fWritten = fclose(outFile) == 0;
+    outFile = NULL;
+    if (!fWritten || !RenameOver(sTempPath, sTargetPath)) {
+        LogPrintf("CDCCTeamFilter::Commit -- unable to write %s\n", sTargetPath);
+        remove(sTempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void CDCCTeamFilter::ProcessLine(const std::string& sLine)
+{
+    sBuffer += sLine;
+    if (sLine.find("</user>") == std::string::npos) return;
+
+    static const XMLTagList vTags = GetXMLTagList("cpid,teamid,expavg_credit,total_credit,create_time,name");
+    std::vector<std::string> vFields = ExtractXMLFields(sBuffer, vTags);
+    std::string sCpid = vFields[0];
+    double dTeamID = cdbl(vFields[1], 0);
+    if (dTeamID == dTargetTeam && outFile) {
+        double dRac = cdbl(vFields[2], 0);
+        double dTotalRAC = cdbl(vFields[3], 0);
+        double dCreated = cdbl(vFields[4], 0);
+        std::string sName = vFields[5];
+        std::string sRow = sCpid + "," + RoundToString(dTeamID, 0) + "," + RoundToString(dRac, 0) + "," + RoundToString(dTotalRAC, 0)
+            + "," + RoundToString(dCreated, 0) + "," + sName + "\r\n";
+        fputs(sRow.c_str(), outFile);
+        nRows++;
+    }
+    sBuffer.clear();
+}
+
+CDCCProjectStream::CDCCProjectStream(const std::string& sURLIn, const std::set<std::string>& setCPIDs, const std::string& sTeamPath, double dTeam) :
+    sURL(sURLIn), researchers(setCPIDs), team(sTeamPath, dTeam), fSuccess(false), nCompressedBytes(0), nInflatedBytes(0), nElapsedMillis(0)
+{
+}
+
+static bool WriteToReader(CGzipLineReader* preader, const char* pch, size_t nSize)
+{
+    return preader->Write(pch, nSize);
+}
+
+bool StreamHTTPBody(const std::string& sURL, CGzipLineReader& reader, int64_t nTimeoutSecs, std::string& sError)
+{
+    int64_t nDeadline = GetSteadyTimeMillis() + nTimeoutSecs * 1000;
+    std::string sNextURL = sURL;
+    for (int i = 0; i <= MAX_DCC_REDIRECTS; i++) {
+        CHTTPClientRequest request;
+        if (!request.SetURL(sNextURL)) {
+            sError = "Invalid URL " + sNextURL;
+            return false;
+        }
+        request.mapHeaders["Agent"] = FormatFullVersion();
+        // One large download per project a day; not worth a pooled connection
+        request.fKeepAlive = false;
+        request.nTimeoutMillis = nDeadline - GetSteadyTimeMillis();
+        request.nStallTimeoutMillis = DCC_STALL_TIMEOUT * 1000;
+        request.fnBody = boost::bind(&WriteToReader, &reader, _1, _2);
+        CHTTPClientResponse response;
+        if (!GetHTTPClient().Request(request, response)) {
+            sError = reader.GetError().empty() ? response.sError + " after " + RoundToString(reader.GetCompressedBytes(), 0) + " bytes" : reader.GetError();
+            return false;
+        }
+        if (!reader.GetError().empty()) {
+            sError = reader.GetError();
+            return false;
+        }
+        std::string sLocation = response.GetHeader("location");
+        if (response.nStatus >= 300 && response.nStatus < 400 && !sLocation.empty()) {
+            if (sLocation[0] == '/') {
+                // Relative redirect, keep scheme and host
+                size_t nSlash = sNextURL.find('/', sNextURL.find("//") + 2);
+                sLocation = sNextURL.substr(0, nSlash) + sLocation;
+            }
+            LogPrint("dcc", "StreamHTTPBody -- %s redirected to %s\n", sNextURL, sLocation);
+            sNextURL = sLocation;
+            continue;
+        }
+        if (response.nStatus != 200) {
+            sError = "HTTP status " + RoundToString(response.nStatus, 0) + " from " + sNextURL;
+            return false;
+        }
+        return true;
+    }
+    sError = "Too many redirects for " + sURL;
+    return false;
+}
+
+static void StreamDCCProject(CDCCProjectStream* pproject, int64_t nTimeoutSecs)
+{
+    RenameThread("biblepay-dcc");
+    int64_t nStart = GetTimeMillis();
+    std::vector<CDCCLineSink*> vSinks;
+    vSinks.push_back(&pproject->researchers);
+    vSinks.push_back(&pproject->team);
+    CGzipLineReader reader(vSinks);
+    try
+    {
+        pproject->fSuccess = StreamHTTPBody(pproject->sURL, reader, nTimeoutSecs, pproject->sError) && reader.Finish();
+        if (pproject->sError.empty()) pproject->sError = reader.GetError();
+        if (pproject->fSuccess) pproject->team.Commit();
+    }
+    catch (const std::exception& e)
+    {
+        pproject->fSuccess = false;
+        pproject->sError = e.what();
+    }
+    pproject->nCompressedBytes = reader.GetCompressedBytes();
+    pproject->nInflatedBytes = reader.GetInflatedBytes();
+    pproject->nElapsedMillis = GetTimeMillis() - nStart;
+    LogPrintf("StreamDCCProject -- %s: %s, %d gzip bytes, %d bytes expanded, %d lines, %d researcher records, %d team rows, %dms %s\n",
+        pproject->sURL, pproject->fSuccess ? "ok" : "failed", pproject->nCompressedBytes, pproject->nInflatedBytes, reader.GetLines(),
+        pproject->researchers.vRecords.size(), pproject->team.nRows, pproject->nElapsedMillis, pproject->sError);
+}
+
+void StreamDCCProjects(const std::vector<CDCCProjectStream*>& vProjects, int64_t nTimeoutSecs)
+{
+    // Create the shared client here rather than racing in the download threads
+    GetHTTPClient();
+    boost::thread_group threadGroup;
+    BOOST_FOREACH(CDCCProjectStream* pproject, vProjects)
+        threadGroup.create_thread(boost::bind(&StreamDCCProject, pproject, nTimeoutSecs));
+    threadGroup.join_all();
+}
@@ -0,0 +1,164 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DCCSTREAM_H
+#define DCCSTREAM_H
+
+#include "serialize.h"
+
+#include <set>
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+struct z_stream_s;
+
+/** Give up on a project export if no data arrived for this many seconds */
+static const int DCC_STALL_TIMEOUT = 120;
+/** Give up on a project export that is still downloading after this many seconds */
+static const int64_t DCC_DOWNLOAD_TIMEOUT = 2 * 60 * 60;
+/** Longest line accepted from an export; anything longer means the stream is corrupt */
+static const size_t MAX_DCC_LINE_LENGTH = 1024 * 1024;
+
+/**
+ * Streaming pipeline for the daily DCC files (the BOINC project user exports).
+ *
+ * The exports are served as user.gz and expand to several GB of XML.  Rather
+ * than writing them to disk, gunzipping them and reading the expanded file
+ * back, the HTTP body is inflated as it arrives and every line is handed to
+ * the filters, which keep only the records the superblock contract needs.
+ */
+
+/** Receives the expanded export one line at a time, without the trailing '\n' */
+class CDCCLineSink
+{
+public:
+    virtual ~CDCCLineSink() {}
+    virtual void ProcessLine(const std::string& sLine) = 0;
+    /** Called once after the last line */
+    virtual void Finish() {}
+};
+
+/** Inflates a gzip stream (one or more members) and splits it into lines for a set of sinks */
+class CGzipLineReader : private boost::noncopyable
+{
+public:
+    explicit CGzipLineReader(const std::vector<CDCCLineSink*>& vSinksIn);
+    ~CGzipLineReader();
+
+    /** Inflate the next chunk of compressed input; false once the stream is corrupt */
+    bool Write(const char* pch, size_t nSize);
+    /** Flush the last line and finish the sinks; false if the gzip stream was truncated */
+    bool Finish();
+
+    const std::string& GetError() const { return sError; }
+    uint64_t GetCompressedBytes() const { return nCompressedBytes; }
+    uint64_t GetInflatedBytes() const { return nInflatedBytes; }
+    uint64_t GetLines() const { return nLines; }
+
+private:
+    void SplitLines(const char* pch, size_t nSize);
+
+    std::vector<CDCCLineSink*> vSinks;
+    struct z_stream_s* pstream;
+    std::vector<char> vOut;
+    std::string sPartial;
+    std::string sLine;
+    std::string sError;
+    bool fMemberEnd;
+    bool fTrailing;
+    uint64_t nCompressedBytes;
+    uint64_t nInflatedBytes;
+    uint64_t nLines;
+};
+
+/**
+ * Phase 1: keep the <user> records of BiblePay researchers.  A record is the
+ * text since the previous <cpid> line, the <cpid> line itself and the two
+ * lines after it (url and team), joined with <ROW> as FilterBoincData expects.
+ */
+class CDCCResearcherFilter : public CDCCLineSink
+{
+public:
+    struct Record
+    {
+        std::string sCPID;
+        std::string sBuffer;
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+            READWRITE(sCPID);
+            READWRITE(sBuffer);
+        }
+    };
+
+    /** setCPIDsIn holds the upper cased CPIDs of the BiblePay researchers */
+    explicit CDCCResearcherFilter(const std::set<std::string>& setCPIDsIn);
+
+    void ProcessLine(const std::string& sLine);
+    void Finish();
+
+    std::vector<Record> vRecords;
+
+private:
+    const std::set<std::string>& setCPIDs;
+    std::string sBuffer;
+    std::string sPendingCPID;
+    int nPendingLines;
+};
+
+/**
+ * Phase 2: write one CSV row per member of a team, used by the faucets.  The
+ * rows go to a temporary file that only replaces sTargetPath on Commit, so a
+ * failed download keeps the previous team file.
+ */
+class CDCCTeamFilter : public CDCCLineSink
+{
+public:
+    CDCCTeamFilter(const std::string& sTargetPathIn, double dTargetTeamIn);
+    ~CDCCTeamFilter();
+
+    void ProcessLine(const std::string& sLine);
+    /** Move the rows written so far over the target file; call once the whole export was read */
+    bool Commit();
+
+    int nRows;
+
+private:
+    std::string sTargetPath;
+    std::string sTempPath;
+    FILE* outFile;
+    double dTargetTeam;
+    std::string sBuffer;
+};
+
+/** One project export and the filters it is streamed through */
+class CDCCProjectStream : private boost::noncopyable
+{
+public:
+    CDCCProjectStream(const std::string& sURLIn, const std::set<std::string>& setCPIDs, const std::string& sTeamPath, double dTeam);
+
+    std::string sURL;
+    CDCCResearcherFilter researchers;
+    CDCCTeamFilter team;
+
+    bool fSuccess;
+    std::string sError;
+    uint64_t nCompressedBytes;
+    uint64_t nInflatedBytes;
+    int64_t nElapsedMillis;
+};
+
+/** GET sURL (http:// or https://, redirects are followed) and pass the body to reader as it arrives */
+bool StreamHTTPBody(const std::string& sURL, CGzipLineReader& reader, int64_t nTimeoutSecs, std::string& sError);
+
+/** Download and filter the project exports concurrently, one thread per project; returns when all are done */
+void StreamDCCProjects(const std::vector<CDCCProjectStream*>& vProjects, int64_t nTimeoutSecs);
+
+#endif // DCCSTREAM_H
@@ -12,6 +12,7 @@
 #include "darksend.h"
 #include "podc.h"
 #include "masternode-payments.h"
+#include "superblock-calendar.h"
 
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
@@ -626,23 +627,13 @@ CSuperblock(uint256& nHash)
 bool CSuperblock::IsValidBlockHeight(int nBlockHeight)
 {
     // SUPERBLOCKS CAN HAPPEN ONLY after hardfork and only ONCE PER CYCLE
-    return nBlockHeight >= Params().GetConsensus().nSuperblockStartBlock &&
-            ((nBlockHeight % Params().GetConsensus().nSuperblockCycle) == 0);
+    return GetGovernanceSuperblockCalendar().IsSuperblock(nBlockHeight);
 }
 
 bool CSuperblock::IsDCCSuperblock(int nHeight)
 {
-	if (!fDistributedComputingEnabled) return false;
-	if ((nHeight > F13000_CUTOVER_HEIGHT_PROD && fProd) || (nHeight > F13000_CUTOVER_HEIGHT_TESTNET && !fProd))
-	{
-		return nHeight >= Params().GetConsensus().nDCCSuperblockStartBlock &&
-            ((nHeight % Params().GetConsensus().nDCCSuperblockCycle) == 10);
-	}
-	else
-	{
-		return nHeight >= Params().GetConsensus().nDCCSuperblockStartBlock &&
-            ((nHeight % Params().GetConsensus().nDCCSuperblockCycle) == 0);
-	}
+	// The calendar is empty when distributed computing is disabled, and carries the F13000 cycle offset change
+	return GetDCCSuperblockCalendar().IsSuperblock(nHeight);
 }
 
 CAmount CSuperblock::GetPaymentsLimit(int nBlockHeight)
@@ -0,0 +1,637 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "httpclient.h"
+
+#include "clientversion.h"
+#include "compat.h"
+#include "netbase.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+
+#include <stdlib.h>
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/foreach.hpp>
+
+#include <openssl/ssl.h>
+
+static const size_t HTTP_CLIENT_READ_CHUNK = 16 * 1024;
+
+CHTTPClientRequest::CHTTPClientRequest() :
+    sMethod("GET"), nPort(80), fTLS(false), sPath("/"), nTimeoutMillis(DEFAULT_HTTP_CLIENT_TIMEOUT), nStallTimeoutMillis(0), nMaxBodySize(0), fKeepAlive(true)
+{
+}
+
+bool CHTTPClientRequest::SetURL(const std::string& sURL)
+{
+    std::string sRest;
+    if (boost::algorithm::istarts_with(sURL, "https://")) {
+        fTLS = true;
+        sRest = sURL.substr(8);
+    } else if (boost::algorithm::istarts_with(sURL, "http://")) {
+        fTLS = false;
+        sRest = sURL.substr(7);
+    } else {
+        return false;
+    }
+    size_t nSlash = sRest.find('/');
+    sPath = nSlash == std::string::npos ? "/" : sRest.substr(nSlash);
+    std::string sHostPort = sRest.substr(0, nSlash);
+    nPort = fTLS ? 443 : 80;
+    size_t nColon = sHostPort.find(':');
+    if (nColon != std::string::npos) {
+        nPort = atoi(sHostPort.substr(nColon + 1));
+        sHostPort = sHostPort.substr(0, nColon);
+    }
+    sHost = sHostPort;
+    return !sHost.empty() && nPort > 0 && nPort < 65536;
+}
+
+std::string CHTTPClientResponse::GetHeader(const std::string& sName) const
+{
+    size_t nPos = sHeaders.find("\r\n");
+    while (nPos != std::string::npos) {
+        nPos += 2;
+        size_t nEnd = sHeaders.find("\r\n", nPos);
+        std::string sLine = sHeaders.substr(nPos, nEnd == std::string::npos ? std::string::npos : nEnd - nPos);
+        size_t nColon = sLine.find(':');
+        if (nColon == sName.size() && boost::algorithm::iequals(sLine.substr(0, nColon), sName)) {
+            std::string sValue = sLine.substr(nColon + 1);
+            boost::algorithm::trim(sValue);
+            return sValue;
+        }
+        nPos = nEnd;
+    }
+    return "";
+}
+
+class CHTTPClient::Connection
+{
+public:
+    std::string sKey;
+    SOCKET hSocket;
+    SSL* ssl;
+    /** Bytes read past the end of the previous response */
+    std::string sPending;
+    int64_t nLastUsed;
+    int64_t nStallTimeoutMillis;
+    bool fReused;
+
+    Connection(const std::string& sKeyIn, SOCKET hSocketIn) : sKey(sKeyIn), hSocket(hSocketIn), ssl(NULL), nLastUsed(0), nStallTimeoutMillis(0), fReused(false) {}
+
+    ~Connection()
+    {
+        if (ssl) SSL_free(ssl);
+        CloseSocket(hSocket);
+    }
+
+    /** Bound the next blocking socket call by the request deadline */
+    bool SetTimeout(int64_t nDeadline)
+    {
+        int64_t nRemaining = nDeadline - GetSteadyTimeMillis();
+        if (nRemaining <= 0) return false;
+        if (nStallTimeoutMillis > 0) nRemaining = std::min(nRemaining, nStallTimeoutMillis);
+#ifdef WIN32
+        DWORD nTimeout = nRemaining;
+#else
+        struct timeval nTimeout;
+        nTimeout.tv_sec = nRemaining / 1000;
+        nTimeout.tv_usec = (nRemaining % 1000) * 1000;
+#endif
+        setsockopt(hSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&nTimeout, sizeof(nTimeout));
+        setsockopt(hSocket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&nTimeout, sizeof(nTimeout));
+        return true;
+    }
+
+    bool WriteAll(const std::string& s, int64_t nDeadline, std::string& sError)
+    {
+        size_t nSent = 0;
+        while (nSent < s.size()) {
+            if (!SetTimeout(nDeadline)) {
+                sError = "timed out";
+                return false;
+            }
+            int n = ssl ? SSL_write(ssl, s.data() + nSent, s.size() - nSent) : send(hSocket, s.data() + nSent, s.size() - nSent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                sError = "write failed";
+                return false;
+            }
+            nSent += n;
+        }
+        return true;
+    }
+
+    /** >0 bytes read, 0 when the peer closed the connection, <0 on error or timeout */
+    int ReadSome(char* pch, size_t nSize, int64_t nDeadline, std::string& sError)
+    {
+        if (!SetTimeout(nDeadline)) {
+            sError = "timed out";
+            return -1;
+        }
+        if (ssl) {
+            int n = SSL_read(ssl, pch, nSize);
+            if (n > 0) return n;
+            int nErr = SSL_get_error(ssl, n);
+            // Servers often drop the connection without a close_notify
+            if (nErr == SSL_ERROR_ZERO_RETURN || (nErr == SSL_ERROR_SYSCALL && n == 0)) return 0;
+        } else {
+            int n = recv(hSocket, pch, nSize, 0);
+            if (n >= 0) return n;
+        }
+        int nErr = WSAGetLastError();
+        bool fTimeout = nErr == WSAEWOULDBLOCK;
+#ifdef WIN32
+        fTimeout = fTimeout || nErr == WSAETIMEDOUT;
+#endif
+        if (fTimeout)
+            sError = GetSteadyTimeMillis() < nDeadline && nStallTimeoutMillis > 0 ? "stalled" : "timed out";
+        else
+            sError = "read failed";
+        return -1;
+    }
+
+    /** Read more into sPending */
+    int Fill(int64_t nDeadline, std::string& sError)
+    {
+        char buf[HTTP_CLIENT_READ_CHUNK];
+        int n = ReadSome(buf, sizeof(buf), nDeadline, sError);
+        if (n > 0) sPending.append(buf, n);
+        return n;
+    }
+
+    /** An idle connection the server has closed (or sent something on) is readable */
+    bool IsStale()
+    {
+        if (ssl && SSL_pending(ssl) > 0) return true;
+        fd_set fdsetRecv;
+        FD_ZERO(&fdsetRecv);
+        FD_SET(hSocket, &fdsetRecv);
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 0;
+        return select(hSocket + 1, &fdsetRecv, NULL, NULL, &timeout) != 0;
+    }
+};
+
+namespace {
+
+/** Where a response body goes: the request's callback, or response.sBody */
+class BodyWriter
+{
+public:
+    BodyWriter(const CHTTPClientRequest& requestIn, CHTTPClientResponse& responseIn) :
+        request(requestIn), response(responseIn), nBytes(0), fStopped(false)
+    {
+        fStream = request.fnBody && response.nStatus >= 200 && response.nStatus < 300;
+    }
+
+    /** false once no more of the body is wanted */
+    bool Write(const char* pch, size_t nSize)
+    {
+        bool fFull = false;
+        if (request.nMaxBodySize > 0 && nBytes + nSize >= request.nMaxBodySize) {
+            nSize = request.nMaxBodySize - nBytes;
+            fFull = true;
+        }
+        nBytes += nSize;
+        if (fStream) {
+            if (!request.fnBody(pch, nSize)) fStopped = true;
+        } else {
+            response.sBody.append(pch, nSize);
+        }
+        if (fFull) fStopped = true;
+        return !fStopped;
+    }
+
+    /** For bodies that are neither framed nor closed: stop at a marker */
+    bool CheckEndMarkers(size_t nNewBytes)
+    {
+        if (fStream) return true;
+        BOOST_FOREACH(const std::string& sMarker, request.vEndMarkers) {
+            size_t nFrom = response.sBody.size() > nNewBytes + sMarker.size() ? response.sBody.size() - nNewBytes - sMarker.size() : 0;
+            if (response.sBody.find(sMarker, nFrom) != std::string::npos) {
+                fStopped = true;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const CHTTPClientRequest& request;
+    CHTTPClientResponse& response;
+    size_t nBytes;
+    bool fStopped;
+    bool fStream;
+};
+
+}
+
+static std::string GetUserAgent()
+{
+    static const std::string strUserAgent = "Mozilla/5.0/" + FormatFullVersion();
+    return strUserAgent;
+}
+
+static std::string FormatRequest(const CHTTPClientRequest& request)
+{
+    std::string s;
+    s.reserve(256 + request.sPath.size() + request.sBody.size());
+    s.append(request.sMethod).append(" ").append(request.sPath.empty() ? "/" : request.sPath).append(" HTTP/1.1\r\n");
+    s.append("Host: ").append(request.sHost);
+    if (request.nPort != (request.fTLS ? 443 : 80)) s.append(":").append(itostr(request.nPort));
+    s.append("\r\n");
+    if (!request.mapHeaders.count("User-Agent")) s.append("User-Agent: ").append(GetUserAgent()).append("\r\n");
+    if (request.sMethod != "GET" || !request.sBody.empty()) s.append("Content-Length: ").append(itostr(request.sBody.size())).append("\r\n");
+    s.append(request.fKeepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
+    for (std::map<std::string, std::string>::const_iterator it = request.mapHeaders.begin(); it != request.mapHeaders.end(); ++it)
+        s.append(it->first).append(": ").append(it->second).append("\r\n");
+    s.append("\r\n").append(request.sBody);
+    return s;
+}
+
+static bool ReadLine(CHTTPClient::Connection* pconn, std::string& sLine, int64_t nDeadline, std::string& sError)
+{
+    size_t nEnd;
+    while ((nEnd = pconn->sPending.find("\r\n")) == std::string::npos) {
+        if (pconn->sPending.size() > HTTP_CLIENT_MAX_HEADER_SIZE) {
+            sError = "line too long";
+            return false;
+        }
+        int n = pconn->Fill(nDeadline, sError);
+        if (n <= 0) {
+            if (n == 0) sError = "connection closed";
+            return false;
+        }
+    }
+    sLine = pconn->sPending.substr(0, nEnd);
+    pconn->sPending.erase(0, nEnd + 2);
+    return true;
+}
+
+/** Pass exactly nSize body bytes to writer; never reads past them, so a pipelined response stays in sPending */
+static bool ReadExact(CHTTPClient::Connection* pconn, uint64_t nSize, BodyWriter& writer, int64_t nDeadline, std::string& sError)
+{
+    size_t nTake = std::min((uint64_t)pconn->sPending.size(), nSize);
+    if (nTake > 0) {
+        bool fMore = writer.Write(pconn->sPending.data(), nTake);
+        pconn->sPending.erase(0, nTake);
+        nSize -= nTake;
+        if (!fMore) return true;
+    }
+    char buf[HTTP_CLIENT_READ_CHUNK];
+    while (nSize > 0) {
+        int n = pconn->ReadSome(buf, std::min((uint64_t)sizeof(buf), nSize), nDeadline, sError);
+        if (n <= 0) {
+            if (n == 0) sError = "connection closed with " + i64tostr(nSize) + " body bytes outstanding";
+            return false;
+        }
+        nSize -= n;
+        if (!writer.Write(buf, n)) return true;
+    }
+    return true;
+}
+
+static bool ReadResponse(CHTTPClient::Connection* pconn, const CHTTPClientRequest& request, CHTTPClientResponse& response,
+    int64_t nDeadline, bool& fKeepOpen, bool& fReceivedAny)
+{
+    fKeepOpen = false;
+    fReceivedAny = !pconn->sPending.empty();
+    response.fReused = pconn->fReused;
+    std::string& sError = response.sError;
+
+    // Headers; interim 1xx responses are skipped
+    while (true) {
+        size_t nEnd;
+        while ((nEnd = pconn->sPending.find("\r\n\r\n")) == std::string::npos) {
+            if (pconn->sPending.size() > HTTP_CLIENT_MAX_HEADER_SIZE) {
+                sError = "response headers too long";
+                return false;
+            }
+            int n = pconn->Fill(nDeadline, sError);
+            if (n <= 0) {
+                if (n == 0) sError = "connection closed before the response headers";
+                return false;
+            }
+            fReceivedAny = true;
+        }
+        response.sHeaders = pconn->sPending.substr(0, nEnd);
+        pconn->sPending.erase(0, nEnd + 4);
+        if (response.sHeaders.size() < 12 || !boost::algorithm::starts_with(response.sHeaders, "HTTP/")) {
+            sError = "malformed status line";
+            return false;
+        }
+        response.nStatus = atoi(response.sHeaders.substr(9, 3));
+        if (response.nStatus >= 200 || response.nStatus < 100) break;
+    }
+
+    std::string sConnection = response.GetHeader("connection");
+    boost::to_lower(sConnection);
+    bool fHTTP11 = boost::algorithm::starts_with(response.sHeaders, "HTTP/1.1");
+    fKeepOpen = request.fKeepAlive && (fHTTP11 ? sConnection != "close" : sConnection == "keep-alive");
+
+    BodyWriter writer(request, response);
+    std::string sTransferEncoding = response.GetHeader("transfer-encoding");
+    std::string sContentLength = response.GetHeader("content-length");
+    if (request.sMethod == "HEAD" || response.nStatus == 204 || response.nStatus == 304) {
+        // No body
+    } else if (boost::algorithm::icontains(sTransferEncoding, "chunked")) {
+        std::string sLine;
+        while (!writer.fStopped) {
+            if (!ReadLine(pconn, sLine, nDeadline, sError)) return false;
+            char* pend = NULL;
+            uint64_t nChunk = strtoull(sLine.c_str(), &pend, 16);
+            if (pend == sLine.c_str()) {
+                sError = "malformed chunk size";
+                return false;
+            }
+            if (nChunk == 0) {
+                // Trailers end with an empty line
+                do {
+                    if (!ReadLine(pconn, sLine, nDeadline, sError)) return false;
+                } while (!sLine.empty());
+                break;
+            }
+            if (!ReadExact(pconn, nChunk, writer, nDeadline, sError)) return false;
+            if (!writer.fStopped && !ReadLine(pconn, sLine, nDeadline, sError)) return false;
+        }
+    } else if (!sContentLength.empty()) {
+        int64_t nLength = atoi64(sContentLength);
+        if (nLength < 0) {
+            sError = "malformed content length";
+            return false;
+        }
+        if (!ReadExact(pconn, nLength, writer, nDeadline, sError)) return false;
+    } else {
+        // The body runs until the server closes the connection
+        fKeepOpen = false;
+        if (!pconn->sPending.empty()) {
+            size_t nSize = pconn->sPending.size();
+            if (writer.Write(pconn->sPending.data(), nSize)) writer.CheckEndMarkers(nSize);
+            pconn->sPending.clear();
+        }
+        char buf[HTTP_CLIENT_READ_CHUNK];
+        while (!writer.fStopped) {
+            int n = pconn->ReadSome(buf, sizeof(buf), nDeadline, sError);
+            if (n == 0) break;
+            if (n < 0) return false;
+            if (writer.Write(buf, n)) writer.CheckEndMarkers(n);
+        }
+    }
+    if (writer.fStopped) fKeepOpen = false;
+    return true;
+}
+
+CHTTPClient::CHTTPClient()
+{
+    SSL_library_init();
+    ctx = SSL_CTX_new(SSLv23_client_method());
+    if (ctx) SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT);
+}
+
+CHTTPClient::~CHTTPClient()
+{
+    CloseIdle();
+    for (std::map<std::string, SSL_SESSION*>::iterator it = mapSessions.begin(); it != mapSessions.end(); ++it)
+        SSL_SESSION_free(it->second);
+    if (ctx) SSL_CTX_free(ctx);
+}
+
+CHTTPClient::Connection* CHTTPClient::Checkout(const CHTTPClientRequest& request, int64_t nDeadline, bool fAllowPooled, std::string& sError)
+{
+    std::string sKey = strprintf("%s://%s:%d", request.fTLS ? "https" : "http", request.sHost, request.nPort);
+    if (fAllowPooled && request.fKeepAlive) {
+        std::vector<Connection*> vStale;
+        Connection* pconn = NULL;
+        {
+            LOCK(cs);
+            std::vector<Connection*>& vIdle = mapIdle[sKey];
+            int64_t nNow = GetSteadyTimeMillis();
+            while (!vIdle.empty() && pconn == NULL) {
+                Connection* pidle = vIdle.back();
+                vIdle.pop_back();
+                if (nNow - pidle->nLastUsed > HTTP_CLIENT_IDLE_TIMEOUT || pidle->IsStale()) {
+                    vStale.push_back(pidle);
+                } else {
+                    pconn = pidle;
+                    pconn->fReused = true;
+                    stats.nReused++;
+                }
+            }
+        }
+        BOOST_FOREACH(Connection* pstale, vStale)
+            delete pstale;
+        if (pconn) return pconn;
+    }
+
+    int64_t nRemaining = nDeadline - GetSteadyTimeMillis();
+    SOCKET hSocket = INVALID_SOCKET;
+    CService addr;
+    std::string sHostPort = request.sHost + ":" + itostr(request.nPort);
+    if (nRemaining <= 0 || !ConnectSocketByName(addr, hSocket, request.sHost.c_str(), request.nPort, nRemaining)) {
+        sError = "Failed connection to " + sHostPort;
+        return NULL;
+    }
+    SetSocketNonBlocking(hSocket, false);
+    Connection* pconn = new Connection(sKey, hSocket);
+    {
+        LOCK(cs);
+        stats.nConnects++;
+    }
+    if (!request.fTLS) return pconn;
+
+    if (ctx == NULL || (pconn->ssl = SSL_new(ctx)) == NULL) {
+        sError = "CTX_IS_NULL";
+        delete pconn;
+        return NULL;
+    }
+    SSL_set_fd(pconn->ssl, hSocket);
+    SSL_set_mode(pconn->ssl, SSL_MODE_AUTO_RETRY);
+    SSL_set_tlsext_host_name(pconn->ssl, request.sHost.c_str());
+    {
+        LOCK(cs);
+        std::map<std::string, SSL_SESSION*>::iterator it = mapSessions.find(sKey);
+        if (it != mapSessions.end()) SSL_set_session(pconn->ssl, it->second);
+    }
+    if (!pconn->SetTimeout(nDeadline) || SSL_connect(pconn->ssl) != 1) {
+        sError = "TLS handshake with " + sHostPort + " failed";
+        delete pconn;
+        return NULL;
+    }
+    LOCK(cs);
+    stats.nHandshakes++;
+    if (SSL_session_reused(pconn->ssl)) stats.nResumedSessions++;
+    return pconn;
+}
+
+void CHTTPClient::Release(Connection* pconn, bool fReusable)
+{
+    Connection* pdelete = pconn;
+    {
+        LOCK(cs);
+        if (pconn->ssl && fReusable) {
+            // Remember the session so the next connection to this host can resume it
+            SSL_SESSION* psession = SSL_get1_session(pconn->ssl);
+            if (psession) {
+                SSL_SESSION*& pstored = mapSessions[pconn->sKey];
+                if (pstored) SSL_SESSION_free(pstored);
+                pstored = psession;
+            }
+        }
+        std::vector<Connection*>& vIdle = mapIdle[pconn->sKey];
+        if (fReusable && pconn->sPending.empty() && vIdle.size() < HTTP_CLIENT_MAX_IDLE_PER_HOST) {
+            pconn->nLastUsed = GetSteadyTimeMillis();
+            vIdle.push_back(pconn);
+            pdelete = NULL;
+        }
+    }
+    delete pdelete;
+}
+
+/** Methods a server may see twice without harm, RFC 7231 section 4.2.2 */
+static bool IsIdempotent(const std::string& sMethod)
+{
+    return sMethod == "GET" || sMethod == "HEAD" || sMethod == "PUT" || sMethod == "DELETE" || sMethod == "OPTIONS";
+}
+
+bool CHTTPClient::Exchange(const std::vector<const CHTTPClientRequest*>& vRequests, std::vector<CHTTPClientResponse*>& vResponses, bool fAllowPooled, size_t& nCompleted)
+{
+    nCompleted = 0;
+    int64_t nTimeout = 0;
+    BOOST_FOREACH(const CHTTPClientRequest* prequest, vRequests)
+        nTimeout = std::max(nTimeout, prequest->nTimeoutMillis);
+    int64_t nDeadline = GetSteadyTimeMillis() + nTimeout;
+
+    Connection* pconn = Checkout(*vRequests[0], nDeadline, fAllowPooled, vResponses[0]->sError);
+    if (pconn == NULL) return false;
+    pconn->nStallTimeoutMillis = vRequests[0]->nStallTimeoutMillis;
+
+    std::string sData;
+    BOOST_FOREACH(const CHTTPClientRequest* prequest, vRequests)
+        sData += FormatRequest(*prequest);
+    bool fReused = pconn->fReused;
+    if (!pconn->WriteAll(sData, nDeadline, vResponses[0]->sError)) {
+        Release(pconn, false);
+        // A pooled connection the server closed in the meantime; nothing was received, so sending again is safe
+        return fReused;
+    }
+    for (size_t i = 0; i < vRequests.size(); i++) {
+        bool fKeepOpen = false;
+        bool fReceivedAny = false;
+        if (!ReadResponse(pconn, *vRequests[i], *vResponses[i], nDeadline, fKeepOpen, fReceivedAny)) {
+            Release(pconn, false);
+            if (!fReused || fReceivedAny || i != 0) return false;
+            // The server may have closed the connection only after acting on the requests, so
+            // sending them again is only safe if doing them twice does no harm
+            BOOST_FOREACH(const CHTTPClientRequest* prequest, vRequests)
+                if (!IsIdempotent(prequest->sMethod)) return false;
+            return true;
+        }
+        nCompleted++;
+        if (!fKeepOpen) {
+            Release(pconn, false);
+            return false;
+        }
+    }
+    Release(pconn, true);
+    return false;
+}
+
+bool CHTTPClient::Request(const CHTTPClientRequest& request, CHTTPClientResponse& response)
+{
+    {
+        LOCK(cs);
+        stats.nRequests++;
+    }
+    std::vector<const CHTTPClientRequest*> vRequests(1, &request);
+    std::vector<CHTTPClientResponse*> vResponses(1, &response);
+    size_t nCompleted = 0;
+    if (Exchange(vRequests, vResponses, true, nCompleted)) {
+        response = CHTTPClientResponse();
+        Exchange(vRequests, vResponses, false, nCompleted);
+    }
+    if (nCompleted == 1) return true;
+    LogPrint("http", "CHTTPClient::Request -- %s %s:%d%s failed: %s\n", request.sMethod, request.sHost, request.nPort, request.sPath, response.sError);
+    LOCK(cs);
+    stats.nFailures++;
+    return false;
+}
+
+bool CHTTPClient::RequestPipelined(const std::vector<CHTTPClientRequest>& vRequests, std::vector<CHTTPClientResponse>& vResponses)
+{
+    vResponses.assign(vRequests.size(), CHTTPClientResponse());
+    {
+        LOCK(cs);
+        stats.nRequests += vRequests.size();
+    }
+    bool fAllowPooled = true;
+    size_t nStart = 0;
+    while (nStart < vRequests.size()) {
+        std::vector<const CHTTPClientRequest*> vBatch;
+        std::vector<CHTTPClientResponse*> vBatchResponses;
+        for (size_t i = nStart; i < vRequests.size(); i++) {
+            const CHTTPClientRequest& request = vRequests[i];
+            if (request.sHost != vRequests[nStart].sHost || request.nPort != vRequests[nStart].nPort || request.fTLS != vRequests[nStart].fTLS)
+                break;
+            vBatch.push_back(&request);
+            vBatchResponses.push_back(&vResponses[i]);
+        }
+        size_t nCompleted = 0;
+        bool fRetry = Exchange(vBatch, vBatchResponses, fAllowPooled, nCompleted);
+        nStart += nCompleted;
+        fAllowPooled = true;
+        if (nStart == vRequests.size()) break;
+        if (fRetry) {
+            // Stale pooled connection: send the rest again on a new one
+            vResponses[nStart] = CHTTPClientResponse();
+            fAllowPooled = false;
+        } else if (!vResponses[nStart].sError.empty()) {
+            LogPrint("http", "CHTTPClient::RequestPipelined -- %s:%d%s failed: %s\n", vRequests[nStart].sHost, vRequests[nStart].nPort, vRequests[nStart].sPath, vResponses[nStart].sError);
+            LOCK(cs);
+            stats.nFailures++;
+            nStart++;
+        }
+        // Otherwise the server closed the connection after a response, and the rest go out on the next one
+    }
+    BOOST_FOREACH(const CHTTPClientResponse& response, vResponses)
+        if (response.nStatus == 0 || !response.sError.empty()) return false;
+    return true;
+}
+
+void CHTTPClient::CloseIdle()
+{
+    std::vector<Connection*> vClose;
+    {
+        LOCK(cs);
+        for (std::map<std::string, std::vector<Connection*> >::iterator it = mapIdle.begin(); it != mapIdle.end(); ++it)
+            vClose.insert(vClose.end(), it->second.begin(), it->second.end());
+        mapIdle.clear();
+    }
+    BOOST_FOREACH(Connection* pconn, vClose)
+        delete pconn;
+}
+
+size_t CHTTPClient::GetIdleCount() const
+{
+    LOCK(cs);
+    size_t nIdle = 0;
+    for (std::map<std::string, std::vector<Connection*> >::const_iterator it = mapIdle.begin(); it != mapIdle.end(); ++it)
+        nIdle += it->second.size();
+    return nIdle;
+}
+
+CHTTPClient::Stats CHTTPClient::GetStats() const
+{
+    LOCK(cs);
+    return stats;
+}
+
+CHTTPClient& GetHTTPClient()
+{
+    static CHTTPClient httpClient;
+    return httpClient;
+}
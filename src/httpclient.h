@@ -0,0 +1,140 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef HTTPCLIENT_H
+#define HTTPCLIENT_H
+
+#include "sync.h"
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+struct ssl_ctx_st;
+struct ssl_session_st;
+
+/** Default limit for a whole request, connecting included */
+static const int64_t DEFAULT_HTTP_CLIENT_TIMEOUT = 30 * 1000;
+/** Pooled connections idle for longer than this are closed rather than reused */
+static const int64_t HTTP_CLIENT_IDLE_TIMEOUT = 30 * 1000;
+/** Idle connections kept per host */
+static const size_t HTTP_CLIENT_MAX_IDLE_PER_HOST = 8;
+/** Largest response header block accepted */
+static const size_t HTTP_CLIENT_MAX_HEADER_SIZE = 64 * 1024;
+
+/** An outgoing request; SetURL fills in the host, port, scheme and path */
+struct CHTTPClientRequest
+{
+    std::string sMethod;
+    std::string sHost;
+    int nPort;
+    bool fTLS;
+    std::string sPath;
+    std::map<std::string, std::string> mapHeaders;
+    std::string sBody;
+    int64_t nTimeoutMillis;
+    /** Give up if no data arrives for this long; 0 means only nTimeoutMillis applies */
+    int64_t nStallTimeoutMillis;
+    /** Reading stops after this many body bytes and the connection is dropped; 0 means no limit */
+    size_t nMaxBodySize;
+    /**
+     * Some pool and BOINC endpoints neither frame the body nor close the
+     * connection; for such bodies reading stops once one of these is seen.
+     */
+    std::vector<std::string> vEndMarkers;
+    /** false sends Connection: close and never pools the connection */
+    bool fKeepAlive;
+    /** When set the body is passed here as it arrives instead of collected; return false to stop */
+    boost::function<bool (const char* pch, size_t nSize)> fnBody;
+
+    CHTTPClientRequest();
+    /** Parse http(s)://host[:port][/path] */
+    bool SetURL(const std::string& sURL);
+};
+
+struct CHTTPClientResponse
+{
+    int nStatus;
+    /** Status line and header lines, CRLF separated, without the blank line */
+    std::string sHeaders;
+    std::string sBody;
+    std::string sError;
+    /** The request went out on a pooled connection */
+    bool fReused;
+
+    CHTTPClientResponse() : nStatus(0), fReused(false) {}
+    /** Value of a response header, matched case insensitively; empty if absent */
+    std::string GetHeader(const std::string& sName) const;
+};
+
+/**
+ * HTTP/1.1 client shared by the pool miner, BOINC, IPFS and PODC calls.
+ *
+ * One SSL_CTX is created for the process and TLS sessions are resumed per
+ * host.  Finished keep-alive connections go back to a per host pool, so a
+ * request to a host that was used recently skips both the TCP connect and the
+ * TLS handshake.  Requests may be issued from any number of threads; each
+ * takes its own connection from the pool.  Bodies framed by Content-Length or
+ * chunked encoding are read exactly, which is what makes the connection
+ * reusable, and can be streamed to a callback instead of being collected.
+ */
+class CHTTPClient : private boost::noncopyable
+{
+public:
+    struct Stats
+    {
+        uint64_t nRequests;
+        uint64_t nConnects;
+        uint64_t nHandshakes;
+        uint64_t nResumedSessions;
+        uint64_t nReused;
+        uint64_t nFailures;
+        Stats() : nRequests(0), nConnects(0), nHandshakes(0), nResumedSessions(0), nReused(0), nFailures(0) {}
+    };
+
+    CHTTPClient();
+    ~CHTTPClient();
+
+    /**
+     * Send a request and read the whole response; false with response.sError set on failure.
+     * A pooled connection the server closed in the meantime is replaced and the request sent
+     * again; a request that is not idempotent, like a POST, only if it could not be sent
+     * out whole, since otherwise the server may have acted on it already.
+     */
+    bool Request(const CHTTPClientRequest& request, CHTTPClientResponse& response);
+    /**
+     * Send requests to one host pipelined on one connection and read the
+     * responses in order.  Bodies are collected; fnBody is not used.
+     * Requests left over when the connection fails are sent one by one.
+     */
+    bool RequestPipelined(const std::vector<CHTTPClientRequest>& vRequests, std::vector<CHTTPClientResponse>& vResponses);
+
+    /** Close every pooled connection */
+    void CloseIdle();
+    size_t GetIdleCount() const;
+    Stats GetStats() const;
+
+    class Connection;
+
+private:
+    Connection* Checkout(const CHTTPClientRequest& request, int64_t nDeadline, bool fAllowPooled, std::string& sError);
+    void Release(Connection* pconn, bool fReusable);
+    /** true if the exchange failed on a pooled connection before any response byte and sending it again is safe */
+    bool Exchange(const std::vector<const CHTTPClientRequest*>& vRequests, std::vector<CHTTPClientResponse*>& vResponses, bool fAllowPooled, size_t& nCompleted);
+
+    struct ssl_ctx_st* ctx;
+    mutable CCriticalSection cs;
+    std::map<std::string, std::vector<Connection*> > mapIdle;
+    std::map<std::string, struct ssl_session_st*> mapSessions;
+    Stats stats;
+};
+
+/** The process wide client */
+CHTTPClient& GetHTTPClient();
+
+#endif // HTTPCLIENT_H
@@ -3,6 +3,7 @@
 #include "base58.h"
 #include "chainparams.h"
 #include "httpserver.h"
+#include "json-stream.h"
 #include "rpcprotocol.h"
 #include "rpcserver.h"
 #include "random.h"
@@ -15,6 +16,7 @@
 #include "utilstrencodings.h"
 
 #include <boost/algorithm/string.hpp> // boost::trim
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp> //BOOST_FOREACH
 
 /** WWW-Authenticate to present with 401 Unauthorized response */
@@ -79,6 +81,68 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     req->WriteReply(nStatus, strReply);
 }
 
+/** Sink of a streamed JSON-RPC reply; the chunked reply starts with the first full chunk */
+class HTTPJSONStream
+{
+public:
+    HTTPJSONStream(HTTPRequest* reqIn) : req(reqIn), fStarted(false) {}
+
+    void operator()(const std::string& strChunk)
+    {
+        if (!fStarted) {
+            req->WriteHeader("Content-Type", "application/json");
+            req->StartChunkedReply(HTTP_OK);
+            fStarted = true;
+        }
+        req->WriteReplyChunk(strChunk);
+    }
+
+private:
+    HTTPRequest* req;
+    bool fStarted;
+};
+
+/**
+ * Reply to a single request whose method can stream its result.  Returns
+ * false if it cannot; errors thrown before any output was sent propagate
+ * so the caller can still answer with a normal error reply.
+ */
+static bool JSONRPCExecStream(HTTPRequest* req, const JSONRequest& jreq)
+{
+    HTTPJSONStream stream(req);
+    CJSONStreamWriter writer(boost::ref(stream));
+
+    // Same member order as JSONRPCReply
+    writer.BeginObject();
+    writer.Key("result");
+    try {
+        if (!tableRPC.executeStream(jreq.strMethod, jreq.params, writer))
+            return false;
+    } catch (...) {
+        if (!writer.HasFlushed())
+            throw;
+        // The status line is gone already; drop the connection without the last chunk, so the
+        // client sees a truncated reply instead of a complete body holding invalid JSON
+        LogPrintf("%s: %s failed after part of its reply was sent\n", __func__, SanitizeString(jreq.strMethod));
+        req->AbortChunkedReply();
+        return true;
+    }
+    writer.Pair("error", NullUniValue);
+    writer.Pair("id", jreq.id);
+    writer.EndObject();
+
+    if (!writer.HasFlushed()) {
+        // Small enough for one plain reply
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, writer.GetBuffer() + "\n");
+        return true;
+    }
+    writer.Flush();
+    req->WriteReplyChunk("\n");
+    req->EndChunkedReply();
+    return true;
+}
+
 //This function checks username and password against -rpcauth
 //entries from config file.
 static bool multiUserAuthorized(std::string strUserPass)
@@ -140,6 +204,65 @@ static bool RPCAuthorized(const std::string& strAuth)
     return multiUserAuthorized(strUserPass);
 }
 
+/** Run a parsed JSON-RPC request, single or batch, and send its reply */
+static bool JSONRPCReplyTo(HTTPRequest* req, const UniValue& valRequest)
+{
+    JSONRequest jreq;
+    try {
+        std::string strReply;
+        // singleton request
+        if (valRequest.isObject()) {
+            jreq.parse(valRequest);
+
+            // Large results are written in chunks as they are produced
+            if (JSONRPCExecStream(req, jreq))
+                return true;
+
+            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
+
+            // Send reply
+            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+
+        // array of requests
+        } else if (valRequest.isArray())
+            strReply = JSONRPCExecBatch(valRequest.get_array());
+        else
+            throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
+
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strReply);
+    } catch (const UniValue& objError) {
+        JSONErrorReply(req, objError, jreq.id);
+        return false;
+    } catch (const std::exception& e) {
+        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        return false;
+    }
+    return true;
+}
+
+static bool IsLongRunningCall(const UniValue& valCall)
+{
+    if (!valCall.isObject())
+        return false;
+    const UniValue& valMethod = find_value(valCall, "method");
+    const UniValue& valParams = find_value(valCall, "params");
+    return valMethod.isStr() && valParams.isArray() && IsLongRunningRPC(valMethod.get_str(), valParams);
+}
+
+/** Whether a request, or any call of a batch, is a long running exec command */
+static bool IsLongRunningRequest(const UniValue& valRequest)
+{
+    if (!valRequest.isArray())
+        return IsLongRunningCall(valRequest);
+    for (unsigned int i = 0; i < valRequest.size(); i++)
+    {
+        if (IsLongRunningCall(valRequest[i]))
+            return true;
+    }
+    return false;
+}
+
 static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 {
     // JSONRPC handles only POST
@@ -168,39 +291,19 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         return false;
     }
 
-    JSONRequest jreq;
-    try {
-        // Parse request
-        UniValue valRequest;
-        if (!valRequest.read(req->ReadBody()))
-            throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
-
-        std::string strReply;
-        // singleton request
-        if (valRequest.isObject()) {
-            jreq.parse(valRequest);
-
-            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
-
-            // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
-
-        // array of requests
-        } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
-        else
-            throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
-
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
-    } catch (const UniValue& objError) {
-        JSONErrorReply(req, objError, jreq.id);
-        return false;
-    } catch (const std::exception& e) {
-        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+    UniValue valRequest;
+    if (!valRequest.read(req->ReadBody())) {
+        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, "Parse error"), NullUniValue);
         return false;
     }
-    return true;
+
+    // Long running exec commands, alone or in a batch, run on their own
+    // threads so they cannot keep the workers from the other calls
+    if (IsLongRunningRequest(valRequest)) {
+        QueueLongHTTPRequest(req, "", boost::bind(&JSONRPCReplyTo, _1, valRequest));
+        return true;
+    }
+    return JSONRPCReplyTo(req, valRequest);
 }
 
 static bool InitRPCAuthentication()
@@ -24,6 +24,7 @@
 #include <event2/http.h>
 #include <event2/thread.h>
 #include <event2/buffer.h>
+#include <event2/bufferevent.h>
 #include <event2/util.h>
 #include <event2/keyvalq_struct.h>
 
@@ -38,6 +39,8 @@
 #include <boost/foreach.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <atomic>
+
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
 
@@ -187,6 +190,8 @@ struct evhttp* eventHTTP = 0;
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
 static WorkQueue<HTTPClosure>* workQueue = 0;
+//! Work queue for the long running calls the handlers pass on, so they do not hold the workers
+static WorkQueue<HTTPClosure>* longWorkQueue = 0;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -363,6 +368,12 @@ static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue)
     queue->Run();
 }
 
+static void HTTPLongWorkQueueRun(WorkQueue<HTTPClosure>* queue)
+{
+    RenameThread("biblepay-httpexec");
+    queue->Run();
+}
+
 /** libevent event log callback */
 static void libevent_log_cb(int severity, const char *msg)
 {
@@ -438,6 +449,7 @@ bool InitHTTPServer()
     LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
 
     workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    longWorkQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
     eventBase = base;
     eventHTTP = http;
     return true;
@@ -454,6 +466,11 @@ bool StartHTTPServer()
 
     for (int i = 0; i < rpcThreads; i++)
         boost::thread(boost::bind(&HTTPWorkQueueRun, workQueue));
+
+    int rpcExecThreads = std::max((long)GetArg("-rpcexecthreads", DEFAULT_RPC_EXEC_THREADS), 1L);
+    LogPrintf("HTTP: starting %d threads for long running calls\n", rpcExecThreads);
+    for (int i = 0; i < rpcExecThreads; i++)
+        boost::thread(boost::bind(&HTTPLongWorkQueueRun, longWorkQueue));
     return true;
 }
 
@@ -470,6 +487,8 @@ void InterruptHTTPServer()
     }
     if (workQueue)
         workQueue->Interrupt();
+    if (longWorkQueue)
+        longWorkQueue->Interrupt();
 }
 
 void StopHTTPServer()
@@ -485,6 +504,13 @@ void StopHTTPServer()
 #endif        
         delete workQueue;
     }
+    if (longWorkQueue) {
+        LogPrint("http", "Waiting for HTTP long running call threads to exit\n");
+#ifndef WIN32
+        longWorkQueue->WaitExit();
+#endif
+        delete longWorkQueue;
+    }
     if (eventBase) {
         LogPrint("http", "Waiting for HTTP event thread to exit\n");
         // Give event loop a few seconds to exit (to send back last RPC responses), then break it
@@ -546,12 +572,36 @@ void HTTPEvent::trigger(struct timeval* tv)
     else
         evtimer_add(ev, tv); // trigger after timeval passed
 }
+/** Chunks of one reply that may wait for the main http thread at once */
+static const int HTTP_MAX_QUEUED_CHUNKS = 4;
+/** Bytes of a chunked reply that may wait in the connection's output buffer before the worker holds back */
+static const size_t HTTP_MAX_UNSENT_REPLY = 1024 * 1024;
+/** How often a held back worker looks at the output buffer again */
+static const int HTTP_UNSENT_POLL_MS = 10;
+
+/** Flow control state of one chunked reply, shared between the worker and the main http thread */
+struct HTTPReplyFlow
+{
+    CSemaphore semChunks; //! bounds the chunks queued for the main http thread
+    std::atomic<size_t> nUnsent; //! output buffer length seen after the last chunk was handed over
+    std::atomic<bool> fClosed; //! the connection went away, the evhttp_request is freed
+    boost::shared_ptr<HTTPReplyFlow>* pCloseArg; //! keeps this alive for the connection close callback
+
+    HTTPReplyFlow() : semChunks(HTTP_MAX_QUEUED_CHUNKS), nUnsent(0), fClosed(false), pCloseArg(NULL) {}
+};
+
 HTTPRequest::HTTPRequest(struct evhttp_request* req) : req(req),
-                                                       replySent(false)
+                                                       replySent(false),
+                                                       fChunked(false)
 {
 }
 HTTPRequest::~HTTPRequest()
 {
+    if (fChunked && req) {
+        // A chunked reply was cut short, close it so the connection is released
+        LogPrintf("%s: Unfinished chunked reply\n", __func__);
+        EndChunkedReply();
+    }
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
@@ -560,6 +610,15 @@ HTTPRequest::~HTTPRequest()
     // evhttpd cleans up the request, as long as a reply was sent.
 }
 
+HTTPRequest* HTTPRequest::Detach()
+{
+    assert(!replySent && !fChunked);
+    HTTPRequest* pnew = new HTTPRequest(req);
+    req = 0;
+    replySent = true;
+    return pnew;
+}
+
 std::pair<bool, std::string> HTTPRequest::GetHeader(const std::string& hdr)
 {
     const struct evkeyvalq* headers = evhttp_request_get_input_headers(req);
@@ -617,6 +676,134 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+/** Length of the connection's output buffer; only the main http thread may look at it */
+static size_t HTTPUnsentLength(struct evhttp_request* req)
+{
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+    struct evhttp_connection* evcon = evhttp_request_get_connection(req);
+    struct bufferevent* bev = evcon ? evhttp_connection_get_bufferevent(evcon) : NULL;
+    if (bev)
+        return evbuffer_get_length(bufferevent_get_output(bev));
+#endif
+    return 0;
+}
+
+static void HTTPChunkedReplyClosed(struct evhttp_connection* evcon, void* arg)
+{
+    boost::shared_ptr<HTTPReplyFlow>* pflow = (boost::shared_ptr<HTTPReplyFlow>*)arg;
+    (*pflow)->fClosed = true;
+    delete pflow;
+}
+
+static void HTTPStartChunkedReply(struct evhttp_request* req, int nStatus, boost::shared_ptr<HTTPReplyFlow> flow)
+{
+    // Learn about a client that goes away mid reply, evhttp frees the request with the connection
+    struct evhttp_connection* evcon = evhttp_request_get_connection(req);
+    if (evcon) {
+        flow->pCloseArg = new boost::shared_ptr<HTTPReplyFlow>(flow);
+        evhttp_connection_set_closecb(evcon, HTTPChunkedReplyClosed, flow->pCloseArg);
+    }
+    evhttp_send_reply_start(req, nStatus, NULL);
+}
+
+void HTTPRequest::StartChunkedReply(int nStatus)
+{
+    assert(!replySent && req);
+    replyFlow.reset(new HTTPReplyFlow());
+    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+        boost::bind(HTTPStartChunkedReply, req, nStatus, replyFlow));
+    ev->trigger(0);
+    replySent = true;
+    fChunked = true;
+}
+
+static void HTTPSendReplyChunk(struct evhttp_request* req, struct evbuffer* evb, boost::shared_ptr<HTTPReplyFlow> flow)
+{
+    if (!flow->fClosed) {
+        evhttp_send_reply_chunk(req, evb);
+        flow->nUnsent = HTTPUnsentLength(req);
+    }
+    evbuffer_free(evb);
+    flow->semChunks.post();
+}
+
+static void HTTPMeasureReply(struct evhttp_request* req, boost::shared_ptr<HTTPReplyFlow> flow)
+{
+    if (!flow->fClosed)
+        flow->nUnsent = HTTPUnsentLength(req);
+    flow->semChunks.post();
+}
+
+void HTTPRequest::WriteReplyChunk(const std::string& strChunk)
+{
+    assert(fChunked && req);
+    if (strChunk.empty())
+        return;
+    replyFlow->semChunks.wait();
+    // evhttp_send_reply_chunk only appends to the output buffer, so wait for a slow client to drain it
+    while (replyFlow->nUnsent > HTTP_MAX_UNSENT_REPLY && !replyFlow->fClosed) {
+        MilliSleep(HTTP_UNSENT_POLL_MS);
+        HTTPEvent* ev = new HTTPEvent(eventBase, true,
+            boost::bind(HTTPMeasureReply, req, replyFlow));
+        ev->trigger(0);
+        replyFlow->semChunks.wait();
+    }
+    if (replyFlow->fClosed) {
+        replyFlow->semChunks.post();
+        return;
+    }
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+        boost::bind(HTTPSendReplyChunk, req, evb, replyFlow));
+    ev->trigger(0);
+}
+
+static void HTTPEndChunkedReply(struct evhttp_request* req, boost::shared_ptr<HTTPReplyFlow> flow)
+{
+    if (flow->fClosed)
+        return;
+    struct evhttp_connection* evcon = evhttp_request_get_connection(req);
+    if (evcon && flow->pCloseArg) {
+        // The connection may outlive this reply, e.g. with keep-alive
+        evhttp_connection_set_closecb(evcon, NULL, NULL);
+        delete flow->pCloseArg;
+    }
+    evhttp_send_reply_end(req);
+}
+
+void HTTPRequest::EndChunkedReply()
+{
+    assert(fChunked && req);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+        boost::bind(HTTPEndChunkedReply, req, replyFlow));
+    ev->trigger(0);
+    req = 0; // transferred back to main thread
+}
+
+static void HTTPAbortChunkedReply(struct evhttp_request* req, boost::shared_ptr<HTTPReplyFlow> flow)
+{
+    if (flow->fClosed)
+        return;
+    struct evhttp_connection* evcon = evhttp_request_get_connection(req);
+    if (!evcon) {
+        evhttp_send_reply_end(req);
+        return;
+    }
+    // Runs the close callback and frees the request along with the connection
+    evhttp_connection_free(evcon);
+}
+
+void HTTPRequest::AbortChunkedReply()
+{
+    assert(fChunked && req);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+        boost::bind(HTTPAbortChunkedReply, req, replyFlow));
+    ev->trigger(0);
+    req = 0; // transferred back to main thread
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
@@ -663,6 +850,16 @@ void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPR
     pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
 }
 
+void QueueLongHTTPRequest(HTTPRequest* req, const std::string &path, const HTTPRequestHandler &handler)
+{
+    std::auto_ptr<HTTPWorkItem> item(new HTTPWorkItem(req->Detach(), path, handler));
+    assert(longWorkQueue);
+    if (longWorkQueue->Enqueue(item.get()))
+        item.release(); /* if true, queue took ownership */
+    else
+        item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
+}
+
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
 {
     std::vector<HTTPPathHandler>::iterator i = pathHandlers.begin();
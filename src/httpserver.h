@@ -9,14 +9,18 @@
 #include <stdint.h>
 #include <boost/thread.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
+/** Threads that run long running calls, apart from the -rpcthreads workers */
+static const int DEFAULT_RPC_EXEC_THREADS=2;
 
 struct evhttp_request;
 struct event_base;
+struct HTTPReplyFlow;
 class CService;
 class HTTPRequest;
 
@@ -43,6 +47,13 @@ typedef boost::function<void(HTTPRequest* req, const std::string &)> HTTPRequest
 void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
+/** Hand a request over to the -rpcexecthreads threads kept for long running
+ * calls, so it does not hold one of the -rpcthreads workers while it runs.
+ * The queue owns req from then on and calls handler with it on one of those
+ * threads; when the queue is full the request is answered as one the work
+ * queue has no room for.
+ */
+void QueueLongHTTPRequest(HTTPRequest* req, const std::string &path, const HTTPRequestHandler &handler);
 
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
@@ -57,11 +68,18 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    bool fChunked;
+    boost::shared_ptr<HTTPReplyFlow> replyFlow; //! flow control of a chunked reply
 
 public:
     HTTPRequest(struct evhttp_request* req);
     ~HTTPRequest();
 
+    /** Move the request into a new HTTPRequest, for another thread to answer.
+     * This one is left empty and sends nothing when it is destroyed.
+     */
+    HTTPRequest* Detach();
+
     enum RequestMethod {
         UNKNOWN,
         GET,
@@ -112,6 +130,36 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a chunked HTTP reply; use this instead of WriteReply when the
+     * body is produced piece by piece.  Headers must be written before.
+     */
+    void StartChunkedReply(int nStatus);
+
+    /**
+     * Send the next piece of a chunked reply.  Blocks while too many chunks
+     * are still waiting for the main http thread or the connection still has
+     * too much unsent output, so neither a slow event loop nor a slow client
+     * can make the body pile up in memory.  Pieces written after the client
+     * went away are dropped.
+     */
+    void WriteReplyChunk(const std::string& strChunk);
+
+    /**
+     * Finish a chunked reply.
+     *
+     * @note Like WriteReply, this gives the request back to the main thread.
+     */
+    void EndChunkedReply();
+
+    /**
+     * Give up on a chunked reply by closing the connection, so the client
+     * sees a truncated body instead of a complete one.
+     *
+     * @note Like WriteReply, this gives the request back to the main thread.
+     */
+    void AbortChunkedReply();
 };
 
 /** Event handler closure.
@@ -133,6 +133,9 @@ enum BindFlags {
 };
 
 static const char* FEE_ESTIMATES_FILENAME="fee_estimates.dat";
+/** How often fee_estimates.dat is written while running, in seconds */
+static const int64_t FEE_ESTIMATES_FLUSH_INTERVAL = 60 * 60;
+static unsigned int nFeeEstimatesFlushedHeight = 0;
 CClientUIInterface uiInterface; // Declared but not defined in ui_interface.h
 
 //////////////////////////////////////////////////////////////////////////////
@@ -236,6 +239,37 @@ void Interrupt(boost::thread_group& threadGroup)
     threadGroup.interrupt_all();
 }
 
+/** Write the fee estimates through a temporary file, so a crash never leaves a truncated file behind */
+static void FlushFeeEstimates()
+{
+    boost::filesystem::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
+    boost::filesystem::path est_path_new = GetDataDir() / (std::string(FEE_ESTIMATES_FILENAME) + ".new");
+    unsigned int nHeight = mempool.GetFeeEstimatesHeight();
+    {
+        CAutoFile est_fileout(fopen(est_path_new.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+        if (est_fileout.IsNull()) {
+            LogPrintf("%s: Failed to write fee estimates to %s\n", __func__, est_path_new.string());
+            return;
+        }
+        if (!mempool.WriteFeeEstimates(est_fileout))
+            return;
+        FileCommit(est_fileout.Get());
+    }
+    if (!RenameOver(est_path_new, est_path)) {
+        LogPrintf("%s: Failed to rename %s\n", __func__, est_path_new.string());
+        return;
+    }
+    nFeeEstimatesFlushedHeight = nHeight;
+}
+
+/** Scheduled while running; only writes when a block has changed the estimates since the last write */
+static void PeriodicFlushFeeEstimates()
+{
+    if (!fFeeEstimatesInitialized || mempool.GetFeeEstimatesHeight() == nFeeEstimatesFlushedHeight)
+        return;
+    FlushFeeEstimates();
+}
+
 /** Preparing steps before shutting down or restarting the wallet */
 void PrepareShutdown()
 {
@@ -282,12 +316,7 @@ void PrepareShutdown()
 
     if (fFeeEstimatesInitialized)
     {
-        boost::filesystem::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
-        CAutoFile est_fileout(fopen(est_path.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
-        if (!est_fileout.IsNull())
-            mempool.WriteFeeEstimates(est_fileout);
-        else
-            LogPrintf("%s: Failed to write fee estimates to %s\n", __func__, est_path.string());
+        FlushFeeEstimates();
         fFeeEstimatesInitialized = false;
     }
 
@@ -540,6 +569,7 @@ std::string HelpMessage(HelpMessageMode mode)
     }
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dbtune=<db>:<setting>=<n>", _("Override a LevelDB setting (blocksize, compression, bloombits, maxopenfiles, writebuffer) of the chainstate, blockindex or indexes database (can be specified multiple times)"));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
@@ -561,6 +591,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-splitindexdb", strprintf(_("Keep the tx, address, timestamp and spent indexes in their own database, blocks/indexes; changing this requires -reindex (default: %u)"), DEFAULT_SPLITINDEXDB));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
@@ -647,6 +678,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtxlock=<address>", _("Enable publish raw transaction (locked via InstantSend) in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubrawprayer=<address>", _("Enable publish prayer messages in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubdcc=<address>", _("Enable publish DCC association messages in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubspork=<address>", _("Enable publish spork changes in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubgobject=<address>", _("Enable publish governance objects in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubgovvote=<address>", _("Enable publish governance votes in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubsuperblock=<address>", _("Enable publish superblock payments in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubmnlistdiff=<address>", _("Enable publish masternode list changes in <address>"));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -754,6 +792,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), BaseParams(CBaseChainParams::MAIN).RPCPort(), BaseParams(CBaseChainParams::TESTNET).RPCPort()));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpcbatchthreads=<n>", strprintf(_("Set the number of threads running read only calls of one batch request (default: %d)"), DEFAULT_RPC_BATCH_THREADS));
+    strUsage += HelpMessageOpt("-rpcexecthreads=<n>", strprintf(_("Set the number of threads running long exec commands, apart from the RPC threads; others wait for their turn (default: %d)"), DEFAULT_RPC_EXEC_THREADS));
     if (showDebug) {
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
@@ -1445,6 +1485,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadMessageSigCheck);
     }
 
 	std::string sSporkKeyName = fProd ? "-sporkkey" : "-sporkkeytest";
@@ -1700,15 +1742,25 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nTotalCache = (GetArg("-dbcache", nDefaultDbCache) << 20);
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
     nTotalCache = std::min(nTotalCache, nMaxDbCache << 20); // total cache cannot be greated than nMaxDbcache
+    bool fIndexes = GetBoolArg("-txindex", DEFAULT_TXINDEX) || GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) ||
+                    GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX) || GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
     int64_t nBlockTreeDBCache = nTotalCache / 8;
-    if (nBlockTreeDBCache > (1 << 21) && !GetBoolArg("-txindex", DEFAULT_TXINDEX))
+    if (nBlockTreeDBCache > (1 << 21) && !fIndexes)
         nBlockTreeDBCache = (1 << 21); // block tree db cache shouldn't be larger than 2 MiB
-    nTotalCache -= nBlockTreeDBCache;
+    int64_t nIndexDBCache = 0;
+    if (GetBoolArg("-splitindexdb", DEFAULT_SPLITINDEXDB)) {
+        // The block index proper is read once at startup, the indexes take the rest of its share
+        nIndexDBCache = std::max(nBlockTreeDBCache - (1 << 21), (int64_t)(1 << 20));
+        nBlockTreeDBCache = std::min(nBlockTreeDBCache, (int64_t)(1 << 21));
+    }
+    nTotalCache -= nBlockTreeDBCache + nIndexDBCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    if (nIndexDBCache > 0)
+        LogPrintf("* Using %.1fMiB for index database\n", nIndexDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
 
@@ -1728,7 +1780,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete pcoinscatcher;
                 delete pblocktree;
 
-                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex);
+                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, nIndexDBCache);
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
@@ -1762,6 +1814,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                // Check for changed -splitindexdb state
+                bool fSplitIndexDB = false;
+                pblocktree->ReadFlag("splitindexdb", fSplitIndexDB);
+                if (fSplitIndexDB != pblocktree->HasSeparateIndexDB()) {
+                    strLoadError = _("You need to rebuild the database using -reindex to change -splitindexdb");
+                    break;
+                }
+
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -1834,7 +1894,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Allowed to fail as this file IS missing on first startup.
     if (!est_filein.IsNull())
         mempool.ReadFeeEstimates(est_filein);
+    nFeeEstimatesFlushedHeight = mempool.GetFeeEstimatesHeight();
     fFeeEstimatesInitialized = true;
+    scheduler.scheduleEvery(&PeriodicFlushFeeEstimates, FEE_ESTIMATES_FLUSH_INTERVAL);
 
 	// **************************** Step 7.5 Initialize KJV Bible
 
@@ -63,14 +63,20 @@ void CInstantSend::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataSt
         CTxLockVote vote;
         vRecv >> vote;
 
-        LOCK2(cs_main, cs_instantsend);
-
         uint256 nVoteHash = vote.GetHash();
 
-        if(mapTxLockVotes.count(nVoteHash)) return;
-        mapTxLockVotes.insert(std::make_pair(nVoteHash, vote));
+        // The duplicate filter, masternode rank and signature checks do not need cs_main or
+        // cs_instantsend, only apply the vote to the lock bookkeeping under them
+        if(!txLockVotes.Insert(nVoteHash, vote)) return;
+
+        if(!vote.IsValid(pfrom)) {
+            // could be because of missing MN
+            LogPrint("instantsend", "CInstantSend::ProcessMessage -- Vote is invalid, txid=%s\n", vote.GetTxHash().ToString());
+            return;
+        }
 
-        ProcessTxLockVote(pfrom, vote);
+        LOCK2(cs_main, cs_instantsend);
+        ProcessTxLockVote(pfrom, vote, true);
 
         return;
     }
@@ -82,29 +88,29 @@ void CInstantSend::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataSt
 
 
 
-bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest)
+bool CInstantSend::ProcessTxLockRequest(const CTxLockRequestRef& txLockRequest)
 {
     LOCK2(cs_main, cs_instantsend);
 
-    uint256 txHash = txLockRequest.GetHash();
+    uint256 txHash = txLockRequest->GetHash();
 
     // Check to see if we conflict with existing completed lock,
-    BOOST_FOREACH(const CTxIn& txin, txLockRequest.vin) {
-        std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(txin.prevout);
-        if(it != mapLockedOutpoints.end() && it->second != txLockRequest.GetHash()) {
+    BOOST_FOREACH(const CTxIn& txin, txLockRequest->vin) {
+        boost::unordered_map<COutPoint, uint256, COutPointKeyHasher>::iterator it = mapLockedOutpoints.find(txin.prevout);
+        if(it != mapLockedOutpoints.end() && it->second != txLockRequest->GetHash()) {
               // Conflicting with complete lock, proceed to see if we should cancel them both
               LogPrintf("CInstantSend::ProcessTxLockRequest -- WARNING: Found conflicting completed Transaction Lock, txid=%s, completed lock txid=%s\n",
-                      txLockRequest.GetHash().ToString(), it->second.ToString());
+                      txLockRequest->GetHash().ToString(), it->second.ToString());
         }
     }
 
     // Check to see if there are votes for conflicting request,
     // if so - do not fail, just warn user
-    BOOST_FOREACH(const CTxIn& txin, txLockRequest.vin) {
-        std::map<COutPoint, std::set<uint256> >::iterator it = mapVotedOutpoints.find(txin.prevout);
+    BOOST_FOREACH(const CTxIn& txin, txLockRequest->vin) {
+        boost::unordered_map<COutPoint, std::set<uint256>, COutPointKeyHasher>::iterator it = mapVotedOutpoints.find(txin.prevout);
         if(it != mapVotedOutpoints.end()) {
             BOOST_FOREACH(const uint256& hash, it->second) {
-                if(hash != txLockRequest.GetHash()) {
+                if(hash != txLockRequest->GetHash()) {
                     LogPrint("instantsend", "CInstantSend::ProcessTxLockRequest -- Double spend attempt! %s\n", txin.prevout.ToStringShort());
                     // do not fail here, let it go and see which one will get the votes to be locked
 					// TODO: notify zmq+script
@@ -121,10 +127,10 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest)
     }
     LogPrintf("CInstantSend::ProcessTxLockRequest -- accepted, txid=%s\n", txHash.ToString());
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     CTxLockCandidate& txLockCandidate = itLockCandidate->second;
     Vote(txLockCandidate);
-    ProcessOrphanTxLockVotes();
+    ProcessOrphanTxLockVotes(txHash);
 
     // Masternodes will sometimes propagate votes before the transaction is known to the client.
     // If this just happened - lock inputs, resolve conflicting locks, update transaction status
@@ -134,37 +140,43 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest)
     return true;
 }
 
-bool CInstantSend::CreateTxLockCandidate(const CTxLockRequest& txLockRequest)
+bool CInstantSend::CreateTxLockCandidate(const CTxLockRequestRef& txLockRequest, bool fValidated)
 {
-    if(!txLockRequest.IsValid()) 
+    if(!fValidated && !txLockRequest->IsValid()) 
 	{
 		return false;
 	}
 
     LOCK(cs_instantsend);
 
-	uint256 txHash = txLockRequest.GetHash();
+	uint256 txHash = txLockRequest->GetHash();
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     if(itLockCandidate == mapTxLockCandidates.end()) 
 	{
          LogPrintf("CInstantSend::CreateTxLockCandidate -- new, txid=%s\n", txHash.ToString());
 
          CTxLockCandidate txLockCandidate(txLockRequest);
          // all inputs should already be checked by txLockRequest.IsValid() above, just use them now
-         BOOST_REVERSE_FOREACH(const CTxIn& txin, txLockRequest.vin) 
+         BOOST_REVERSE_FOREACH(const CTxIn& txin, txLockRequest->vin) 
 		 {
              txLockCandidate.AddOutPointLock(txin.prevout);
          }
          mapTxLockCandidates.insert(std::make_pair(txHash, txLockCandidate));
  	 }
-	 else if (!itLockCandidate->second.txLockRequest.IsBorn) 
+	 else if (!itLockCandidate->second.txLockRequest->IsBorn) 
 	 {
 			// i.e. empty Transaction Lock Candidate was created earlier, let's update it with actual data
 		 	LogPrintf("CInstantSend::CreateTxLockCandidate -- creating birth, txid=%s\n", txHash.ToString());
 		
-			itLockCandidate->second.txLockRequest = txLockRequest;
-			itLockCandidate->second.txLockRequest.IsBorn = true;
+			if (txLockRequest->IsBorn)
+				itLockCandidate->second.txLockRequest = txLockRequest;
+			else
+			{
+				CTxLockRequest txLockRequestBorn(*txLockRequest);
+				txLockRequestBorn.IsBorn = true;
+				itLockCandidate->second.txLockRequest = MakeTxLockRequestRef(txLockRequestBorn);
+			}
 			if (itLockCandidate->second.IsTimedOut()) 
 			{ 
 				LogPrintf("CInstantSend::CreateTxLockCandidate -- timed out, txid=%s\n", txHash.ToString());
@@ -173,7 +185,7 @@ bool CInstantSend::CreateTxLockCandidate(const CTxLockRequest& txLockRequest)
             LogPrintf("CInstantSend::CreateTxLockCandidate -- update empty, txid=%s\n", txHash.ToString());
  
             // all inputs should already be checked by txLockRequest.IsValid() above, just use them now
-            BOOST_REVERSE_FOREACH(const CTxIn& txin, txLockRequest.vin) 
+            BOOST_REVERSE_FOREACH(const CTxIn& txin, txLockRequest->vin) 
 		    {
                itLockCandidate->second.AddOutPointLock(txin.prevout);
             }
@@ -190,8 +202,9 @@ void CInstantSend::CreateEmptyTxLockCandidate(const uint256& txHash)
     if (mapTxLockCandidates.find(txHash) != mapTxLockCandidates.end())
         return;
     LogPrint("instantsend","CInstantSend::CreateEmptyTxLockCandidate -- new, txid=%s\n", txHash.ToString());
-    const CTxLockRequest txLockRequest = CTxLockRequest();
-    mapTxLockCandidates.insert(std::make_pair(txHash, CTxLockCandidate(txLockRequest)));
+    // Every empty candidate shares the one empty request
+    static const CTxLockRequestRef txLockRequestEmpty = MakeTxLockRequestRef(CTxLockRequest());
+    mapTxLockCandidates.insert(std::make_pair(txHash, CTxLockCandidate(txLockRequestEmpty)));
 }
 
 
@@ -219,7 +232,7 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate)
 
         int nLockInputHeight = nPrevoutHeight + 4;
 
-        int n = mnodeman.GetMasternodeRank(activeMasternode.vin, nLockInputHeight, MIN_INSTANTSEND_PROTO_VERSION);
+        int n = GetMasternodeRank(activeMasternode.vin.prevout, nLockInputHeight);
 
         if(n == -1) {
             LogPrint("instantsend", "CInstantSend::Vote -- Unknown Masternode %s\n", activeMasternode.vin.prevout.ToStringShort());
@@ -236,14 +249,14 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate)
 
         LogPrint("instantsend", "CInstantSend::Vote -- In the top %d (%d)\n", nSignaturesTotal, n);
 
-        std::map<COutPoint, std::set<uint256> >::iterator itVoted = mapVotedOutpoints.find(itOutpointLock->first);
+        boost::unordered_map<COutPoint, std::set<uint256>, COutPointKeyHasher>::iterator itVoted = mapVotedOutpoints.find(itOutpointLock->first);
 
         // Check to see if we already voted for this outpoint,
         // refuse to vote twice or to include the same outpoint in another tx
         bool fAlreadyVoted = false;
         if(itVoted != mapVotedOutpoints.end()) {
             BOOST_FOREACH(const uint256& hash, itVoted->second) {
-                std::map<uint256, CTxLockCandidate>::iterator it2 = mapTxLockCandidates.find(hash);
+                boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator it2 = mapTxLockCandidates.find(hash);
                 if(it2->second.HasMasternodeVoted(itOutpointLock->first, activeMasternode.vin.prevout)) {
                     // we already voted for this outpoint to be included either in the same tx or in a competing one,
                     // skip it anyway
@@ -273,7 +286,7 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate)
 
         // vote constructed sucessfully, let's store and relay it
         uint256 nVoteHash = vote.GetHash();
-        mapTxLockVotes.insert(std::make_pair(nVoteHash, vote));
+        txLockVotes.Insert(nVoteHash, vote);
         if(itOutpointLock->second.AddVote(vote)) {
             LogPrintf("CInstantSend::Vote -- Vote created successfully, relaying: txHash=%s, outpoint=%s, vote=%s\n",
                     txHash.ToString(), itOutpointLock->first.ToStringShort(), nVoteHash.ToString());
@@ -299,7 +312,7 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate)
 }
 
 //received a consensus vote
-bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote)
+bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, bool fValidated)
 {
     // cs_main, cs_wallet and cs_instantsend should be already locked
     AssertLockHeld(cs_main);
@@ -311,7 +324,7 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote)
 
     uint256 txHash = vote.GetTxHash();
 
-    if(!vote.IsValid(pfrom)) 
+    if(!fValidated && !vote.IsValid(pfrom)) 
 	{
         // could be because of missing MN
         LogPrint("instantsend", "CInstantSend::ProcessTxLockVote -- Vote is invalid, txid=%s\n", txHash.ToString());
@@ -324,18 +337,18 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote)
     // Masternodes will sometimes propagate votes before the transaction is known to the client,
     // will actually process only after the lock request itself has arrived
 
-    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
-    if(it == mapTxLockCandidates.end() || !it->second.txLockRequest.IsBorn) 
+    boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator it = mapTxLockCandidates.find(txHash);
+    if(it == mapTxLockCandidates.end() || !it->second.txLockRequest->IsBorn) 
 	{
 	    if(!mapTxLockVotesOrphan.count(vote.GetHash())) 
 		{
     		// start timeout countdown after the very first vote
             CreateEmptyTxLockCandidate(txHash);
-            mapTxLockVotesOrphan[vote.GetHash()] = vote;
+            AddOrphanTxLockVote(vote);
             LogPrint("instantsend", "CInstantSend::ProcessTxLockVote -- Orphan vote: txid=%s  masternode=%s new\n",
                     txHash.ToString(), vote.GetMasternodeOutpoint().ToStringShort());
             bool fReprocess = true;
-            std::map<uint256, CTxLockRequest>::iterator itLockRequest = mapLockRequestAccepted.find(txHash);
+            boost::unordered_map<uint256, CTxLockRequestRef, CCoinsKeyHasher>::iterator itLockRequest = mapLockRequestAccepted.find(txHash);
             if(itLockRequest == mapLockRequestAccepted.end()) {
                 itLockRequest = mapLockRequestRejected.find(txHash);
                 if(itLockRequest == mapLockRequestRejected.end()) {
@@ -343,11 +356,12 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote)
                     fReprocess = false;
                 }
             }
-            if(fReprocess && IsEnoughOrphanVotesForTx(itLockRequest->second)) {
+            if(fReprocess && IsEnoughOrphanVotesForTx(*itLockRequest->second)) {
                 // We have enough votes for corresponding lock to complete,
                 // tx lock request should already be received at this stage.
                 LogPrint("instantsend", "CInstantSend::ProcessTxLockVote -- Found enough orphan votes, reprocessing Transaction Lock Request: txid=%s\n", txHash.ToString());
-                ProcessTxLockRequest(itLockRequest->second);
+                CTxLockRequestRef txLockRequest = itLockRequest->second;
+                ProcessTxLockRequest(txLockRequest);
                 return true;
             }
         } else {
@@ -359,10 +373,12 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote)
         // TO DO: make sure this works good enough for multi-quorum
 
         int nMasternodeOrphanExpireTime = GetTime() + 60*10; // keep time data for 10 minutes
-        if(!mapMasternodeOrphanVotes.count(vote.GetMasternodeOutpoint())) {
-            mapMasternodeOrphanVotes[vote.GetMasternodeOutpoint()] = nMasternodeOrphanExpireTime;
+        boost::unordered_map<COutPoint, int64_t, COutPointKeyHasher>::iterator itMnOrphan = mapMasternodeOrphanVotes.find(vote.GetMasternodeOutpoint());
+        if(itMnOrphan == mapMasternodeOrphanVotes.end()) {
+            mapMasternodeOrphanVotes.insert(std::make_pair(vote.GetMasternodeOutpoint(), (int64_t)nMasternodeOrphanExpireTime));
+            nMasternodeOrphanVoteTimeTotal += nMasternodeOrphanExpireTime;
         } else {
-            int64_t nPrevOrphanVote = mapMasternodeOrphanVotes[vote.GetMasternodeOutpoint()];
+            int64_t nPrevOrphanVote = itMnOrphan->second;
             if(nPrevOrphanVote > GetTime() && nPrevOrphanVote > GetAverageMasternodeOrphanVoteTime()) {
                 LogPrint("instantsend", "CInstantSend::ProcessTxLockVote -- masternode is spamming orphan Transaction Lock Votes: txid=%s  masternode=%s\n",
                         txHash.ToString(), vote.GetMasternodeOutpoint().ToStringShort());
@@ -370,7 +386,8 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote)
                 return false;
             }
             // not spamming, refresh
-            mapMasternodeOrphanVotes[vote.GetMasternodeOutpoint()] = nMasternodeOrphanExpireTime;
+            nMasternodeOrphanVoteTimeTotal += nMasternodeOrphanExpireTime - nPrevOrphanVote;
+            itMnOrphan->second = nMasternodeOrphanExpireTime;
         }
 
         return true;
@@ -385,7 +402,7 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote)
  
     LogPrint("instantsend", "CInstantSend::ProcessTxLockVote -- Transaction Lock Vote, txid=%s\n", txHash.ToString());
 
-    std::map<COutPoint, std::set<uint256> >::iterator it1 = mapVotedOutpoints.find(vote.GetOutpoint());
+    boost::unordered_map<COutPoint, std::set<uint256>, COutPointKeyHasher>::iterator it1 = mapVotedOutpoints.find(vote.GetOutpoint());
     if(it1 != mapVotedOutpoints.end()) {
         BOOST_FOREACH(const uint256& hash, it1->second) {
             if(hash != txHash) {
@@ -393,7 +410,7 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote)
 				// let's see if it was the same masternode who voted on this outpoint
                 // for another tx lock request
 
-                std::map<uint256, CTxLockCandidate>::iterator it2 = mapTxLockCandidates.find(hash);
+                boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator it2 = mapTxLockCandidates.find(hash);
                 
 				if(it2 !=mapTxLockCandidates.end() && it2->second.HasMasternodeVoted(vote.GetOutpoint(), vote.GetMasternodeOutpoint())) 
 				{
@@ -427,7 +444,7 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote)
     }
 
     int nSignatures = txLockCandidate.CountVotes();
-    int nSignaturesMax = txLockCandidate.txLockRequest.GetMaxSignatures();
+    int nSignaturesMax = txLockCandidate.txLockRequest->GetMaxSignatures();
     LogPrint("instantsend", "CInstantSend::ProcessTxLockVote -- Transaction Lock signatures count: %d/%d, vote hash=%s\n",
             nSignatures, nSignaturesMax, vote.GetHash().ToString());
 
@@ -436,15 +453,39 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote)
     return true;
 }
 
-void CInstantSend::ProcessOrphanTxLockVotes()
+void CInstantSend::AddOrphanTxLockVote(const CTxLockVote& vote)
+{
+    uint256 nVoteHash = vote.GetHash();
+    mapTxLockVotesOrphan[nVoteHash] = vote;
+    mapTxLockVotesOrphanByTx[vote.GetTxHash()].insert(nVoteHash);
+}
+
+void CInstantSend::EraseOrphanTxLockVote(const uint256& nVoteHash)
+{
+    boost::unordered_map<uint256, CTxLockVote, CCoinsKeyHasher>::iterator it = mapTxLockVotesOrphan.find(nVoteHash);
+    if(it == mapTxLockVotesOrphan.end()) return;
+    boost::unordered_map<uint256, std::set<uint256>, CCoinsKeyHasher>::iterator itByTx = mapTxLockVotesOrphanByTx.find(it->second.GetTxHash());
+    if(itByTx != mapTxLockVotesOrphanByTx.end()) {
+        itByTx->second.erase(nVoteHash);
+        if(itByTx->second.empty()) mapTxLockVotesOrphanByTx.erase(itByTx);
+    }
+    mapTxLockVotesOrphan.erase(it);
+}
+
+void CInstantSend::ProcessOrphanTxLockVotes(const uint256& txHash)
 {
     LOCK2(cs_main, cs_instantsend);
-    std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotesOrphan.begin();
-    while(it != mapTxLockVotesOrphan.end()) {
-        if(ProcessTxLockVote(NULL, it->second)) {
-            mapTxLockVotesOrphan.erase(it++);
-        } else {
-            ++it;
+    // Only votes for this tx can have stopped being orphans
+    boost::unordered_map<uint256, std::set<uint256>, CCoinsKeyHasher>::iterator itByTx = mapTxLockVotesOrphanByTx.find(txHash);
+    if(itByTx == mapTxLockVotesOrphanByTx.end()) return;
+    // copy, processing a vote can modify the orphan maps
+    std::set<uint256> setVoteHashes = itByTx->second;
+    BOOST_FOREACH(const uint256& nVoteHash, setVoteHashes) {
+        boost::unordered_map<uint256, CTxLockVote, CCoinsKeyHasher>::iterator it = mapTxLockVotesOrphan.find(nVoteHash);
+        if(it == mapTxLockVotesOrphan.end()) continue;
+        CTxLockVote vote = it->second;
+        if(ProcessTxLockVote(NULL, vote)) {
+            EraseOrphanTxLockVote(nVoteHash);
         }
     }
 }
@@ -467,15 +508,16 @@ bool CInstantSend::IsEnoughOrphanVotesForTxAndOutPoint(const uint256& txHash, co
     // Scan orphan votes to check if this outpoint has enough orphan votes to be locked in some tx.
     LOCK2(cs_main, cs_instantsend);
     int nCountVotes = 0;
-    std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotesOrphan.begin();
-    while(it != mapTxLockVotesOrphan.end()) {
-        if(it->second.GetTxHash() == txHash && it->second.GetOutpoint() == outpoint) {
+    boost::unordered_map<uint256, std::set<uint256>, CCoinsKeyHasher>::iterator itByTx = mapTxLockVotesOrphanByTx.find(txHash);
+    if(itByTx == mapTxLockVotesOrphanByTx.end()) return false;
+    BOOST_FOREACH(const uint256& nVoteHash, itByTx->second) {
+        boost::unordered_map<uint256, CTxLockVote, CCoinsKeyHasher>::iterator it = mapTxLockVotesOrphan.find(nVoteHash);
+        if(it != mapTxLockVotesOrphan.end() && it->second.GetOutpoint() == outpoint) {
             nCountVotes++;
             if(nCountVotes >= COutPointLock::SIGNATURES_REQUIRED) {
                 return true;
             }
         }
-        ++it;
     }
     return false;
 }
@@ -499,7 +541,7 @@ void CInstantSend::TryToFinalizeLockCandidate(const CTxLockCandidate& txLockCand
  
     LOCK2(cs_main, cs_instantsend);
 
-    uint256 txHash = txLockCandidate.txLockRequest.GetHash();
+    uint256 txHash = txLockCandidate.txLockRequest->GetHash();
 	if (fDebugMaster) LogPrint("debug10", "InstantSend : AllOutPointReady %f, IsLockedInstantSendTransaction %f, bool %f \n",(float)txLockCandidate.IsAllOutPointsReady(),	(float)IsLockedInstantSendTransaction(txHash), (float)true); 
 
     if(txLockCandidate.IsAllOutPointsReady() && !IsLockedInstantSendTransaction(txHash)) 
@@ -534,7 +576,7 @@ void CInstantSend::UpdateLockedTransaction(const CTxLockCandidate& txLockCandida
     }
 #endif
 
-    GetMainSignals().NotifyTransactionLock(txLockCandidate.txLockRequest);
+    GetMainSignals().NotifyTransactionLock(*txLockCandidate.txLockRequest);
 
     LogPrint("instantsend", "CInstantSend::UpdateLockedTransaction -- done, txid=%s\n", txHash.ToString());
 }
@@ -573,7 +615,7 @@ void CInstantSend::LockTransactionInputs(const CTxLockCandidate& txLockCandidate
 bool CInstantSend::GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet)
 {
     LOCK(cs_instantsend);
-    std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(outpoint);
+    boost::unordered_map<COutPoint, uint256, COutPointKeyHasher>::iterator it = mapLockedOutpoints.find(outpoint);
     if(it == mapLockedOutpoints.end()) return false;
     hashRet = it->second;
     return true;
@@ -592,7 +634,7 @@ bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
 	}
     LOCK(mempool.cs); // protect mempool.mapNextTx
 
-    BOOST_FOREACH(const CTxIn& txin, txLockCandidate.txLockRequest.vin) 
+    BOOST_FOREACH(const CTxIn& txin, txLockCandidate.txLockRequest->vin) 
 	{
         uint256 hashConflicting;
         if(GetLockedOutPointTxHash(txin.prevout, hashConflicting) && txHash != hashConflicting) 
@@ -600,8 +642,8 @@ bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
 
 			 // completed lock which conflicts with another completed one?
              // this means that majority of MNs in the quorum for this specific tx input are malicious!
-             std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
-             std::map<uint256, CTxLockCandidate>::iterator itLockCandidateConflicting = mapTxLockCandidates.find(hashConflicting);
+             boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+             boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator itLockCandidateConflicting = mapTxLockCandidates.find(hashConflicting);
              if(itLockCandidate == mapTxLockCandidates.end() || itLockCandidateConflicting == mapTxLockCandidates.end()) 
 			 {
                  // safety check, should never really happen
@@ -612,8 +654,8 @@ bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
               LogPrintf("CInstantSend::ResolveConflicts -- WARNING: Found conflicting completed Transaction Lock, dropping both, txid=%s, conflicting txid=%s\n",
                       txHash.ToString(), hashConflicting.ToString());
 
-			  CTxLockRequest txLockRequest = itLockCandidate->second.txLockRequest;
-              CTxLockRequest txLockRequestConflicting = itLockCandidateConflicting->second.txLockRequest;
+			  CTxLockRequestRef txLockRequest = itLockCandidate->second.txLockRequest;
+              CTxLockRequestRef txLockRequestConflicting = itLockCandidateConflicting->second.txLockRequest;
               itLockCandidate->second.SetConfirmedHeight(0); // expired
               itLockCandidateConflicting->second.SetConfirmedHeight(0); // expired
               CheckAndRemove(); // clean up
@@ -654,7 +696,7 @@ bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
         return true;
     }
     // Not in block yet, make sure all its inputs are still unspent
-    BOOST_FOREACH(const CTxIn& txin, txLockCandidate.txLockRequest.vin) 
+    BOOST_FOREACH(const CTxIn& txin, txLockCandidate.txLockRequest->vin) 
 	{
         CCoins coins;
         //if(!pcoinsTip->GetCoins(txin.prevout.hash, coins))
@@ -677,16 +719,8 @@ int64_t CInstantSend::GetAverageMasternodeOrphanVoteTime()
     // NOTE: should never actually call this function when mapMasternodeOrphanVotes is empty
     if(mapMasternodeOrphanVotes.empty()) return 0;
 
-    std::map<COutPoint, int64_t>::iterator it = mapMasternodeOrphanVotes.begin();
-    int64_t total = 0;
-
-    while(it != mapMasternodeOrphanVotes.end()) 
-	{
-        total+= it->second;
-        ++it;
-    }
-
-    return total / mapMasternodeOrphanVotes.size();
+    // the total is kept up to date as entries are added, refreshed and removed
+    return nMasternodeOrphanVoteTimeTotal / (int64_t)mapMasternodeOrphanVotes.size();
 }
 
 void CInstantSend::CheckAndRemove()
@@ -697,7 +731,7 @@ void CInstantSend::CheckAndRemove()
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.begin();
+    boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator itLockCandidate = mapTxLockCandidates.begin();
 
     // remove expired candidates
     while(itLockCandidate != mapTxLockCandidates.end()) {
@@ -722,75 +756,115 @@ void CInstantSend::CheckAndRemove()
     }
 
     // remove expired votes
-    std::map<uint256, CTxLockVote>::iterator itVote = mapTxLockVotes.begin();
-    while(itVote != mapTxLockVotes.end()) {
-        if(itVote->second.IsExpired(nCachedBlockHeight)) {
-            LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing expired vote: txid=%s  masternode=%s\n",
-                    itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToStringShort());
-            mapTxLockVotes.erase(itVote++);
-        } else {
-            ++itVote;
-        }
-    }
+    txLockVotes.RemoveExpired(nCachedBlockHeight);
 
     // remove expired orphan votes
-    std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.begin();
+    boost::unordered_map<uint256, CTxLockVote, CCoinsKeyHasher>::iterator itOrphanVote = mapTxLockVotesOrphan.begin();
     while(itOrphanVote != mapTxLockVotesOrphan.end()) {
         if(itOrphanVote->second.IsTimedOut()) 
 		{
             LogPrint("instantsend", "CInstantSend::CheckAndRemoveExpiredOrphanVotes -- Removing timed out orphan vote: txid=%s  masternode=%s\n",
                itOrphanVote->second.GetTxHash().ToString(), itOrphanVote->second.GetMasternodeOutpoint().ToStringShort());
-            mapTxLockVotes.erase(itOrphanVote->first);
-            mapTxLockVotesOrphan.erase(itOrphanVote++);
+            uint256 nVoteHash = itOrphanVote->first;
+            ++itOrphanVote;
+            txLockVotes.Erase(nVoteHash);
+            EraseOrphanTxLockVote(nVoteHash);
         } else {
             ++itOrphanVote;
         }
     }
 
     // remove expired masternode orphan votes (DOS protection)
-    std::map<COutPoint, int64_t>::iterator itMasternodeOrphan = mapMasternodeOrphanVotes.begin();
+    boost::unordered_map<COutPoint, int64_t, COutPointKeyHasher>::iterator itMasternodeOrphan = mapMasternodeOrphanVotes.begin();
     while(itMasternodeOrphan != mapMasternodeOrphanVotes.end()) {
         if(itMasternodeOrphan->second < GetTime()) {
             LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing expired orphan masternode vote: masternode=%s\n",
                     itMasternodeOrphan->first.ToStringShort());
+            nMasternodeOrphanVoteTimeTotal -= itMasternodeOrphan->second;
             mapMasternodeOrphanVotes.erase(itMasternodeOrphan++);
         } else {
             ++itMasternodeOrphan;
         }
     }
+
+    // remove stale masternode ranks
+    {
+        LOCK(cs_ranks);
+        std::map<int, CMasternodeRanks>::iterator itRanks = mapMasternodeRanks.begin();
+        while(itRanks != mapMasternodeRanks.end()) {
+            if(GetTime() - itRanks->second.nTimeCalculated > INSTANTSEND_RANK_CACHE_SECONDS) {
+                mapMasternodeRanks.erase(itRanks++);
+            } else {
+                ++itRanks;
+            }
+        }
+    }
+}
+
+int CInstantSend::GetMasternodeRank(const COutPoint& outpointMasternode, int nBlockHeight)
+{
+    {
+        LOCK(cs_ranks);
+        std::map<int, CMasternodeRanks>::iterator it = mapMasternodeRanks.find(nBlockHeight);
+        if(it != mapMasternodeRanks.end() && GetTime() - it->second.nTimeCalculated <= INSTANTSEND_RANK_CACHE_SECONDS &&
+                it->second.nRanksVersion == mnodeman.GetRanksVersion()) {
+            boost::unordered_map<COutPoint, int, COutPointKeyHasher>::iterator itRank = it->second.mapRanks.find(outpointMasternode);
+            return itRank == it->second.mapRanks.end() ? -1 : itRank->second;
+        }
+    }
+
+    // Rank the whole list once per height; cs_ranks must not be held here because
+    // GetMasternodeRanks takes cs_main and the masternode manager lock.  The version is
+    // read first, so a list change while ranking makes the next call rank again
+    int nRanksVersion = mnodeman.GetRanksVersion();
+    std::vector<std::pair<int, CMasternode> > vecMasternodeRanks = mnodeman.GetMasternodeRanks(nBlockHeight, MIN_INSTANTSEND_PROTO_VERSION);
+    if(vecMasternodeRanks.empty()) return -1;
+
+    CMasternodeRanks ranks;
+    ranks.nTimeCalculated = GetTime();
+    ranks.nRanksVersion = nRanksVersion;
+    int nRank = -1;
+    for(std::vector<std::pair<int, CMasternode> >::iterator it = vecMasternodeRanks.begin(); it != vecMasternodeRanks.end(); ++it) {
+        ranks.mapRanks[it->second.vin.prevout] = it->first;
+        if(it->second.vin.prevout == outpointMasternode) nRank = it->first;
+    }
+
+    LOCK(cs_ranks);
+    mapMasternodeRanks[nBlockHeight] = ranks;
+    return nRank;
 }
 
 bool CInstantSend::AlreadyHave(const uint256& hash)
 {
+    if(txLockVotes.Has(hash)) return true;
     LOCK(cs_instantsend);
     return mapLockRequestAccepted.count(hash) ||
-            mapLockRequestRejected.count(hash) ||
-            mapTxLockVotes.count(hash);
+            mapLockRequestRejected.count(hash);
 }
 
-void CInstantSend::AcceptLockRequest(const CTxLockRequest& txLockRequest)
+void CInstantSend::AcceptLockRequest(const CTxLockRequestRef& txLockRequest)
 {
     LOCK(cs_instantsend);
-    mapLockRequestAccepted.insert(make_pair(txLockRequest.GetHash(), txLockRequest));
+    mapLockRequestAccepted.insert(make_pair(txLockRequest->GetHash(), txLockRequest));
 }
 
-void CInstantSend::RejectLockRequest(const CTxLockRequest& txLockRequest)
+void CInstantSend::RejectLockRequest(const CTxLockRequestRef& txLockRequest)
 {
     LOCK(cs_instantsend);
-    mapLockRequestRejected.insert(make_pair(txLockRequest.GetHash(), txLockRequest));
+    mapLockRequestRejected.insert(make_pair(txLockRequest->GetHash(), txLockRequest));
 }
 
 bool CInstantSend::HasTxLockRequest(const uint256& txHash)
 {
-    CTxLockRequest txLockRequestTmp;
+    CTxLockRequestRef txLockRequestTmp;
     return GetTxLockRequest(txHash, txLockRequestTmp);
 }
 
-bool CInstantSend::GetTxLockRequest(const uint256& txHash, CTxLockRequest& txLockRequestRet)
+bool CInstantSend::GetTxLockRequest(const uint256& txHash, CTxLockRequestRef& txLockRequestRet)
 {
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+    boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator it = mapTxLockCandidates.find(txHash);
     if(it == mapTxLockCandidates.end()) return false;
     txLockRequestRet = it->second.txLockRequest;
 
@@ -799,13 +873,7 @@ bool CInstantSend::GetTxLockRequest(const uint256& txHash, CTxLockRequest& txLoc
 
 bool CInstantSend::GetTxLockVote(const uint256& hash, CTxLockVote& txLockVoteRet)
 {
-    LOCK(cs_instantsend);
-
-    std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotes.find(hash);
-    if(it == mapTxLockVotes.end()) return false;
-    txLockVoteRet = it->second;
-
-    return true;
+    return txLockVotes.Get(hash, txLockVoteRet);
 }
 
 bool CInstantSend::IsInstantSendReadyToLock(const uint256& txHash)
@@ -816,7 +884,7 @@ bool CInstantSend::IsInstantSendReadyToLock(const uint256& txHash)
     LOCK(cs_instantsend);
     // There must be a successfully verified lock request
     // and all outputs must be locked (i.e. have enough signatures)
-    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+    boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator it = mapTxLockCandidates.find(txHash);
     return it != mapTxLockCandidates.end() && it->second.IsAllOutPointsReady();
 }
 
@@ -828,7 +896,7 @@ bool CInstantSend::IsLockedInstantSendTransaction(const uint256& txHash)
     LOCK(cs_instantsend);
 
     // there must be a lock candidate
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     if(itLockCandidate == mapTxLockCandidates.end()) 
 	{
 		return false;
@@ -859,7 +927,7 @@ int CInstantSend::GetTransactionLockSignatures(const uint256& txHash)
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     if(itLockCandidate != mapTxLockCandidates.end()) {
         return itLockCandidate->second.CountVotes();
     }
@@ -878,7 +946,7 @@ bool CInstantSend::IsTxLockCandidateTimedOut(const uint256& txHash)
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate != mapTxLockCandidates.end()) 
 	{
         return !itLockCandidate->second.IsAllOutPointsReady() &&
@@ -892,7 +960,7 @@ void CInstantSend::Relay(const uint256& txHash)
 {
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::const_iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::const_iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate != mapTxLockCandidates.end()) {
         itLockCandidate->second.Relay();
     }
@@ -901,6 +969,10 @@ void CInstantSend::Relay(const uint256& txHash)
 void CInstantSend::UpdatedBlockTip(const CBlockIndex *pindex)
 {
     nCachedBlockHeight = pindex->nHeight;
+
+    // a reorg can change the block hashes the ranks were scored against
+    LOCK(cs_ranks);
+    mapMasternodeRanks.clear();
 }
 
 void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
@@ -933,7 +1005,7 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
     LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d\n", txHash.ToString(), nHeightNew);
 
      // Check lock candidates
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     if(itLockCandidate != mapTxLockCandidates.end()) {
         LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d lock candidate updated\n",
                 txHash.ToString(), nHeightNew);
@@ -944,15 +1016,11 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
             // Check corresponding lock votes
             std::vector<CTxLockVote> vVotes = itOutpointLock->second.GetVotes();
             std::vector<CTxLockVote>::iterator itVote = vVotes.begin();
-            std::map<uint256, CTxLockVote>::iterator it;
             while(itVote != vVotes.end()) {
                 uint256 nVoteHash = itVote->GetHash();
                 LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d vote %s updated\n",
                         txHash.ToString(), nHeightNew, nVoteHash.ToString());
-                it = mapTxLockVotes.find(nVoteHash);
-                if(it != mapTxLockVotes.end()) {
-                    it->second.SetConfirmedHeight(nHeightNew);
-                }
+                txLockVotes.SetConfirmedHeight(nVoteHash, nHeightNew);
                 ++itVote;
             }
             ++itOutpointLock;
@@ -960,20 +1028,91 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
     }
 
      // check orphan votes
-    std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.begin();
-    while(itOrphanVote != mapTxLockVotesOrphan.end()) {
-        if(itOrphanVote->second.GetTxHash() == txHash) {
+    boost::unordered_map<uint256, std::set<uint256>, CCoinsKeyHasher>::iterator itOrphanVotes = mapTxLockVotesOrphanByTx.find(txHash);
+    if(itOrphanVotes != mapTxLockVotesOrphanByTx.end()) {
+        BOOST_FOREACH(const uint256& nVoteHash, itOrphanVotes->second) {
             LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d vote %s updated\n",
-                    txHash.ToString(), nHeightNew, itOrphanVote->first.ToString());
-            mapTxLockVotes[itOrphanVote->first].SetConfirmedHeight(nHeightNew);
+                    txHash.ToString(), nHeightNew, nVoteHash.ToString());
+            txLockVotes.SetConfirmedHeight(nVoteHash, nHeightNew);
         }
-        ++itOrphanVote;
     }
 }
 std::string CInstantSend::ToString()
 {
     LOCK(cs_instantsend);
-    return strprintf("Lock Candidates: %llu, Votes %llu", mapTxLockCandidates.size(), mapTxLockVotes.size());
+    return strprintf("Lock Candidates: %llu, Votes %llu", mapTxLockCandidates.size(), txLockVotes.Size());
+}
+
+//
+// CTxLockVoteStore
+//
+
+bool CTxLockVoteStore::Insert(const uint256& hash, const CTxLockVote& vote)
+{
+    Shard& shard = GetShard(hash);
+    LOCK(shard.cs);
+    return shard.mapVotes.insert(std::make_pair(hash, vote)).second;
+}
+
+bool CTxLockVoteStore::Has(const uint256& hash) const
+{
+    const Shard& shard = GetShard(hash);
+    LOCK(shard.cs);
+    return shard.mapVotes.count(hash);
+}
+
+bool CTxLockVoteStore::Get(const uint256& hash, CTxLockVote& voteRet) const
+{
+    const Shard& shard = GetShard(hash);
+    LOCK(shard.cs);
+    boost::unordered_map<uint256, CTxLockVote, CCoinsKeyHasher>::const_iterator it = shard.mapVotes.find(hash);
+    if(it == shard.mapVotes.end()) return false;
+    voteRet = it->second;
+    return true;
+}
+
+void CTxLockVoteStore::SetConfirmedHeight(const uint256& hash, int nConfirmedHeight)
+{
+    Shard& shard = GetShard(hash);
+    LOCK(shard.cs);
+    boost::unordered_map<uint256, CTxLockVote, CCoinsKeyHasher>::iterator it = shard.mapVotes.find(hash);
+    if(it != shard.mapVotes.end()) {
+        it->second.SetConfirmedHeight(nConfirmedHeight);
+    }
+}
+
+void CTxLockVoteStore::Erase(const uint256& hash)
+{
+    Shard& shard = GetShard(hash);
+    LOCK(shard.cs);
+    shard.mapVotes.erase(hash);
+}
+
+void CTxLockVoteStore::RemoveExpired(int nHeight)
+{
+    for(int i = 0; i < SHARDS; i++) {
+        LOCK(vShards[i].cs);
+        boost::unordered_map<uint256, CTxLockVote, CCoinsKeyHasher>::iterator itVote = vShards[i].mapVotes.begin();
+        while(itVote != vShards[i].mapVotes.end()) {
+            if(itVote->second.IsExpired(nHeight)) {
+                LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing expired vote: txid=%s  masternode=%s\n",
+                        itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToStringShort());
+                vShards[i].mapVotes.erase(itVote++);
+            } else {
+                ++itVote;
+            }
+        }
+    }
+}
+
+size_t CTxLockVoteStore::Size() const
+{
+    size_t nSize = 0;
+    for(int i = 0; i < SHARDS; i++) {
+        LOCK(vShards[i].cs);
+        nSize += vShards[i].mapVotes.size();
+    }
+    return nSize;
 }
 //
 // CTxLockRequest
@@ -1082,7 +1221,7 @@ bool CTxLockVote::IsValid(CNode* pnode) const
 
     int nLockInputHeight = coins.nHeight + 4;
 
-	int n = mnodeman.GetMasternodeRank(CTxIn(outpointMasternode), nLockInputHeight, MIN_INSTANTSEND_PROTO_VERSION);
+	int n = instantsend.GetMasternodeRank(outpointMasternode, nLockInputHeight);
     if(n == -1) {
         //can be caused by past versions trying to vote with an invalid protocol
         LogPrint("instantsend", "CTxLockVote::IsValid -- Can't calculate rank for masternode %s\n", outpointMasternode.ToStringShort());
@@ -1283,7 +1422,7 @@ bool CTxLockCandidate::IsTimedOut() const
 
 void CTxLockCandidate::Relay() const
 {
-    RelayTransaction(txLockRequest);
+    RelayTransaction(*txLockRequest);
     std::map<COutPoint, COutPointLock>::const_iterator itOutpointLock = mapOutPointLocks.begin();
     while(itOutpointLock != mapOutPointLocks.end()) {
         itOutpointLock->second.Relay();
@@ -4,9 +4,12 @@
 #ifndef INSTANTX_H
 #define INSTANTX_H
 
+#include "coins.h"
 #include "net.h"
 #include "primitives/transaction.h"
 
+#include <boost/unordered_map.hpp>
+
 class CTxLockVote;
 class COutPointLock;
 class CTxLockRequest;
@@ -28,86 +31,21 @@ static const int INSTANTSEND_CONFIRMATIONS_REQUIRED = 6;
 static const int DEFAULT_INSTANTSEND_DEPTH          = 5;
 static const int INSTANTSEND_TIMEOUT_SECONDS        = 180;
 static const int MIN_INSTANTSEND_PROTO_VERSION      = 70714;
+static const int INSTANTSEND_RANK_CACHE_SECONDS     = 60;
  
 extern bool fEnableInstantSend;
 extern int nInstantSendDepth;
 extern int nCompleteTXLocks;
 
-class CInstantSend
+class COutPointKeyHasher
 {
 private:
-    
-    // Keep track of current block index
-    int nCachedBlockHeight;
-
-    // maps for AlreadyHave
-    std::map<uint256, CTxLockRequest> mapLockRequestAccepted; // tx hash - tx
-    std::map<uint256, CTxLockRequest> mapLockRequestRejected; // tx hash - tx
-    std::map<uint256, CTxLockVote> mapTxLockVotes; // vote hash - vote
-    std::map<uint256, CTxLockVote> mapTxLockVotesOrphan; // vote hash - vote
-
-    std::map<uint256, CTxLockCandidate> mapTxLockCandidates; // tx hash - lock candidate
-
-    std::map<COutPoint, std::set<uint256> > mapVotedOutpoints; // utxo - tx hash set
-    std::map<COutPoint, uint256> mapLockedOutpoints; // utxo - tx hash
-
-    //track masternodes who voted with no txreq (for DOS protection)
-    std::map<COutPoint, int64_t> mapMasternodeOrphanVotes; // mn outpoint - time
-
-    bool CreateTxLockCandidate(const CTxLockRequest& txLockRequest);
-	void CreateEmptyTxLockCandidate(const uint256& txHash);
-    void Vote(CTxLockCandidate& txLockCandidate);
-
-    //process consensus vote message
-    bool ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote);
-    void ProcessOrphanTxLockVotes();
-    bool IsEnoughOrphanVotesForTx(const CTxLockRequest& txLockRequest);
-    bool IsEnoughOrphanVotesForTxAndOutPoint(const uint256& txHash, const COutPoint& outpoint);
-    int64_t GetAverageMasternodeOrphanVoteTime();
-
-    void TryToFinalizeLockCandidate(const CTxLockCandidate& txLockCandidate);
-    void LockTransactionInputs(const CTxLockCandidate& txLockCandidate);
-    //update UI and notify external script if any
-    void UpdateLockedTransaction(const CTxLockCandidate& txLockCandidate);
-    bool ResolveConflicts(const CTxLockCandidate& txLockCandidate);
-
-    bool IsInstantSendReadyToLock(const uint256 &txHash);
+    CCoinsKeyHasher hasher;
 
 public:
-    CCriticalSection cs_instantsend;
-
-    void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
-
-    bool ProcessTxLockRequest(const CTxLockRequest& txLockRequest);
-
-    bool AlreadyHave(const uint256& hash);
-
-    void AcceptLockRequest(const CTxLockRequest& txLockRequest);
-    void RejectLockRequest(const CTxLockRequest& txLockRequest);
-    bool HasTxLockRequest(const uint256& txHash);
-    bool GetTxLockRequest(const uint256& txHash, CTxLockRequest& txLockRequestRet);
-
-    bool GetTxLockVote(const uint256& hash, CTxLockVote& txLockVoteRet);
-
-    bool GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet);
-
-    // verify if transaction is currently locked
-    bool IsLockedInstantSendTransaction(const uint256& txHash);
-    // get the actual number of accepted lock signatures
-    int GetTransactionLockSignatures(const uint256& txHash);
-	// get instantsend confirmations (only)
-    int GetConfirmations(const uint256 &nTXHash);
-    // remove expired entries from maps
-    void CheckAndRemove();
-    // verify if transaction lock timed out
-    bool IsTxLockCandidateTimedOut(const uint256& txHash);
-
-    void Relay(const uint256& txHash);
-
-    void UpdatedBlockTip(const CBlockIndex *pindex);
-    void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
-	
-    std::string ToString();
+    size_t operator()(const COutPoint& outpoint) const {
+        return hasher(outpoint.hash) ^ outpoint.n;
+    }
 };
 
 class CTxLockRequest : public CTransaction
@@ -140,6 +78,10 @@ public:
     }
 };
 
+/** Shared, so the lock candidate and the accepted or rejected maps hold one copy of a request */
+typedef boost::shared_ptr<const CTxLockRequest> CTxLockRequestRef;
+template <typename Tx> static inline CTxLockRequestRef MakeTxLockRequestRef(const Tx& txIn) { return boost::make_shared<const CTxLockRequest>(txIn); }
+
 class CTxLockVote
 {
 private:
@@ -231,17 +173,17 @@ private:
     int nConfirmedHeight; // when corresponding tx is 0-confirmed or conflicted, nConfirmedHeight is -1
 	int64_t nTimeCreated;
 public:
-    CTxLockCandidate(const CTxLockRequest& txLockRequestIn) :
+    CTxLockCandidate(const CTxLockRequestRef& txLockRequestIn) :
         nConfirmedHeight(-1),
 		nTimeCreated(GetTime()),
         txLockRequest(txLockRequestIn),
         mapOutPointLocks()
         {}
 
-    CTxLockRequest txLockRequest;
+    CTxLockRequestRef txLockRequest;
     std::map<COutPoint, COutPointLock> mapOutPointLocks;
 
-    uint256 GetHash() const { return txLockRequest.GetHash(); }
+    uint256 GetHash() const { return txLockRequest->GetHash(); }
 
     void AddOutPointLock(const COutPoint& outpoint);
 	void MarkOutpointAsAttacked(const COutPoint& outpoint);
@@ -257,4 +199,138 @@ public:
     void Relay() const;
 };
 
+/**
+ * Lock votes keyed by vote hash.  The map is split into shards that carry their
+ * own lock, so the duplicate filter for incoming votes, AlreadyHave() and getdata
+ * lookups do not have to wait for cs_instantsend.
+ */
+class CTxLockVoteStore
+{
+private:
+    static const int SHARDS = 16;
+
+    struct Shard
+    {
+        mutable CCriticalSection cs;
+        boost::unordered_map<uint256, CTxLockVote, CCoinsKeyHasher> mapVotes;
+    };
+
+    Shard vShards[SHARDS];
+
+    Shard& GetShard(const uint256& hash) { return vShards[hash.GetCheapHash() % SHARDS]; }
+    const Shard& GetShard(const uint256& hash) const { return vShards[hash.GetCheapHash() % SHARDS]; }
+
+public:
+    // returns false if the vote was already known
+    bool Insert(const uint256& hash, const CTxLockVote& vote);
+    bool Has(const uint256& hash) const;
+    bool Get(const uint256& hash, CTxLockVote& voteRet) const;
+    void SetConfirmedHeight(const uint256& hash, int nConfirmedHeight);
+    void Erase(const uint256& hash);
+    void RemoveExpired(int nHeight);
+    size_t Size() const;
+};
+
+class CInstantSend
+{
+private:
+    
+    // Keep track of current block index
+    int nCachedBlockHeight;
+
+    // maps for AlreadyHave
+    boost::unordered_map<uint256, CTxLockRequestRef, CCoinsKeyHasher> mapLockRequestAccepted; // tx hash - tx
+    boost::unordered_map<uint256, CTxLockRequestRef, CCoinsKeyHasher> mapLockRequestRejected; // tx hash - tx
+    CTxLockVoteStore txLockVotes; // vote hash - vote, guarded by its own shard locks
+    boost::unordered_map<uint256, CTxLockVote, CCoinsKeyHasher> mapTxLockVotesOrphan; // vote hash - vote
+    boost::unordered_map<uint256, std::set<uint256>, CCoinsKeyHasher> mapTxLockVotesOrphanByTx; // tx hash - orphan vote hash set
+
+    boost::unordered_map<uint256, CTxLockCandidate, CCoinsKeyHasher> mapTxLockCandidates; // tx hash - lock candidate
+
+    boost::unordered_map<COutPoint, std::set<uint256>, COutPointKeyHasher> mapVotedOutpoints; // utxo - tx hash set
+    boost::unordered_map<COutPoint, uint256, COutPointKeyHasher> mapLockedOutpoints; // utxo - tx hash
+
+    //track masternodes who voted with no txreq (for DOS protection)
+    boost::unordered_map<COutPoint, int64_t, COutPointKeyHasher> mapMasternodeOrphanVotes; // mn outpoint - time
+    int64_t nMasternodeOrphanVoteTimeTotal; // sum of mapMasternodeOrphanVotes values
+
+    // masternode ranks by lock input height, so that every vote does not re-sort the masternode list
+    struct CMasternodeRanks
+    {
+        int64_t nTimeCalculated;
+        int nRanksVersion; // mnodeman.GetRanksVersion() they were computed at
+        boost::unordered_map<COutPoint, int, COutPointKeyHasher> mapRanks;
+    };
+    CCriticalSection cs_ranks;
+    std::map<int, CMasternodeRanks> mapMasternodeRanks; // block height - ranks
+
+	void CreateEmptyTxLockCandidate(const uint256& txHash);
+    void Vote(CTxLockCandidate& txLockCandidate);
+
+    void AddOrphanTxLockVote(const CTxLockVote& vote);
+    void EraseOrphanTxLockVote(const uint256& nVoteHash);
+    void ProcessOrphanTxLockVotes(const uint256& txHash);
+    bool IsEnoughOrphanVotesForTx(const CTxLockRequest& txLockRequest);
+    bool IsEnoughOrphanVotesForTxAndOutPoint(const uint256& txHash, const COutPoint& outpoint);
+    int64_t GetAverageMasternodeOrphanVoteTime();
+
+    void TryToFinalizeLockCandidate(const CTxLockCandidate& txLockCandidate);
+    void LockTransactionInputs(const CTxLockCandidate& txLockCandidate);
+    //update UI and notify external script if any
+    void UpdateLockedTransaction(const CTxLockCandidate& txLockCandidate);
+    bool ResolveConflicts(const CTxLockCandidate& txLockCandidate);
+
+    bool IsInstantSendReadyToLock(const uint256 &txHash);
+
+public:
+    CCriticalSection cs_instantsend;
+
+    CInstantSend() :
+        nCachedBlockHeight(0),
+        nMasternodeOrphanVoteTimeTotal(0)
+        {}
+
+    void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
+
+    bool ProcessTxLockRequest(const CTxLockRequestRef& txLockRequest);
+
+    //process consensus vote message, the vote is checked with CTxLockVote::IsValid() unless fValidated is set
+    bool ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, bool fValidated = false);
+
+    //create or complete the lock candidate for a request, the request is checked with CTxLockRequest::IsValid() unless fValidated is set
+    bool CreateTxLockCandidate(const CTxLockRequestRef& txLockRequest, bool fValidated = false);
+
+    // rank of a masternode among those eligible to vote at nBlockHeight, -1 if unknown
+    int GetMasternodeRank(const COutPoint& outpointMasternode, int nBlockHeight);
+
+    bool AlreadyHave(const uint256& hash);
+
+    void AcceptLockRequest(const CTxLockRequestRef& txLockRequest);
+    void RejectLockRequest(const CTxLockRequestRef& txLockRequest);
+    bool HasTxLockRequest(const uint256& txHash);
+    bool GetTxLockRequest(const uint256& txHash, CTxLockRequestRef& txLockRequestRet);
+
+    bool GetTxLockVote(const uint256& hash, CTxLockVote& txLockVoteRet);
+
+    bool GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet);
+
+    // verify if transaction is currently locked
+    bool IsLockedInstantSendTransaction(const uint256& txHash);
+    // get the actual number of accepted lock signatures
+    int GetTransactionLockSignatures(const uint256& txHash);
+	// get instantsend confirmations (only)
+    int GetConfirmations(const uint256 &nTXHash);
+    // remove expired entries from maps
+    void CheckAndRemove();
+    // verify if transaction lock timed out
+    bool IsTxLockCandidateTimedOut(const uint256& txHash);
+
+    void Relay(const uint256& txHash);
+
+    void UpdatedBlockTip(const CBlockIndex *pindex);
+    void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
+	
+    std::string ToString();
+};
+
 #endif
@@ -0,0 +1,216 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ipfscache.h"
+
+#include "dbwrapper.h"
+#include "podc.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <math.h>
+
+#include <boost/algorithm/string/case_conv.hpp>
+
+static const char DB_IPFS_OBJECT = 'o';
+
+static bool IsDeleted(const UniValue& o)
+{
+    return o["deleted"].getValStr() == "1";
+}
+
+/** The value as the totals add it up: rounded to cents, 0 if it is not a number */
+static int64_t GetCents(const std::string& sValue)
+{
+    try {
+        return llround(cdbl(sValue, 2) * 100);
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+
+CIPFSObjectCache::CIPFSObjectCache(const boost::filesystem::path& path, bool fMemory, const FetchFunction& fetchIn) :
+    fetch(fetchIn), nFetches(0)
+{
+    // Objects are JSON: compressible, and read by point lookup
+    CDBProfile profile;
+    profile.fCompression = true;
+    pdb = new CDBWrapper(path, 1 << 20, fMemory, false, false, profile);
+}
+
+CIPFSObjectCache::~CIPFSObjectCache()
+{
+    delete pdb;
+}
+
+void CIPFSObjectCache::AddIndex(std::string sType, const std::string& sField)
+{
+    boost::to_upper(sType);
+    LOCK(cs);
+    TypeState& state = mapTypes[sType];
+    if (state.mapIndexes.count(sField)) return;
+    FieldIndex& index = state.mapIndexes[sField];
+    for (std::map<std::string, CBusinessObject>::const_iterator it = state.mapObjects.begin(); it != state.mapObjects.end(); ++it) {
+        if (IsDeleted(it->second.o)) continue;
+        std::string sValue = it->second.o[sField].getValStr();
+        index.nSumCents += GetCents(sValue);
+        boost::to_upper(sValue);
+        index.mapValues[sValue].insert(it->first);
+    }
+}
+
+bool CIPFSObjectCache::GetJSON(const std::string& sHash, std::string& sJson, std::string& sError)
+{
+    {
+        LOCK(cs);
+        if (pdb->Read(std::make_pair(DB_IPFS_OBJECT, sHash), sJson)) return true;
+        std::map<std::string, int64_t>::const_iterator it = mapFailed.find(sHash);
+        if (it != mapFailed.end() && GetTime() - it->second < IPFS_CACHE_RETRY_SECONDS) {
+            sError = "IPFS object " + sHash + " could not be fetched recently";
+            return false;
+        }
+    }
+    sError = "";
+    std::string sFetched = fetch(sHash, sError);
+    // Only well formed objects are kept for good; anything else is tried again later
+    UniValue o(UniValue::VOBJ);
+    if (sError.empty() && (!o.read(sFetched) || !o.isObject())) sError = "IPFS object " + sHash + " is not a JSON object";
+    LOCK(cs);
+    nFetches++;
+    if (!sError.empty()) {
+        mapFailed[sHash] = GetTime();
+        return false;
+    }
+    mapFailed.erase(sHash);
+    pdb->Write(std::make_pair(DB_IPFS_OBJECT, sHash), sFetched);
+    sJson = sFetched;
+    return true;
+}
+
+void CIPFSObjectCache::Index(TypeState& state, const CBusinessObject& object, int nSign)
+{
+    if (IsDeleted(object.o)) return;
+    state.nRows += nSign;
+    for (std::map<std::string, FieldIndex>::iterator it = state.mapIndexes.begin(); it != state.mapIndexes.end(); ++it) {
+        std::string sValue = object.o[it->first].getValStr();
+        it->second.nSumCents += nSign * GetCents(sValue);
+        boost::to_upper(sValue);
+        if (nSign > 0) {
+            it->second.mapValues[sValue].insert(object.sPrimaryKey);
+        } else {
+            std::map<std::string, std::set<std::string> >::iterator itValue = it->second.mapValues.find(sValue);
+            if (itValue == it->second.mapValues.end()) continue;
+            itValue->second.erase(object.sPrimaryKey);
+            if (itValue->second.empty()) it->second.mapValues.erase(itValue);
+        }
+    }
+}
+
+void CIPFSObjectCache::Sync(std::string sType, const std::map<std::string, std::string>& mapCurrent)
+{
+    boost::to_upper(sType);
+    std::vector<std::pair<std::string, std::string> > vMissing;
+    {
+        LOCK(cs);
+        TypeState& state = mapTypes[sType];
+        // Drop objects whose primary key is gone or now names different content
+        for (std::map<std::string, CBusinessObject>::iterator it = state.mapObjects.begin(); it != state.mapObjects.end();) {
+            std::map<std::string, std::string>::const_iterator itCurrent = mapCurrent.find(it->first);
+            if (itCurrent == mapCurrent.end() || itCurrent->second != it->second.sHash) {
+                Index(state, it->second, -1);
+                state.mapObjects.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+        for (std::map<std::string, std::string>::const_iterator it = mapCurrent.begin(); it != mapCurrent.end(); ++it)
+            if (!it->second.empty() && !state.mapObjects.count(it->first)) vMissing.push_back(*it);
+    }
+
+    // Fetch without holding cs, so queries on other types are not held up by the network
+    std::vector<CBusinessObject> vFetched;
+    for (unsigned int i = 0; i < vMissing.size(); i++) {
+        std::string sJson;
+        std::string sError;
+        CBusinessObject object;
+        if (!GetJSON(vMissing[i].second, sJson, sError) || !object.o.read(sJson)) {
+            LogPrint("ipfs", "CIPFSObjectCache::Sync -- %s %s: %s\n", sType, vMissing[i].first, sError);
+            continue;
+        }
+        object.sPrimaryKey = vMissing[i].first;
+        object.sHash = vMissing[i].second;
+        vFetched.push_back(object);
+    }
+
+    LOCK(cs);
+    TypeState& state = mapTypes[sType];
+    for (unsigned int i = 0; i < vFetched.size(); i++) {
+        // A Sync running at the same time may have added it already
+        if (state.mapObjects.count(vFetched[i].sPrimaryKey)) continue;
+        state.mapObjects[vFetched[i].sPrimaryKey] = vFetched[i];
+        Index(state, vFetched[i], 1);
+    }
+}
+
+void CIPFSObjectCache::GetObjects(std::string sType, std::vector<CBusinessObject>& vObjects) const
+{
+    boost::to_upper(sType);
+    vObjects.clear();
+    LOCK(cs);
+    std::map<std::string, TypeState>::const_iterator itType = mapTypes.find(sType);
+    if (itType == mapTypes.end()) return;
+    vObjects.reserve(itType->second.nRows);
+    for (std::map<std::string, CBusinessObject>::const_iterator it = itType->second.mapObjects.begin(); it != itType->second.mapObjects.end(); ++it)
+        if (!IsDeleted(it->second.o)) vObjects.push_back(it->second);
+}
+
+bool CIPFSObjectCache::FindByField(std::string sType, const std::string& sField, std::string sValue, CBusinessObject& object) const
+{
+    boost::to_upper(sType);
+    boost::to_upper(sValue);
+    LOCK(cs);
+    std::map<std::string, TypeState>::const_iterator itType = mapTypes.find(sType);
+    if (itType == mapTypes.end()) return false;
+    const TypeState& state = itType->second;
+    std::map<std::string, FieldIndex>::const_iterator itIndex = state.mapIndexes.find(sField);
+    if (itIndex != state.mapIndexes.end()) {
+        std::map<std::string, std::set<std::string> >::const_iterator itValue = itIndex->second.mapValues.find(sValue);
+        if (itValue == itIndex->second.mapValues.end()) return false;
+        object = state.mapObjects.find(*itValue->second.begin())->second;
+        return true;
+    }
+    for (std::map<std::string, CBusinessObject>::const_iterator it = state.mapObjects.begin(); it != state.mapObjects.end(); ++it) {
+        if (IsDeleted(it->second.o)) continue;
+        std::string sObjectValue = it->second.o[sField].getValStr();
+        boost::to_upper(sObjectValue);
+        if (sObjectValue == sValue) {
+            object = it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+double CIPFSObjectCache::GetTotal(std::string sType, const std::string& sField, int& nRows) const
+{
+    boost::to_upper(sType);
+    nRows = 0;
+    LOCK(cs);
+    std::map<std::string, TypeState>::const_iterator itType = mapTypes.find(sType);
+    if (itType == mapTypes.end()) return 0;
+    const TypeState& state = itType->second;
+    nRows = state.nRows;
+    std::map<std::string, FieldIndex>::const_iterator itIndex = state.mapIndexes.find(sField);
+    if (itIndex != state.mapIndexes.end()) return itIndex->second.nSumCents / 100.0;
+    int64_t nSumCents = 0;
+    for (std::map<std::string, CBusinessObject>::const_iterator it = state.mapObjects.begin(); it != state.mapObjects.end(); ++it)
+        if (!IsDeleted(it->second.o)) nSumCents += GetCents(it->second.o[sField].getValStr());
+    return nSumCents / 100.0;
+}
+
+uint64_t CIPFSObjectCache::GetFetches() const
+{
+    LOCK(cs);
+    return nFetches;
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef IPFSCACHE_H
+#define IPFSCACHE_H
+
+#include "sync.h"
+
+#include <univalue.h>
+
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+class CDBWrapper;
+
+/** Seconds before an IPFS hash that could not be fetched is tried again */
+static const int64_t IPFS_CACHE_RETRY_SECONDS = 10 * 60;
+
+/** A business object as the list and search calls return it */
+struct CBusinessObject
+{
+    std::string sPrimaryKey;
+    std::string sHash;
+    UniValue o;
+};
+
+/**
+ * Local store of the IPFS business objects (contacts, revenue, expenses...).
+ *
+ * An IPFS hash names immutable content, so the JSON of each object is fetched
+ * once and kept in a LevelDB under the data dir, keyed by hash, and never
+ * invalidated.  On top of that the cache keeps the current object of every
+ * (type, primary key) parsed in memory, with optional indexes on declared
+ * fields: primary keys by field value, and the field's total.  Sync brings a
+ * type up to date with the type;primarykey -> hash entries of the application
+ * cache, fetching only hashes it has not seen; after that list, search and
+ * total queries need no network access.
+ */
+class CIPFSObjectCache : private boost::noncopyable
+{
+public:
+    typedef boost::function<std::string (const std::string& sHash, std::string& sError)> FetchFunction;
+
+    CIPFSObjectCache(const boost::filesystem::path& path, bool fMemory, const FetchFunction& fetchIn);
+    ~CIPFSObjectCache();
+
+    /** Index sField of sType objects, so searches and totals on it do not scan */
+    void AddIndex(std::string sType, const std::string& sField);
+
+    /** JSON of an object, from the store or fetched once and stored */
+    bool GetJSON(const std::string& sHash, std::string& sJson, std::string& sError);
+
+    /** Make the objects of sType those named by mapCurrent (primary key -> IPFS hash) */
+    void Sync(std::string sType, const std::map<std::string, std::string>& mapCurrent);
+
+    /** Objects of sType that are not deleted, in primary key order */
+    void GetObjects(std::string sType, std::vector<CBusinessObject>& vObjects) const;
+    /** First object, in primary key order, whose sField equals sValue ignoring case */
+    bool FindByField(std::string sType, const std::string& sField, std::string sValue, CBusinessObject& object) const;
+    /** Sum of sField, each value rounded to cents, over the objects that are not deleted */
+    double GetTotal(std::string sType, const std::string& sField, int& nRows) const;
+
+    uint64_t GetFetches() const;
+
+private:
+    struct FieldIndex
+    {
+        std::map<std::string, std::set<std::string> > mapValues;
+        int64_t nSumCents;
+        FieldIndex() : nSumCents(0) {}
+    };
+
+    struct TypeState
+    {
+        std::map<std::string, CBusinessObject> mapObjects;
+        std::map<std::string, FieldIndex> mapIndexes;
+        int nRows;
+        TypeState() : nRows(0) {}
+    };
+
+    void Index(TypeState& state, const CBusinessObject& object, int nSign);
+
+    CDBWrapper* pdb;
+    FetchFunction fetch;
+    mutable CCriticalSection cs;
+    std::map<std::string, TypeState> mapTypes;
+    std::map<std::string, int64_t> mapFailed;
+    uint64_t nFetches;
+};
+
+#endif // IPFSCACHE_H
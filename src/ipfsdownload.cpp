@@ -0,0 +1,457 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ipfsdownload.h"
+
+#include "httpclient.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+
+#include <errno.h>
+#include <fstream>
+#include <limits>
+#include <stdio.h>
+#include <vector>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+namespace {
+
+/** Bytes nStart..nEnd-1 of the file; those before nNext are on disk */
+struct CIPFSRange
+{
+    uint64_t nStart;
+    uint64_t nEnd;
+    uint64_t nNext;
+};
+
+/** Where a body that is written front to back has got to */
+struct CSequentialTarget
+{
+    FILE* file;
+    uint64_t nOffset;
+    bool fFailed;
+    explicit CSequentialTarget(FILE* fileIn) : file(fileIn), nOffset(0), fFailed(false) {}
+};
+
+/** The first request of a download; a whole file sent instead of a range is checked before it is written */
+struct CProbeTarget : public CSequentialTarget
+{
+    const CHTTPClientResponse* presponse;
+    uint64_t nExpectedSize;
+    bool fSizeMismatch;
+    CProbeTarget(FILE* fileIn, const CHTTPClientResponse* presponseIn, uint64_t nExpectedSizeIn) :
+        CSequentialTarget(fileIn), presponse(presponseIn), nExpectedSize(nExpectedSizeIn), fSizeMismatch(false) {}
+};
+
+/** One request for a range; the reply is checked before the first byte is written */
+struct CRangeAttempt
+{
+    CHTTPClientResponse response;
+    bool fChecked;
+    std::string sError;
+    CRangeAttempt() : fChecked(false) {}
+};
+
+}
+
+static bool WriteAt(FILE* file, const char* pch, size_t nSize, uint64_t nOffset)
+{
+#ifdef WIN32
+    // No pwrite; seek and write as one step
+    static boost::mutex mutexWrite;
+    boost::lock_guard<boost::mutex> lock(mutexWrite);
+    if (_fseeki64(file, nOffset, SEEK_SET) != 0) return false;
+    return fwrite(pch, 1, nSize, file) == nSize;
+#else
+    int fd = fileno(file);
+    while (nSize > 0) {
+        ssize_t n = pwrite(fd, pch, nSize, nOffset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        pch += n;
+        nSize -= n;
+        nOffset += n;
+    }
+    return true;
+#endif
+}
+
+static bool WriteSequential(CSequentialTarget* ptarget, const char* pch, size_t nSize)
+{
+    if (!WriteAt(ptarget->file, pch, nSize, ptarget->nOffset)) {
+        ptarget->fFailed = true;
+        return false;
+    }
+    ptarget->nOffset += nSize;
+    return true;
+}
+
+static bool WriteProbe(CProbeTarget* ptarget, const char* pch, size_t nSize)
+{
+    if (ptarget->presponse->nStatus == 200 && ptarget->nExpectedSize > 0) {
+        // The gateway ignored Range and sends the whole file; refuse it unless it is the size recorded on chain
+        std::string sLength = ptarget->presponse->GetHeader("content-length");
+        if ((!sLength.empty() && sLength != strprintf("%d", ptarget->nExpectedSize)) || ptarget->nOffset + nSize > ptarget->nExpectedSize) {
+            ptarget->fSizeMismatch = true;
+            return false;
+        }
+    }
+    return WriteSequential(ptarget, pch, nSize);
+}
+
+/** Parse "bytes <first>-<last>/<total>" */
+static bool ParseContentRange(const std::string& sContentRange, uint64_t& nFirst, uint64_t& nLast, uint64_t& nTotal)
+{
+    unsigned long long nFirstIn, nLastIn, nTotalIn;
+    if (sscanf(sContentRange.c_str(), "bytes %llu-%llu/%llu", &nFirstIn, &nLastIn, &nTotalIn) != 3) return false;
+    nFirst = nFirstIn;
+    nLast = nLastIn;
+    nTotal = nTotalIn;
+    return nFirst <= nLast && nLast < nTotal;
+}
+
+std::string GetIPFSProgressPath(const std::string& sPath)
+{
+    return sPath + ".progress";
+}
+
+/** What tells whether the gateway still has the same file: its ETag, else its Last-Modified, else nothing */
+static std::string GetValidator(const CHTTPClientResponse& response)
+{
+    std::string sETag = response.GetHeader("etag");
+    if (!sETag.empty()) return "ETag: " + sETag;
+    std::string sLastModified = response.GetHeader("last-modified");
+    if (!sLastModified.empty()) return "Last-Modified: " + sLastModified;
+    return "";
+}
+
+/** An /ipfs/<hash> URL names content that cannot change */
+static bool IsContentAddressed(const std::string& sURL)
+{
+    size_t nPos = sURL.find("/ipfs/");
+    return nPos != std::string::npos && nPos + 6 < sURL.size() && sURL[nPos + 6] != '/';
+}
+
+/** The ranges of an unfinished download of sURL to sPath, if its progress file is intact and the file is still there */
+static bool ReadProgress(const std::string& sPath, const std::string& sURL, std::string& sValidator, uint64_t& nSize, std::vector<CIPFSRange>& vRanges)
+{
+    std::ifstream streamIn(GetIPFSProgressPath(sPath).c_str());
+    std::string sSavedURL;
+    if (!streamIn || !std::getline(streamIn, sSavedURL) || sSavedURL != sURL) return false;
+    if (!std::getline(streamIn, sValidator) || !(streamIn >> nSize)) return false;
+    CIPFSRange range;
+    uint64_t nCovered = 0;
+    while (streamIn >> range.nStart >> range.nEnd >> range.nNext) {
+        if (range.nStart != nCovered || range.nEnd < range.nStart || range.nNext < range.nStart || range.nNext > range.nEnd) return false;
+        nCovered = range.nEnd;
+        vRanges.push_back(range);
+    }
+    if (vRanges.empty() || nCovered != nSize) return false;
+    try {
+        return boost::filesystem::file_size(sPath) == nSize;
+    } catch (const boost::filesystem::filesystem_error&) {
+        return false;
+    }
+}
+
+static bool WriteProgress(const std::string& sPath, const std::string& sURL, const std::string& sValidator, uint64_t nSize, const std::vector<CIPFSRange>& vRanges)
+{
+    std::string sProgressPath = GetIPFSProgressPath(sPath);
+    std::string sNewPath = sProgressPath + ".new";
+    {
+        std::ofstream streamOut(sNewPath.c_str(), std::ios::trunc);
+        streamOut << sURL << "\n" << sValidator << "\n" << nSize << "\n";
+        for (size_t i = 0; i < vRanges.size(); i++)
+            streamOut << vRanges[i].nStart << " " << vRanges[i].nEnd << " " << vRanges[i].nNext << "\n";
+        if (!streamOut.good()) return false;
+    }
+    return RenameOver(sNewPath, sProgressPath);
+}
+
+/** Fetches the unfinished ranges of a download concurrently, one thread per range */
+class CIPFSRangeFetcher
+{
+public:
+    CIPFSRangeFetcher(CIPFSDownload& downloadIn, FILE* fileIn, const CHTTPClientRequest& requestIn, const std::string& sValidatorIn, int64_t nDeadlineIn) :
+        download(downloadIn), file(fileIn), request(requestIn), sValidator(sValidatorIn), nDeadline(nDeadlineIn), nUnsaved(0)
+    {
+    }
+
+    std::vector<CIPFSRange> vRanges;
+
+    void Run()
+    {
+        boost::thread_group threadGroup;
+        for (size_t i = 0; i < vRanges.size(); i++) {
+            if (vRanges[i].nNext >= vRanges[i].nEnd) continue;
+            download.nRangesUsed++;
+            threadGroup.create_thread(boost::bind(&CIPFSRangeFetcher::FetchRange, this, i));
+        }
+        threadGroup.join_all();
+    }
+
+    bool IsComplete() const
+    {
+        for (size_t i = 0; i < vRanges.size(); i++)
+            if (vRanges[i].nNext < vRanges[i].nEnd) return false;
+        return true;
+    }
+
+    bool SaveProgress()
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        nUnsaved = 0;
+        return WriteProgress(download.sPath, download.sURL, sValidator, download.nSize, vRanges);
+    }
+
+private:
+    CIPFSDownload& download;
+    FILE* file;
+    const CHTTPClientRequest& request;
+    std::string sValidator;
+    int64_t nDeadline;
+    boost::mutex mutex;
+    uint64_t nUnsaved;
+
+    bool Write(size_t i, CRangeAttempt* pattempt, const char* pch, size_t nSize)
+    {
+        // Only this thread moves the range forward; the lock is for the totals and the progress file
+        CIPFSRange& range = vRanges[i];
+        if (!pattempt->fChecked) {
+            // A gateway that ignores Range sends the file from byte 0, which must not land here
+            uint64_t nFirst, nLast, nTotal;
+            if (pattempt->response.nStatus != 206 || !ParseContentRange(pattempt->response.GetHeader("content-range"), nFirst, nLast, nTotal) ||
+                nFirst != range.nNext || nTotal != download.nSize) {
+                pattempt->sError = "unexpected reply to a range request: " + pattempt->response.GetHeader("content-range");
+                return false;
+            }
+            pattempt->fChecked = true;
+        }
+        nSize = std::min((uint64_t)nSize, range.nEnd - range.nNext);
+        if (!WriteAt(file, pch, nSize, range.nNext)) {
+            pattempt->sError = "cannot write " + download.sPath;
+            return false;
+        }
+        boost::lock_guard<boost::mutex> lock(mutex);
+        range.nNext += nSize;
+        download.nTransferred += nSize;
+        nUnsaved += nSize;
+        if (nUnsaved >= IPFS_PROGRESS_INTERVAL) {
+            nUnsaved = 0;
+            WriteProgress(download.sPath, download.sURL, sValidator, download.nSize, vRanges);
+        }
+        return range.nNext < range.nEnd;
+    }
+
+    void FetchRange(size_t i)
+    {
+        RenameThread("biblepay-ipfs");
+        CIPFSRange& range = vRanges[i];
+        std::string sError;
+        for (int nAttempt = 0; nAttempt < IPFS_RANGE_ATTEMPTS && range.nNext < range.nEnd; nAttempt++) {
+            int64_t nRemaining = nDeadline - GetSteadyTimeMillis();
+            if (nRemaining <= 0) {
+                sError = "timed out";
+                break;
+            }
+            CHTTPClientRequest rangeRequest = request;
+            rangeRequest.mapHeaders["Range"] = strprintf("bytes=%d-%d", range.nNext, range.nEnd - 1);
+            rangeRequest.nTimeoutMillis = nRemaining;
+            CRangeAttempt attempt;
+            rangeRequest.fnBody = boost::bind(&CIPFSRangeFetcher::Write, this, i, &attempt, _1, _2);
+            bool fOk = GetHTTPClient().Request(rangeRequest, attempt.response);
+            if (!attempt.sError.empty()) {
+                sError = attempt.sError;
+                break;
+            }
+            if (fOk && attempt.response.nStatus != 206) {
+                sError = "HTTP status " + itostr(attempt.response.nStatus);
+                break;
+            }
+            sError = fOk ? "reply ended early" : attempt.response.sError;
+            if (range.nNext < range.nEnd)
+                LogPrint("ipfs", "CIPFSRangeFetcher::FetchRange -- %s bytes %d-%d stopped at %d: %s\n", download.sURL, range.nStart, range.nEnd - 1, range.nNext, sError);
+        }
+        if (range.nNext >= range.nEnd) return;
+        boost::lock_guard<boost::mutex> lock(mutex);
+        if (download.sError.empty())
+            download.sError = strprintf("bytes %d-%d stopped at %d: %s", range.nStart, range.nEnd - 1, range.nNext, sError);
+    }
+};
+
+CIPFSDownload::CIPFSDownload(const std::string& sURLIn, const std::string& sPathIn, int64_t nTimeoutMillisIn) :
+    sURL(sURLIn), sPath(sPathIn), nExpectedSize(0), nRanges(IPFS_DOWNLOAD_RANGES), nTimeoutMillis(nTimeoutMillisIn),
+    nSize(0), nTransferred(0), nResumed(0), nRangesUsed(0), nElapsedMillis(0)
+{
+}
+
+double CIPFSDownload::GetThroughput() const
+{
+    return nElapsedMillis > 0 ? nTransferred * 1000.0 / nElapsedMillis : 0;
+}
+
+static IPFSDownloadResult FetchIntoFile(CIPFSDownload& download, CHTTPClientRequest& request, FILE* file,
+    const std::string& sSavedValidator, uint64_t nSavedSize, const std::vector<CIPFSRange>& vSaved)
+{
+    int64_t nDeadline = GetSteadyTimeMillis() + download.nTimeoutMillis;
+    request.nTimeoutMillis = download.nTimeoutMillis;
+    request.nStallTimeoutMillis = IPFS_STALL_TIMEOUT * 1000;
+
+    // Byte 0 tells the size, and whether the gateway serves ranges at all
+    CHTTPClientRequest probe = request;
+    probe.mapHeaders["Range"] = "bytes=0-0";
+    CHTTPClientResponse response;
+    CProbeTarget target(file, &response, download.nExpectedSize);
+    probe.fnBody = boost::bind(&WriteProbe, &target, _1, _2);
+    bool fOk = GetHTTPClient().Request(probe, response);
+    if (target.fSizeMismatch) {
+        download.sError = strprintf("gateway sends %s bytes, %d recorded on chain", response.GetHeader("content-length"), download.nExpectedSize);
+        return IPFS_DOWNLOAD_SIZE_MISMATCH;
+    }
+    if (target.fFailed) {
+        download.sError = "cannot write " + download.sPath;
+        return IPFS_DOWNLOAD_FILE_ERROR;
+    }
+    if (!fOk) {
+        download.sError = response.sError;
+        return response.nStatus == 0 ? IPFS_DOWNLOAD_CONNECT_FAILED : IPFS_DOWNLOAD_FAILED;
+    }
+    if (response.nStatus == 200) {
+        // No range support: the whole file came with the probe
+        download.nSize = download.nTransferred = target.nOffset;
+        download.nRangesUsed = 1;
+        TruncateFile(file, download.nSize);
+        if (download.nExpectedSize > 0 && download.nSize != download.nExpectedSize) {
+            download.sError = strprintf("%d bytes received, %d recorded on chain", download.nSize, download.nExpectedSize);
+            return IPFS_DOWNLOAD_SIZE_MISMATCH;
+        }
+        return IPFS_DOWNLOAD_OK;
+    }
+    uint64_t nFirst, nLast, nTotal;
+    if (response.nStatus != 206 || !ParseContentRange(response.GetHeader("content-range"), nFirst, nLast, nTotal) || nFirst != 0) {
+        download.sError = "HTTP status " + itostr(response.nStatus) + " from " + download.sURL;
+        return IPFS_DOWNLOAD_FAILED;
+    }
+    download.nSize = nTotal;
+    if (download.nExpectedSize > 0 && nTotal != download.nExpectedSize) {
+        download.sError = strprintf("gateway has %d bytes, %d recorded on chain", nTotal, download.nExpectedSize);
+        return IPFS_DOWNLOAD_SIZE_MISMATCH;
+    }
+    if (nTotal > std::numeric_limits<unsigned int>::max()) {
+        download.sError = strprintf("%d bytes is too large", nTotal);
+        return IPFS_DOWNLOAD_FAILED;
+    }
+
+    // Resume only what is known to be the same file: same URL (checked on reading the progress), size and
+    // validator; a gateway that sends no validator is trusted only for content addressed by its hash
+    std::string sValidator = GetValidator(response);
+    CIPFSRangeFetcher fetcher(download, file, request, sValidator, nDeadline);
+    if (!vSaved.empty() && nSavedSize == nTotal && sSavedValidator == sValidator && (!sValidator.empty() || IsContentAddressed(download.sURL))) {
+        fetcher.vRanges = vSaved;
+        for (size_t i = 0; i < vSaved.size(); i++)
+            download.nResumed += vSaved[i].nNext - vSaved[i].nStart;
+    } else {
+        TruncateFile(file, nTotal);
+        AllocateFileRange(file, 0, nTotal);
+        int nRanges = (int)std::max((uint64_t)1, std::min((uint64_t)std::max(download.nRanges, 1), nTotal / IPFS_MIN_RANGE_SIZE));
+        for (int i = 0; i < nRanges; i++) {
+            CIPFSRange range;
+            range.nStart = range.nNext = nTotal / nRanges * i;
+            range.nEnd = i == nRanges - 1 ? nTotal : nTotal / nRanges * (i + 1);
+            fetcher.vRanges.push_back(range);
+        }
+    }
+    if (!fetcher.SaveProgress()) {
+        download.sError = "cannot write " + GetIPFSProgressPath(download.sPath);
+        return IPFS_DOWNLOAD_FILE_ERROR;
+    }
+    fetcher.Run();
+    if (!fetcher.IsComplete()) {
+        fetcher.SaveProgress();
+        return IPFS_DOWNLOAD_FAILED;
+    }
+    return IPFS_DOWNLOAD_OK;
+}
+
+IPFSDownloadResult DownloadIPFSFile(CIPFSDownload& download)
+{
+    int64_t nStart = GetTimeMillis();
+    IPFSDownloadResult result;
+    CHTTPClientRequest request;
+    if (!request.SetURL(download.sURL)) {
+        download.sError = "Invalid URL " + download.sURL;
+        result = IPFS_DOWNLOAD_BAD_URL;
+    } else {
+        std::string sSavedValidator;
+        uint64_t nSavedSize = 0;
+        std::vector<CIPFSRange> vSaved;
+        bool fResume = ReadProgress(download.sPath, download.sURL, sSavedValidator, nSavedSize, vSaved);
+        FILE* file = fopen(download.sPath.c_str(), fResume ? "r+b" : "w+b");
+        if (file == NULL) {
+            download.sError = "cannot open " + download.sPath;
+            result = IPFS_DOWNLOAD_FILE_ERROR;
+        } else {
+            result = FetchIntoFile(download, request, file, sSavedValidator, nSavedSize, vSaved);
+            fclose(file);
+        }
+        if (result == IPFS_DOWNLOAD_OK) {
+            boost::system::error_code ec;
+            if (boost::filesystem::file_size(download.sPath, ec) != download.nSize) {
+                download.sError = "file size does not match after download";
+                result = IPFS_DOWNLOAD_FAILED;
+            }
+            boost::filesystem::remove(GetIPFSProgressPath(download.sPath), ec);
+        }
+    }
+    download.nElapsedMillis = GetTimeMillis() - nStart;
+    LogPrintf("DownloadIPFSFile -- %s: %s, %d bytes, %d received in %d ranges, %d resumed, %dms, %.1f KB/s %s\n",
+        download.sURL, result == IPFS_DOWNLOAD_OK ? "ok" : "failed", download.nSize, download.nTransferred, download.nRangesUsed,
+        download.nResumed, download.nElapsedMillis, download.GetThroughput() / 1024, download.sError);
+    return result;
+}
+
+IPFSDownloadResult DownloadIPFSRange(const std::string& sURL, const std::string& sPath, uint64_t nFirst, uint64_t nLast, int64_t nTimeoutMillis, std::string& sError)
+{
+    CHTTPClientRequest request;
+    if (!request.SetURL(sURL) || nLast < nFirst) {
+        sError = "Invalid URL or range";
+        return IPFS_DOWNLOAD_BAD_URL;
+    }
+    FILE* file = fopen(sPath.c_str(), "wb");
+    if (file == NULL) {
+        sError = "cannot open " + sPath;
+        return IPFS_DOWNLOAD_FILE_ERROR;
+    }
+    request.mapHeaders["Range"] = strprintf("bytes=%d-%d", nFirst, nLast);
+    request.nTimeoutMillis = nTimeoutMillis;
+    request.nStallTimeoutMillis = IPFS_STALL_TIMEOUT * 1000;
+    // A gateway that ignores Range sends everything; keep only as much as was asked for
+    request.nMaxBodySize = nLast - nFirst + 1;
+    CSequentialTarget target(file);
+    request.fnBody = boost::bind(&WriteSequential, &target, _1, _2);
+    CHTTPClientResponse response;
+    bool fOk = GetHTTPClient().Request(request, response);
+    fclose(file);
+    if (target.fFailed) {
+        sError = "cannot write " + sPath;
+        return IPFS_DOWNLOAD_FILE_ERROR;
+    }
+    if (!fOk) {
+        sError = response.sError;
+        return response.nStatus == 0 ? IPFS_DOWNLOAD_CONNECT_FAILED : IPFS_DOWNLOAD_FAILED;
+    }
+    if (response.nStatus != 200 && response.nStatus != 206) {
+        sError = "HTTP status " + itostr(response.nStatus) + " from " + sURL;
+        return IPFS_DOWNLOAD_FAILED;
+    }
+    return IPFS_DOWNLOAD_OK;
+}
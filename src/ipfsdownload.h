@@ -0,0 +1,81 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef IPFSDOWNLOAD_H
+#define IPFSDOWNLOAD_H
+
+#include <stdint.h>
+#include <string>
+
+/** Range requests a download is split into */
+static const int IPFS_DOWNLOAD_RANGES = 4;
+/** Ranges are never made smaller than this, so small files take a single request */
+static const uint64_t IPFS_MIN_RANGE_SIZE = 256 * 1024;
+/** Give up on a request if no data arrived for this many seconds */
+static const int IPFS_STALL_TIMEOUT = 60;
+/** Requests made for one range, each continuing where the last one stopped */
+static const int IPFS_RANGE_ATTEMPTS = 3;
+/** Bytes received between saves of the progress file */
+static const uint64_t IPFS_PROGRESS_INTERVAL = 1024 * 1024;
+
+/** Download results, numbered as ipfs_download has always reported them */
+enum IPFSDownloadResult
+{
+    IPFS_DOWNLOAD_OK = 1,
+    IPFS_DOWNLOAD_FILE_ERROR = -1,
+    IPFS_DOWNLOAD_FAILED = -2,
+    IPFS_DOWNLOAD_CONNECT_FAILED = -3,
+    IPFS_DOWNLOAD_BAD_URL = -4,
+    IPFS_DOWNLOAD_SIZE_MISMATCH = -5
+};
+
+/**
+ * A file fetched from an IPFS gateway in concurrent HTTP range requests.
+ *
+ * The first request asks for byte 0 only, which tells the size and whether
+ * the gateway serves ranges (a gateway that does not simply sends the whole
+ * file, which is then written as it arrives once its Content-Length matches
+ * nExpectedSize).  The target file is allocated at full size and every range
+ * is written in place as it arrives.  The ranges and how far each got are
+ * kept in <path>.progress with the URL and the gateway's ETag or
+ * Last-Modified; a download that timed out or failed resumes from there on
+ * the next call instead of starting over, as long as the URL, size and
+ * validator still match.  Without a validator only /ipfs/<hash> URLs, whose
+ * content cannot change, are resumed.  The progress file is removed once the
+ * file is complete.
+ */
+struct CIPFSDownload
+{
+    std::string sURL;
+    std::string sPath;
+    /** Size recorded on chain (IPFSSIZE); when set, a file of any other size is refused */
+    uint64_t nExpectedSize;
+    int nRanges;
+    int64_t nTimeoutMillis;
+
+    uint64_t nSize;
+    /** Bytes received by this call */
+    uint64_t nTransferred;
+    /** Bytes already on disk from an earlier call */
+    uint64_t nResumed;
+    int nRangesUsed;
+    int64_t nElapsedMillis;
+    std::string sError;
+
+    CIPFSDownload(const std::string& sURLIn, const std::string& sPathIn, int64_t nTimeoutMillisIn);
+
+    /** Bytes per second received by this call */
+    double GetThroughput() const;
+};
+
+/** Where the progress of a partial download of sPath is kept */
+std::string GetIPFSProgressPath(const std::string& sPath);
+
+/** Download, or finish downloading, download.sURL to download.sPath */
+IPFSDownloadResult DownloadIPFSFile(CIPFSDownload& download);
+
+/** Fetch bytes nFirst..nLast of sURL into sPath in one request, as ipfsgetrange does */
+IPFSDownloadResult DownloadIPFSRange(const std::string& sURL, const std::string& sPath, uint64_t nFirst, uint64_t nLast, int64_t nTimeoutMillis, std::string& sError);
+
+#endif // IPFSDOWNLOAD_H
@@ -0,0 +1,112 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "json-stream.h"
+
+#include <univalue.h>
+
+CJSONStreamWriter::CJSONStreamWriter(const SinkFn& sinkIn, size_t nChunkSizeIn) :
+    sink(sinkIn), nChunkSize(nChunkSizeIn), nFlushed(0), fAfterKey(false)
+{
+    strBuffer.reserve(nChunkSize);
+}
+
+void CJSONStreamWriter::Separator()
+{
+    if (fAfterKey) {
+        // the value of a member follows its key directly
+        fAfterKey = false;
+        return;
+    }
+    if (vFirst.empty())
+        return;
+    if (!vFirst.back())
+        strBuffer += ',';
+    vFirst.back() = false;
+}
+
+void CJSONStreamWriter::Write(const std::string& str)
+{
+    strBuffer += str;
+    if (strBuffer.size() >= nChunkSize)
+        Flush();
+}
+
+void CJSONStreamWriter::BeginObject()
+{
+    Separator();
+    strBuffer += '{';
+    vFirst.push_back(true);
+}
+
+void CJSONStreamWriter::EndObject()
+{
+    vFirst.pop_back();
+    Write("}");
+}
+
+void CJSONStreamWriter::BeginArray()
+{
+    Separator();
+    strBuffer += '[';
+    vFirst.push_back(true);
+}
+
+void CJSONStreamWriter::EndArray()
+{
+    vFirst.pop_back();
+    Write("]");
+}
+
+void CJSONStreamWriter::Key(const std::string& strKey)
+{
+    Separator();
+    // UniValue escapes the key the same way it escapes string values
+    Write(UniValue(strKey).write() + ":");
+    fAfterKey = true;
+}
+
+void CJSONStreamWriter::Value(const UniValue& val)
+{
+    if (val.isObject()) {
+        BeginObject();
+        const std::vector<std::string>& vKeys = val.getKeys();
+        for (unsigned int i = 0; i < val.size(); i++)
+            Pair(vKeys[i], val[i]);
+        EndObject();
+    } else if (val.isArray()) {
+        BeginArray();
+        for (unsigned int i = 0; i < val.size(); i++)
+            Value(val[i]);
+        EndArray();
+    } else {
+        Separator();
+        Write(val.write());
+    }
+}
+
+void CJSONStreamWriter::BeginString()
+{
+    Separator();
+    strBuffer += '"';
+}
+
+void CJSONStreamWriter::StringPart(const std::string& str)
+{
+    Write(str);
+}
+
+void CJSONStreamWriter::EndString()
+{
+    Write("\"");
+}
+
+void CJSONStreamWriter::Flush()
+{
+    if (strBuffer.empty())
+        return;
+    nFlushed += strBuffer.size();
+    sink(strBuffer);
+    strBuffer.clear();
+}
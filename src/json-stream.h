@@ -0,0 +1,66 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+class UniValue;
+
+/** Bytes buffered before they are handed to the sink */
+static const size_t DEFAULT_JSON_STREAM_CHUNK = 64 * 1024;
+
+/**
+ * Writes JSON piece by piece into fixed size chunks.
+ *
+ * The output is byte for byte what UniValue::write() produces for the same
+ * tree, but only the element being written has to exist in memory: large
+ * RPC responses emit their members one at a time and every full chunk is
+ * passed to the sink (usually an HTTP chunked reply) right away.
+ */
+class CJSONStreamWriter
+{
+public:
+    typedef boost::function<void (const std::string& strChunk)> SinkFn;
+
+    explicit CJSONStreamWriter(const SinkFn& sinkIn, size_t nChunkSizeIn = DEFAULT_JSON_STREAM_CHUNK);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    /** Name of the next object member */
+    void Key(const std::string& strKey);
+    /** Write a complete value; objects and arrays are walked, never serialized in one piece */
+    void Value(const UniValue& val);
+    void Pair(const std::string& strKey, const UniValue& val) { Key(strKey); Value(val); }
+    /** Write a string value in pieces; the pieces are not escaped, so they must be plain text such as hex */
+    void BeginString();
+    void StringPart(const std::string& str);
+    void EndString();
+
+    /** Hand everything buffered to the sink */
+    void Flush();
+    /** True once the sink has been called, after which the response can no longer be replaced */
+    bool HasFlushed() const { return nFlushed > 0; }
+    /** Output not yet handed to the sink */
+    const std::string& GetBuffer() const { return strBuffer; }
+
+private:
+    SinkFn sink;
+    size_t nChunkSize;
+    size_t nFlushed;
+    std::string strBuffer;
+    std::vector<bool> vFirst;   // per open container: nothing written into it yet
+    bool fAfterKey;
+
+    void Separator();
+    void Write(const std::string& str);
+};
+
+#endif // JSON_STREAM_H
@@ -19,6 +19,7 @@
 #include "init.h"
 #include "podc.h"
 #include "merkleblock.h"
+#include "messagesigcheck.h"
 #include "net.h"
 #include "policy/policy.h"
 #include "pow.h"
@@ -34,6 +35,9 @@
 #include "undo.h"
 #include "util.h"
 #include "spork.h"
+#include "spork-cache.h"
+#include "dccregistry.h"
+#include "perfstats.h"
 #include "utilmoneystr.h"
 #include "utilstrencodings.h"
 #include "validationinterface.h"
@@ -148,6 +152,7 @@ std::string sOS = "";
 
 std::map<std::string, std::string> mvApplicationCache;
 std::map<std::string, int64_t> mvApplicationCacheTimestamp;
+CCriticalSection cs_appcache;
 std::map<int64_t, std::string> mapDebug;
 
 bool fPoolMiningMode = false;
@@ -2015,6 +2020,42 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     return true;
 }
 
+bool GetAddressIndexPage(uint160 addressHash, int type, int start, int end,
+                         const CAddressIndexKey* pCursor, size_t nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, CAddressIndexKey &next)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressIndexPage(addressHash, type, start, end, pCursor, nLimit, addressIndex, next))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressUnspentPage(uint160 addressHash, int type, const CAddressUnspentKey* pCursor, size_t nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs, CAddressUnspentKey &next)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressUnspentIndexPage(addressHash, type, pCursor, nLimit, unspentOutputs, next))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &balance)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressBalance(addressHash, type, balance))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
 
 const CBlockIndex* GetBlockIndexByTransactionHash(const uint256 &hash)
 {
@@ -2130,6 +2171,8 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
 	// Depending on the context of the call, ensure the block is read from the disk without a CheckProofOfWork Error
 
 	boost::to_upper(Context);
+	// Context names the caller, so reads are counted and timed per caller
+	CPerfTimer timer(GetPerfTimer("readblockfromdisk", Context));
 	bool bCheckPOW = true;
 	if  (  Context=="RETRIEVETXOUTINFO" 
 		|| Context=="GETTRANSACTION" 
@@ -2957,6 +3000,28 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CMessageSigCheck> messagesigcheckqueue(8);
+static CCriticalSection cs_messagesigcheckqueue;
+
+void ThreadMessageSigCheck() {
+    RenameThread("biblepay-msgsigch");
+    messagesigcheckqueue.Thread();
+}
+
+void CheckMessageSignaturesInParallel(std::vector<CMessageSigCheck>& vChecks)
+{
+    // Without worker threads, or while another thread is using the queue, the
+    // signatures are simply checked one at a time where they are used
+    if (!nScriptCheckThreads || vChecks.size() < 2)
+        return;
+    TRY_LOCK(cs_messagesigcheckqueue, lockQueue);
+    if (!lockQueue)
+        return;
+    CCheckQueueControl<CMessageSigCheck> control(&messagesigcheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
 //
 // Called periodically asynchronously; alerts if it smells like
 // we're being fed a bad chain (blocks being generated much
@@ -3748,6 +3813,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     BOOST_FOREACH(const CTransaction &tx, pblock->vtx) {
         SyncWithWallets(tx, pblock);
     }
+    GetMainSignals().BlockConnected(*pblock, pindexNew);
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
     LogPrint("bench", "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
@@ -4565,6 +4631,8 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
 		{
 		    return state.DoS(1, error("%s: CPID Signature empty. ", __func__), REJECT_INVALID, "cpid-empty");
 		}
+		// A single signature, checked before the block's messages are gathered for the message signature queue and so
+		// not part of that batch; a valid one is cached, and checking it again when the block is memorized only hashes
 		bool fCheckCPIDSignature = VerifyCPIDSignature(sCPIDSignature, false, sError);
 		if (!fCheckCPIDSignature)
 		{
@@ -5166,6 +5234,15 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
+    // Address indexes built before the balance totals existed get them computed once
+    bool fAddressBalances = false;
+    if (fAddressIndex && !(pblocktree->ReadFlag("addressbalances", fAddressBalances) && fAddressBalances)) {
+        LogPrintf("%s: building address balances...\n", __func__);
+        if (!pblocktree->RebuildAddressBalances())
+            return error("%s: failed to build address balances", __func__);
+        pblocktree->WriteFlag("addressbalances", true);
+    }
+
     // Check whether we have a timestamp index
     pblocktree->ReadFlag("timestampindex", fTimestampIndex);
     LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
@@ -5345,6 +5422,7 @@ bool InitBlockIndex(const CChainParams& chainparams)
     // Use the provided setting for -addressindex in the new database
     fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
     pblocktree->WriteFlag("addressindex", fAddressIndex);
+    pblocktree->WriteFlag("addressbalances", fAddressIndex);
 
     // Use the provided setting for -timestampindex in the new database
     fTimestampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
@@ -5353,6 +5431,8 @@ bool InitBlockIndex(const CChainParams& chainparams)
     fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
     pblocktree->WriteFlag("spentindex", fSpentIndex);
 
+    pblocktree->WriteFlag("splitindexdb", pblocktree->HasSeparateIndexDB());
+
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -5967,22 +6047,22 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 }
 
                 if (!pushed && inv.type == MSG_TX) {
-                    CTransaction tx;
-                    if (mempool.lookup(inv.hash, tx)) {
+                    CTransactionRef ptx = mempool.get(inv.hash);
+                    if (ptx) {
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
-                        ss << tx;
+                        ss << *ptx;
                         pfrom->PushMessage(NetMsgType::TX, ss);
                         pushed = true;
                     }
                 }
 
                 if (!pushed && inv.type == MSG_TXLOCK_REQUEST) {
-                    CTxLockRequest txLockRequest;
+                    CTxLockRequestRef txLockRequest;
                     if(instantsend.GetTxLockRequest(inv.hash, txLockRequest)) {
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
-                        ss << txLockRequest;
+                        ss << *txLockRequest;
                         pfrom->PushMessage(NetMsgType::TXLOCKREQUEST, ss);
                         pushed = true;
                     }
@@ -6669,7 +6749,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         vector<uint256> vWorkQueue;
         vector<uint256> vEraseQueue;
         CTransaction tx;
-        CTxLockRequest txLockRequest;
+        CTxLockRequestRef txLockRequest;
         CDarksendBroadcastTx dstx;
         int nInvType = MSG_TX;
 
@@ -6677,12 +6757,15 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         if(strCommand == NetMsgType::TX) {
             vRecv >> tx;
         } else if(strCommand == NetMsgType::TXLOCKREQUEST) {
-            vRecv >> txLockRequest;
-            tx = txLockRequest;
+            // Read in place, the lock candidate and the accepted or rejected map share it
+            boost::shared_ptr<CTxLockRequest> ptxLockRequest = boost::make_shared<CTxLockRequest>();
+            vRecv >> *ptxLockRequest;
+            txLockRequest = ptxLockRequest;
+            tx = *txLockRequest;
             nInvType = MSG_TXLOCK_REQUEST;
         } else if (strCommand == NetMsgType::DSTX) {
             vRecv >> dstx;
-            tx = dstx.tx;
+            tx = *dstx.tx;
             nInvType = MSG_DSTX;
         }
 
@@ -6693,7 +6776,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         // Process custom logic, no matter if tx will be accepted to mempool later or not
         if (strCommand == NetMsgType::TXLOCKREQUEST) {
             if(!instantsend.ProcessTxLockRequest(txLockRequest)) {
-                LogPrint("instantsend", "TXLOCKREQUEST -- failed %s\n", txLockRequest.GetHash().ToString());
+                LogPrint("instantsend", "TXLOCKREQUEST -- failed %s\n", txLockRequest->GetHash().ToString());
                 return false;
             }
         } else if (strCommand == NetMsgType::DSTX) {
@@ -7048,10 +7131,9 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         BOOST_FOREACH(uint256& hash, vtxid) {
             CInv inv(MSG_TX, hash);
             if (pfrom->pfilter) {
-                CTransaction tx;
-                bool fInMemPool = mempool.lookup(hash, tx);
-                if (!fInMemPool) continue; // another thread removed since queryHashes, maybe...
-                if (!pfrom->pfilter->IsRelevantAndUpdate(tx)) continue;
+                CTransactionRef ptx = mempool.get(hash);
+                if (!ptx) continue; // another thread removed since queryHashes, maybe...
+                if (!pfrom->pfilter->IsRelevantAndUpdate(*ptx)) continue;
             }
             vInv.push_back(inv);
             if (vInv.size() == MAX_INV_SZ) {
@@ -7552,6 +7634,7 @@ bool NonObnoxiousLog(std::string sLogSection, std::string sLogKey, std::string s
 {
 	boost::to_upper(sLogSection);
 	boost::to_upper(sLogKey);
+	LOCK(cs_appcache);
 	int64_t nElapsed = GetAdjustedTime() - mvApplicationCacheTimestamp[sLogSection + ";" + sLogKey];
 	WriteCache(sLogSection, sLogKey, "1", GetAdjustedTime());
 	bool bAllowed = (nElapsed > nAllowedSpan) ? true : false;
@@ -7571,6 +7654,7 @@ void WriteCache(std::string sSection, std::string sKey, std::string sValue, int6
 		boost::to_upper(sSection);
 		boost::to_upper(sKey);
 	}
+	LOCK(cs_appcache);
 	std::string temp_value = mvApplicationCache[sSection + ";" + sKey];
 	if (temp_value.empty())
 	{
@@ -7586,11 +7670,21 @@ void WriteCache(std::string sSection, std::string sKey, std::string sValue, int6
 		mvApplicationCacheTimestamp[sSection + ";" + sKey]=locktime;
 	}
 	mvApplicationCacheTimestamp[sSection + ";" + sKey] = locktime;
+	if (sSection == "SPORK") GetSporkValueCache().Set(sKey, sValue);
+	if (sSection == "DCC") GetDCCRegistry().Memorize(sKey, sValue, locktime);
+}
+
+// Keep the typed spork cache and the DCC registry in step when cache entries are blanked or deleted
+static void ForgetCacheEntry(const std::string& sCacheKey)
+{
+	if (sCacheKey.compare(0, 6, "SPORK;") == 0) GetSporkValueCache().Set(sCacheKey.substr(6), "");
+	if (sCacheKey.compare(0, 4, "DCC;") == 0) GetDCCRegistry().Forget(sCacheKey.substr(4));
 }
 
 void PurgeCacheAsOfExpiration(std::string sSection, int64_t nExpiration)
 {
 	boost::to_upper(sSection);
+	LOCK(cs_appcache);
 	for(map<string,string>::iterator ii=mvApplicationCache.begin(); ii!=mvApplicationCache.end(); ++ii)
 	{
 		std::string sKey = (*ii).first;
@@ -7604,6 +7698,7 @@ void PurgeCacheAsOfExpiration(std::string sSection, int64_t nExpiration)
 				{
 					mvApplicationCache[sKey]="";
 					mvApplicationCacheTimestamp[sKey]=0;
+					ForgetCacheEntry(sKey);
 				}
 			}
 		}
@@ -7622,8 +7717,10 @@ bool IsTimeWithinMins(int64_t nTime, int mins)
 void DeleteCache(std::string section, std::string keyname)
 {
     std::string pk = section + ";" +keyname;
+    LOCK(cs_appcache);
     mvApplicationCache.erase(pk);
     mvApplicationCacheTimestamp.erase(pk);
+    ForgetCacheEntry(pk);
 }
 
 
@@ -7655,8 +7752,55 @@ std::string GetMessagesFromBlock(const CBlock& block, std::string sTargetType)
 }
 
 
+/** The message signatures MemorizePrayer will check for a block, picked by message type the way GetTxMessage, MemorizeUTXOWeight and the DCC registry pick them */
+static void GetBlockMessageSigChecks(const CBlock& block, std::vector<CMessageSigCheck>& vChecks)
+{
+	static const XMLTagList vTags = GetXMLTagList("MT,MV,NONCE,SPORKSIG,BOSIG,BOSIGNER,cpidsig,PODC_TASKS");
+	static CSporkHandle hPrayersMustBeSigned("prayersmustbesigned");
+	const std::string sFoundationAddress = Params().GetConsensus().FoundationAddress;
+	bool fPrayersMustBeSigned = (hPrayersMustBeSigned.GetDouble(0) == 1);
+	bool fFreshChatter = (GetAdjustedTime() - block.GetBlockTime()) < GetSporkDouble("podcmaximumchatterage", (60 * 60 * 24));
+	for (unsigned int n = 0; n < block.vtx.size(); n++)
+	{
+		std::string sMessage = "";
+		for (unsigned int i = 0; i < block.vtx[n].vout.size(); i++)
+			sMessage += block.vtx[n].vout[i].sTxOutMessage;
+		if (sMessage.empty()) continue;
+		std::vector<std::string> vFields = ExtractXMLFields(sMessage, vTags);
+		std::string sType = vFields[0];
+		boost::to_upper(sType);
+		std::string sSigned = vFields[1] + vFields[2];
+		if (sType == "SPORK" || (sType == "PRAYER" && fPrayersMustBeSigned))
+		{
+			vChecks.push_back(CMessageSigCheck(sFoundationAddress, vFields[3], sSigned));
+		}
+		else if (sType == "EXPENSE" || sType == "REVENUE" || sType == "ORPHAN")
+		{
+			vChecks.push_back(CMessageSigCheck(sFoundationAddress, vFields[4], sSigned));
+		}
+		else if (sType == "DCC")
+		{
+			std::vector<std::string> vDCC = Split(vFields[1].c_str(), ";");
+			if (vDCC.size() >= 5) vChecks.push_back(CMessageSigCheck(vDCC[2], vDCC[4], vDCC[0] + ";" + vDCC[1] + ";" + vDCC[2] + ";" + vDCC[3]));
+		}
+		else if (sType != "PRAYER" && sType != "ATTACHMENT" && sType != "CPIDTASKS" && sType != "REPENT" && sType != "MESSAGE")
+		{
+			if (!vFields[4].empty() && !vFields[5].empty()) vChecks.push_back(CMessageSigCheck(vFields[5], vFields[4], sSigned));
+		}
+		if (!vFields[7].empty() && !vFields[6].empty() && fFreshChatter)
+		{
+			std::string sCPID = GetElement(vFields[6], ";", 0);
+			std::string sHash = GetElement(vFields[6], ";", 1);
+			std::string sPK = GetElement(vFields[6], ";", 2);
+			vChecks.push_back(CMessageSigCheck(sPK, GetElement(vFields[6], ";", 3), sCPID + ";" + sHash + ";" + sPK));
+		}
+	}
+}
+
 void MemorizeBlockChainPrayers(bool fDuringConnectBlock, bool fSubThread, bool fColdBoot, bool fDuringSanctuaryQuorum)
 {
+		// The tip blocks memorized on connect and the long rescans are timed apart
+		CPerfTimer timer(GetPerfTimer("memorize_prayers", fDuringConnectBlock ? "ConnectBlock" : (fColdBoot ? "ColdBoot" : (fDuringSanctuaryQuorum ? "SanctuaryQuorum" : "Rescan"))));
 		int nDeserializedHeight = 0;
 		if (fColdBoot)
 		{
@@ -7682,6 +7826,10 @@ void MemorizeBlockChainPrayers(bool fDuringConnectBlock, bool fSubThread, bool f
 			CBlock block;
 			if (ReadBlockFromDisk(block, pindex, consensusParams, "MemorizeBlockChainPrayers")) 
 			{
+				// Recover the block's message signatures on every core first; the checks while memorizing then hit the cache
+				std::vector<CMessageSigCheck> vSigChecks;
+				GetBlockMessageSigChecks(block, vSigChecks);
+				CheckMessageSignaturesInParallel(vSigChecks);
 	  			for (unsigned int n = 0; n < block.vtx.size(); n++)
        			{
 					double dTotalSent = 0;
@@ -7862,6 +8010,8 @@ bool CheckSporkSig(TxMessage t)
 {
 	std::string sError = "";
 	const CChainParams& chainparams = Params();
+	static CPerfStat& statSporkSig = GetPerfTimer("txmessage_sigcheck", "CheckSporkSig");
+	CPerfTimer timer(statSporkSig);
 	bool fSigValid = CheckStakeSignature(chainparams.GetConsensus().FoundationAddress, t.sSporkSig, t.sMessageValue + t.sNonce, sError);
     bool bValid = (fSigValid && t.fNonceValid);
 	if (!bValid)
@@ -7877,6 +8027,8 @@ bool CheckBusinessObjectSig(TxMessage t)
 	if (!t.sBOSig.empty() && !t.sBOSigner.empty())
 	{	
 		std::string sError = "";
+		static CPerfStat& statBOSig = GetPerfTimer("txmessage_sigcheck", "CheckBusinessObjectSig");
+		CPerfTimer timer(statBOSig);
 		bool fBOSigValid = CheckStakeSignature(t.sBOSigner, t.sBOSig, t.sMessageValue + t.sNonce, sError);
    		if (!fBOSigValid)
 		{
@@ -7891,21 +8043,25 @@ bool CheckBusinessObjectSig(TxMessage t)
 TxMessage GetTxMessage(std::string sMessage, int64_t nTime, int iPosition, std::string sTxId, double dAmount)
 {
 	TxMessage t;
-	t.sMessageType = ExtractXML(sMessage,"<MT>","</MT>");
-	t.sMessageKey  = ExtractXML(sMessage,"<MK>","</MK>");
-	t.sMessageValue= ExtractXML(sMessage,"<MV>","</MV>");
-	t.sSig         = ExtractXML(sMessage,"<MS>","</MS>");
-	t.sNonce       = ExtractXML(sMessage,"<NONCE>","</NONCE>");
+	static CPerfStat& statTxMessages = GetPerfCounter("txmessages");
+	statTxMessages.Add();
+	// Every field comes out of one scan of the message; the tag names are case sensitive
+	static const XMLTagList vTags = GetXMLTagList("MT,MK,MV,MS,NONCE,SPORKSIG,BOSIG,BOSIGNER,ipfshash,ipfssize,cpidsig,PODC_TASKS");
+	std::vector<std::string> vFields = ExtractXMLFields(sMessage, vTags);
+	t.sMessageType = vFields[0];
+	t.sMessageKey  = vFields[1];
+	t.sMessageValue= vFields[2];
+	t.sSig         = vFields[3];
+	t.sNonce       = vFields[4];
 	t.nNonce       = cdbl(t.sNonce, 0);
-	t.sSporkSig    = ExtractXML(sMessage,"<SPORKSIG>","</SPORKSIG>");
-	t.sIPFSHash    = ExtractXML(sMessage,"<IPFSHASH>", "</IPFSHASH>");
-	t.sBOSig       = ExtractXML(sMessage,"<BOSIG>", "</BOSIG>");
-	t.sBOSigner    = ExtractXML(sMessage,"<BOSIGNER>", "</BOSIGNER>");
-	t.sIPFSHash    = ExtractXML(sMessage,"<ipfshash>", "</ipfshash>");
-	t.sIPFSSize    = ExtractXML(sMessage,"<ipfssize>", "</ipfssize>");
-	t.sCPIDSig     = ExtractXML(sMessage,"<cpidsig>","</cpidsig>");
+	t.sSporkSig    = vFields[5];
+	t.sBOSig       = vFields[6];
+	t.sBOSigner    = vFields[7];
+	t.sIPFSHash    = vFields[8];
+	t.sIPFSSize    = vFields[9];
+	t.sCPIDSig     = vFields[10];
 	t.sCPID        = GetElement(t.sCPIDSig, ";", 0);
-	t.sPODCTasks   = ExtractXML(sMessage, "<PODC_TASKS>", "</PODC_TASKS>");
+	t.sPODCTasks   = vFields[11];
 	t.sTxId        = sTxId;
 	t.nTime        = nTime;
 	t.dAmount      = dAmount;
@@ -7914,7 +8070,8 @@ TxMessage GetTxMessage(std::string sMessage, int64_t nTime, int iPosition, std::
 	t.sTimestamp = TimestampToHRDate((double)nTime + iPosition);
 	t.fNonceValid = (!(t.nNonce > (nTime+(60 * 60)) || t.nNonce < (nTime-(60 * 60))));
 	t.nAge = GetAdjustedTime() - nTime;
-	t.fPrayersMustBeSigned = (GetSporkDouble("prayersmustbesigned", 0) == 1);
+	static CSporkHandle hPrayersMustBeSigned("prayersmustbesigned");
+	t.fPrayersMustBeSigned = (hPrayersMustBeSigned.GetDouble(0) == 1);
 
 	if (t.sMessageType == "PRAYER" && (!(Contains(t.sMessageKey, "(") ))) t.sMessageKey += " (" + t.sTimestamp + ")";
 	if (t.sMessageType == "SPORK" || (t.sMessageType == "PRAYER" && t.fPrayersMustBeSigned))
@@ -7986,7 +8143,10 @@ void MemorizePrayer(std::string sMessage, int64_t nTime, double dAmount, int iPo
 	MemorizeUTXOWeight(t, dAmount);
 	if (t.fPassedSecurityCheck && !t.sMessageType.empty() && !t.sMessageKey.empty() && !t.sMessageValue.empty())
 	{
+		// Only announce live changes; the cold boot replay of the chain is not news to subscribers
+		bool fChanged = fPrayersMemorized && ReadCache(t.sMessageType, t.sMessageKey) != t.sMessageValue;
 		WriteCache(t.sMessageType, t.sMessageKey, t.sMessageValue, nTime);
+		if (fChanged) GetMainSignals().NotifyMessage(t.sMessageType, t.sMessageKey, t.sMessageValue, nTime);
 	}
 }
 
@@ -8481,6 +8641,7 @@ CAmount GetRetirementAccountContributionAmount(int nPrevHeight)
 std::string ReadCacheWithMaxAge(std::string sSection, std::string sKey, int64_t nMaxAge)
 {
 	// This allows us to disregard old cache messages
+	LOCK(cs_appcache);
 	std::string sValue = ReadCache(sSection, sKey);
 	std::string sFullKey = sSection + ";" + sKey;
 	boost::to_upper(sFullKey);
@@ -8498,6 +8659,7 @@ std::string ReadCacheWithMaxAge(std::string sSection, std::string sKey, int64_t
 void ClearCache(std::string sSection)
 {
 	boost::to_upper(sSection);
+	LOCK(cs_appcache);
 	for(map<string,string>::iterator ii=mvApplicationCache.begin(); ii!=mvApplicationCache.end(); ++ii)
 	{
 		std::string sKey = (*ii).first;
@@ -8508,6 +8670,7 @@ void ClearCache(std::string sSection)
 			{
 				mvApplicationCache[sKey]="";
 				mvApplicationCacheTimestamp[sKey]=0;
+				ForgetCacheEntry(sKey);
 			}
 		}
 	}
@@ -8521,6 +8684,7 @@ std::string ReadCache(std::string sSection, std::string sKey)
 	boost::to_upper(sKey);
 	
 	if (sSection.empty() || sKey.empty()) return "";
+	LOCK(cs_appcache);
 	try
 	{
 		std::string sValue = mvApplicationCache[sSection + ";" + sKey];
@@ -36,6 +36,7 @@ class CBlockTreeDB;
 class CBloomFilter;
 class CChainParams;
 class CInv;
+class CMessageSigCheck;
 class CScriptCheck;
 class CTxMemPool;
 class CValidationInterface;
@@ -191,6 +192,8 @@ extern CBlock cblockGenesis;
 
 extern std::map<std::string, std::string> mvApplicationCache;
 extern std::map<std::string, int64_t> mvApplicationCacheTimestamp;
+/** Guards mvApplicationCache and mvApplicationCacheTimestamp, which the miner threads write outside cs_main */
+extern CCriticalSection cs_appcache;
 
 extern std::map<int64_t, std::string> mapDebug;
 
@@ -361,6 +364,10 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the message signature checking thread; there are as many as script checking threads */
+void ThreadMessageSigCheck();
+/** Check message signatures on the message signature threads, so that checking them again where they are used hits the cache */
+void CheckMessageSignaturesInParallel(std::vector<CMessageSigCheck>& vChecks);
 
 /** Try to detect Partition (network isolation) attacks against us */
 void PartitionCheck(bool (*initialDownloadCheck)(), CCriticalSection& cs, const CBlockIndex *const &bestHeader, int64_t nPowTargetSpacing);
@@ -713,6 +720,39 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+/** Running totals over all address index entries of one address */
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+    int64_t deltas;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(deltas);
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+        deltas = 0;
+    }
+
+    void Add(CAmount satoshis, int nSign) {
+        balance += satoshis * nSign;
+        if (satoshis > 0)
+            received += satoshis * nSign;
+        deltas += nSign;
+    }
+};
+
 struct CDiskTxPos : public CDiskBlockPos
 {
     unsigned int nTxOffset; // after header
@@ -850,6 +890,17 @@ bool GetAddressIndex(uint160 addressHash, int type,
                      int start = 0, int end = 0);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+/**
+ * One page of an address' entries, starting at pCursor (or the first entry)
+ * and at most nLimit long.  next is set to the entry the following page
+ * starts at, or nulled after the last page.
+ */
+bool GetAddressIndexPage(uint160 addressHash, int type, int start, int end,
+                         const CAddressIndexKey* pCursor, size_t nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, CAddressIndexKey &next);
+bool GetAddressUnspentPage(uint160 addressHash, int type, const CAddressUnspentKey* pCursor, size_t nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs, CAddressUnspentKey &next);
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &balance);
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
@@ -10,6 +10,7 @@
 #include "masternodeman.h"
 #include "netfulfilledman.h"
 #include "spork.h"
+#include "superblock-calendar.h"
 #include "util.h"
 
 #include <boost/lexical_cast.hpp>
@@ -114,7 +115,7 @@ bool IsBlockValueValid(const CBlock& block, int nBlockHeight, CAmount blockRewar
     if(!masternodeSync.IsSynced()) 
 	{
         // not enough data but at least it must NOT exceed superblock max value
-        if(CSuperblock::IsValidBlockHeight(nBlockHeight) || (fDistributedComputingEnabled && CSuperblock::IsDCCSuperblock(nBlockHeight)))
+        if(GetGovernanceSuperblockCalendar().IsSuperblock(nBlockHeight) || GetDCCSuperblockCalendar().IsSuperblock(nBlockHeight))
 		{
             if(fDebugMaster) LogPrintf("IsBlockPayeeValid -- WARNING: Client not synced, checking superblock max bounds only \n");
             if(!isSuperblockMaxValueMet) 
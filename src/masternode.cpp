@@ -115,6 +115,8 @@ bool CMasternode::UpdateFromNewBroadcast(CMasternodeBroadcast& mnb)
     vchSig = mnb.vchSig;
     nProtocolVersion = mnb.nProtocolVersion;
     addr = mnb.addr;
+    // the protocol version decides whether it is ranked for InstantSend
+    mnodeman.NotifyRanksChanged();
     nPoSeBanScore = 0;
     nPoSeBanHeight = 0;
     nTimeLastChecked = 0;
@@ -183,7 +185,7 @@ void CMasternode::Check(bool fForce)
         if(!pcoinsTip->GetCoins(vin.prevout.hash, coins) ||
            (unsigned int)vin.prevout.n>=coins.vout.size() ||
            coins.vout[vin.prevout.n].IsNull()) {
-            nActiveState = MASTERNODE_OUTPOINT_SPENT;
+            SetActiveState(MASTERNODE_OUTPOINT_SPENT);
             LogPrint("masternode", "CMasternode::Check -- Failed to find Masternode UTXO, masternode=%s\n", vin.prevout.ToStringShort());
             return;
         }
@@ -199,7 +201,7 @@ void CMasternode::Check(bool fForce)
         LogPrintf("CMasternode::Check -- Masternode %s is unbanned and back in list now\n", vin.prevout.ToStringShort());
         DecreasePoSeBanScore();
     } else if(nPoSeBanScore >= MASTERNODE_POSE_BAN_MAX_SCORE) {
-        nActiveState = MASTERNODE_POSE_BAN;
+        SetActiveState(MASTERNODE_POSE_BAN);
         // ban for the whole payment cycle
         nPoSeBanHeight = nHeight + mnodeman.size();
         LogPrintf("CMasternode::Check -- Masternode %s is banned till block %d now\n", vin.prevout.ToStringShort(), nPoSeBanHeight);
@@ -215,7 +217,7 @@ void CMasternode::Check(bool fForce)
                    (fOurMasternode && nProtocolVersion < PROTOCOL_VERSION);
 
     if(fRequireUpdate) {
-        nActiveState = MASTERNODE_UPDATE_REQUIRED;
+        SetActiveState(MASTERNODE_UPDATE_REQUIRED);
         if(nActiveStatePrev != nActiveState) {
             LogPrint("masternode", "CMasternode::Check -- Masternode %s is in %s state now\n", vin.prevout.ToStringShort(), GetStateString());
         }
@@ -237,7 +239,7 @@ void CMasternode::Check(bool fForce)
     if(!fWaitForPing || fOurMasternode) {
 
         if(!IsPingedWithin(MASTERNODE_NEW_START_REQUIRED_SECONDS)) {
-            nActiveState = MASTERNODE_NEW_START_REQUIRED;
+            SetActiveState(MASTERNODE_NEW_START_REQUIRED);
             if(nActiveStatePrev != nActiveState) {
                 LogPrint("masternode", "CMasternode::Check -- Masternode %s is in %s state now\n", vin.prevout.ToStringShort(), GetStateString());
             }
@@ -251,7 +253,7 @@ void CMasternode::Check(bool fForce)
                 vin.prevout.ToStringShort(), nTimeLastWatchdogVote, GetTime(), fWatchdogExpired);
 
         if(fWatchdogExpired) {
-            nActiveState = MASTERNODE_WATCHDOG_EXPIRED;
+            SetActiveState(MASTERNODE_WATCHDOG_EXPIRED);
             if(nActiveStatePrev != nActiveState) {
                 LogPrint("masternode", "CMasternode::Check -- Masternode %s is in %s state now\n", vin.prevout.ToStringShort(), GetStateString());
             }
@@ -259,7 +261,7 @@ void CMasternode::Check(bool fForce)
         }
 
         if(!IsPingedWithin(MASTERNODE_EXPIRATION_SECONDS)) {
-            nActiveState = MASTERNODE_EXPIRED;
+            SetActiveState(MASTERNODE_EXPIRED);
             if(nActiveStatePrev != nActiveState) {
                 LogPrint("masternode", "CMasternode::Check -- Masternode %s is in %s state now\n", vin.prevout.ToStringShort(), GetStateString());
             }
@@ -269,19 +271,26 @@ void CMasternode::Check(bool fForce)
 
 	// Rob Andrew - BBP: This is a pretty strict check
     if(lastPing.sigTime - sigTime < MASTERNODE_MIN_MNP_SECONDS) {
-        nActiveState = MASTERNODE_PRE_ENABLED;
+        SetActiveState(MASTERNODE_PRE_ENABLED);
         if(nActiveStatePrev != nActiveState) {
             LogPrint("masternode", "CMasternode::Check -- Masternode %s is in %s state now\n", vin.prevout.ToStringShort(), GetStateString());
         }
         return;
     }
 
-    nActiveState = MASTERNODE_ENABLED; // OK
+    SetActiveState(MASTERNODE_ENABLED); // OK
     if(nActiveStatePrev != nActiveState) {
         LogPrint("masternode", "CMasternode::Check -- Masternode %s is in %s state now\n", vin.prevout.ToStringShort(), GetStateString());
     }
 }
 
+void CMasternode::SetActiveState(int nActiveStateIn)
+{
+    if((nActiveState == MASTERNODE_ENABLED) != (nActiveStateIn == MASTERNODE_ENABLED))
+        mnodeman.NotifyRanksChanged();
+    nActiveState = nActiveStateIn;
+}
+
 bool CMasternode::IsValidNetAddr()
 {
     return IsValidNetAddr(addr);
@@ -259,6 +259,8 @@ public:
     }
 
     bool IsEnabled() { return nActiveState == MASTERNODE_ENABLED; }
+    /// Change nActiveState, telling mnodeman when the masternode enters or leaves the ranking
+    void SetActiveState(int nActiveStateIn);
     bool IsPreEnabled() { return nActiveState == MASTERNODE_PRE_ENABLED; }
     bool IsPoSeBanned() { return nActiveState == MASTERNODE_POSE_BAN; }
     // NOTE: this one relies on nPoSeBanScore, not on nActiveState as everything else here
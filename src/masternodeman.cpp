@@ -11,6 +11,7 @@
 #include "masternodeman.h"
 #include "netfulfilledman.h"
 #include "util.h"
+#include "validationinterface.h"
 
 /** Masternode manager */
 CMasternodeMan mnodeman;
@@ -117,6 +118,7 @@ CMasternodeMan::CMasternodeMan()
   fIndexRebuilt(false),
   fMasternodesAdded(false),
   fMasternodesRemoved(false),
+  nRanksVersion(0),
   vecDirtyGovernanceObjectHashes(),
   nLastWatchdogVoteTime(0),
   mapSeenMasternodeBroadcast(),
@@ -134,6 +136,8 @@ bool CMasternodeMan::Add(CMasternode &mn)
         vMasternodes.push_back(mn);
         indexMasternodes.AddMasternodeVIN(mn.vin);
         fMasternodesAdded = true;
+        NotifyRanksChanged();
+        GetMainSignals().NotifyMasternodeListDiff(std::vector<COutPoint>(1, mn.vin.prevout), std::vector<COutPoint>());
         return true;
     }
 
@@ -198,7 +202,7 @@ void CMasternodeMan::CheckAndRemove()
 {
     if(!masternodeSync.IsMasternodeListSynced()) return;
 
-   
+    std::vector<COutPoint> vRemoved;
     {
         // Need LOCK2 here to ensure consistent locking order because code below locks cs_main
         // in CheckMnbAndUpdateMasternodeList()
@@ -224,8 +228,10 @@ void CMasternodeMan::CheckAndRemove()
 
                 // and finally remove it from the list
                 it->FlagGovernanceItemsAsDirty();
+                vRemoved.push_back(it->vin.prevout);
                 it = vMasternodes.erase(it);
                 fMasternodesRemoved = true;
+                NotifyRanksChanged();
             } else {
                 bool fAsk = pCurrentBlockIndex &&
                             (nAskForMnbRecovery > 0) &&
@@ -283,6 +289,9 @@ void CMasternodeMan::CheckAndRemove()
             }
         }
     }
+    if(!vRemoved.empty()) {
+        GetMainSignals().NotifyMasternodeListDiff(std::vector<COutPoint>(), vRemoved);
+    }
     {
         // no need for cm_main below
         LOCK(cs);
@@ -385,6 +394,7 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     vMasternodes.clear();
+    NotifyRanksChanged();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
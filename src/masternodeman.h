@@ -8,6 +8,8 @@
 #include "masternode.h"
 #include "sync.h"
 
+#include <atomic>
+
 using namespace std;
 
 class CMasternodeMan;
@@ -148,6 +150,9 @@ private:
     /// Set when masternodes are removed, cleared when CGovernanceManager is notified
     bool fMasternodesRemoved;
 
+    /// Bumped when masternodes are added, removed, updated or enter or leave the enabled state
+    std::atomic<int> nRanksVersion;
+
     std::vector<uint256> vecDirtyGovernanceObjectHashes;
 
     int64_t nLastWatchdogVoteTime;
@@ -364,6 +369,10 @@ public:
      */
     void NotifyMasternodeUpdates();
 
+    /// Masternode ranks computed while this returned the same value are still valid; needs no lock
+    int GetRanksVersion() const { return nRanksVersion; }
+    void NotifyRanksChanged() { ++nRanksVersion; }
+
 };
 
 #endif
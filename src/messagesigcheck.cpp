@@ -0,0 +1,126 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "messagesigcheck.h"
+
+#include "base58.h"
+#include "hash.h"
+#include "main.h"
+#include "memusage.h"
+#include "pubkey.h"
+#include "random.h"
+#include "utilstrencodings.h"
+
+#include <boost/thread.hpp>
+#include <boost/unordered_set.hpp>
+
+namespace {
+
+class CMessageSigCacheHasher
+{
+public:
+    size_t operator()(const uint256& key) const {
+        return key.GetCheapHash();
+    }
+};
+
+/** The valid message signatures, kept like the script signature cache */
+class CMessageSigCache
+{
+private:
+    //! Entries are the hash of (nonce, address, message hash, signature)
+    uint256 nonce;
+    typedef boost::unordered_set<uint256, CMessageSigCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_msgsigcache;
+
+public:
+    CMessageSigCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void ComputeEntry(uint256& entry, const std::string& sAddress, const uint256& hashMessage, const std::string& sSignature)
+    {
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << nonce << sAddress << hashMessage << sSignature;
+        entry = ss.GetHash();
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_msgsigcache);
+        return setValid.count(entry);
+    }
+
+    void Set(const uint256& entry)
+    {
+        size_t nMaxCacheSize = MAX_MESSAGE_SIG_CACHE_SIZE * ((size_t) 1 << 20);
+        boost::unique_lock<boost::shared_mutex> lock(cs_msgsigcache);
+        while (memusage::DynamicUsage(setValid) > nMaxCacheSize)
+        {
+            map_type::size_type s = GetRand(setValid.bucket_count());
+            map_type::local_iterator it = setValid.begin(s);
+            if (it != setValid.end(s)) {
+                setValid.erase(*it);
+            }
+        }
+        setValid.insert(entry);
+    }
+};
+
+}
+
+bool CheckMessageSignature(const std::string& sAddress, const std::string& sSignature, const std::string& sMessage, std::string& sError)
+{
+    static CMessageSigCache messageSigCache;
+
+    CBitcoinAddress addr(sAddress);
+    if (!addr.IsValid())
+    {
+        sError = "Invalid address";
+        return false;
+    }
+    CKeyID keyID;
+    if (!addr.GetKeyID(keyID))
+    {
+        sError = "Address does not refer to key";
+        return false;
+    }
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << strMessageMagic;
+    ss << sMessage;
+    uint256 hashMessage = ss.GetHash();
+
+    uint256 entry;
+    messageSigCache.ComputeEntry(entry, sAddress, hashMessage, sSignature);
+    if (messageSigCache.Get(entry))
+        return true;
+
+    bool fInvalid = false;
+    std::vector<unsigned char> vchSig = DecodeBase64(sSignature.c_str(), &fInvalid);
+    if (fInvalid)
+    {
+        sError = "Malformed base64 encoding";
+        return false;
+    }
+    CPubKey pubkey;
+    if (!pubkey.RecoverCompact(hashMessage, vchSig))
+    {
+        sError = "Unable to recover public key.";
+        return false;
+    }
+    if (pubkey.GetID() != keyID)
+        return false;
+
+    messageSigCache.Set(entry);
+    return true;
+}
+
+bool CMessageSigCheck::operator()()
+{
+    std::string sError;
+    CheckMessageSignature(sAddress, sSignature, sMessage, sError);
+    return true;
+}
@@ -0,0 +1,48 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MESSAGESIGCHECK_H
+#define MESSAGESIGCHECK_H
+
+#include <string>
+#include <vector>
+
+// Limit the cache of checked message signatures to about 8MB
+static const unsigned int MAX_MESSAGE_SIG_CACHE_SIZE = 8;
+
+/**
+ * Check a signed message (the CPID, spork, business object and proof of
+ * loyalty signatures carried in output messages): sSignature is the base64
+ * compact signature of sMessage by the key of sAddress.  Signatures found
+ * valid are remembered by (address, message hash, signature), so a message
+ * checked again, or checked ahead of time by the message signature queue,
+ * costs a hash instead of a public key recovery.
+ */
+bool CheckMessageSignature(const std::string& sAddress, const std::string& sSignature, const std::string& sMessage, std::string& sError);
+
+/** One message signature to check on the message signature queue; the result ends up in the cache */
+class CMessageSigCheck
+{
+public:
+    CMessageSigCheck() {}
+    CMessageSigCheck(const std::string& sAddressIn, const std::string& sSignatureIn, const std::string& sMessageIn) :
+        sAddress(sAddressIn), sSignature(sSignatureIn), sMessage(sMessageIn) {}
+
+    /** Always true: a bad signature is the caller's to judge, and must not stop the rest of the batch */
+    bool operator()();
+
+    void swap(CMessageSigCheck& check)
+    {
+        sAddress.swap(check.sAddress);
+        sSignature.swap(check.sSignature);
+        sMessage.swap(check.sMessage);
+    }
+
+private:
+    std::string sAddress;
+    std::string sSignature;
+    std::string sMessage;
+};
+
+#endif // MESSAGESIGCHECK_H
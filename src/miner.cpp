@@ -98,48 +98,21 @@ int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParam
 }
 
 
-CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& scriptPubKeyIn, std::string sPoolMiningPublicKey, std::string sMinerGuid, 
-	int iThreadId, CAmount retired_MiningTithe, double dProofOfLoyaltyPercentage, std::string sCPIDSignature, std::string& out_Error)
+static unsigned int GetBlockMaxSize()
 {
-    // Create new block
-    auto_ptr<CBlockTemplate> pblocktemplate(new CBlockTemplate());
-    if(!pblocktemplate.get())
-        return NULL;
-    CBlock *pblock = &pblocktemplate->block; // pointer for convenience
-
-    // Create coinbase tx
-    CMutableTransaction txNew;
-    txNew.vin.resize(1);
-    txNew.vin[0].prevout.SetNull();
-    txNew.vout.resize(1);
-    txNew.vout[0].scriptPubKey = scriptPubKeyIn;
-	CBlockIndex* pindexPrev = chainActive.Tip();
-	
-	// BiblePay - Add support for Pools - this section applies during Non-Tithe blocks
-	if (!sPoolMiningPublicKey.empty())
-	{
-		CBitcoinAddress cbaPoolAddress(sPoolMiningPublicKey);
-        CScript spkPoolScript = GetScriptForDestination(cbaPoolAddress.Get());
-    	txNew.vout[0].scriptPubKey = spkPoolScript;
-	}
-
-	int nLastTitheBlock = fProd ? LAST_TITHE_BLOCK : LAST_TITHE_BLOCK_TESTNET;
-	bool fTitheBlocksActive = ((pindexPrev->nHeight+1) < nLastTitheBlock);
-	
-	if (fTitheBlocksActive)
-	{
-		if (((pindexPrev->nHeight+1) % TITHE_MODULUS)==0)
-		{
-			CBitcoinAddress cbaFoundationAddress(chainparams.GetConsensus().FoundationAddress);
-			CScript spkFoundationAddress = GetScriptForDestination(cbaFoundationAddress.Get());
-    		txNew.vout[0].scriptPubKey = spkFoundationAddress;
-		}
-	}
-
     // Largest block you're willing to create:
     unsigned int nBlockMaxSize = GetArg("-blockmaxsize", DEFAULT_BLOCK_MAX_SIZE);
     // Limit to between 1K and MAX_BLOCK_SIZE-1K for sanity:
-    nBlockMaxSize = std::max((unsigned int)1000, std::min((unsigned int)(MAX_BLOCK_SIZE-1000), nBlockMaxSize));
+    return std::max((unsigned int)1000, std::min((unsigned int)(MAX_BLOCK_SIZE-1000), nBlockMaxSize));
+}
+
+void SelectBlockTransactions(CTxMemPool& pool, int nHeight, int64_t nLockTimeCutoff, CBlockTxSelection& selection)
+{
+    AssertLockHeld(pool.cs);
+
+    selection.SetNull();
+
+    unsigned int nBlockMaxSize = GetBlockMaxSize();
 
     // How much of the block should be dedicated to high-priority transactions,
     // included regardless of the fees they pay
@@ -169,156 +142,337 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& s
     unsigned int nBlockSigOps = 100;
     int lastFewTxs = 0;
     CAmount nFees = 0;
-	if (iThreadId > 30) iThreadId = 0;
-    {
-        LOCK2(cs_main, mempool.cs);
-        const int nHeight = pindexPrev->nHeight + 1;
-        pblock->nTime = GetAdjustedTime() + iThreadId;
-        const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
-        // Add our coinbase tx as first transaction
-        pblock->vtx.push_back(txNew);
-        pblocktemplate->vTxFees.push_back(-1); // updated at end
-        pblocktemplate->vTxSigOps.push_back(-1); // updated at end
-        pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
-        // -regtest only: allow overriding block.nVersion with
-        // -blockversion=N to test forking scenarios
-        if (chainparams.MineBlocksOnDemand())
-            pblock->nVersion = GetArg("-blockversion", pblock->nVersion);
 
-		// BIBLEPAY - Add Memory Pool Transactions to Block
-        int64_t nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
-                                ? nMedianTimePast
-                                : pblock->GetBlockTime();
+    bool fPriorityBlock = nBlockPrioritySize > 0;
+    if (fPriorityBlock) {
+        vecPriority.reserve(pool.mapTx.size());
+        for (CTxMemPool::indexed_transaction_set::iterator mi = pool.mapTx.begin();
+             mi != pool.mapTx.end(); ++mi)
+        {
+            double dPriority = mi->GetPriority(nHeight);
+            CAmount dummy;
+            pool.ApplyDeltas(mi->GetTx().GetHash(), dPriority, dummy);
+            vecPriority.push_back(TxCoinAgePriority(dPriority, mi));
+        }
+        std::make_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
+    }
 
+    CTxMemPool::indexed_transaction_set::nth_index<3>::type::iterator mi = pool.mapTx.get<3>().begin();
+    CTxMemPool::txiter iter;
 
-        bool fPriorityBlock = nBlockPrioritySize > 0;
-        if (fPriorityBlock) {
-            vecPriority.reserve(mempool.mapTx.size());
-            for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
-                 mi != mempool.mapTx.end(); ++mi)
-            {
-                double dPriority = mi->GetPriority(nHeight);
-                CAmount dummy;
-                mempool.ApplyDeltas(mi->GetTx().GetHash(), dPriority, dummy);
-                vecPriority.push_back(TxCoinAgePriority(dPriority, mi));
-            }
-            std::make_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
+    while (mi != pool.mapTx.get<3>().end() || !clearedTxs.empty())
+    {
+        bool priorityTx = false;
+        if (fPriorityBlock && !vecPriority.empty()) { // add a tx from priority queue to fill the blockprioritysize
+            priorityTx = true;
+            iter = vecPriority.front().second;
+            actualPriority = vecPriority.front().first;
+            std::pop_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
+            vecPriority.pop_back();
         }
+        else if (clearedTxs.empty()) { // add tx with next highest score
+            iter = pool.mapTx.project<0>(mi);
+            mi++;
+        }
+        else {  // try to add a previously postponed child tx
+            iter = clearedTxs.top();
+            clearedTxs.pop();
+        }
+
+        if (inBlock.count(iter))
+            continue; // could have been added to the priorityBlock
 
-        CTxMemPool::indexed_transaction_set::nth_index<3>::type::iterator mi = mempool.mapTx.get<3>().begin();
-        CTxMemPool::txiter iter;
+        const CTransaction& tx = iter->GetTx();
 
-        while (mi != mempool.mapTx.get<3>().end() || !clearedTxs.empty())
+        bool fOrphan = false;
+        BOOST_FOREACH(CTxMemPool::txiter parent, pool.GetMemPoolParents(iter))
         {
-            bool priorityTx = false;
-            if (fPriorityBlock && !vecPriority.empty()) { // add a tx from priority queue to fill the blockprioritysize
-                priorityTx = true;
-                iter = vecPriority.front().second;
-                actualPriority = vecPriority.front().first;
-                std::pop_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
-                vecPriority.pop_back();
+            if (!inBlock.count(parent)) {
+                fOrphan = true;
+                break;
+            }
+        }
+        if (fOrphan) {
+            if (priorityTx)
+                waitPriMap.insert(std::make_pair(iter,actualPriority));
+            else
+                waitSet.insert(iter);
+            continue;
+        }
+
+        unsigned int nTxSize = iter->GetTxSize();
+        if (fPriorityBlock &&
+            (nBlockSize + nTxSize >= nBlockPrioritySize || !AllowFree(actualPriority))) {
+            fPriorityBlock = false;
+            waitPriMap.clear();
+        }
+        if (!priorityTx &&
+            (iter->GetModifiedFee() < ::minRelayTxFee.GetFee(nTxSize) && nBlockSize >= nBlockMinSize)) {
+            break;
+        }
+        if (nBlockSize + nTxSize >= nBlockMaxSize) {
+            if (nBlockSize >  nBlockMaxSize - 100 || lastFewTxs > 50) {
+                break;
             }
-            else if (clearedTxs.empty()) { // add tx with next highest score
-                iter = mempool.mapTx.project<0>(mi);
-                mi++;
+            // Once we're within 1000 bytes of a full block, only look at 50 more txs
+            // to try to fill the remaining space.
+            if (nBlockSize > nBlockMaxSize - 1000) {
+                lastFewTxs++;
             }
-            else {  // try to add a previously postponed child tx
-                iter = clearedTxs.top();
-                clearedTxs.pop();
+            continue;
+        }
+
+        if (!IsFinalTx(tx, nHeight, nLockTimeCutoff))
+            continue;
+
+        unsigned int nTxSigOps = iter->GetSigOpCount();
+        if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS) {
+            if (nBlockSigOps > MAX_BLOCK_SIGOPS - 2) {
+                break;
             }
+            continue;
+        }
+
+        CAmount nTxFees = iter->GetFee();
+        // Added
+        selection.vtx.push_back(iter->GetSharedTx());
+        selection.vTxFees.push_back(nTxFees);
+        selection.vTxSigOps.push_back(nTxSigOps);
+        nBlockSize += nTxSize;
+        ++nBlockTx;
+        nBlockSigOps += nTxSigOps;
+        nFees += nTxFees;
+
+        if (fPrintPriority)
+        {
+            double dPriority = iter->GetPriority(nHeight);
+            CAmount dummy;
+            pool.ApplyDeltas(tx.GetHash(), dPriority, dummy);
+            if (fDebugMaster) LogPrintf("priority %.1f fee %s txid %s\n", dPriority , CFeeRate(iter->GetModifiedFee(), nTxSize).ToString(), tx.GetHash().ToString());
+        }
 
-            if (inBlock.count(iter))
-                continue; // could have been added to the priorityBlock
+        inBlock.insert(iter);
+        // Add transactions that depend on this one to the priority queue
+        BOOST_FOREACH(CTxMemPool::txiter child, pool.GetMemPoolChildren(iter))
+        {
+            if (fPriorityBlock) {
+                waitPriIter wpiter = waitPriMap.find(child);
+                if (wpiter != waitPriMap.end()) {
+                    vecPriority.push_back(TxCoinAgePriority(wpiter->second,child));
+                    std::push_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
+                    waitPriMap.erase(wpiter);
+                }
+            }
+            else {
+                if (waitSet.count(child)) {
+                    clearedTxs.push(child);
+                    waitSet.erase(child);
+                }
+            }
+        }
+    }
 
-            const CTransaction& tx = iter->GetTx();
+    selection.nBlockSize = nBlockSize;
+    selection.nBlockTx = nBlockTx;
+    selection.nBlockSigOps = nBlockSigOps;
+    selection.nFees = nFees;
+}
 
+// The last selection made from the global mempool, shared by miner threads and getblocktemplate
+static CCriticalSection cs_blockTxSelection;
+static CBlockTxSelection cachedBlockTxSelection;
+static CTxMemPool::setEntries setBlockTxSelected; // valid while no transaction left the mempool
+static uint256 hashBlockTxSelectionTip;
+static unsigned int nBlockTxSelectionMempoolUpdates = 0;
+static unsigned int nBlockTxSelectionMempoolRemovals = 0;
+static int64_t nBlockTxSelectionLockTimeCutoff = 0;
+static bool fBlockTxSelectionWholePool = false;
+static bool fBlockTxSelectionCached = false;
+
+/**
+ * Append the transactions added to the mempool since the cached selection
+ * was made, when that selection holds the whole mempool.  Each one has to
+ * pay the relay fee, be final and fit, and its mempool parents have to be
+ * in the selection, so a fresh selection would take it as well.  False if
+ * any of them does not qualify; the caller then selects again.
+ */
+static bool AppendBlockTransactions(int nHeight, int64_t nLockTimeCutoff)
+{
+    if (!fBlockTxSelectionWholePool)
+        return false;
+
+    // No transaction left the pool, so the ones not selected are the new ones
+    size_t nNew = mempool.mapTx.size() - setBlockTxSelected.size();
+    std::vector<CTxMemPool::txiter> vNew;
+    vNew.reserve(nNew);
+    // Newest first, so usually only the new entries are looked at
+    CTxMemPool::indexed_transaction_set::nth_index<2>::type::iterator mi = mempool.mapTx.get<2>().end();
+    while (mi != mempool.mapTx.get<2>().begin() && vNew.size() < nNew)
+    {
+        --mi;
+        CTxMemPool::txiter iter = mempool.mapTx.project<0>(mi);
+        if (!setBlockTxSelected.count(iter))
+            vNew.push_back(iter);
+    }
+    if (vNew.size() != nNew)
+        return false;
+
+    unsigned int nBlockMaxSize = GetBlockMaxSize();
+    CBlockTxSelection& selection = cachedBlockTxSelection;
+    // Oldest first; a transaction whose new parent comes later waits for the next pass
+    std::reverse(vNew.begin(), vNew.end());
+    while (!vNew.empty())
+    {
+        std::vector<CTxMemPool::txiter> vWaiting;
+        BOOST_FOREACH(CTxMemPool::txiter iter, vNew)
+        {
             bool fOrphan = false;
             BOOST_FOREACH(CTxMemPool::txiter parent, mempool.GetMemPoolParents(iter))
             {
-                if (!inBlock.count(parent)) {
+                if (!setBlockTxSelected.count(parent)) {
                     fOrphan = true;
                     break;
                 }
             }
             if (fOrphan) {
-                if (priorityTx)
-                    waitPriMap.insert(std::make_pair(iter,actualPriority));
-                else
-                    waitSet.insert(iter);
+                vWaiting.push_back(iter);
                 continue;
             }
 
+            const CTransaction& tx = iter->GetTx();
             unsigned int nTxSize = iter->GetTxSize();
-            if (fPriorityBlock &&
-                (nBlockSize + nTxSize >= nBlockPrioritySize || !AllowFree(actualPriority))) {
-                fPriorityBlock = false;
-                waitPriMap.clear();
-            }
-            if (!priorityTx &&
-                (iter->GetModifiedFee() < ::minRelayTxFee.GetFee(nTxSize) && nBlockSize >= nBlockMinSize)) {
-                break;
-            }
-            if (nBlockSize + nTxSize >= nBlockMaxSize) {
-                if (nBlockSize >  nBlockMaxSize - 100 || lastFewTxs > 50) {
-                    break;
-                }
-                // Once we're within 1000 bytes of a full block, only look at 50 more txs
-                // to try to fill the remaining space.
-                if (nBlockSize > nBlockMaxSize - 1000) {
-                    lastFewTxs++;
-                }
-                continue;
-            }
+            unsigned int nTxSigOps = iter->GetSigOpCount();
+            if (iter->GetModifiedFee() < ::minRelayTxFee.GetFee(nTxSize) ||
+                selection.nBlockSize + nTxSize >= nBlockMaxSize ||
+                selection.nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS ||
+                !IsFinalTx(tx, nHeight, nLockTimeCutoff))
+                return false;
+
+            selection.vtx.push_back(iter->GetSharedTx());
+            selection.vTxFees.push_back(iter->GetFee());
+            selection.vTxSigOps.push_back(nTxSigOps);
+            selection.nBlockSize += nTxSize;
+            selection.nBlockTx++;
+            selection.nBlockSigOps += nTxSigOps;
+            selection.nFees += iter->GetFee();
+            setBlockTxSelected.insert(iter);
+        }
+        if (vWaiting.size() == vNew.size())
+            return false;
+        vNew.swap(vWaiting);
+    }
+    return true;
+}
 
-            if (!IsFinalTx(tx, nHeight, nLockTimeCutoff))
-                continue;
+void GetBlockTransactions(const CBlockIndex* pindexPrev, int64_t nLockTimeCutoff, CBlockTxSelection& selection)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(mempool.cs);
+
+    LOCK(cs_blockTxSelection);
+    // Priorities depend on the height and finality on the cutoff, and a removed transaction
+    // may be spent or conflicted, so these always select again.  While the mempool only
+    // gained transactions (or prioritisetransaction changed the order), a selection that
+    // holds the whole pool takes the new ones as they come instead of rescanning mapTx.
+    unsigned int nMempoolUpdates = mempool.GetTransactionsUpdated();
+    unsigned int nMempoolRemovals = mempool.GetTransactionsRemoved();
+    bool fSelect = !fBlockTxSelectionCached ||
+        hashBlockTxSelectionTip != pindexPrev->GetBlockHash() ||
+        nBlockTxSelectionLockTimeCutoff != nLockTimeCutoff ||
+        nBlockTxSelectionMempoolRemovals != nMempoolRemovals;
+    if (!fSelect && nBlockTxSelectionMempoolUpdates != nMempoolUpdates)
+        fSelect = !AppendBlockTransactions(pindexPrev->nHeight + 1, nLockTimeCutoff);
+    if (fSelect)
+    {
+        SelectBlockTransactions(mempool, pindexPrev->nHeight + 1, nLockTimeCutoff, cachedBlockTxSelection);
+        setBlockTxSelected.clear();
+        BOOST_FOREACH(const CTransactionRef& ptx, cachedBlockTxSelection.vtx)
+            setBlockTxSelected.insert(mempool.mapTx.find(ptx->GetHash()));
+        fBlockTxSelectionWholePool = setBlockTxSelected.size() == mempool.mapTx.size();
+        hashBlockTxSelectionTip = pindexPrev->GetBlockHash();
+        nBlockTxSelectionMempoolRemovals = nMempoolRemovals;
+        nBlockTxSelectionLockTimeCutoff = nLockTimeCutoff;
+        fBlockTxSelectionCached = true;
+    }
+    nBlockTxSelectionMempoolUpdates = nMempoolUpdates;
+    selection = cachedBlockTxSelection;
+}
 
-            unsigned int nTxSigOps = iter->GetSigOpCount();
-            if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS) {
-                if (nBlockSigOps > MAX_BLOCK_SIGOPS - 2) {
-                    break;
-                }
-                continue;
-            }
+CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& scriptPubKeyIn, std::string sPoolMiningPublicKey, std::string sMinerGuid, 
+	int iThreadId, CAmount retired_MiningTithe, double dProofOfLoyaltyPercentage, std::string sCPIDSignature, std::string& out_Error)
+{
+    // Create new block
+    auto_ptr<CBlockTemplate> pblocktemplate(new CBlockTemplate());
+    if(!pblocktemplate.get())
+        return NULL;
+    CBlock *pblock = &pblocktemplate->block; // pointer for convenience
 
-            CAmount nTxFees = iter->GetFee();
-            // Added
-            pblock->vtx.push_back(tx);
-            pblocktemplate->vTxFees.push_back(nTxFees);
-            pblocktemplate->vTxSigOps.push_back(nTxSigOps);
-            nBlockSize += nTxSize;
-            ++nBlockTx;
-            nBlockSigOps += nTxSigOps;
-            nFees += nTxFees;
-
-            if (fPrintPriority)
-            {
-                double dPriority = iter->GetPriority(nHeight);
-                CAmount dummy;
-                mempool.ApplyDeltas(tx.GetHash(), dPriority, dummy);
-                if (fDebugMaster) LogPrintf("priority %.1f fee %s txid %s\n", dPriority , CFeeRate(iter->GetModifiedFee(), nTxSize).ToString(), tx.GetHash().ToString());
-            }
+    // Create coinbase tx
+    CMutableTransaction txNew;
+    txNew.vin.resize(1);
+    txNew.vin[0].prevout.SetNull();
+    txNew.vout.resize(1);
+    txNew.vout[0].scriptPubKey = scriptPubKeyIn;
+	CBlockIndex* pindexPrev = chainActive.Tip();
+	
+	// BiblePay - Add support for Pools - this section applies during Non-Tithe blocks
+	if (!sPoolMiningPublicKey.empty())
+	{
+		CBitcoinAddress cbaPoolAddress(sPoolMiningPublicKey);
+        CScript spkPoolScript = GetScriptForDestination(cbaPoolAddress.Get());
+    	txNew.vout[0].scriptPubKey = spkPoolScript;
+	}
 
-            inBlock.insert(iter);
-	        // Add transactions that depend on this one to the priority queue
-            BOOST_FOREACH(CTxMemPool::txiter child, mempool.GetMemPoolChildren(iter))
-            {
-                if (fPriorityBlock) {
-                    waitPriIter wpiter = waitPriMap.find(child);
-                    if (wpiter != waitPriMap.end()) {
-                        vecPriority.push_back(TxCoinAgePriority(wpiter->second,child));
-                        std::push_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
-                        waitPriMap.erase(wpiter);
-                    }
-                }
-                else {
-                    if (waitSet.count(child)) {
-                        clearedTxs.push(child);
-                        waitSet.erase(child);
-                    }
-                }
-            }
-        }
+	int nLastTitheBlock = fProd ? LAST_TITHE_BLOCK : LAST_TITHE_BLOCK_TESTNET;
+	bool fTitheBlocksActive = ((pindexPrev->nHeight+1) < nLastTitheBlock);
+	
+	if (fTitheBlocksActive)
+	{
+		if (((pindexPrev->nHeight+1) % TITHE_MODULUS)==0)
+		{
+			CBitcoinAddress cbaFoundationAddress(chainparams.GetConsensus().FoundationAddress);
+			CScript spkFoundationAddress = GetScriptForDestination(cbaFoundationAddress.Get());
+    		txNew.vout[0].scriptPubKey = spkFoundationAddress;
+		}
+	}
+
+    uint64_t nBlockSize = 0;
+    uint64_t nBlockTx = 0;
+    unsigned int nBlockSigOps = 0;
+    CAmount nFees = 0;
+	if (iThreadId > 30) iThreadId = 0;
+    {
+        LOCK2(cs_main, mempool.cs);
+        const int nHeight = pindexPrev->nHeight + 1;
+        pblock->nTime = GetAdjustedTime() + iThreadId;
+        const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
+        // Add our coinbase tx as first transaction
+        pblock->vtx.push_back(txNew);
+        pblocktemplate->vTxFees.push_back(-1); // updated at end
+        pblocktemplate->vTxSigOps.push_back(-1); // updated at end
+        pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
+        // -regtest only: allow overriding block.nVersion with
+        // -blockversion=N to test forking scenarios
+        if (chainparams.MineBlocksOnDemand())
+            pblock->nVersion = GetArg("-blockversion", pblock->nVersion);
+
+		// BIBLEPAY - Add Memory Pool Transactions to Block
+        int64_t nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
+                                ? nMedianTimePast
+                                : pblock->GetBlockTime();
+
+
+        CBlockTxSelection selection;
+        GetBlockTransactions(pindexPrev, nLockTimeCutoff, selection);
+        pblock->vtx.reserve(selection.vtx.size() + 1);
+        BOOST_FOREACH(const CTransactionRef& ptx, selection.vtx)
+            pblock->vtx.push_back(*ptx);
+        pblocktemplate->vTxFees.insert(pblocktemplate->vTxFees.end(), selection.vTxFees.begin(), selection.vTxFees.end());
+        pblocktemplate->vTxSigOps.insert(pblocktemplate->vTxSigOps.end(), selection.vTxSigOps.begin(), selection.vTxSigOps.end());
+        nBlockSize = selection.nBlockSize;
+        nBlockTx = selection.nBlockTx;
+        nBlockSigOps = selection.nBlockSigOps;
+        nFees = selection.nFees;
 
         // NOTE: unlike in bitcoin, we need to pass PREVIOUS block height here
         CAmount blockReward = nFees + GetBlockSubsidy(pindexPrev, pindexPrev->nBits, pindexPrev->nHeight, Params().GetConsensus());
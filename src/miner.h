@@ -14,6 +14,7 @@ class CBlockIndex;
 class CChainParams;
 class CReserveKey;
 class CScript;
+class CTxMemPool;
 class CWallet;
 namespace Consensus { struct Params; };
 
@@ -29,12 +30,45 @@ struct CBlockTemplate
     std::vector<int64_t> vTxSigOps;
 };
 
+/** Mempool transactions chosen for a block, in block order, without the coinbase */
+struct CBlockTxSelection
+{
+    std::vector<CTransactionRef> vtx;   // shared with the mempool entries, so copies of a selection are cheap
+    std::vector<CAmount> vTxFees;
+    std::vector<int64_t> vTxSigOps;
+    uint64_t nBlockSize;        // includes the 1000 bytes reserved for the coinbase
+    uint64_t nBlockTx;
+    unsigned int nBlockSigOps;  // includes the 100 sigops reserved for the coinbase
+    CAmount nFees;
+
+    CBlockTxSelection() { SetNull(); }
+    void SetNull()
+    {
+        vtx.clear();
+        vTxFees.clear();
+        vTxSigOps.clear();
+        nBlockSize = 0;
+        nBlockTx = 0;
+        nBlockSigOps = 0;
+        nFees = 0;
+    }
+};
+
 /** Run the miner threads */
 void GenerateBiblecoins(bool fGenerate, int nThreads, const CChainParams& chainparams);
 /** Generate a new block, without valid proof-of-work */
 CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& scriptPubKeyIn, std::string sPoolMiningPublicKey, std::string sMinerGuid,
 	int iThreadID, CAmount retiredMiningTithe, double dProofOfLoyaltyPercentage, std::string sCPIDSignature, std::string& sErr);
 
+/** Fill selection from pool by priority then ancestor fee rate, honouring -blockmaxsize, -blockprioritysize and -blockminsize */
+void SelectBlockTransactions(CTxMemPool& pool, int nHeight, int64_t nLockTimeCutoff, CBlockTxSelection& selection);
+/**
+ * Mempool selection for a block on top of pindexPrev, reused until the tip changes or a
+ * transaction leaves the mempool.  Transactions added to the mempool are appended to a
+ * selection that holds the whole pool; otherwise the pool is selected from again.
+ */
+void GetBlockTransactions(const CBlockIndex* pindexPrev, int64_t nLockTimeCutoff, CBlockTxSelection& selection);
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
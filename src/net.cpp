@@ -17,6 +17,7 @@
 #include "consensus/consensus.h"
 #include "crypto/common.h"
 #include "hash.h"
+#include "httpclient.h"
 #include "primitives/transaction.h"
 #include "scheduler.h"
 #include "ui_interface.h"
@@ -25,6 +26,7 @@
 #include "podc.h"
 #include "darksend.h"
 #include "instantx.h"
+#include "ipfsdownload.h"
 #include "masternode-sync.h"
 #include "masternodeman.h"
 
@@ -89,10 +91,10 @@ extern std::string SQL(std::string sCommand, std::string sAddress, std::string s
 extern std::string PrepareHTTPPost(bool bPost, std::string sPage, std::string sHostHeader, const string& sMsg, const map<string,string>& mapRequestHeaders);
 extern std::string GetDomainFromURL(std::string sURL);
 extern bool DownloadDistributedComputingFile(int iNextSuperblock, std::string& sError);
-bool FilterFile(int iBufferSize, int iNextSuperblock, std::string& sError);
+bool FilterFile(std::string sProject1URL, std::string sProject2URL, int iNextSuperblock, std::string& sError);
 std::string GetSporkValue(std::string sKey);
 int ipfs_socket_connect(string ip_address, int port);
-int ipfs_http_get(const string& request, const string& ip_address, int port, const string& fname, double dTimeoutSecs);
+int64_t GetIPFSSize(std::string sHash);
 extern int ipfs_download(const string& url, const string& filename, double dTimeoutSecs, double dRangeRequestMin, double dRangeRequestMax);
 int64_t GetFileSize(std::string sPath);
 
@@ -2128,11 +2130,11 @@ void RelayTransaction(const CTransaction& tx)
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss.reserve(10000);
     uint256 hash = tx.GetHash();
-    CTxLockRequest txLockRequest;
+    CTxLockRequestRef txLockRequest;
     if(mapDarksendBroadcastTxes.count(hash)) { // MSG_DSTX
         ss << mapDarksendBroadcastTxes[hash];
     } else if(instantsend.GetTxLockRequest(hash, txLockRequest)) { // MSG_TXLOCK_REQUEST
-        ss << txLockRequest;
+        ss << *txLockRequest;
     } else { // MSG_TX
         ss << tx;
     }
@@ -2776,135 +2778,6 @@ void ReleaseNodeVector(const std::vector<CNode*>& vecNodes)
 }
 
 
-bool RecvHttpLine(SOCKET hSocket, string& strLine, int iMaxLineSize, int iTimeoutSecs)
-{
-	try
-	{
-		strLine = "";
-		clock_t begin = clock();
-		while (true)
-		{
-			char c;
-     		int nBytes = recv(hSocket, &c, 1, MSG_DONTWAIT);
-			clock_t end = clock();
-			double elapsed_secs = double(end - begin) / (CLOCKS_PER_SEC + .01);
-			if (elapsed_secs > iTimeoutSecs) 
-			{
-				if (fDebugMaster) LogPrintf(" http timeout ");
-				return true;
-			}
-			if (nBytes > 0)
-			{
-				strLine += c;
-				if (c == '\n')      return true;
-				if (c == '\r')      return true;
-				if (strLine.find("</html>") != string::npos) return true;
-				if (strLine.find("</HTML>") != string::npos) return true;
-				if (strLine.find("<EOF>") != string::npos) return true;
-				if (strLine.find("<END>") != string::npos) return true;
-				if ((int)strLine.size() >= iMaxLineSize)
-					return true;
-			}
-			else if (nBytes <= 0)
-			{
-				boost::this_thread::interruption_point();
-				if (nBytes < 0)
-				{
-
-					int nErr = WSAGetLastError();
-					if (nErr == WSAEMSGSIZE)
-						continue;
-					if (nErr == WSAEWOULDBLOCK || nErr == WSAEINTR || nErr == WSAEINPROGRESS)
-					{
-						MilliSleep(1);
-						clock_t end = clock();
-						double elapsed_secs = double(end - begin) / (CLOCKS_PER_SEC+.01);
-						if (elapsed_secs > iTimeoutSecs) return true;
-						continue;
-					}
-				}
-				if (!strLine.empty())
-					return true;
-				if (nBytes == 0)
-				{
-					// socket closed
-					return false;
-				}
-				else
-				{
-					// socket error
-					int nErr = WSAGetLastError();
-					if (nErr > 0)
-					{
-						if (fDebugMaster) LogPrintf("HTTP Socket Error: %d\n", nErr);
-						return false;
-					}
-				}
-			}
-		}
-
-	}
-	catch (std::exception &e)
-	{
-        return false;
-    }
-	catch (...)
-	{
-		return false;
-	}
-
-}
-
-
-
-std::string GetHTTPContent(const CService& addrConnect, std::string getdata, int iTimeoutSecs, int iOptBreak)
-{
-	try
-	{
-		char *pszGet = (char*)getdata.c_str();
-		SOCKET hSocket;
-
-	    bool proxyConnectionFailed = false;
-    
-
-		if (!ConnectSocket(addrConnect, hSocket, iTimeoutSecs*1000, &proxyConnectionFailed))
-		{
-			return "GetHttpContent() : connection to address failed";
-		}
-
-		send(hSocket, pszGet, strlen(pszGet), MSG_NOSIGNAL);
-		string strLine;
-		std::string strOut="null";
-		MilliSleep(1);
-		double timeout = 0;
-		clock_t begin = clock();
-		while (RecvHttpLine(hSocket, strLine, 50000, iTimeoutSecs))
-		{
-            strOut = strOut + strLine + "\r\n";
-			MilliSleep(1);
-			timeout=timeout+1;
-		    clock_t end = clock();
-			double elapsed_secs = double(end - begin) / (CLOCKS_PER_SEC+.01);
-			if (elapsed_secs > iTimeoutSecs) break;
-		    if (strLine.find("<END>") != string::npos) break;
-			if (strLine.find("<eof>") != string::npos) break;
-			if (strLine.find("</html>") != string::npos) break;
-			if (strLine.find("</HTML>") != string::npos) break;
-			if (iOptBreak == 1) if (strLine.find("}") != string::npos) break;
-		}
-		CloseSocket(hSocket);
-		return strOut;
-	}
-    catch (std::exception &e)
-	{
-        return "";
-    }
-	catch (...)
-	{
-		return "";
-	}
-}
-
 std::string GetDomainFromURL(std::string sURL)
 {
 	std::string sDomain = "";
@@ -2956,6 +2829,41 @@ std::string SQL(std::string sCommand, std::string sAddress, std::string sArgumen
 }
 
 
+/** Send a pool, BOINC or IPFS request through the shared client; the result keeps the headers in front of the body as callers parse both */
+static bool BiblepayClientRequest(bool bPost, bool fTLS, std::string sBaseURL, int iPort, const std::string& sPage, const std::string& sPayload,
+	const map<string, string>& mapRequestHeaders, int iTimeoutSecs, int iMaxSize, const std::vector<std::string>& vEndMarkers, std::string& sResult)
+{
+	CHTTPClientRequest request;
+	request.sMethod = bPost ? "POST" : "GET";
+	request.sHost = GetDomainFromURL(sBaseURL);
+	request.sHost = request.sHost.substr(0, request.sHost.find('/'));
+	if (request.sHost.empty())
+	{
+		sResult = "DOMAIN_MISSING";
+		return false;
+	}
+	request.nPort = iPort;
+	request.fTLS = fTLS;
+	request.sPath = "/" + sPage;
+	request.mapHeaders = mapRequestHeaders;
+	request.sBody = sPayload;
+	request.nTimeoutMillis = iTimeoutSecs * 1000;
+	request.nMaxBodySize = iMaxSize;
+	request.vEndMarkers = vEndMarkers;
+	CHTTPClientResponse response;
+	bool fSuccess = GetHTTPClient().Request(request, response);
+	if (fDebug10) LogPrintf("BiblepayClientRequest -- %s%s status %d, %d bytes, %s %s\n", request.sHost, request.sPath, response.nStatus, response.sBody.size(),
+		response.fReused ? "reused" : "new connection", response.sError);
+	// A timeout after the headers still hands back what arrived, as the old readers did
+	if (!fSuccess && response.sHeaders.empty())
+	{
+		sResult = response.sError;
+		return false;
+	}
+	sResult = response.sHeaders + "\r\n\r\n" + response.sBody;
+	return true;
+}
+
 std::string BiblepayHttpPost(bool bPost, int iThreadID, std::string sActionName, std::string sDistinctUser, 
 	std::string sPayload, std::string sBaseURL, std::string sPage, int iPort, std::string sSolution, int iOptBreak)
 {
@@ -2972,20 +2880,17 @@ std::string BiblepayHttpPost(bool bPost, int iThreadID, std::string sActionName,
 			mapRequestHeaders["ThreadID"] = RoundToString(iThreadID,0);
 			mapRequestHeaders["OS"] = sOS;
 
-			CService addrConnect;
-			std::string sDomain = GetDomainFromURL(sBaseURL);
-			if (sDomain.empty()) return "DOMAIN_MISSING";
-			CService addrIP(sDomain, iPort, true);
-     		if (addrIP.IsValid())
-			{
-				addrConnect = addrIP;
-			}
-			else
+			std::vector<std::string> vEndMarkers;
+			vEndMarkers.push_back("<END>");
+			vEndMarkers.push_back("<eof>");
+			vEndMarkers.push_back("</html>");
+			vEndMarkers.push_back("</HTML>");
+			if (iOptBreak == 1) vEndMarkers.push_back("}");
+			std::string sResponse;
+			if (!BiblepayClientRequest(bPost, false, sBaseURL, iPort, sPage, sPayload, mapRequestHeaders, 15, 0, vEndMarkers, sResponse))
 			{
-  				return "DNS_ERROR"; 
+				return sResponse == "DOMAIN_MISSING" ? sResponse : "GetHttpContent() : connection to address failed";
 			}
-			std::string sPost = PrepareHTTPPost(bPost, sPage, sDomain, sPayload, mapRequestHeaders);
-			std::string sResponse = GetHTTPContent(addrConnect, sPost, 15, iOptBreak);
 			if (fDebug10) LogPrintf("\r\n  HTTP_RESPONSE:    %s    \r\n",sResponse.c_str());
 			return sResponse;
 	}
@@ -2999,30 +2904,6 @@ std::string BiblepayHttpPost(bool bPost, int iThreadID, std::string sActionName,
 	}
 }
 
-bool DownloadIndividualDistributedComputingFile2(int iNextSuperblock, std::string sBaseURL, std::string sPage, std::string sUserFile, std::string& sError)
-{
-	std::string sPath = GetSANDirectory2() + sUserFile + ".gz";
-	std::string sTarget = GetSANDirectory2() + sUserFile;
-	boost::filesystem::remove(sTarget);
-    boost::filesystem::remove(sPath);
-	std::string sURL = sBaseURL + sPage;
-	std::string sCommand = "wget " + sURL + " -O " + sPath + " -q";
-    std::string sResult = SystemCommand2(sCommand.c_str());
-	sCommand = "gunzip " + sPath;
-    sResult = SystemCommand2(sCommand.c_str());
-	int64_t nFileSize = GetFileSize(sTarget);
-	if (fDebugMaster) LogPrintf(" DIDCF2 phase1 %s, sz %f \n", sResult.c_str(), nFileSize);
-	if (nFileSize < 1)
-	{
-		sError = sResult;
-		return false;
-	}
-	else
-	{
-		return true;
-	}
-}
-
 bool DownloadIndividualDistributedComputingFile(int iNextSuperblock, std::string sBaseURL, std::string sPage, std::string sUserFile, std::string& sError)
 {
 	// First delete:
@@ -3182,10 +3063,11 @@ bool DownloadDistributedComputingFile(int iNextSuperblock, std::string& sError)
 	std::string sSrc2 = GetSporkValue(sProjectId2);
 	std::string sBaseURL2 = "https://" + sSrc2;
 	std::string sPage2 = "/boinc/stats/user.gz";
-	DownloadIndividualDistributedComputingFile2(iNextSuperblock, sBaseURL, sPage, "user1", sError);
-	DownloadIndividualDistributedComputingFile2(iNextSuperblock, sBaseURL2, sPage2, "user2", sError);
+	// The exports are streamed through the filters now; remove expanded copies left by older versions
+	boost::filesystem::remove(GetSANDirectory2() + "user1");
+	boost::filesystem::remove(GetSANDirectory2() + "user2");
 	LogPrintf("Filter File %f",iNextSuperblock);
-	FilterFile(50, iNextSuperblock, sError);
+	FilterFile(sBaseURL + sPage, sBaseURL2 + sPage2, iNextSuperblock, sError);
 	fDistributedComputingCycleDownloading = false;
 	return true;
 }
@@ -3200,69 +3082,13 @@ std::string BiblepayIPFSPost(std::string sFileName, std::string sPayload)
 		mapRequestHeaders["Filename"] = sFileName;
 		const CChainParams& chainparams = Params();
 		mapRequestHeaders["NetworkID"] = chainparams.NetworkIDString();
-		BIO* bio;
-		SSL_CTX* ctx;
-		SSL_library_init();
-		ctx = SSL_CTX_new(SSLv23_client_method());
-		if (ctx == NULL) 
-			return "<ERROR>CTX_IS_NULL</ERROR>";
-		bio = BIO_new_ssl_connect(ctx);
-		std::string sDomain = GetDomainFromURL("ipfs.biblepay.org");
-		int iPort = 443;
-		std::string sDomainWithPort = sDomain + ":" + RoundToString(iPort, 0);
-		BIO_set_conn_hostname(bio, sDomainWithPort.c_str());
-		if(BIO_do_connect(bio) <= 0)
-			return "<ERROR>BIO_FAILURE while connecting " + sDomainWithPort + "</ERROR>";
-		CService addrConnect;
-		if (sDomain.empty()) return "<ERROR>DOMAIN_MISSING</ERROR>";
-		CService addrIP(sDomain, iPort, true);
-    	if (addrIP.IsValid())
-		{
-			addrConnect = addrIP;
-		}
-		else
-		{ 
-			return "<ERROR>DNS_ERROR</ERROR>"; 
-		}
-		
-		std::string sPost = PrepareHTTPPost(true, "ipfs.bible", sDomain, sPayload, mapRequestHeaders);
-		const char* write_buf = sPost.c_str();
-		if(BIO_write(bio, write_buf, strlen(write_buf)) <= 0)
-		{
-		return "<ERROR>FAILED_HTTPS_POST</ERROR>";
-		}
-		int size;
-		char buf[1024];
-		clock_t begin = clock();
-		std::string sData = "";
-		for(;;)
-		{
-			size = BIO_read(bio, buf, 1023);
-			if(size <= 0)
-			{
-				break;
-			}
-			buf[size] = 0;
-			string MyData(buf);
-			sData += MyData;
-			clock_t end = clock();
-			double elapsed_secs = double(end - begin) / (CLOCKS_PER_SEC + .01);
-			if (elapsed_secs > iTimeoutSecs) break;
-			if (sData.find("</html>") != string::npos) break;
-			if (sData.find("</HTML>") != string::npos) break;
-			if (sData.find("<EOF>") != string::npos) break;
-			if (sData.find("Content-Length:") != string::npos)
-			{
-				double dMaxSize = cdbl(ExtractXML(sData,"Content-Length: ","\n"),0);
-				std::size_t foundPos = sData.find("Content-Length:");
-				if (dMaxSize > 0)
-				{
-					iMaxSize = dMaxSize + (int)foundPos + 16;
-				}
-			}
-			if ((int)sData.size() >= (iMaxSize-1)) break;
-		}
-		BIO_free_all(bio);
+		std::vector<std::string> vEndMarkers;
+		vEndMarkers.push_back("</html>");
+		vEndMarkers.push_back("</HTML>");
+		vEndMarkers.push_back("<EOF>");
+		std::string sData;
+		if (!BiblepayClientRequest(true, true, "ipfs.biblepay.org", 443, "ipfs.bible", sPayload, mapRequestHeaders, iTimeoutSecs, iMaxSize, vEndMarkers, sData))
+			return "<ERROR>" + sData + "</ERROR>";
 		return sData;
 }
 
@@ -3283,92 +3109,25 @@ std::string BiblepayHTTPSPost(bool bPost, int iThreadID, std::string sActionName
 			mapRequestHeaders["ThreadID"] = RoundToString(iThreadID,0);
 			mapRequestHeaders["OS"] = sOS;
 
-			BIO* bio;
-			SSL_CTX* ctx;
-			//   Registers the SSL/TLS ciphers and digests and starts the security layer.
-			SSL_library_init();
-			ctx = SSL_CTX_new(SSLv23_client_method());
-			if (ctx == NULL)
-			{
-				return "<ERROR>CTX_IS_NULL</ERROR>";
-			}
-			bio = BIO_new_ssl_connect(ctx);
-			std::string sDomain = GetDomainFromURL(sBaseURL);
-			std::string sDomainWithPort = sDomain + ":" + "443";
-			BIO_set_conn_hostname(bio, sDomainWithPort.c_str());
-			if(BIO_do_connect(bio) <= 0)
-			{
-				return "<ERROR>Failed connection to " + sDomainWithPort + "</ERROR>";
-			}
-	
-			CService addrConnect;
-			if (sDomain.empty()) return "<ERROR>DOMAIN_MISSING</ERROR>";
-			CService addrIP(sDomain, 443, true);
-            if (addrIP.IsValid())
+			std::vector<std::string> vEndMarkers;
+			vEndMarkers.push_back("</html>");
+			vEndMarkers.push_back("</HTML>");
+			vEndMarkers.push_back("<EOF>");
+			vEndMarkers.push_back("<END>");
+			vEndMarkers.push_back("</account_out>");
+			vEndMarkers.push_back("</am_set_info_reply>");
+			vEndMarkers.push_back("</am_get_info_reply>");
+			if (iBreakOnError == 1)
 			{
-				addrConnect = addrIP;
-			}
-			else
-			{
-  				return "<ERROR>DNS_ERROR</ERROR>"; 
-			}
-			std::string sPost = PrepareHTTPPost(bPost, sPage, sDomain, sPayload, mapRequestHeaders);
-			const char* write_buf = sPost.c_str();
-			if(BIO_write(bio, write_buf, strlen(write_buf)) <= 0)
-			{
-				//  Handle failed writes here
-				if(!BIO_should_retry(bio))
-				{
-					// ToDo: Server requested a retry.  Handle this someday.
-				}
-				return "<ERROR>FAILED_HTTPS_POST</ERROR>";
+				vEndMarkers.push_back("</user>");
+				vEndMarkers.push_back("</error>");
+				vEndMarkers.push_back("</error_msg>");
 			}
-      		//  Variables used to read the response from the server
-			int size;
-			char buf[1024];
-			clock_t begin = clock();
-			std::string sData = "";
-			for(;;)
-			{
-				//  Get chunks of the response 1023 at the time.
-				size = BIO_read(bio, buf, 1023);
-				if(size <= 0)
-				{
-					break;
-				}
-				buf[size] = 0;
-				string MyData(buf);
-				sData += MyData;
-				clock_t end = clock();
-				double elapsed_secs = double(end - begin) / (CLOCKS_PER_SEC + .01);
-				if (elapsed_secs > iTimeoutSecs) break;
-				if (sData.find("</html>") != string::npos) break;
-				if (sData.find("</HTML>") != string::npos) break;
-				if (sData.find("<EOF>") != string::npos) break;
-				if (sData.find("<END>") != string::npos) break;
-				if (sData.find("</account_out>") != string::npos) break;
-				if (sData.find("</am_set_info_reply>") != string::npos) break;
-				if (sData.find("</am_get_info_reply>") != string::npos) break;
-				if (iBreakOnError == 1) if (sData.find("</user>") != string::npos) break;
-				if (iBreakOnError == 1) if (sData.find("</error>") != string::npos) break;
-				if (iBreakOnError == 1) if (sData.find("</error_msg>") != string::npos) break;
-				if (iBreakOnError == 2) if (sData.find("</results>") != string::npos) break;
-				if (iBreakOnError == 3) if (sData.find("}}") != string::npos) break;
-				if (sData.find("Content-Length:") != string::npos)
-				{
-					double dMaxSize = cdbl(ExtractXML(sData,"Content-Length: ","\n"),0);
-					std::size_t foundPos = sData.find("Content-Length:");
-					if (dMaxSize > 0)
-					{
-						iMaxSize = dMaxSize + (int)foundPos + 16;
-					}
-				}
-				if ((int)sData.size() >= (iMaxSize-1)) break;
-			}
-			// R ANDREW - JAN 4 2018: Free bio resources
-
-			BIO_free_all(bio);
-			
+			if (iBreakOnError == 2) vEndMarkers.push_back("</results>");
+			if (iBreakOnError == 3) vEndMarkers.push_back("}}");
+			std::string sData;
+			if (!BiblepayClientRequest(bPost, true, sBaseURL, 443, sPage, sPayload, mapRequestHeaders, iTimeoutSecs, iMaxSize, vEndMarkers, sData))
+				return "<ERROR>" + sData + "</ERROR>";
 			return sData;
 	}
 	catch (std::exception &e)
@@ -3385,168 +3144,19 @@ std::string BiblepayHTTPSPost(bool bPost, int iThreadID, std::string sActionName
 /*                                                                          IPFS                                                                 */
 
 
-string ipfs_header_value(const string& full_header, const string& header_name)
-{
-    size_t pos = full_header.find(header_name);
-    string r;
-    if (pos!=string::npos)
-    {
-        size_t begin = full_header.find_first_not_of(": ", pos + header_name.length());
-        size_t until = full_header.find_first_of("\r\n\t ", begin + 1);
-        if (begin!=string::npos && until!=string::npos)
-        {
-            r = full_header.substr(begin,until-begin);
-        }
-    }
-    return r;
-}
-
-int ipfs_http_get(const string& request, const string& ip_address, int port, const string& fname, double dTimeoutSecs)
-{
-    char buffer[65535];
-	int bytes_total=0;
-	int bytes_expected=99999999;
-    int mode = 0;
-	SOCKET socketnumber;
-	CService addrConnect(ip_address, port, true);
-    if (!addrConnect.IsValid()) return -4;
-	bool proxyConnectionFailed = false;
-   
-	if (!ConnectSocket(addrConnect, socketnumber, dTimeoutSecs * 1000, &proxyConnectionFailed))
-	{
-		return -3;
-	}
-
-	ofstream fd(fname.c_str());
-	if (!fd.good()) return -1;
-	
-	int iOffset = 0;
-	LogPrintf(" sending %s ",ip_address.c_str());
-
-    ::send(socketnumber, request.c_str(), request.length(), MSG_NOSIGNAL | MSG_DONTWAIT);
-	double begin = clock();
-    while (bytes_total < bytes_expected)
-	{
-		    char tempbuffer[4096];
-			int iTempBytesRec = ::recv(socketnumber, tempbuffer, sizeof(tempbuffer), MSG_DONTWAIT);
-			if (iTempBytesRec > 0)
-			{
-				for (int k = 0; k < iTempBytesRec; k++)
-				{
-					buffer[iOffset + k] = tempbuffer[k];
-				}
-				iOffset += iTempBytesRec;
-			}
-		                
-			double elapsed_secs = double(clock() - begin) / (CLOCKS_PER_SEC + .01);
-			if (elapsed_secs > dTimeoutSecs) break;
-			if (iOffset > 255 || (iOffset+bytes_total > bytes_expected-1))
-			{
-				if (mode == 1) 
-				{
-					fd.write(buffer, iOffset);
-					bytes_total += iOffset;
-					//	LogPrintf(" . rec %f  bytestotal %f . ", iOffset, bytes_total);
-					iOffset = 0;
-					memset(buffer, 0, sizeof(buffer));
-				}
-				else if (mode == 0)
-				{
-					string sHeader(buffer);
-					std::string CL = ExtractXML(sHeader, "Content-Length:","\n");
-					int ContentSize = (int)cdbl(CL, 0);
-					if (ContentSize > 0)
-					{
-						// Find offset
-						int body_start = sHeader.find("\r\n\r\n");
-						bytes_expected  = ContentSize + body_start + 3;
-						bytes_total += iOffset;
-						// LogPrintf(" data %s bytes expected %f  elapsed %f bodystart %f   bytestotal %f ....... ",CL.c_str(), bytes_expected, elapsed_secs, body_start, bytes_total);
-						mode=1;
-						// Write first chunk
-						int iFirstByte = body_start + 4;
-						int iFirstChunk = iOffset - iFirstByte;
-						char tempbuffer[iFirstChunk];
-						for (int j = 0; j < iFirstChunk; j++)
-						{
-							tempbuffer[j] = buffer[j + iFirstByte];
-						}
-						fd.write(tempbuffer, iFirstChunk);
-						memset(buffer, 0, sizeof(buffer));
-						iOffset = 0;
-					}
-			}
-		}
-    }
-    ::close(socketnumber);
-    fd.close();
-	if (bytes_total >= bytes_expected && bytes_total > 0 && bytes_expected > 0) return 1;
-	return -2;
-}
-
-
 int ipfs_download(const string& url, const string& filename, double dTimeoutSecs, double dRangeRequestMin, double dRangeRequestMax)
 {
-	int port = 0;
-    string protocol, domain, path, query, url_port;
-    vector<string> ip_addresses;
-    int offset = 0;
-    size_t pos1,pos2,pos3,pos4;
-    offset = offset==0 && url.compare(0, 8, "https://")==0 ? 8 : offset;
-    offset = offset==0 && url.compare(0, 7, "http://" )==0 ? 7 : offset;
-    pos1 = url.find_first_of('/', offset+1 );
-    path = pos1==string::npos ? "" : url.substr(pos1);
-    domain = string( url.begin()+offset, pos1 != string::npos ? url.begin()+pos1 : url.end() );
-    path = (pos2 = path.find("#"))!=string::npos ? path.substr(0,pos2) : path;
-    url_port = (pos3 = domain.find(":"))!=string::npos ? domain.substr(pos3+1) : "";
-    domain = domain.substr(0, pos3!=string::npos ? pos3 : domain.length());
-    protocol = offset > 0 ? url.substr(0,offset-3) : "";
-    query = (pos4 = path.find("?"))!=string::npos ? path.substr(pos4+1) : "";
-    path = pos4!=string::npos ? path.substr(0,pos4) : path;
- 
-    if (query.length()>0)
-    {
-        path.reserve( path.length() + 1 + query.length() );
-        path.append("?").append(query);
-    }
-    if (url_port.length()==0 && protocol.length()>0)
-    {
-        url_port = protocol=="http" ? "80" : "443";
-    }
-
-	// DNS
-	CService addrIP(domain, (int)cdbl(url_port, 0), true);
-    if (addrIP.IsValid())
+	std::string sError;
+	if (dRangeRequestMax > 0)
+		return DownloadIPFSRange(url, filename, (uint64_t)dRangeRequestMin, (uint64_t)dRangeRequestMax, (int64_t)(dTimeoutSecs * 1000), sError);
+	CIPFSDownload download(url, filename, (int64_t)(dTimeoutSecs * 1000));
+	// Paid PODS documents have their size on chain
+	size_t nPos = url.find("/ipfs/");
+	if (nPos != string::npos)
 	{
-		domain = GetIPFromAddress(addrIP.ToString());
-		LogPrintf(" domain %s ",domain.c_str());
+		std::string sHash = url.substr(nPos + 6);
+		download.nExpectedSize = GetIPFSSize(sHash.substr(0, sHash.find_first_of("/?#")));
 	}
-	
-    if (domain.length() > 0)
-            ip_addresses.push_back(domain);
-    int r = -1;
-    if (ip_addresses.size() > 0)
-    {
-        stringstream(url_port) >> port;
-        stringstream request;
-        request << "GET " << path << " HTTP/1.1\r\n";
-        request << "Host: " << domain << "\r\n";
-		if (dRangeRequestMax > 0)
-		{
-			request << "Range: bytes=" + (RoundToString(dRangeRequestMin, 0) + "-" + RoundToString(dRangeRequestMax, 0)) << "\r\n";
-		}
-
-		request << "\r\n";
-
-		int ix = ip_addresses.size();
-
-        for(int i = 0; i < ix; i++)
-        {
-            r = ipfs_http_get(request.str(), ip_addresses[i], port, filename, dTimeoutSecs);
-			if (r==1) return r;
-        }
-    }
-
-	return r;
+	return DownloadIPFSFile(download);
 }
 
@@ -0,0 +1,197 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "perfstats.h"
+
+#include "sync.h"
+#include "tinyformat.h"
+
+#include <algorithm>
+#include <map>
+#include <new>
+#include <stdlib.h>
+
+#include <boost/thread/tss.hpp>
+
+/** Upper bounds of the latency buckets in microseconds; the last bucket has none */
+static const int64_t vBucketLimits[PERF_LATENCY_BUCKETS - 1] = { 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+
+static int GetThreadSlot()
+{
+    static boost::thread_specific_ptr<int> ptrSlot;
+    static std::atomic<int> nNextSlot(0);
+    int* pnSlot = ptrSlot.get();
+    if (pnSlot == NULL)
+    {
+        // thread_specific_ptr deletes the slot number when the thread ends
+        pnSlot = new int(nNextSlot.fetch_add(1, std::memory_order_relaxed) % PERF_THREAD_SLOTS);
+        ptrSlot.reset(pnSlot);
+    }
+    return *pnSlot;
+}
+
+CPerfStat::CPerfStat(const std::string& sNameIn, const std::string& sLabelIn, bool fTimerIn) :
+    sName(sNameIn), sLabel(sLabelIn), fTimer(fTimerIn)
+{
+    for (int i = 0; i < PERF_THREAD_SLOTS; i++)
+    {
+        Slot& slot = vSlots[i];
+        slot.nCount.store(0, std::memory_order_relaxed);
+        slot.nTotalMicros.store(0, std::memory_order_relaxed);
+        slot.nMaxMicros.store(0, std::memory_order_relaxed);
+        for (int j = 0; j < PERF_LATENCY_BUCKETS; j++)
+            slot.vBuckets[j].store(0, std::memory_order_relaxed);
+    }
+}
+
+void CPerfStat::Add(uint64_t nCount)
+{
+    vSlots[GetThreadSlot()].nCount.fetch_add(nCount, std::memory_order_relaxed);
+}
+
+void CPerfStat::AddSample(int64_t nMicros)
+{
+    // The clock can be set back while a call is timed
+    uint64_t nSample = nMicros < 0 ? 0 : nMicros;
+    int nBucket = 0;
+    while (nBucket < PERF_LATENCY_BUCKETS - 1 && nMicros >= vBucketLimits[nBucket])
+        nBucket++;
+
+    Slot& slot = vSlots[GetThreadSlot()];
+    slot.nCount.fetch_add(1, std::memory_order_relaxed);
+    slot.nTotalMicros.fetch_add(nSample, std::memory_order_relaxed);
+    slot.vBuckets[nBucket].fetch_add(1, std::memory_order_relaxed);
+    uint64_t nMax = slot.nMaxMicros.load(std::memory_order_relaxed);
+    while (nSample > nMax && !slot.nMaxMicros.compare_exchange_weak(nMax, nSample, std::memory_order_relaxed)) {}
+}
+
+CPerfStatSnapshot CPerfStat::GetSnapshot() const
+{
+    CPerfStatSnapshot snapshot;
+    snapshot.sName = sName;
+    snapshot.sLabel = sLabel;
+    snapshot.fTimer = fTimer;
+    snapshot.nCount = 0;
+    snapshot.nTotalMicros = 0;
+    snapshot.nMaxMicros = 0;
+    for (int j = 0; j < PERF_LATENCY_BUCKETS; j++)
+        snapshot.vBuckets[j] = 0;
+    for (int i = 0; i < PERF_THREAD_SLOTS; i++)
+    {
+        const Slot& slot = vSlots[i];
+        snapshot.nCount += slot.nCount.load(std::memory_order_relaxed);
+        snapshot.nTotalMicros += slot.nTotalMicros.load(std::memory_order_relaxed);
+        snapshot.nMaxMicros = std::max(snapshot.nMaxMicros, slot.nMaxMicros.load(std::memory_order_relaxed));
+        for (int j = 0; j < PERF_LATENCY_BUCKETS; j++)
+            snapshot.vBuckets[j] += slot.vBuckets[j].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+// Stats are never freed: call sites keep references to them in statics that
+// threads still running at shutdown may use
+class CPerfStatRegistry
+{
+public:
+    CPerfStat& Get(const std::string& sName, const std::string& sLabel, bool fTimer)
+    {
+        LOCK(cs);
+        CPerfStat*& pstat = mapStats[std::make_pair(sName, sLabel)];
+        if (pstat == NULL)
+        {
+            // Rounded up to the cache line the slots are aligned to
+            char* pch = (char*)malloc(sizeof(CPerfStat) + PERF_CACHE_LINE - 1);
+            if (pch == NULL) throw std::bad_alloc();
+            pch += (PERF_CACHE_LINE - (uintptr_t)pch % PERF_CACHE_LINE) % PERF_CACHE_LINE;
+            pstat = new (pch) CPerfStat(sName, sLabel, fTimer);
+        }
+        return *pstat;
+    }
+
+    std::vector<CPerfStatSnapshot> GetSnapshots()
+    {
+        std::vector<CPerfStatSnapshot> vSnapshots;
+        LOCK(cs);
+        for (std::map<std::pair<std::string, std::string>, CPerfStat*>::const_iterator it = mapStats.begin(); it != mapStats.end(); ++it)
+            vSnapshots.push_back(it->second->GetSnapshot());
+        return vSnapshots;
+    }
+
+private:
+    CCriticalSection cs;
+    std::map<std::pair<std::string, std::string>, CPerfStat*> mapStats;
+};
+
+static CPerfStatRegistry& GetRegistry()
+{
+    static CPerfStatRegistry* pregistry = new CPerfStatRegistry();
+    return *pregistry;
+}
+
+CPerfStat& GetPerfCounter(const std::string& sName, const std::string& sLabel)
+{
+    return GetRegistry().Get(sName, sLabel, false);
+}
+
+CPerfStat& GetPerfTimer(const std::string& sName, const std::string& sLabel)
+{
+    return GetRegistry().Get(sName, sLabel, true);
+}
+
+std::vector<CPerfStatSnapshot> GetPerfStatSnapshots()
+{
+    return GetRegistry().GetSnapshots();
+}
+
+/** A label value with the backslash, double quote and line feed escaped */
+static std::string PrometheusEscape(const std::string& sValue)
+{
+    std::string sEscaped;
+    sEscaped.reserve(sValue.size());
+    for (size_t i = 0; i < sValue.size(); i++)
+    {
+        if (sValue[i] == '\\') sEscaped += "\\\\";
+        else if (sValue[i] == '"') sEscaped += "\\\"";
+        else if (sValue[i] == '\n') sEscaped += "\\n";
+        else sEscaped += sValue[i];
+    }
+    return sEscaped;
+}
+
+static std::string PrometheusLabels(const CPerfStatSnapshot& stat, const std::string& sExtra)
+{
+    std::string sLabels = stat.sLabel.empty() ? "" : "context=\"" + PrometheusEscape(stat.sLabel) + "\"";
+    if (!sExtra.empty()) sLabels += (sLabels.empty() ? "" : ",") + sExtra;
+    return sLabels.empty() ? "" : "{" + sLabels + "}";
+}
+
+std::string FormatPerfStatsPrometheus()
+{
+    std::vector<CPerfStatSnapshot> vStats = GetPerfStatSnapshots();
+    std::string sOut;
+    for (int i = 0; i < (int)vStats.size(); i++)
+    {
+        const CPerfStatSnapshot& stat = vStats[i];
+        std::string sMetric = "biblepay_" + stat.sName;
+        // Labelled stats of one name share the TYPE line
+        bool fFirst = i == 0 || vStats[i - 1].sName != stat.sName;
+        if (!stat.fTimer)
+        {
+            if (fFirst) sOut += "# TYPE " + sMetric + "_total counter\n";
+            sOut += strprintf("%s_total%s %u\n", sMetric, PrometheusLabels(stat, ""), stat.nCount);
+            continue;
+        }
+        if (fFirst) sOut += "# TYPE " + sMetric + "_seconds histogram\n";
+        uint64_t nCumulative = 0;
+        for (int j = 0; j < PERF_LATENCY_BUCKETS; j++)
+        {
+            nCumulative += stat.vBuckets[j];
+            std::string sBound = j < PERF_LATENCY_BUCKETS - 1 ? strprintf("%g", vBucketLimits[j] / 1000000.0) : "+Inf";
+            sOut += strprintf("%s_seconds_bucket%s %u\n", sMetric, PrometheusLabels(stat, "le=\"" + sBound + "\""), nCumulative);
+        }
+        sOut += strprintf("%s_seconds_sum%s %.6f\n", sMetric, PrometheusLabels(stat, ""), stat.nTotalMicros / 1000000.0);
+        sOut += strprintf("%s_seconds_count%s %u\n", sMetric, PrometheusLabels(stat, ""), stat.nCount);
+    }
+    return sOut;
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERFSTATS_H
+#define PERFSTATS_H
+
+#include "utiltime.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Latency buckets of a timer: <10us, <100us, <1ms, <10ms, <100ms, <1s, <10s, >=10s */
+static const int PERF_LATENCY_BUCKETS = 8;
+/** Threads are spread over this many counter slots; threads beyond it share slots */
+static const int PERF_THREAD_SLOTS = 16;
+/** Size of the cache lines the per thread slots are aligned to */
+static const int PERF_CACHE_LINE = 64;
+
+struct CPerfStatSnapshot
+{
+    std::string sName;
+    std::string sLabel;
+    bool fTimer;
+    uint64_t nCount;
+    uint64_t nTotalMicros;
+    uint64_t nMaxMicros;
+    uint64_t vBuckets[PERF_LATENCY_BUCKETS];
+};
+
+/**
+ * A counter, or a timer with a latency histogram, for the BiblePay specific
+ * work (prayer memorization, PODC, BibleHash, block reads).
+ *
+ * Every thread adds to its own slot with relaxed atomic increments, and the
+ * slots are aligned to whole cache lines, so recording takes no lock and
+ * threads do not contend for a line.  The slots are only summed up when the
+ * stats are read by getperfstats or /rest/perfstats.
+ *
+ * Only the registry creates stats, on a cache line boundary, which plain new
+ * does not promise for over-aligned types before C++17.
+ */
+class CPerfStat
+{
+public:
+    CPerfStat(const std::string& sNameIn, const std::string& sLabelIn, bool fTimerIn);
+
+    void Add(uint64_t nCount = 1);
+    void AddSample(int64_t nMicros);
+    CPerfStatSnapshot GetSnapshot() const;
+
+    const std::string sName;
+    const std::string sLabel;
+    const bool fTimer;
+
+private:
+    // Aligned, and so also sized, to whole cache lines
+    struct alignas(PERF_CACHE_LINE) Slot
+    {
+        std::atomic<uint64_t> nCount;
+        std::atomic<uint64_t> nTotalMicros;
+        std::atomic<uint64_t> nMaxMicros;
+        std::atomic<uint64_t> vBuckets[PERF_LATENCY_BUCKETS];
+    };
+    static_assert(sizeof(Slot) % PERF_CACHE_LINE == 0, "perf stat slots share a cache line");
+
+    Slot vSlots[PERF_THREAD_SLOTS];
+
+    CPerfStat(const CPerfStat&);
+    CPerfStat& operator=(const CPerfStat&);
+};
+
+/** Times the scope it lives in into a timer stat */
+class CPerfTimer
+{
+public:
+    explicit CPerfTimer(CPerfStat& statIn) : stat(statIn), nStart(GetTimeMicros()) {}
+    ~CPerfTimer() { stat.AddSample(GetTimeMicros() - nStart); }
+
+private:
+    CPerfStat& stat;
+    int64_t nStart;
+};
+
+/**
+ * The counter or timer registered under a name (and label, such as the
+ * ReadBlockFromDisk context), created on first use and kept until shutdown.
+ * Hot paths keep the reference in a function level static.
+ */
+CPerfStat& GetPerfCounter(const std::string& sName, const std::string& sLabel = "");
+CPerfStat& GetPerfTimer(const std::string& sName, const std::string& sLabel = "");
+
+/** Every registered stat, ordered by name and label */
+std::vector<CPerfStatSnapshot> GetPerfStatSnapshots();
+/** The stats in the Prometheus text exposition format */
+std::string FormatPerfStatsPrometheus();
+
+#endif // PERFSTATS_H
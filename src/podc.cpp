@@ -218,6 +218,27 @@ double GetResearcherCredit(double dDRMode, double dAvgCredit, double dUTXOWeight
 	return dModifiedCredit;
 }
 
+double GetTeamPercentage(double dUserTeam, double dProjectTeam, std::string sTeamBlacklist, double dNonBiblepayTeamPercentage)
+{
+	// Return a reward percentage for a given team 
+	// First, if blacklists are enabled, if user team is in blacklist, reject the users RAC
+	if (!sTeamBlacklist.empty())
+	{
+		std::vector<std::string> vTeams = Split(sTeamBlacklist.c_str(), ";");
+		for (int i = 0; i < (int)vTeams.size(); i++)
+		{
+			double dBlacklistedTeam = cdbl(vTeams[i], 0);
+			if (dBlacklistedTeam != 0 && dUserTeam != 0 && dBlacklistedTeam == dUserTeam)
+			{
+				return 0;
+			}
+		}
+	}
+	if (dProjectTeam == 0) return 1;
+	// Next, if BiblePay team is required, verify the team matches
+	return (dUserTeam == dProjectTeam) ? 1 : dNonBiblepayTeamPercentage;
+}
+
 double GetUTXOLevel(double dUTXOWeight, double dTotalRAC, double dAvgCredit, double dRequiredSPM, double dRequiredSPR, double dRACThreshhold)
 {
 	double dEstimatedMagnitude = (dAvgCredit / (dTotalRAC + .01)) * 1000;
@@ -413,6 +434,33 @@ std::string ExtractXML(std::string XMLdata, std::string key, std::string key_end
 	return extraction;
 }
 
+XMLTagList GetXMLTagList(const std::string& sNames)
+{
+	XMLTagList vTags;
+	std::vector<std::string> vNames = Split(sNames.c_str(), ",");
+	for (int i = 0; i < (int)vNames.size(); i++)
+	{
+		vTags.push_back(std::make_pair("<" + vNames[i] + ">", "</" + vNames[i] + ">"));
+	}
+	return vTags;
+}
+
+std::vector<std::string> ExtractXMLFields(const std::string& sData, const XMLTagList& vTags)
+{
+	// std::string::find runs on the C library's vectorized memchr/memcmp, which beats comparing every
+	// tag at each '<' in one pass; what this saves over ExtractXML is the copies of sData and the tags
+	std::vector<std::string> vValues(vTags.size());
+	for (size_t i = 0; i < vTags.size(); i++)
+	{
+		const std::string& sKey = vTags[i].first;
+		std::string::size_type loc = sData.find(sKey, 0);
+		if (loc == std::string::npos) continue;
+		std::string::size_type loc_end = sData.find(vTags[i].second, loc + 3);
+		if (loc_end != std::string::npos) vValues[i] = sData.substr(loc + sKey.length(), loc_end - loc - sKey.length());
+	}
+	return vValues;
+}
+
 double BoincDecayFunction(double dAgeInSecs)
 {
 	// Rob Andrews - 2/26/2018 - The Boinc Decay function decays a researchers total credit by the Linear Regression constant (.69314) (divided by 7 (half of its half life) * One Exponent (^2.71) 
@@ -532,6 +580,25 @@ std::string GetWUElement(std::string sWUdata, std::string sRootElementName, doub
 	return "";
 }
 
+void GetWUElements(const std::string& sWUdata, const std::string& sRootElementName, const std::string& sPrimaryKeyElement, const std::string& sOutputElement, boost::unordered_map<double, std::string>& mapElements)
+{
+	// Same lookup as GetWUElement for every task in the response, in a single pass: mapElements[TaskID] = element value, the first match wins
+	std::string sKeyStart = "<" + sPrimaryKeyElement + ">";
+	std::string sKeyEnd = "</" + sPrimaryKeyElement + ">";
+	std::string sOutputStart = "<" + sOutputElement + ">";
+	std::string sOutputEnd = "</" + sOutputElement + ">";
+	size_t nStart = 0;
+	while (true)
+	{
+		size_t nEnd = sWUdata.find(sRootElementName, nStart);
+		std::string sSegment = sWUdata.substr(nStart, nEnd == std::string::npos ? std::string::npos : nEnd - nStart);
+		double dTask = cdbl(ExtractXML(sSegment, sKeyStart, sKeyEnd), 0);
+		mapElements.insert(std::make_pair(dTask, ExtractXML(sSegment, sOutputStart, sOutputEnd)));
+		if (nEnd == std::string::npos || sRootElementName.empty()) break;
+		nStart = nEnd + sRootElementName.length();
+	}
+}
+
 /*
 bool CheckMessageSignature(std::string sMsg, std::string sSig)
 {
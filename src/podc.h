@@ -14,6 +14,8 @@
 
 #include "uint256.h"
 
+#include <boost/unordered_map.hpp>
+
 
 int GetPODCVersion();
 std::string PackPODC(std::string sBlock, int iTaskLength, int iTimeLength);
@@ -22,6 +24,7 @@ std::string FilterBoincData(std::string sData, std::string sRootElement, std::st
 std::string MutateToList(std::string sData);
 double GetResearcherCredit(double dDRMode, double dAvgCredit, double dUTXOWeight, double dTaskWeight, double dUnbanked, double dTotalRAC, double dReqSPM, double dReqSPR, double dRACThreshhold, double dTeamPercent);
 double GetUTXOLevel(double dUTXOWeight, double dTotalRAC, double dAvgCredit, double dRequiredSPM, double dRequiredSPR, double dRACThreshhold);
+double GetTeamPercentage(double dUserTeam, double dProjectTeam, std::string sTeamBlacklist, double dNonBiblepayTeamPercentage);
 double SnapToGrid(double dPercent);
 double EnforceLimits(double dValue);
 int GetResearcherCount(std::string recipient, std::string RecipList);
@@ -42,10 +45,21 @@ double GetCPIDUTXOWeight(double dAmount);
 
 std::string ExtractXML(std::string XMLdata, std::string key, std::string key_end);
 
+/** Start and end tags of the fields ExtractXMLFields pulls out of one message */
+typedef std::vector<std::pair<std::string, std::string> > XMLTagList;
+/** "<Name>","</Name>" for every ',' separated name in sNames */
+XMLTagList GetXMLTagList(const std::string& sNames);
+/**
+ * The same values as ExtractXML(sData, vTags[i].first, vTags[i].second) for every tag, without
+ * copying sData or the tags for each field.
+ */
+std::vector<std::string> ExtractXMLFields(const std::string& sData, const XMLTagList& vTags);
+
 double cdbl(std::string s, int place);
 
 bool Contains(std::string data, std::string instring);
 std::string GetWUElement(std::string sWUdata, std::string sRootElementName, double dTaskID, std::string sPrimaryKeyElement, std::string sOutputElement);
+void GetWUElements(const std::string& sWUdata, const std::string& sRootElementName, const std::string& sPrimaryKeyElement, const std::string& sOutputElement, boost::unordered_map<double, std::string>& mapElements);
 std::string GetListOfData(std::string sSourceData, std::string sDelimiter, std::string sSubDelimiter, int iSubPosition, int iMaxCount);
 std::string GJE(std::string sKey, std::string sValue, bool bIncludeDelimiter, bool bQuoteValue);
 int64_t StringToUnixTime(std::string sTime);
@@ -6,12 +6,15 @@
 #define BITCOIN_POLICYESTIMATOR_H
 
 #include "amount.h"
+#include "coins.h"
 #include "uint256.h"
 
 #include <map>
 #include <string>
 #include <vector>
 
+#include <boost/unordered_map.hpp>
+
 class CAutoFile;
 class CFeeRate;
 class CTxMemPoolEntry;
@@ -65,6 +68,13 @@ class CTxMemPool;
  * the number of transactions we've seen in that fee bucket when calculating
  * an estimate for any number of confirmations below the number of blocks
  * they've been outstanding.
+ *
+ * The moving averages are decayed lazily.  Every stored average is kept
+ * relative to a shared scale factor, the product of all the per block decays
+ * seen so far, so decaying a block only multiplies that one factor and a
+ * block costs time in proportion to the buckets its transactions touch.  The
+ * stored values are folded back into the scale factor before it can
+ * underflow and whenever the state is written to disk.
  */
 
 /**
@@ -87,34 +97,35 @@ private:
     // Count the total # of txs in each bucket
     // Track the historical moving average of this total over blocks
     std::vector<double> txCtAvg;
-    // and calcuate the total for the current block to update the moving average
-    std::vector<int> curBlockTxCt;
 
     // Count the total # of txs confirmed within Y blocks in each bucket
     // Track the historical moving average of theses totals over blocks
     std::vector<std::vector<double> > confAvg; // confAvg[Y][X]
-    // and calcuate the totals for the current block to update the moving averages
-    std::vector<std::vector<int> > curBlockConf; // curBlockConf[Y][X]
 
     // Sum the total priority/fee of all tx's in each bucket
     // Track the historical moving average of this total over blocks
     std::vector<double> avg;
-    // and calculate the total for the current block to update the moving average
-    std::vector<double> curBlockVal;
 
     // Combine the conf counts with tx counts to calculate the confirmation % for each Y,X
     // Combine the total value with the tx counts to calculate the avg fee/priority per bucket
 
     std::string dataTypeString;
     double decay;
+    // The averages above are stored divided by decayScale, the decay accumulated since they were last rescaled
+    double decayScale;
 
     // Mempool counts of outstanding transactions
     // For each bucket X, track the number of transactions in the mempool
     // that are unconfirmed for each possible confirmation value Y
     std::vector<std::vector<int> > unconfTxs;  //unconfTxs[Y][X]
+    // sum of unconfTxs[Y] over all buckets, so empty rows can be skipped
+    std::vector<int> unconfTxsRowCt;
     // transactions still unconfirmed after MAX_CONFIRMS for each bucket
     std::vector<int> oldUnconfTxs;
 
+    /** Fold decayScale into the stored averages */
+    void Rescale();
+
 public:
     /**
      * Initialize the data structures.  This is called by BlockPolicyEstimator's
@@ -126,11 +137,11 @@ public:
      */
     void Initialize(std::vector<double>& defaultBuckets, unsigned int maxConfirms, double decay, std::string dataTypeString);
 
-    /** Clear the state of the curBlock variables to start counting for the new block */
+    /** Move the mempool counts of the block index reused for nBlockHeight to the old unconfirmed counts */
     void ClearCurrent(unsigned int nBlockHeight);
 
     /**
-     * Record a new transaction data point in the current block stats
+     * Record a new transaction data point in the moving averages of the current block
      * @param blocksToConfirm the number of blocks it took this transaction to confirm
      * @param val either the fee or the priority when entered of the transaction
      * @warning blocksToConfirm is 1-based and has to be >= 1
@@ -144,9 +155,9 @@ public:
     void removeTx(unsigned int entryHeight, unsigned int nBestSeenHeight,
                   unsigned int bucketIndex);
 
-    /** Update our estimates by decaying our historical moving average and updating
-        with the data gathered from the current block */
-    void UpdateMovingAverages();
+    /** Decay our historical moving averages by one block.  Called before the
+        transactions of the new block are recorded, so they get full weight */
+    void DecayMovingAverages();
 
     /**
      * Calculate a fee or priority estimate.  Find the lowest value bucket (or range of buckets
@@ -165,7 +176,7 @@ public:
     /** Return the max number of confirms we're tracking */
     unsigned int GetMaxConfirms() { return confAvg.size(); }
 
-    /** Write state of estimation data to a file*/
+    /** Write state of estimation data to a file (rescales the stored averages first) */
     void Write(CAutoFile& fileout);
 
     /**
@@ -264,6 +275,9 @@ public:
     /** Read estimation data from a file */
     void Read(CAutoFile& filein);
 
+    /** Height of the last block processed, changes whenever the estimates do */
+    unsigned int GetBestSeenHeight() const { return nBestSeenHeight; }
+
 private:
     CFeeRate minTrackedFee; //! Passed to constructor to avoid dependency on main
     double minTrackedPriority; //! Set to AllowFreeThreshold
@@ -277,7 +291,7 @@ private:
     };
 
     // map of txids to information about that transaction
-    std::map<uint256, TxStatsInfo> mapMemPoolTxs;
+    boost::unordered_map<uint256, TxStatsInfo, CCoinsKeyHasher> mapMemPoolTxs;
 
     /** Classes to track historical data on transaction confirmations */
     TxConfirmStats feeStats, priStats;
@@ -12,6 +12,7 @@
 #include "uint256.h"
 #include "util.h"
 #include "kjv.h"
+#include "perfstats.h"
 #include "rpcblockchain.cpp"
 #include <math.h>
 #include <openssl/crypto.h>
@@ -26,6 +27,14 @@ uint256 PercentToBigIntBase(int iPercent);
 extern bool CheckProofOfLoyalty(double dWeight, uint256 hash, unsigned int nBits, const Consensus::Params& params, 
 	int64_t nBlockTime, int64_t nPrevBlockTime, int nPrevHeight, unsigned int nNonce, const CBlockIndex* pindexPrev, bool bLoadingBlockIndex);
 
+// BibleHash as the proof checks run it; the "biblehash" count against the "check_pow" and "check_pol" counts gives the hashes per block validated
+static uint256 ValidationBibleHash(uint256 hash, int64_t nBlockTime, int64_t nPrevBlockTime, bool bMining, int nPrevHeight, const CBlockIndex* pindexLast, bool bRequireTxIndex, 
+	bool f7000, bool f8000, bool f9000, bool fTitheBlocksActive, unsigned int nNonce)
+{
+	static CPerfStat& statBibleHash = GetPerfTimer("biblehash");
+	CPerfTimer timer(statBibleHash);
+	return BibleHash(hash, nBlockTime, nPrevBlockTime, bMining, nPrevHeight, pindexLast, bRequireTxIndex, f7000, f8000, f9000, fTitheBlocksActive, nNonce);
+}
 
 
 
@@ -329,6 +338,8 @@ bool CheckProofOfLoyalty(double dWeight, uint256 hash, unsigned int nBits, const
 	bool f_9000; 
 	bool fTitheBlocksActive;
 	GetMiningParams(nPrevHeight, f_7000, f_8000, f_9000, fTitheBlocksActive);
+	static CPerfStat& statCheckPOL = GetPerfTimer("check_pol");
+	CPerfTimer timer(statCheckPOL);
 
 	// *********************************** PROOF OF LOYALTY - CHECKBLOCK **************************** 1-19-2018 ****************************
     bnTarget.SetCompact(nBits, &fNegative, &fOverflow);
@@ -338,7 +349,7 @@ bool CheckProofOfLoyalty(double dWeight, uint256 hash, unsigned int nBits, const
 	int64_t nPercent = GetStakeTargetModifierPercent(nPrevHeight, dWeight);
 	uint256 uBase = PercentToBigIntBase(nPercent);
 	bnTarget += UintToArith256(uBase);
-	uint256 uBibleHash = BibleHash(hash, nBlockTime, nPrevBlockTime, true, nPrevHeight, NULL, false, f_7000, f_8000, f_9000, fTitheBlocksActive, nNonce);
+	uint256 uBibleHash = ValidationBibleHash(hash, nBlockTime, nPrevBlockTime, true, nPrevHeight, NULL, false, f_7000, f_8000, f_9000, fTitheBlocksActive, nNonce);
 
 	if (UintToArith256(uBibleHash) > bnTarget)
 	{
@@ -368,6 +379,8 @@ bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&
     bool fOverflow;
     arith_uint256 bnTarget;
 	if (fProofOfLoyaltyEnabled) return true;
+	static CPerfStat& statCheckPOW = GetPerfTimer("check_pow");
+	CPerfTimer timer(statCheckPOW);
 
 	bool fProdChain = Params().NetworkIDString() == "main" ? true : false;
 	bool bRequireTxIndexLookup = false;  // This is a project currently in TestNet, slated to go live after Sanctuaries are enabled and fully tested by slack team
@@ -399,10 +412,10 @@ bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&
 	
 	if (f7000 || f_8000)
 	{
-		uint256 uBibleHash = BibleHash(hash, nBlockTime, nPrevBlockTime, true, nPrevHeight, NULL, false, f_7000, f_8000, f_9000, fTitheBlocksActive, nNonce);
+		uint256 uBibleHash = ValidationBibleHash(hash, nBlockTime, nPrevBlockTime, true, nPrevHeight, NULL, false, f_7000, f_8000, f_9000, fTitheBlocksActive, nNonce);
 		if (UintToArith256(uBibleHash) > bnTarget)
 		{
-			uint256 uBibleHash2 = BibleHash(hash, nBlockTime, nPrevBlockTime, true, nPrevHeight, NULL, false, f_7000, f_8000, f_9000, fTitheBlocksActive, nNonce);
+			uint256 uBibleHash2 = ValidationBibleHash(hash, nBlockTime, nPrevBlockTime, true, nPrevHeight, NULL, false, f_7000, f_8000, f_9000, fTitheBlocksActive, nNonce);
 			if (UintToArith256(uBibleHash2) > bnTarget)
 			{
 				uint256 uTarget = ArithToUint256(bnTarget);
@@ -433,7 +446,7 @@ bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&
 
 	if (f7000 && !bLoadingBlockIndex && bRequireTxIndexLookup)
 	{
-		if	(UintToArith256(BibleHash(hash, nBlockTime, nPrevBlockTime, true, nPrevHeight, pindexPrev, true, f_7000, f_8000, f_9000, fTitheBlocksActive, nNonce)) > bnTarget)
+		if	(UintToArith256(ValidationBibleHash(hash, nBlockTime, nPrevBlockTime, true, nPrevHeight, pindexPrev, true, f_7000, f_8000, f_9000, fTitheBlocksActive, nNonce)) > bnTarget)
 		{
 			uint256 h2 = (pindexPrev != NULL) ? pindexPrev->GetBlockHash() : uint256S("0x0");
 			return error("CheckProofOfWork(2): BibleHash does not meet POW level with TxIndex Lookup, prevheight %f pindexPrev %s ",(double)nPrevHeight,h2.GetHex().c_str());
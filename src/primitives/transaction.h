@@ -12,6 +12,9 @@
 #include "uint256.h"
 #include "podc.h"
 
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+
 
 /** An outpoint - a combination of a transaction hash and an index n into its vout */
 class COutPoint
@@ -371,6 +374,16 @@ public:
 
     std::string ToString() const;
 };
+
+/**
+ * A shared, immutable transaction.  The mempool, relay and policy code hand
+ * these around instead of copying the transaction with its output messages;
+ * the hash is computed once, when the CTransaction is built.  CBlock::vtx,
+ * CWalletTx and CTxLockRequest still hold their transactions by value.
+ */
+typedef boost::shared_ptr<const CTransaction> CTransactionRef;
+static inline CTransactionRef MakeTransactionRef() { return boost::make_shared<const CTransaction>(); }
+template <typename Tx> static inline CTransactionRef MakeTransactionRef(const Tx& txIn) { return boost::make_shared<const CTransaction>(txIn); }
  
 /** A mutable version of CTransaction. */
 struct CMutableTransaction
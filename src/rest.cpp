@@ -3,14 +3,19 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "base58.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "main.h"
+#include "hash.h"
 #include "httpserver.h"
+#include "json-stream.h"
+#include "perfstats.h"
 #include "rpcserver.h"
 #include "streams.h"
+#include "superblock-calendar.h"
 #include "sync.h"
 #include "txmempool.h"
 #include "utilstrencodings.h"
@@ -23,7 +28,8 @@
 
 using namespace std;
 
-static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const size_t MAX_GETUTXOS_OUTPOINTS = 1000; //allow a max of 1000 outpoints to be queried at once
+static const int MAX_REST_BLOCKS = 500; //allow a max of 500 blocks per /rest/blocks range
 
 enum RetFormat {
     RF_UNDEF,
@@ -58,8 +64,24 @@ struct CCoin {
     }
 };
 
+/** One application cache entry as served by /rest/messages */
+struct CRESTMessage {
+    std::string sKey;
+    std::string sValue;
+    int64_t nTime;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(sKey);
+        READWRITE(sValue);
+        READWRITE(nTime);
+    }
+};
+
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
-extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false, bool verbose = false, bool prayers = true);
 extern UniValue mempoolInfoToJSON();
 extern UniValue mempoolToJSON(bool fVerbose = false);
 extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
@@ -126,6 +148,82 @@ static bool CheckWarmup(HTTPRequest* req)
     return true;
 }
 
+/** Remove the "?a=1&b=2" part of a request path and return its parameters */
+static std::string SplitQuery(const std::string& strReq, std::map<std::string, std::string>& mapQuery)
+{
+    const std::string::size_type pos = strReq.find('?');
+    if (pos == std::string::npos)
+        return strReq;
+
+    vector<string> params;
+    std::string strQuery = strReq.substr(pos + 1);
+    boost::split(params, strQuery, boost::is_any_of("&"));
+    BOOST_FOREACH(const std::string& strParam, params) {
+        const std::string::size_type eq = strParam.find('=');
+        if (eq == std::string::npos)
+            mapQuery[strParam] = "";
+        else
+            mapQuery[strParam.substr(0, eq)] = strParam.substr(eq + 1);
+    }
+    return strReq.substr(0, pos);
+}
+
+/**
+ * Send the ETag of the reply.  If the client already holds that version a
+ * 304 is sent and true is returned; the handler must then stop.
+ */
+static bool ReplyNotModified(HTTPRequest* req, const uint256& hashContent)
+{
+    const std::string strETag = "\"" + hashContent.GetHex() + "\"";
+    req->WriteHeader("ETag", strETag);
+    std::pair<bool, std::string> ifNoneMatch = req->GetHeader("If-None-Match");
+    if (!ifNoneMatch.first || ifNoneMatch.second.find(strETag) == std::string::npos)
+        return false;
+    req->WriteReply(HTTP_NOT_MODIFIED);
+    return true;
+}
+
+/** Sink for replies sent in chunks; the status line goes out with the first chunk */
+class RESTChunkStream
+{
+public:
+    RESTChunkStream(HTTPRequest* reqIn, const std::string& strContentTypeIn) : req(reqIn), strContentType(strContentTypeIn), fStarted(false) {}
+
+    void operator()(const std::string& strChunk)
+    {
+        if (!fStarted) {
+            req->WriteHeader("Content-Type", strContentType);
+            req->StartChunkedReply(HTTP_OK);
+            fStarted = true;
+        }
+        req->WriteReplyChunk(strChunk);
+    }
+
+    bool HasStarted() const { return fStarted; }
+
+    void End()
+    {
+        if (!fStarted) {
+            req->WriteHeader("Content-Type", strContentType);
+            req->WriteReply(HTTP_OK);
+            return;
+        }
+        req->EndChunkedReply();
+    }
+
+    /** Cut a started reply short; the client must not take it for complete */
+    void Abort()
+    {
+        assert(fStarted);
+        req->AbortChunkedReply();
+    }
+
+private:
+    HTTPRequest* req;
+    std::string strContentType;
+    bool fStarted;
+};
+
 static bool rest_headers(HTTPRequest* req,
                          const std::string& strURIPart)
 {
@@ -273,6 +371,271 @@ static bool rest_block_notxdetails(HTTPRequest* req, const std::string& strURIPa
     return rest_block(req, strURIPart, false);
 }
 
+static bool rest_blocks(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    vector<string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No block range specified. Use /rest/blocks/<start>/<count>.<ext>.");
+
+    int32_t nStart, nCount;
+    if (!ParseInt32(path[0], &nStart) || nStart < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid start height: " + path[0]);
+    if (!ParseInt32(path[1], &nCount) || nCount < 1 || nCount > MAX_REST_BLOCKS)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + path[1]);
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    std::vector<CBlockIndex*> vIndex;
+    uint256 hashTip;
+    {
+        LOCK(cs_main);
+        if (nStart > chainActive.Height())
+            return RESTERR(req, HTTP_NOT_FOUND, "Start height beyond the chain tip: " + path[0]);
+        for (int nHeight = nStart; nHeight <= chainActive.Height() && (int)vIndex.size() < nCount; nHeight++) {
+            CBlockIndex* pindex = chainActive[nHeight];
+            if (fHavePruned && !(pindex->nStatus & BLOCK_HAVE_DATA) && pindex->nTx > 0)
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not available (pruned data)");
+            vIndex.push_back(pindex);
+        }
+        hashTip = chainActive.Tip()->GetBlockHash();
+    }
+
+    // Raw blocks only change with their hashes; json also reports confirmations
+    CHashWriter ssETag(SER_GETHASH, 0);
+    BOOST_FOREACH(const CBlockIndex* pindex, vIndex) {
+        ssETag << pindex->GetBlockHash();
+    }
+    if (rf == RF_JSON)
+        ssETag << hashTip;
+    if (ReplyNotModified(req, ssETag.GetHash()))
+        return true;
+
+    // Blocks are read and sent one at a time so a range never sits in memory whole
+    RESTChunkStream stream(req, rf == RF_JSON ? "application/json" : (rf == RF_HEX ? "text/plain" : "application/octet-stream"));
+    CJSONStreamWriter writer(boost::ref(stream));
+    if (rf == RF_JSON)
+        writer.BeginArray();
+
+    BOOST_FOREACH(const CBlockIndex* pindex, vIndex) {
+        CBlock block;
+        bool fRead;
+        {
+            LOCK(cs_main);
+            fRead = ReadBlockFromDisk(block, pindex, Params().GetConsensus(), "REST_BLOCKS");
+        }
+        if (!fRead) {
+            if (!stream.HasStarted())
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not found");
+            // The status line is gone already; drop the connection so the range is not taken as complete
+            LogPrintf("%s: %s not found after part of the range was sent\n", __func__, pindex->GetBlockHash().GetHex());
+            stream.Abort();
+            return true;
+        }
+
+        if (rf == RF_JSON) {
+            writer.Value(blockToJSON(block, pindex, true, false, true));
+            continue;
+        }
+        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+        ssBlock << block;
+        if (rf == RF_BINARY)
+            stream(ssBlock.str());
+        else
+            stream(HexStr(ssBlock.begin(), ssBlock.end()) + "\n");
+    }
+
+    if (rf == RF_JSON) {
+        writer.EndArray();
+        writer.Flush();
+        stream("\n");
+    }
+    stream.End();
+    return true;
+}
+
+static bool rest_messages(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::map<std::string, std::string> mapQuery;
+    std::string strType;
+    const RetFormat rf = ParseDataFormat(strType, SplitQuery(strURIPart, mapQuery));
+
+    if (strType.empty() || strType.find_first_of(";/") != std::string::npos)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid message type. Use /rest/messages/<type>.<ext>?since=<height>.");
+    boost::to_upper(strType);
+
+    int32_t nSince = 0;
+    if (mapQuery.count("since") && (!ParseInt32(mapQuery["since"], &nSince) || nSince < 0))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid since height: " + mapQuery["since"]);
+
+    // The cache records when a message was sent, not its height, so filter on the time of the since block
+    int64_t nSinceTime = 0;
+    if (nSince > 0) {
+        LOCK(cs_main);
+        nSinceTime = nSince > chainActive.Height() ? std::numeric_limits<int64_t>::max() : chainActive[nSince]->GetBlockTime();
+    }
+
+    std::vector<CRESTMessage> vMessages;
+    {
+        LOCK(cs_appcache);
+        const std::string strPrefix = strType + ";";
+        for (std::map<std::string, std::string>::const_iterator it = mvApplicationCache.lower_bound(strPrefix);
+             it != mvApplicationCache.end() && it->first.compare(0, strPrefix.size(), strPrefix) == 0; ++it) {
+            if (it->second.empty())
+                continue;
+            CRESTMessage message;
+            message.sKey = it->first.substr(strPrefix.size());
+            message.sValue = it->second;
+            message.nTime = mvApplicationCacheTimestamp[it->first];
+            if (message.nTime >= nSinceTime)
+                vMessages.push_back(message);
+        }
+    }
+
+    CDataStream ssMessages(SER_NETWORK, PROTOCOL_VERSION);
+    ssMessages << vMessages;
+    if (ReplyNotModified(req, Hash(ssMessages.begin(), ssMessages.end())))
+        return true;
+
+    switch (rf) {
+    case RF_BINARY: {
+        string binaryMessages = ssMessages.str();
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, binaryMessages);
+        return true;
+    }
+
+    case RF_HEX: {
+        string strHex = HexStr(ssMessages.begin(), ssMessages.end()) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+
+    case RF_JSON: {
+        UniValue jsonMessages(UniValue::VARR);
+        BOOST_FOREACH(const CRESTMessage& message, vMessages) {
+            UniValue obj(UniValue::VOBJ);
+            obj.push_back(Pair("key", message.sKey));
+            obj.push_back(Pair("value", message.sValue));
+            obj.push_back(Pair("time", message.nTime));
+            jsonMessages.push_back(obj);
+        }
+        string strJSON = jsonMessages.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_superblock(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string heightStr;
+    const RetFormat rf = ParseDataFormat(heightStr, strURIPart);
+
+    int32_t nHeight;
+    if (!ParseInt32(heightStr, &nHeight) || nHeight < 1)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + heightStr);
+
+    const bool fDCC = GetDCCSuperblockCalendar().IsSuperblock(nHeight);
+    const bool fGovernance = GetGovernanceSuperblockCalendar().IsSuperblock(nHeight);
+    if (!fDCC && !fGovernance)
+        return RESTERR(req, HTTP_NOT_FOUND, heightStr + " is not a superblock height");
+
+    CBlock block;
+    CBlockIndex* pblockindex = NULL;
+    {
+        LOCK(cs_main);
+        if (nHeight > chainActive.Height())
+            return RESTERR(req, HTTP_NOT_FOUND, heightStr + " not found");
+
+        pblockindex = chainActive[nHeight];
+        if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            return RESTERR(req, HTTP_NOT_FOUND, heightStr + " not available (pruned data)");
+
+        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), "REST_SUPERBLOCK"))
+            return RESTERR(req, HTTP_NOT_FOUND, heightStr + " not found");
+    }
+
+    // The payouts can only change with a reorg, which changes the block hash
+    if (ReplyNotModified(req, pblockindex->GetBlockHash()))
+        return true;
+
+    const std::vector<CTxOut>& vPayments = block.vtx[0].vout;
+    CDataStream ssPayments(SER_NETWORK, PROTOCOL_VERSION);
+    ssPayments << nHeight << pblockindex->GetBlockHash() << vPayments;
+
+    switch (rf) {
+    case RF_BINARY: {
+        string binaryPayments = ssPayments.str();
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, binaryPayments);
+        return true;
+    }
+
+    case RF_HEX: {
+        string strHex = HexStr(ssPayments.begin(), ssPayments.end()) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+
+    case RF_JSON: {
+        UniValue objSuperblock(UniValue::VOBJ);
+        objSuperblock.push_back(Pair("height", nHeight));
+        objSuperblock.push_back(Pair("hash", pblockindex->GetBlockHash().GetHex()));
+        objSuperblock.push_back(Pair("time", block.GetBlockTime()));
+        objSuperblock.push_back(Pair("dcc", fDCC));
+        objSuperblock.push_back(Pair("governance", fGovernance));
+
+        UniValue payments(UniValue::VARR);
+        CAmount nTotal = 0;
+        BOOST_FOREACH(const CTxOut& txout, vPayments) {
+            UniValue payment(UniValue::VOBJ);
+            CTxDestination dest;
+            if (ExtractDestination(txout.scriptPubKey, dest))
+                payment.push_back(Pair("address", CBitcoinAddress(dest).ToString()));
+            else
+                payment.push_back(Pair("script", HexStr(txout.scriptPubKey.begin(), txout.scriptPubKey.end())));
+            payment.push_back(Pair("amount", ValueFromAmount(txout.nValue)));
+            payments.push_back(payment);
+            nTotal += txout.nValue;
+        }
+        objSuperblock.push_back(Pair("total", ValueFromAmount(nTotal)));
+        objSuperblock.push_back(Pair("payments", payments));
+
+        string strJSON = objSuperblock.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
 static bool rest_chaininfo(HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -348,6 +711,37 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+static bool rest_perfstats(HTTPRequest* req, const std::string& strURIPart)
+{
+    // No warmup check: the timings of the startup work are wanted as well
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    if (!param.empty())
+        return RESTERR(req, HTTP_NOT_FOUND, "not found");
+
+    switch (rf) {
+    case RF_UNDEF: {
+        req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+        req->WriteReply(HTTP_OK, FormatPerfStatsPrometheus());
+        return true;
+    }
+    case RF_JSON: {
+        UniValue rpcParams(UniValue::VARR);
+        UniValue perfStatsObject = getperfstats(rpcParams, false);
+        string strJSON = perfStatsObject.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json, or none for Prometheus text)");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
 static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -498,6 +892,7 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     vector<unsigned char> bitmap;
     vector<CCoin> outs;
     std::string bitmapStringRepresentation;
+    bitmapStringRepresentation.reserve(vOutPoints.size());
     boost::dynamic_bitset<unsigned char> hits(vOutPoints.size());
     {
         LOCK2(cs_main, mempool.cs);
@@ -511,23 +906,33 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
         if (fCheckMemPool)
             view.SetBackend(viewMempool); // switch cache backend to db+mempool in case user likes to query mempool
 
+        // Large batches usually ask for several outputs of one transaction; look each txid up once
+        std::map<uint256, CCoins> mapCoins;
+        std::set<uint256> setMissing;
         for (size_t i = 0; i < vOutPoints.size(); i++) {
-            CCoins coins;
-            uint256 hash = vOutPoints[i].hash;
-            if (view.GetCoins(hash, coins)) {
-                mempool.pruneSpent(hash, coins);
-                if (coins.IsAvailable(vOutPoints[i].n)) {
-                    hits[i] = true;
-                    // Safe to index into vout here because IsAvailable checked if it's off the end of the array, or if
-                    // n is valid but points to an already spent output (IsNull).
-                    CCoin coin;
-                    coin.nTxVer = coins.nVersion;
-                    coin.nHeight = coins.nHeight;
-                    coin.out = coins.vout.at(vOutPoints[i].n);
-                    assert(!coin.out.IsNull());
-                    outs.push_back(coin);
+            const uint256& hash = vOutPoints[i].hash;
+            std::map<uint256, CCoins>::iterator it = mapCoins.find(hash);
+            if (it == mapCoins.end() && !setMissing.count(hash)) {
+                CCoins coins;
+                if (view.GetCoins(hash, coins)) {
+                    mempool.pruneSpent(hash, coins);
+                    it = mapCoins.insert(std::make_pair(hash, coins)).first;
+                } else {
+                    setMissing.insert(hash);
                 }
             }
+            if (it != mapCoins.end() && it->second.IsAvailable(vOutPoints[i].n)) {
+                const CCoins& coins = it->second;
+                hits[i] = true;
+                // Safe to index into vout here because IsAvailable checked if it's off the end of the array, or if
+                // n is valid but points to an already spent output (IsNull).
+                CCoin coin;
+                coin.nTxVer = coins.nVersion;
+                coin.nHeight = coins.nHeight;
+                coin.out = coins.vout.at(vOutPoints[i].n);
+                assert(!coin.out.IsNull());
+                outs.push_back(coin);
+            }
 
             bitmapStringRepresentation.append(hits[i] ? "1" : "0"); // form a binary string representation (human-readable for json output)
         }
@@ -608,6 +1013,10 @@ static const struct {
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/blocks/", rest_blocks},
+      {"/rest/messages/", rest_messages},
+      {"/rest/superblock/", rest_superblock},
+      {"/rest/perfstats", rest_perfstats},
 };
 
 bool StartREST()
@@ -10,10 +10,12 @@
 #include "checkpoints.h"
 #include "coins.h"
 #include "consensus/validation.h"
+#include "dbwrapper.h"
 #include "main.h"
 #include "policy/policy.h"
 #include "primitives/transaction.h"
 #include "rpcserver.h"
+#include "json-stream.h"
 #include "podc.h"
 #include "streams.h"
 #include "sync.h"
@@ -30,7 +32,16 @@
 #include "activemasternode.h"
 #include "masternodeman.h"
 #include "governance-classes.h"
+#include "superblock-calendar.h"
+#include "spork-cache.h"
+#include "dcccontract.h"
+#include "dccregistry.h"
+#include "dccstream.h"
+#include "ipfscache.h"
+#include "ipfsdownload.h"
 #include "masternode-sync.h"
+#include "messagesigcheck.h"
+#include "perfstats.h"
 
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
@@ -99,6 +110,7 @@ extern std::string GetCPID();
 
 bool ipfs_download(const string& url, const string& filename, double dTimeoutSecs, double dRangeRequestMin, double dRangeRequestMax);
 extern int CheckSanctuaryIPFSHealth(std::string sAddress);
+int64_t GetIPFSSize(std::string sHash);
 extern std::string AssociateDCAccount(std::string sProjectId, std::string sBoincEmail, std::string sBoincPassword, std::string sUnbankedPublicKey, bool fForce);
 extern std::string SubmitToIPFS(std::string sPath, std::string& sError);
 extern std::string GetUndownloadedIPFSHash();
@@ -107,17 +119,15 @@ extern int64_t GetFileSize(std::string sPath);
 extern std::string StoreBusinessObject(UniValue& oBusinessObject, std::string& sError);
 extern UniValue GetBusinessObject(std::string sType, std::string sPrimaryKey, std::string& sError);
 extern UniValue GetBusinessObjectList(std::string sType);
+CIPFSObjectCache& GetBusinessObjectCache();
 extern bool is_email_valid(const std::string& e);
 
 extern double AscertainResearcherTotalRAC();
 extern std::vector<std::string> GetListOfDCCS(std::string sSearch, bool fRequireSig);
 extern bool VerifyCPIDSignature(std::string sFullSig, bool bRequireEndToEndVerification, std::string& sError);
-extern double GetSumOfXMLColumnFromXMLFile(std::string sFileName, std::string sObjectName, std::string sElementName, double dReqSPM, double dReqSPR, double dTeamRequired, std::string sConcatCpids, 
-		double dRACThreshhold, std::string sTeamBlacklist, int iNextSuperblock);
 extern uint256 GetDCCHash(std::string sContract);
 extern UniValue UTXOReport(std::string sCPID);
 extern uint256 GetDCCFileHash();
-extern double GetTeamPercentage(double dUserTeam, double dProjectTeam, std::string sTeamBlacklist, double dNonBiblepayTeamPercentage);
 extern std::string AttachProject(std::string sAuth);
 extern UserVote GetSumOfSignal(std::string sType, std::string sIPFSHash);
 extern std::string SendBusinessObject(std::string sType, std::string sPrimaryKey, std::string sValue, double dStorageFee, std::string sSignKey, bool fSign, std::string& sError);
@@ -198,6 +208,7 @@ extern std::string GetDCCElement(std::string sData, int iElement, bool fCheckSig
 extern double GetWCGRACByCPID(std::string sCPID);
 extern std::string SerializeSanctuaryQuorumTrigger(int nEventBlockHeight, std::string sContract);
 extern double VerifyTasks(std::string sCPID, std::string sTasks);
+void VerifyTasksBatch(const std::vector<std::string>& vCPIDs, const std::vector<std::string>& vTaskLists, std::vector<double>& vWeights);
 extern std::string GetActiveProposals();
 
 extern std::string GetSporkValue(std::string sKey);
@@ -237,7 +248,7 @@ extern int GetMinimumResearcherParticipationLevel();
 extern int64_t GetDCCFileAge();
 extern std::string GetBoincPasswordHash(std::string sProjectPassword, std::string sProjectEmail);
 extern std::string GetBoincTasksByHost(int iHostID, std::string sProjectId);
-extern bool FilterFile(int iBufferSize, int iNextSuperblock, std::string& sError);
+extern bool FilterFile(std::string sProject1URL, std::string sProject2URL, int iNextSuperblock, std::string& sError);
 extern uint256 GetDCPAMHashByContract(std::string sContract, int nHeight);
 extern uint256 GetDCPAMHash(std::string sAddresses, std::string sAmounts);
 extern int GetLastDCSuperblockWithPayment(int nChainHeight);
@@ -342,7 +353,7 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false, bool bVerbose = false, bool bShowPrayers = true)
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails, bool bVerbose, bool bShowPrayers, bool bTxList)
 {
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", block.GetHash().GetHex()));
@@ -363,6 +374,8 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
 	{
 		BOOST_FOREACH(const CTransaction&tx, block.vtx)
 		{
+			if (!bTxList)
+				break; // the caller writes the ids itself, the empty array only keeps the member order
 			if(txDetails)
 			{
 				UniValue objTx(UniValue::VOBJ);
@@ -517,6 +530,8 @@ UniValue showblock(const UniValue& params, bool fHelp)
             "Returns information about the block at <height>.");
 	std::string sBlock = params[0].get_str();
 	int nHeight = (int)cdbl(sBlock,0);
+    // Runs in parallel with other batch elements, so the chain is read under cs_main like getblock
+    LOCK(cs_main);
     if (nHeight < 0 || nHeight > chainActive.Tip()->nHeight)
         throw runtime_error("Block number out of range.");
     CBlockIndex* pblockindex = FindBlockByHeight(nHeight);
@@ -581,6 +596,75 @@ UniValue getdifficulty(const UniValue& params, bool fHelp)
     return GetDifficultyN(NULL,10);
 }
 
+/** What getrawmempool shows of one entry, copied so a long reply can be written without the locks */
+struct CMempoolEntryInfo
+{
+    uint256 txid;
+    size_t nTxSize;
+    CAmount nFee;
+    CAmount nModifiedFee;
+    int64_t nTime;
+    unsigned int nHeight;
+    double dStartingPriority;
+    double dCurrentPriority;
+    uint64_t nCountWithDescendants;
+    uint64_t nSizeWithDescendants;
+    CAmount nModFeesWithDescendants;
+    set<string> setDepends;
+};
+
+static void mempoolEntryToInfo(const CTxMemPoolEntry& e, CMempoolEntryInfo& info)
+{
+    AssertLockHeld(mempool.cs);
+    const CTransaction& tx = e.GetTx();
+    info.txid = tx.GetHash();
+    info.nTxSize = e.GetTxSize();
+    info.nFee = e.GetFee();
+    info.nModifiedFee = e.GetModifiedFee();
+    info.nTime = e.GetTime();
+    info.nHeight = e.GetHeight();
+    info.dStartingPriority = e.GetPriority(e.GetHeight());
+    info.dCurrentPriority = e.GetPriority(chainActive.Height());
+    info.nCountWithDescendants = e.GetCountWithDescendants();
+    info.nSizeWithDescendants = e.GetSizeWithDescendants();
+    info.nModFeesWithDescendants = e.GetModFeesWithDescendants();
+    info.setDepends.clear();
+    BOOST_FOREACH(const CTxIn& txin, tx.vin)
+    {
+        if (mempool.exists(txin.prevout.hash))
+            info.setDepends.insert(txin.prevout.hash.ToString());
+    }
+}
+
+static void mempoolInfoToJSON(const CMempoolEntryInfo& e, UniValue& info)
+{
+    info.push_back(Pair("size", (int)e.nTxSize));
+    info.push_back(Pair("fee", ValueFromAmount(e.nFee)));
+    info.push_back(Pair("modifiedfee", ValueFromAmount(e.nModifiedFee)));
+    info.push_back(Pair("time", e.nTime));
+    info.push_back(Pair("height", (int)e.nHeight));
+    info.push_back(Pair("startingpriority", e.dStartingPriority));
+    info.push_back(Pair("currentpriority", e.dCurrentPriority));
+    info.push_back(Pair("descendantcount", e.nCountWithDescendants));
+    info.push_back(Pair("descendantsize", e.nSizeWithDescendants));
+    info.push_back(Pair("descendantfees", e.nModFeesWithDescendants));
+
+    UniValue depends(UniValue::VARR);
+    BOOST_FOREACH(const string& dep, e.setDepends)
+    {
+        depends.push_back(dep);
+    }
+
+    info.push_back(Pair("depends", depends));
+}
+
+static void mempoolEntryToJSON(const CTxMemPoolEntry& e, UniValue& info)
+{
+    CMempoolEntryInfo entryInfo;
+    mempoolEntryToInfo(e, entryInfo);
+    mempoolInfoToJSON(entryInfo, info);
+}
+
 UniValue mempoolToJSON(bool fVerbose = false)
 {
     if (fVerbose)
@@ -591,31 +675,7 @@ UniValue mempoolToJSON(bool fVerbose = false)
         {
             const uint256& hash = e.GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
-            info.push_back(Pair("size", (int)e.GetTxSize()));
-            info.push_back(Pair("fee", ValueFromAmount(e.GetFee())));
-            info.push_back(Pair("modifiedfee", ValueFromAmount(e.GetModifiedFee())));
-            info.push_back(Pair("time", e.GetTime()));
-            info.push_back(Pair("height", (int)e.GetHeight()));
-            info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
-            info.push_back(Pair("currentpriority", e.GetPriority(chainActive.Height())));
-            info.push_back(Pair("descendantcount", e.GetCountWithDescendants()));
-            info.push_back(Pair("descendantsize", e.GetSizeWithDescendants()));
-            info.push_back(Pair("descendantfees", e.GetModFeesWithDescendants()));
-            const CTransaction& tx = e.GetTx();
-            set<string> setDepends;
-            BOOST_FOREACH(const CTxIn& txin, tx.vin)
-            {
-                if (mempool.exists(txin.prevout.hash))
-                    setDepends.insert(txin.prevout.hash.ToString());
-            }
-
-            UniValue depends(UniValue::VARR);
-            BOOST_FOREACH(const string& dep, setDepends)
-            {
-                depends.push_back(dep);
-            }
-
-            info.push_back(Pair("depends", depends));
+            mempoolEntryToJSON(e, info);
             o.push_back(Pair(hash.ToString(), info));
         }
         return o;
@@ -678,6 +738,51 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
     return mempoolToJSON(fVerbose);
 }
 
+void mempoolToJSONStream(bool fVerbose, CJSONStreamWriter& writer)
+{
+    // Same output as mempoolToJSON.  The entries are copied under the locks
+    // and written after releasing them, a slow client must not stall the
+    // mempool and block validation while the reply drains
+    if (fVerbose)
+    {
+        vector<CMempoolEntryInfo> vInfo;
+        {
+            LOCK2(cs_main, mempool.cs);
+            vInfo.resize(mempool.mapTx.size());
+            size_t i = 0;
+            BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
+                mempoolEntryToInfo(e, vInfo[i++]);
+        }
+        writer.BeginObject();
+        BOOST_FOREACH(const CMempoolEntryInfo& e, vInfo)
+        {
+            UniValue info(UniValue::VOBJ);
+            mempoolInfoToJSON(e, info);
+            writer.Pair(e.txid.ToString(), info);
+        }
+        writer.EndObject();
+    }
+    else
+    {
+        vector<uint256> vtxid;
+        mempool.queryHashes(vtxid);
+
+        writer.BeginArray();
+        BOOST_FOREACH(const uint256& hash, vtxid)
+            writer.Value(hash.ToString());
+        writer.EndArray();
+    }
+}
+
+void getrawmempool_stream(const UniValue& params, CJSONStreamWriter& writer)
+{
+    bool fVerbose = false;
+    if (params.size() > 0)
+        fVerbose = params[0].get_bool();
+
+    mempoolToJSONStream(fVerbose, writer);
+}
+
 UniValue getblockhashes(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 2)
@@ -884,6 +989,24 @@ UniValue getblockheaders(const UniValue& params, bool fHelp)
     return arrHeaders;
 }
 
+static CBlockIndex* ReadBlockForRPC(const std::string& strHash, CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    uint256 hash(uint256S(strHash));
+
+    if (mapBlockIndex.count(hash) == 0)
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+
+    CBlockIndex* pblockindex = mapBlockIndex[hash];
+
+    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+
+    if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), "GETBLOCK"))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+    return pblockindex;
+}
+
 UniValue getblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 1 || params.size() > 2)
@@ -924,24 +1047,12 @@ UniValue getblock(const UniValue& params, bool fHelp)
 
     LOCK(cs_main);
 
-    std::string strHash = params[0].get_str();
-    uint256 hash(uint256S(strHash));
-
     bool fVerbose = true;
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
-
-    if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), "GETBLOCK"))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+    CBlockIndex* pblockindex = ReadBlockForRPC(params[0].get_str(), block);
 
     if (!fVerbose)
     {
@@ -954,6 +1065,106 @@ UniValue getblock(const UniValue& params, bool fHelp)
     return blockToJSON(block, pblockindex, false, false);
 }
 
+void getblock_stream(const UniValue& params, CJSONStreamWriter& writer)
+{
+    bool fVerbose = true;
+    if (params.size() > 1)
+        fVerbose = params[1].get_bool();
+
+    CBlock block;
+    UniValue result(UniValue::VOBJ);
+    {
+        LOCK(cs_main);
+        CBlockIndex* pblockindex = ReadBlockForRPC(params[0].get_str(), block);
+        if (fVerbose)
+            result = blockToJSON(block, pblockindex, false, false, true, false);
+    }
+
+    if (!fVerbose)
+    {
+        // Same bytes as serializing the whole block, hex encoded one transaction at a time
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << block.GetBlockHeader();
+        WriteCompactSize(ss, block.vtx.size());
+        writer.BeginString();
+        writer.StringPart(HexStr(ss.begin(), ss.end()));
+        BOOST_FOREACH(const CTransaction& tx, block.vtx)
+        {
+            ss.clear();
+            ss << tx;
+            writer.StringPart(HexStr(ss.begin(), ss.end()));
+        }
+        writer.EndString();
+        return;
+    }
+
+    // Members in blockToJSON's order, the transaction ids taken from the block as they are written
+    writer.BeginObject();
+    const std::vector<std::string>& vKeys = result.getKeys();
+    for (unsigned int i = 0; i < result.size(); i++)
+    {
+        if (vKeys[i] != "tx")
+        {
+            writer.Pair(vKeys[i], result[i]);
+            continue;
+        }
+        writer.Key("tx");
+        writer.BeginArray();
+        BOOST_FOREACH(const CTransaction& tx, block.vtx)
+            writer.Value(tx.GetHash().GetHex());
+        writer.EndArray();
+    }
+    writer.EndObject();
+}
+
+UniValue getdbstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getdbstats\n"
+            "\nReturns the LevelDB settings and internal statistics of each open database.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {                 (object) chainstate, blockindex and, with -splitindexdb, indexes\n"
+            "    \"path\": \"dir\",          (string) The database directory\n"
+            "    \"cachesize\": n,         (numeric) Cache budget in bytes\n"
+            "    \"blocksize\": n,         (numeric) LevelDB block size in bytes\n"
+            "    \"compression\": true|false, (boolean) Whether blocks are snappy compressed\n"
+            "    \"bloombits\": n,         (numeric) Bloom filter bits per key\n"
+            "    \"maxopenfiles\": n,      (numeric) Maximum open table files\n"
+            "    \"writebuffer\": n,       (numeric) Write buffer in percent of the cache\n"
+            "    \"approximatesize\": n,   (numeric) Approximate bytes on disk\n"
+            "    \"prefixes\": { \"c\": n, ... }, (object) Approximate bytes per leading key byte\n"
+            "    \"stats\": \"...\"          (string) LevelDB's leveldb.stats property\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        );
+
+    UniValue ret(UniValue::VOBJ);
+    std::vector<CDBStats> vStats = GetDBStats();
+    BOOST_FOREACH(const CDBStats& stats, vStats) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("path", stats.strPath));
+        obj.push_back(Pair("cachesize", (uint64_t)stats.nCacheSize));
+        obj.push_back(Pair("blocksize", (uint64_t)stats.profile.nBlockSize));
+        obj.push_back(Pair("compression", stats.profile.fCompression));
+        obj.push_back(Pair("bloombits", stats.profile.nBloomBits));
+        obj.push_back(Pair("maxopenfiles", stats.profile.nMaxOpenFiles));
+        obj.push_back(Pair("writebuffer", stats.profile.nWriteBufferPercent));
+        obj.push_back(Pair("approximatesize", stats.nApproximateSize));
+        UniValue prefixes(UniValue::VOBJ);
+        for (std::map<char, uint64_t>::const_iterator it = stats.mapPrefixSizes.begin(); it != stats.mapPrefixSizes.end(); ++it)
+            prefixes.push_back(Pair(std::string(1, it->first), it->second));
+        obj.push_back(Pair("prefixes", prefixes));
+        obj.push_back(Pair("stats", stats.strLevelDBStats));
+        ret.push_back(Pair(stats.profile.strName, obj));
+    }
+    return ret;
+}
+
 UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 0)
@@ -1692,12 +1903,21 @@ double GetStakeWeight(CTransaction tx, int64_t nTipTime, std::string sXML, bool
 		bool fSigned = false;
 		// Ensure the signature works for every output:
 		std::string sMessage = ExtractXML(sXML, "<polmessage>","</polmessage>");
+		std::vector<std::string> vSignatures(tx.vout.size());
+		std::vector<std::string> vAddresses(tx.vout.size());
+		std::vector<CMessageSigCheck> vSigChecks;
 		for (int iIndex = 0; iIndex < (int)tx.vout.size(); iIndex++) 
 		{
-			std::string sSignature = ExtractXML(sXML, "<SIG_" + RoundToString(iIndex,0) + ">","</SIG_" + RoundToString(iIndex,0) + ">");
-			const CTxOut& txout = tx.vout[iIndex];
-			std::string sAddr = PubKeyToAddress(txout.scriptPubKey);
-			fSigned = CheckStakeSignature(sAddr, sSignature, sMessage, sError);
+			vSignatures[iIndex] = ExtractXML(sXML, "<SIG_" + RoundToString(iIndex,0) + ">","</SIG_" + RoundToString(iIndex,0) + ">");
+			vAddresses[iIndex] = PubKeyToAddress(tx.vout[iIndex].scriptPubKey);
+			if (iIndex > 0) vSigChecks.push_back(CMessageSigCheck(vAddresses[iIndex], vSignatures[iIndex], sMessage));
+		}
+		for (int iIndex = 0; iIndex < (int)tx.vout.size(); iIndex++) 
+		{
+			// A stake that is not signed at all fails on the first output without recovering the rest;
+			// past it the other outputs' signatures are recovered on every core, and the checks below hit the cache
+			if (iIndex == 1) CheckMessageSignaturesInParallel(vSigChecks);
+			fSigned = CheckStakeSignature(vAddresses[iIndex], vSignatures[iIndex], sMessage, sError);
 			if (!fSigned) break;
 		}
 
@@ -1816,6 +2036,19 @@ uint256 Sha256001(int nType, int nVersion, string data)
     return result;
 }
 
+/** Run an exec ipfsget download and report how it went */
+static void AddIPFSDownloadResults(CIPFSDownload& download, UniValue& results)
+{
+	int i = DownloadIPFSFile(download);
+	results.push_back(Pair("Results", i));
+	results.push_back(Pair("Size", (int64_t)download.nSize));
+	results.push_back(Pair("Resumed bytes", (int64_t)download.nResumed));
+	results.push_back(Pair("Ranges", download.nRangesUsed));
+	results.push_back(Pair("Elapsed (ms)", download.nElapsedMillis));
+	results.push_back(Pair("Throughput (KB/s)", download.GetThroughput() / 1024));
+	if (!download.sError.empty()) results.push_back(Pair("Error", download.sError));
+}
+
 UniValue exec(const UniValue& params, bool fHelp)
 {
     if (fHelp || (params.size() != 1 && params.size() != 2  && params.size() != 3 && params.size() != 4 && params.size() != 5 && params.size() != 6 && params.size() != 7))
@@ -2293,8 +2526,8 @@ UniValue exec(const UniValue& params, bool fHelp)
 			throw runtime_error("You must specify source IPFSURL and target filename.");
 		std::string sURL = params[1].get_str();
 		std::string sPath = params[2].get_str();
-		int i = ipfs_download(sURL, sPath, 375, 0, 0);
-		results.push_back(Pair("Results", i));
+		CIPFSDownload download(sURL, sPath, 375 * 1000);
+		AddIPFSDownloadResults(download, results);
 	}
 	else if (sItem == "ipfsget")
 	{
@@ -2304,8 +2537,9 @@ UniValue exec(const UniValue& params, bool fHelp)
 		std::string sPath = params[2].get_str();
 		std::string sFN = GetFileNameFromPath(sPath);
 		std::string sURL = "http://ipfs.biblepay.org:8080/ipfs/" + sHash;
-		int i = ipfs_download(sURL, sPath, 375, 0, 0);
-		results.push_back(Pair("Results", i));
+		CIPFSDownload download(sURL, sPath, 375 * 1000);
+		download.nExpectedSize = GetIPFSSize(sHash);
+		AddIPFSDownloadResults(download, results);
 	}
 	else if (sItem == "ipfsgetrange")
 	{
@@ -2560,6 +2794,35 @@ UniValue exec(const UniValue& params, bool fHelp)
 		results.push_back(Pair("contract", sContract));
 		results.push_back(Pair("hash", sHash));
 	}
+	else if (sItem == "dccreplay")
+	{
+		// Recompute the last daily magnitude contract from the input it was built from, optionally on a given number of threads
+		std::string sPath = GetSANDirectory2() + "dccinputs";
+		int nThreads = GetNumCores();
+		if (params.size() > 1) nThreads = (int)cdbl(params[1].get_str(), 0);
+		if (params.size() > 2) sPath = params[2].get_str();
+		CDCCContractInput input;
+		std::string sError = "";
+		if (!ReadDCCContractInput(sPath, input, sError)) throw runtime_error(sError);
+		CDCCContract contract;
+		bool fComputed = ComputeDCCContract(input, contract, nThreads);
+		results.push_back(Pair("Researchers", (int)input.vResearchers.size()));
+		results.push_back(Pair("Records", (int)(input.vProject1.size() + input.vProject2.size())));
+		results.push_back(Pair("Threads", nThreads));
+		results.push_back(Pair("Elapsed (ms)", contract.nElapsedMillis));
+		if (fComputed)
+		{
+			std::string sHash = GetDCCHash(contract.sContract).GetHex();
+			results.push_back(Pair("Rows", contract.nRows));
+			results.push_back(Pair("Total Magnitude", contract.dTotalMagnitude));
+			results.push_back(Pair("hash", sHash));
+			results.push_back(Pair("Matches contract_hash", sHash == ReadCache("dcc", "contract_hash")));
+		}
+		else
+		{
+			results.push_back(Pair("Error", contract.sError));
+		}
+	}
 	else if (sItem == "testmodaldebuginput")
 	{
 		results.push_back(Pair("testmodal", "Entering Modal Mode Now"));
@@ -3840,6 +4103,7 @@ void SerializePrayersToFile(int nHeight)
 	std::string sTarget = GetSANDirectory2() + "prayers2" + sSuffix;
 	FILE *outFile = fopen(sTarget.c_str(), "w");
 	LogPrintf("Serializing Prayers... %f ",GetAdjustedTime());
+	LOCK(cs_appcache);
 	for(map<string,string>::iterator ii=mvApplicationCache.begin(); ii!=mvApplicationCache.end(); ++ii) 
     {
 		std::string sKey = (*ii).first;
@@ -3954,77 +4218,41 @@ std::string GetUndownloadedIPFSHash()
 	return "";
 }
 
+/** Bring the business object cache up to date with the sType entries of the application cache */
+static void SyncBusinessObjects(std::string sType)
+{
+	std::map<std::string, std::string> mapCurrent;
+	std::string sPrefix = sType + ";";
+	{
+		LOCK(cs_appcache);
+		for (map<string,string>::iterator ii = mvApplicationCache.lower_bound(sPrefix); ii != mvApplicationCache.end() && ii->first.compare(0, sPrefix.length(), sPrefix) == 0; ++ii)
+			mapCurrent[ii->first.substr(sPrefix.length())] = ii->second;
+	}
+	GetBusinessObjectCache().Sync(sType, mapCurrent);
+}
+
 double GetBusinessObjectTotal(std::string sType, std::string sFieldName, int iAggregationType)
 {
-	UniValue ret(UniValue::VOBJ);
 	boost::to_upper(sType);
-	double dTotal = 0;
-	double dTotalRows = 0;
-    for(map<string,string>::iterator ii=mvApplicationCache.begin(); ii!=mvApplicationCache.end(); ++ii) 
-    {
-		std::string sKey = (*ii).first;
-	   	if (sKey.length() > sType.length())
-		{
-			if (sKey.substr(0,sType.length())==sType)
-			{
-				std::string sPrimaryKey = sKey.substr(sType.length() + 1, sKey.length() - sType.length());
-				std::string sIPFSHash = mvApplicationCache[(*ii).first];
-				std::string sError = "";
-				UniValue o = GetBusinessObject(sType, sPrimaryKey, sError);
-				if (o.size() > 0)
-				{
-					bool fDeleted = o["deleted"].getValStr() == "1";
-					if (!fDeleted)
-					{
-						std::string sBOValue = o[sFieldName].getValStr();
-						double dBOValue = cdbl(sBOValue, 2);
-						dTotal += dBOValue;
-						dTotalRows++;
-					}
-				}
-			}
-		}
-	}
+	SyncBusinessObjects(sType);
+	int nRows = 0;
+	double dTotal = GetBusinessObjectCache().GetTotal(sType, sFieldName, nRows);
 	if (iAggregationType == 1) return dTotal;
 	double dAvg = 0;
-	if (dTotalRows > 0) dAvg = dTotal / dTotalRows;
+	if (nRows > 0) dAvg = dTotal / nRows;
 	if (iAggregationType == 2) return dAvg;
 	return 0;
 }
 
 
-
-
 UniValue GetBusinessObjectByFieldValue(std::string sType, std::string sFieldName, std::string sSearchValue)
 {
 	UniValue ret(UniValue::VOBJ);
 	boost::to_upper(sType);
-	boost::to_upper(sSearchValue);
-    for(map<string,string>::iterator ii=mvApplicationCache.begin(); ii!=mvApplicationCache.end(); ++ii) 
-    {
-		std::string sKey = (*ii).first;
-	   	if (sKey.length() > sType.length())
-		{
-			if (sKey.substr(0,sType.length())==sType)
-			{
-				std::string sPrimaryKey = sKey.substr(sType.length() + 1, sKey.length() - sType.length());
-				std::string sIPFSHash = mvApplicationCache[(*ii).first];
-				std::string sError = "";
-				UniValue o = GetBusinessObject(sType, sPrimaryKey, sError);
-				if (o.size() > 0)
-				{
-					bool fDeleted = o["deleted"].getValStr() == "1";
-					if (!fDeleted)
-					{
-						std::string sBOValue = o[sFieldName].getValStr();
-						boost::to_upper(sBOValue);
-						if (sBOValue == sSearchValue)
-							return o;
-					}
-				}
-			}
-		}
-	}
+	SyncBusinessObjects(sType);
+	CBusinessObject object;
+	if (GetBusinessObjectCache().FindByField(sType, sFieldName, sSearchValue, object))
+		return object.o;
 	return ret;
 }
 
@@ -4033,26 +4261,11 @@ UniValue GetBusinessObjectList(std::string sType)
 {
 	UniValue ret(UniValue::VOBJ);
 	boost::to_upper(sType);
-    for(map<string,string>::iterator ii=mvApplicationCache.begin(); ii!=mvApplicationCache.end(); ++ii) 
-    {
-		std::string sKey = (*ii).first;
-	   	if (sKey.length() > sType.length())
-		{
-			if (sKey.substr(0,sType.length()) == sType)
-			{
-				std::string sPrimaryKey = sKey.substr(sType.length() + 1, sKey.length() - sType.length());
-				std::string sIPFSHash = mvApplicationCache[(*ii).first];
-				std::string sError = "";
-				UniValue o = GetBusinessObject(sType, sPrimaryKey, sError);
-				if (o.size() > 0)
-				{
-					bool fDeleted = o["deleted"].getValStr() == "1";
-					if (!fDeleted)
-							ret.push_back(Pair(sPrimaryKey + " (" + sIPFSHash + ")", o));
-				}
-			}
-		}
-	}
+	SyncBusinessObjects(sType);
+	std::vector<CBusinessObject> vObjects;
+	GetBusinessObjectCache().GetObjects(sType, vObjects);
+	BOOST_FOREACH(const CBusinessObject& object, vObjects)
+		ret.push_back(Pair(object.sPrimaryKey + " (" + object.sHash + ")", object.o));
 	return ret;
 }
 
@@ -4074,6 +4287,7 @@ UserVote GetSumOfSignal(std::string sType, std::string sIPFSHash)
 	std::string sData = "";
 	UserVote v = UserVote();
 
+	LOCK(cs_appcache);
     for(map<string,string>::iterator ii=mvApplicationCache.begin(); ii!=mvApplicationCache.end(); ++ii) 
     {
 		std::string sKey = (*ii).first;
@@ -4108,48 +4322,44 @@ std::string GetBusinessObjectList(std::string sType, std::string sFields)
 	boost::to_upper(sType);
 	std::vector<std::string> vFields = Split(sFields.c_str(), ",");
 	std::string sData = "";
-    for(map<string,string>::iterator ii=mvApplicationCache.begin(); ii!=mvApplicationCache.end(); ++ii) 
-    {
-		std::string sKey = (*ii).first;
-	   	if (sKey.length() > sType.length())
+	SyncBusinessObjects(sType);
+	std::vector<CBusinessObject> vObjects;
+	GetBusinessObjectCache().GetObjects(sType, vObjects);
+	BOOST_FOREACH(const CBusinessObject& object, vObjects)
+	{
+		// 1st column is ID - objecttype - recaddress - secondarykey
+		std::string sPK = sType + "-" + object.sPrimaryKey + "-" + object.sHash;
+		std::string sRow = sPK + "<col>";
+		for (int i = 0; i < (int)vFields.size(); i++)
 		{
-			if (sKey.substr(0,sType.length()) == sType)
-			{
-				std::string sPrimaryKey = sKey.substr(sType.length() + 1, sKey.length() - sType.length());
-				std::string sIPFSHash = mvApplicationCache[(*ii).first];
-				std::string sError = "";
-				UniValue o = GetBusinessObject(sType, sPrimaryKey, sError);
-				if (o.size() > 0)
-				{
-					bool fDeleted = o["deleted"].getValStr() == "1";
-					if (!fDeleted)
-					{
-						// 1st column is ID - objecttype - recaddress - secondarykey
-						std::string sPK = sType + "-" + sPrimaryKey + "-" + sIPFSHash;
-						std::string sRow = sPK + "<col>";
-						for (int i = 0; i < (int)vFields.size(); i++)
-						{
-							sRow += o[vFields[i]].getValStr() + "<col>";
-						}
-						sData += sRow + "<object>";
-					}
-				}
-			}
+			sRow += object.o[vFields[i]].getValStr() + "<col>";
 		}
+		sData += sRow + "<object>";
 	}
 	LogPrintf("BOList data %s \n",sData.c_str());
 	return sData;
 }
 
 
+int64_t GetIPFSSize(std::string sHash)
+{
+	// IPFSSIZE is keyed by the time of the transaction that paid for the hash
+	LOCK(cs_appcache);
+	map<string,int64_t>::iterator it = mvApplicationCacheTimestamp.find("IPFS;" + sHash);
+	if (it == mvApplicationCacheTimestamp.end()) return 0;
+	return (int64_t)cdbl(ReadCache("IPFSSize" + RoundToString(it->second, 0), sHash), 0);
+}
+
 UniValue GetIPFSList(int iMaxAgeInDays, std::string& out_Files)
 {
 	UniValue ret(UniValue::VOBJ);
 	std::string sType = "IPFS";
 	int64_t nMinStamp = GetAdjustedTime() - (86400 * iMaxAgeInDays);
 	std::string sFiles = ""; // TODO:  Make this a map of files for PODS; for now this is OK for a proof-of-concept
-	double dCostPerByte = GetSporkDouble("ipfscostperbyte", .0002);
+	static CSporkHandle hCostPerByte("ipfscostperbyte");
+	double dCostPerByte = hCostPerByte.GetDouble(.0002);
 	// Only include the IPFS hashes that actually paid the PODS fees
+	LOCK(cs_appcache);
     for(map<string,string>::iterator ii=mvApplicationCache.begin(); ii!=mvApplicationCache.end(); ++ii) 
     {
 		std::string sKey = (*ii).first;
@@ -4188,6 +4398,7 @@ UniValue GetDataList(std::string sType, int iMaxAgeInDays, int& iSpecificEntry,
 	ret.push_back(Pair("DataList",sType));
 	int iPos = 0;
 	int iTotalRecords = 0;
+	LOCK(cs_appcache);
     for(map<string,string>::iterator ii=mvApplicationCache.begin(); ii!=mvApplicationCache.end(); ++ii) 
     {
 		std::string sKey = (*ii).first;
@@ -4443,27 +4654,25 @@ std::string FindResearcherCPIDByAddress(std::string sSearch, std::string& out_ad
 		    std::string sAddress = CBitcoinAddress(address).ToString();
 			boost::to_upper(strName);
 			// If we have a valid burn in the chain, prefer it
-			std::vector<std::string> vCPIDs = GetListOfDCCS(sAddress, true);
-			if (vCPIDs.size() > 0)
+			std::vector<CDCCRegistry::Entry> vDCCs = GetDCCRegistry().Find(sAddress, true);
+			// The string list this replaced always held a trailing empty row, so every address of ours is counted
+			nTotalMagnitude += GetMagnitudeByAddress(sAddress);
+			for (int i=0; i < (int)vDCCs.size(); i++)
 			{
-				nTotalMagnitude += GetMagnitudeByAddress(sAddress);
-				for (int i=0; i < (int)vCPIDs.size(); i++)
+				std::string sCPID = vDCCs[i].GetCPID(false);
+				if (sSearch.empty() && !sCPID.empty()) 
+				{
+					out_address = sAddress;
+					msGlobalCPID += sCPID + ";";
+					sLastCPID = sCPID;
+				}
+				else if (!sSearch.empty())
 				{
-					std::string sCPID = GetDCCElement(vCPIDs[i], 0, false);
-					if (sSearch.empty() && !sCPID.empty()) 
+					if (sSearch == sAddress && !sCPID.empty()) 
 					{
+						nTotalMagnitude = GetMagnitudeByAddress(sAddress);
 						out_address = sAddress;
-						msGlobalCPID += sCPID + ";";
-						sLastCPID = sCPID;
-					}
-					else if (!sSearch.empty())
-					{
-						if (sSearch == sAddress && !sCPID.empty()) 
-						{
-							nTotalMagnitude = GetMagnitudeByAddress(sAddress);
-							out_address = sAddress;
-							return sCPID;
-						}
+						return sCPID;
 					}
 				}
 			}
@@ -4698,8 +4907,10 @@ bool AdvertiseDistributedComputingKey(std::string sProjectId, std::string sAuth,
 
 double GetMinimumRequiredUTXOStake(double dRAC, double dFactor)
 {
-	double dReqSPM = GetSporkDouble("requiredspm", 500);
-	double dReqSPR = GetSporkDouble("requiredspr", 0);
+	static CSporkHandle hReqSPM("requiredspm");
+	static CSporkHandle hReqSPR("requiredspr");
+	double dReqSPM = hReqSPM.GetDouble(500);
+	double dReqSPR = hReqSPR.GetDouble(0);
 	double dRequirement = 0;
 	double dEstimatedMagnitude = dRAC / 5000; // This is a rough estimate only lasting until April 1, 2018 pending outcome of SPR vote
 	LogPrintf(" getminimumrequiredutxostake RAC %f, reqspm %f, reqspr %f ",dRAC, dReqSPM, dReqSPR);
@@ -4926,6 +5137,7 @@ std::string RetrieveDCCWithMaxAge(std::string cpid, int64_t iMaxSeconds)
 {
 	boost::to_upper(cpid); // CPID must be uppercase to retrieve
     const std::string key = "DCC;" + cpid;
+	LOCK(cs_appcache);
     const std::string& value = mvApplicationCache[key];
 	const Consensus::Params& consensusParams = Params().GetConsensus();
     int64_t iAge = chainActive.Tip() != NULL ? chainActive.Tip()->nTime - mvApplicationCacheTimestamp[key] : 0;
@@ -4935,6 +5147,7 @@ std::string RetrieveDCCWithMaxAge(std::string cpid, int64_t iMaxSeconds)
 int64_t RetrieveCPIDAssociationTime(std::string cpid)
 {
 	std::string key = "DCC;" + cpid;
+	LOCK(cs_appcache);
 	return mvApplicationCacheTimestamp[key];
 }
 
@@ -4944,26 +5157,28 @@ std::string GetDCCPublicKey(const std::string& cpid, bool fRequireSig)
 	if (cpid.empty()) return "";
 	int iMonths = 120;
     int64_t iMaxSeconds = 60 * 24 * 30 * iMonths * 60;
-    std::string sData = RetrieveDCCWithMaxAge(cpid, iMaxSeconds);
-    if (sData.empty())
-	{
-		return "";
-	}
-    // DCC data structure: CPID,hashRand,PubKey,ResearcherID,Sig(base64Enc)
-	std::string sElement = GetDCCElement(sData, 2, fRequireSig); // Public Key
-	return sElement;
+	std::string sKey = cpid;
+	boost::to_upper(sKey); // CPID must be uppercase to retrieve
+	CDCCRegistry::Entry dcc;
+	if (!GetDCCRegistry().GetByKey(sKey, dcc)) return "";
+    int64_t iAge = chainActive.Tip() != NULL ? chainActive.Tip()->nTime - dcc.nTime : 0;
+	if (iAge > iMaxSeconds) return "";
+    // DCC data structure: CPID,hashRand,PubKey,ResearcherID,Sig(base64Enc); the signature was checked when the DCC was memorized
+	return dcc.GetAddress(fRequireSig);
 }
 
 double GetTaskWeight(std::string sCPID)
 {
-	double nMaximumChatterAge = GetSporkDouble("podcmaximumchatterage", (60 * 60 * 24));
+	static CSporkHandle hMaximumChatterAge("podcmaximumchatterage");
+	double nMaximumChatterAge = hMaximumChatterAge.GetDouble(60 * 60 * 24);
 	std::string sTaskList = ReadCacheWithMaxAge("CPIDTasks", sCPID, nMaximumChatterAge);
 	return (sTaskList.empty()) ? 0 : 100;
 }
 
 double GetUTXOWeight(std::string sCPID)
 {
-	double nMaximumChatterAge = GetSporkDouble("podcmaximumchatterage", (60 * 60 * 24));
+	static CSporkHandle hMaximumChatterAge("podcmaximumchatterage");
+	double nMaximumChatterAge = hMaximumChatterAge.GetDouble(60 * 60 * 24);
 	double dUTXOWeight = cdbl(ReadCacheWithMaxAge("UTXOWeight", sCPID, nMaximumChatterAge), 0);
 	return dUTXOWeight;
 }
@@ -5035,59 +5250,59 @@ UniValue UTXOReport(std::string sCPID)
 
 double GetUserMagnitude(std::string sListOfPublicKeys, double& nBudget, double& nTotalPaid, int& out_iLastSuperblock, std::string& out_Superblocks, int& out_SuperblockCount, int& out_HitCount, double& out_OneDayPaid, double& out_OneWeekPaid, double& out_OneDayBudget, double& out_OneWeekBudget)
 {
+	static CPerfStat& statUserMagnitude = GetPerfTimer("user_magnitude");
+	CPerfTimer timer(statUserMagnitude);
 	// Query actual magnitude from last superblock
 	const Consensus::Params& consensusParams = Params().GetConsensus();
-	int iNextSuperblock = 0;  
-	for (int b = chainActive.Tip()->nHeight; b > 1; b--)
+	const CSuperblockCalendar& calendar = GetDCCSuperblockCalendar();
+	// Walk the DC superblocks backwards directly rather than testing every height
+	for (int b = calendar.GetPrevious(chainActive.Tip()->nHeight); b > consensusParams.nDCCSuperblockStartBlock && b > 1; b = calendar.GetPrevious(b - 1))
 	{
-		int iLastSuperblock = GetLastDCSuperblockHeight(b + 1, iNextSuperblock);
-		if (iLastSuperblock == b)
+		int iLastSuperblock = b;
+		out_SuperblockCount++;
+		CBlockIndex* pindex = FindBlockByHeight(b);
+		CBlock block;
+		double nTotalBlock = 0;
+		if (ReadBlockFromDisk(block, pindex, consensusParams, "MemorizeBlockChainPrayers")) 
 		{
-			out_SuperblockCount++;
-			CBlockIndex* pindex = FindBlockByHeight(b);
-			CBlock block;
-			double nTotalBlock = 0;
-			if (ReadBlockFromDisk(block, pindex, consensusParams, "MemorizeBlockChainPrayers")) 
-			{
-					  nBudget = CSuperblock::GetPaymentsLimit(iLastSuperblock) / COIN;
-					  nTotalPaid=0;
-					  nTotalBlock=0;
-					  int Age = GetAdjustedTime() - block.GetBlockTime();
-							
-					  for (unsigned int i = 1; i < block.vtx[0].vout.size(); i++)
-					  {
-				            std::string sRecipient = PubKeyToAddress(block.vtx[0].vout[i].scriptPubKey);
-							double dAmount = block.vtx[0].vout[i].nValue/COIN;
-							nTotalBlock += dAmount;
-							if (Contains(sListOfPublicKeys, sRecipient))
-							{
-								nTotalPaid += dAmount;
-								if (Age > 0 && Age < 86400)
-								{
-									out_OneDayPaid += dAmount;
-								}
-								if (Age > 0 && Age < (7 * 86400)) out_OneWeekPaid += dAmount;
-							}
-					  }
-					  if (nTotalBlock > (nBudget * .50) && nBudget > 0) 
-					  {
-						    if (out_iLastSuperblock == 0) out_iLastSuperblock = iLastSuperblock;
-						    out_Superblocks += RoundToString(b,0) + ",";
-							out_HitCount++;
+				  nBudget = CSuperblock::GetPaymentsLimit(iLastSuperblock) / COIN;
+				  nTotalPaid=0;
+				  nTotalBlock=0;
+				  int Age = GetAdjustedTime() - block.GetBlockTime();
+						
+				  for (unsigned int i = 1; i < block.vtx[0].vout.size(); i++)
+				  {
+			            std::string sRecipient = PubKeyToAddress(block.vtx[0].vout[i].scriptPubKey);
+						double dAmount = block.vtx[0].vout[i].nValue/COIN;
+						nTotalBlock += dAmount;
+						if (Contains(sListOfPublicKeys, sRecipient))
+						{
+							nTotalPaid += dAmount;
 							if (Age > 0 && Age < 86400)
 							{
-								out_OneDayBudget += nBudget;
-							}
-							if (Age > 0 && Age < (7 * 86400)) 
-							{
-								out_OneWeekBudget += nBudget;
-							}
-							if (Age > (7 * 86400)) 
-							{
-								break;
+								out_OneDayPaid += dAmount;
 							}
-					  }
-				}
+							if (Age > 0 && Age < (7 * 86400)) out_OneWeekPaid += dAmount;
+						}
+				  }
+				  if (nTotalBlock > (nBudget * .50) && nBudget > 0) 
+				  {
+					    if (out_iLastSuperblock == 0) out_iLastSuperblock = iLastSuperblock;
+					    out_Superblocks += RoundToString(b,0) + ",";
+						out_HitCount++;
+						if (Age > 0 && Age < 86400)
+						{
+							out_OneDayBudget += nBudget;
+						}
+						if (Age > 0 && Age < (7 * 86400)) 
+						{
+							out_OneWeekBudget += nBudget;
+						}
+						if (Age > (7 * 86400)) 
+						{
+							break;
+						}
+				  }
 			}
 		}
 		if (out_OneWeekBudget > 0)
@@ -5168,29 +5383,17 @@ double GetMinimumMagnitude()
 int GetLastDCSuperblockHeight(int nCurrentHeight, int& nNextSuperblock)
 {
     // Compute last/next superblock
-    int nLastSuperblock = 0;
     int nSuperblockStartBlock = Params().GetConsensus().nDCCSuperblockStartBlock;
-    // int nSuperblockCycle = Params().GetConsensus().nDCCSuperblockCycle;
-    // int nFirstSuperblockOffset = (nSuperblockCycle - nSuperblockStartBlock % nSuperblockCycle) % nSuperblockCycle;
 	// 6-5-2018 - R ANDREWS - CASCADING SUPERBLOCKS 
-	// So this looks complicated, but this logic allows us to transition over the F12000-F13000 superblock interval cycle change with a broken schedule in-between
-	int nHeight = nCurrentHeight;
-	for (; nHeight > nSuperblockStartBlock; nHeight--)
+	// The calendar carries the F12000-F13000 superblock interval cycle change (with a broken schedule in-between) as separate segments
+	const CSuperblockCalendar& calendar = GetDCCSuperblockCalendar();
+	// The start block itself is never reported as the last superblock, and nNextSuperblock is left untouched below the start block
+	int nLastSuperblock = calendar.GetPrevious(nCurrentHeight);
+	if (nLastSuperblock <= nSuperblockStartBlock) nLastSuperblock = 0;
+	if (nCurrentHeight >= nSuperblockStartBlock)
 	{
-		if (CSuperblock::IsDCCSuperblock(nHeight))
-		{
-			nLastSuperblock = nHeight;
-			break;
-		}
-	}
-	nHeight++;
-	for (; nHeight > nSuperblockStartBlock; nHeight++)
-	{
-		if (CSuperblock::IsDCCSuperblock(nHeight))
-		{
-			nNextSuperblock = nHeight;
-			break;
-		}
+		int nNext = calendar.GetNext(nCurrentHeight);
+		if (nNext > 0) nNextSuperblock = nNext;
 	}
 	return nLastSuperblock;
 }
@@ -5426,154 +5629,6 @@ std::string GetBoincTasksByHost(int iHostID, std::string sProjectId)
 }
 
 
-bool FilterPhase1(int iNextSuperblock, std::string sConcatCPIDs, std::string sSourcePath, std::string sTargetPath, std::vector<std::string> vCPIDs)
-{
-	boost::filesystem::path pathIn(sSourcePath);
-    std::ifstream streamIn;
-    streamIn.open(pathIn.string().c_str());
-	if (!streamIn) return false;
-
-	FILE *outFile = fopen(sTargetPath.c_str(), "w");
-	std::string sBuffer = "";
-	int iBuffer = 0;
-	
-	// Phase 1: Scan the Combined Researcher file for all Biblepay Researchers (who have associated BiblePay Keys with Research Projects)
-	// Filter the file down to BiblePay researchers:
-	int iLines = 0;
-	std::string sOutData = "";
-	std::string line;
-    int64_t nMaxAge = (int64_t)GetSporkDouble("podcmaximumchatterage", (60 * 60 * 24));
-	 
-    while(std::getline(streamIn, line))
-    {
-		  std::string sCpid = ExtractXML(line,"<cpid>","</cpid>");
-		  sBuffer += line + "<ROW>";
-		  iBuffer++;
-		  iLines++;
-		  if (iLines % 2000000 == 0) LogPrintf(" Processing DCC Line %f ",(double)iLines);
-		  if (!sCpid.empty())
-		  {
-			 boost::to_upper(sCpid);
-			 if (Contains(sConcatCPIDs, sCpid))
-			 {
-				for (int i = 0; i < (int)vCPIDs.size(); i++)
-				{
-					std::string sBiblepayResearcher = GetDCCElement(vCPIDs[i], 0, false);
-					boost::to_upper(sBiblepayResearcher);
-					if (!sBiblepayResearcher.empty() && sBiblepayResearcher == sCpid)
-					{
-						for (int z = 0; z < 2; z++)
-						{
-							// Add in the User URL and Team
-							bool bAddlData = static_cast<bool>(std::getline(streamIn, line));
-							if (bAddlData) sBuffer += line + "<ROW>";
-						}
-
-						double dUTXOWeight = GetMatureMetric("UTXOWeight", sCpid, nMaxAge, iNextSuperblock);
-						double dTaskWeight = GetMatureMetric("TaskWeight", sCpid, nMaxAge, iNextSuperblock);
-						double dUnbanked = cdbl(ReadCacheWithMaxAge("Unbanked", sCpid, nMaxAge), 0);
-						std::string sExtra = "<utxoweight>" + RoundToString(dUTXOWeight, 0) 
-							+ "</utxoweight>\r\n<taskweight>" 
-							+ RoundToString(dTaskWeight, 0) + "</taskweight><unbanked>" + RoundToString(dUnbanked, 0) + "</unbanked>\r\n";
-						std::string sData = FilterBoincData(sBuffer, "<user>","</user>", sExtra);
-						sOutData += sData;
-						sBuffer = "";
-					}
-			 	}
-			 }
-			 else
-			 {
-				 sBuffer="";
-			 }
-		  }
-    }
-	fputs(sOutData.c_str(), outFile);
-	streamIn.close();
-    fclose(outFile);
-	return true;
-}
-
-
-bool FilterPhase2(int iNextSuperblock, std::string sSourcePath, std::string sTargetPath, double dTargetTeam)
-{
-	boost::filesystem::path pathIn(sSourcePath);
-    std::ifstream streamIn;
-    streamIn.open(pathIn.string().c_str());
-	if (!streamIn) return false;
-
-	FILE *outFile = fopen(sTargetPath.c_str(), "w");
-	std::string sBuffer = "";
-	// This file is used by the faucets; Find all team members who are not necessarily yet associated in the chain:
-	std::string line;
-     
-    while(std::getline(streamIn, line))
-    {
-		  sBuffer += line;
-		  if (Contains(sBuffer,"</user>"))
-		  {
-			  	 std::string sCpid = ExtractXML(sBuffer,"<cpid>","</cpid>");
-				 double dTeamID = cdbl(ExtractXML(sBuffer,"<teamid>","</teamid>"), 0);
-				 double dRac = cdbl(ExtractXML(sBuffer,"<expavg_credit>","</expavg_credit>"), 0);
-				 double dTotalRAC = cdbl(ExtractXML(sBuffer,"<total_credit>","</total_credit>"), 0);
-				 double dCreated = cdbl(ExtractXML(sBuffer,"<create_time>","</create_time>"), 0);
-				 std::string sName = ExtractXML(sBuffer,"<name>","</name>");
-				 if (dTargetTeam == dTeamID)
-				 {
-					 std::string sRow = sCpid + "," + RoundToString(dTeamID,0) + "," + RoundToString(dRac,0) + "," + RoundToString(dTotalRAC,0) + "," + RoundToString(dCreated,0) + "," + sName + "\r\n";
-					 fputs(sRow.c_str(), outFile);
-				 }
-				 sBuffer="";
-		  }
-				 
-    }
-	streamIn.close();
-    fclose(outFile);
-	return true;
-}
-
-
-double GetRACFromPODCProject(int iNextSuperblock, std::string sFileName, std::string sResearcherCPID, double dDRMode, double dReqSPM, double dReqSPR, double dTeamRequired,
-	double dProjectFactor, double dRACThreshhold, std::string sTeamBlacklist, double& out_Team)
-{
-	boost::filesystem::path pathFiltered(sFileName);
-	std::ifstream streamFiltered;
-    streamFiltered.open(pathFiltered.string().c_str());
-	if (!streamFiltered) return 0;
-	std::string sUser = "";
-	int64_t nMaxAge = (int64_t)GetSporkDouble("podcmaximumchatterage", (60 * 60 * 24));
-	double dUTXOWeight = GetMatureMetric("UTXOWeight", sResearcherCPID, nMaxAge, iNextSuperblock);
-	double dTaskWeight = GetMatureMetric("TaskWeight", sResearcherCPID, nMaxAge, iNextSuperblock);
-	double dNonBiblepayTeamPercentage = cdbl(GetSporkValue("nonbiblepayteampercentage"), 2);
-
-	double dUnbanked = cdbl(ReadCacheWithMaxAge("Unbanked", sResearcherCPID, nMaxAge), 0);
-	double dTotalRAC = 0;
-	double dTotalFound = 0;
-	boost::to_upper(sResearcherCPID);
-	std::string line = "";
-    while(std::getline(streamFiltered, line))
-    {
-		sUser += line;
-		if (Contains(line, "</user>"))
-		{
-			std::string sCPID = ExtractXML(sUser, "<cpid>", "</cpid>");
-			boost::to_upper(sCPID);
-			if (sCPID == sResearcherCPID)
-			{
-				double dAvgCredit = cdbl(ExtractXML(sUser, "<expavg_credit>", "</expavg_credit>"), 4);
-				double dTeam = cdbl(ExtractXML(sUser, "<teamid>", "</teamid>"), 0);
-				out_Team = dTeam;
-				// if (fDebugMaster) LogPrintf(" CPID %s, ExtraRAC %f, Team %f, TeamReq %f  ", sCPID.c_str(), dModifiedCredit, dTeam, dTeamRequired);
-				double dPercent = GetTeamPercentage(dTeam, dTeamRequired, sTeamBlacklist, dNonBiblepayTeamPercentage);
-				double dModifiedCredit = GetResearcherCredit(dDRMode, dAvgCredit, dUTXOWeight, dTaskWeight, dUnbanked, dTotalRAC, dReqSPM, dReqSPR, dRACThreshhold, dPercent) * dProjectFactor;
-				dTotalFound += dModifiedCredit;
-			}
-			sUser = "";
-		}
-    }
-	streamFiltered.close();
-	return dTotalFound;
-}
-
 int64_t GetHistoricalMilestoneAge(int64_t nMaturityAge, int64_t nOffset)
 {
 	// This function returns the timestamp in history of the last PODC Quorum Cutoff (by default the quorum cutoff occurs once every 4 hours)
@@ -5624,21 +5679,12 @@ double GetMatureMetric(std::string sMetricName, std::string sPrimaryKey, int64_t
 		
 
 
-bool FilterFile(int iBufferSize, int iNextSuperblock, std::string& sError)
+bool FilterFile(std::string sProject1URL, std::string sProject2URL, int iNextSuperblock, std::string& sError)
 {
-	std::vector<std::string> vCPIDs = GetListOfDCCS("", false);
-    std::string buffer;
-    std::string line;
-    std::string sTarget = GetSANDirectory2() + "user1";
-	std::string sFiltered = GetSANDirectory2() + "filtered1";
+	CPerfTimer timer(GetPerfTimer("filterfile"));
+	std::vector<CDCCRegistry::Entry> vDCCs = GetDCCRegistry().GetList(false);
 	std::string sDailyMagnitudeFile = GetSANDirectory2() + "magnitude";
 
-    if (!boost::filesystem::exists(sTarget.c_str())) 
-	{
-        sError = "DCC input file does not exist.";
-        return false;
-    }
-
     int64_t nMaxAge = (int64_t)GetSporkDouble("podcmaximumchatterage", (60 * 60 * 24));
 	double dReqSPM = GetSporkDouble("requiredspm", 500);
 	double dReqSPR = GetSporkDouble("requiredspr", 0);
@@ -5660,20 +5706,31 @@ bool FilterFile(int iBufferSize, int iNextSuperblock, std::string& sError)
 
 	ClearCache("Unbanked");
 	double dDRMode = cdbl(GetSporkValue("dr"), 0);
-	for (int i = 0; i < (int)vCPIDs.size(); i++)
+	std::vector<std::string> vTaskCPIDs(vDCCs.size());
+	std::vector<std::string> vTaskLists(vDCCs.size());
+	for (int i = 0; i < (int)vDCCs.size(); i++)
 	{
-		std::string sCPID1 = GetDCCElement(vCPIDs[i], 0, true);
-		double dRosettaID = cdbl(GetDCCElement(vCPIDs[i], 3, false), 0);
-		double dUnbankedIndicator = cdbl(GetDCCElement(vCPIDs[i], 5, false), 0);
-		if (dUnbankedIndicator==1) sCPID1 = GetDCCElement(vCPIDs[i], 0, false);
+		std::string sCPID1 = vDCCs[i].GetCPID(true);
+		double dUnbankedIndicator = vDCCs[i].dUnbanked;
+		if (dUnbankedIndicator==1) sCPID1 = vDCCs[i].GetCPID(false);
+		vTaskCPIDs[i] = sCPID1;
+		// R ANDREWS; 5-9-2018
+		if (!sCPID1.empty() && (dDRMode == 0 || dDRMode == 2)) vTaskLists[i] = GetMatureString("CPIDTasks", sCPID1, nMaxAge, iNextSuperblock);
+	}
+	std::vector<double> vTaskWeights;
+	{
+		CPerfTimer timerPhase(GetPerfTimer("filterfile_phase", "VerifyTasks"));
+		VerifyTasksBatch(vTaskCPIDs, vTaskLists, vTaskWeights);
+	}
+	for (int i = 0; i < (int)vDCCs.size(); i++)
+	{
+		std::string sCPID1 = vTaskCPIDs[i];
+		double dRosettaID = vDCCs[i].dRosettaID;
+		double dUnbankedIndicator = vDCCs[i].dUnbanked;
 		if (!sCPID1.empty())
 		{
 			if (!sCPID1.empty()) sConcatCPIDs += sCPID1 + ",";
-			std::string sTaskList = GetMatureString("CPIDTasks", sCPID1, nMaxAge, iNextSuperblock);
-			double dVerifyTasks = 0;
-			// R ANDREWS; 5-9-2018
-			if (dDRMode == 0 || dDRMode == 2) dVerifyTasks = VerifyTasks(sCPID1, sTaskList);
-			WriteCache("TaskWeight", sCPID1, RoundToString(dVerifyTasks, 0), GetAdjustedTime());
+			WriteCache("TaskWeight", sCPID1, RoundToString(vTaskWeights[i], 0), GetAdjustedTime());
 			if (dRosettaID > 0 && IsInList(sUnbankedList, ",", RoundToString(dRosettaID,0)))
 			{
 				WriteCache("Unbanked", sCPID1, "1", GetAdjustedTime());
@@ -5690,138 +5747,107 @@ bool FilterFile(int iBufferSize, int iNextSuperblock, std::string& sError)
 	boost::to_upper(sConcatCPIDs);
 	if (fDebugMaster) LogPrintf("Filter Phase 1: CPID List concatenated %s, unbanked %s  ",sConcatCPIDs.c_str(), sUnbankedList.c_str());
 
-	// Filter each BOINC Project file down to the individual BiblePay records
-
-	bool bResult = FilterPhase1(iNextSuperblock, sConcatCPIDs, sTarget, sFiltered, vCPIDs);
-	if (!bResult)
+	// Filter each BOINC Project export down to the individual BiblePay records while it downloads; both projects stream concurrently and nothing expanded is written to disk
+	std::set<std::string> setCPIDs;
+	for (int i = 0; i < (int)vDCCs.size(); i++)
 	{
-		LogPrintf(" \n FilterFile::FilterPhase 1 failed. \n");
-		return false;
+		std::string sBiblepayResearcher = vDCCs[i].GetCPID(false);
+		boost::to_upper(sBiblepayResearcher);
+		if (!sBiblepayResearcher.empty()) setCPIDs.insert(sBiblepayResearcher);
 	}
 	std::string sTeamFile1 = GetSANDirectory2() + "team1";
 	std::string sTeamFile2 = GetSANDirectory2() + "team2";
 
 	double dTeamRequired = cdbl(GetSporkValue("team"), 0);
 	double dTeamBackupProject = cdbl(GetSporkValue("team2"), 0);
-	
-	bResult = FilterPhase2(iNextSuperblock, sTarget, sTeamFile1, dTeamRequired);
 
-	std::string sTarget2 = GetSANDirectory2() + "user2";
-	std::string sFiltered2 = GetSANDirectory2() + "filtered2";
-	
-    if (boost::filesystem::exists(sTarget2.c_str())) 
+	CDCCProjectStream project1(sProject1URL, setCPIDs, sTeamFile1, dTeamRequired);
+	CDCCProjectStream project2(sProject2URL, setCPIDs, sTeamFile2, dTeamBackupProject);
+	std::vector<CDCCProjectStream*> vProjects;
+	vProjects.push_back(&project1);
+	vProjects.push_back(&project2);
 	{
-		FilterPhase1(iNextSuperblock, sConcatCPIDs, sTarget2, sFiltered2, vCPIDs);
-    }
-	bResult = FilterPhase2(iNextSuperblock, sTarget2, sTeamFile2, dTeamBackupProject);
-
-	//  Phase II : Normalize the file for Biblepay (this process asseses the magnitude of each BiblePay Researcher relative to one another, with 100 being the leader, 0 being a researcher with no activity)
-	//  We measure users by RAC - the BOINC Decay function: expavg_credit.  This is the half-life of the users cobblestone emission over a one month period.
-	
-	double dRAC1 = GetSumOfXMLColumnFromXMLFile(sFiltered, "<user>", "expavg_credit", dReqSPM, dReqSPR, dTeamRequired, sConcatCPIDs, dRACThreshhold, sTeamBlacklist, iNextSuperblock);
-	double dRAC2 = GetSumOfXMLColumnFromXMLFile(sFiltered2,"<user>", "expavg_credit", dReqSPM, dReqSPR, dTeamBackupProject, sConcatCPIDs, dRACThreshhold, sTeamBlacklist, iNextSuperblock);
-	double dTotalRAC = dRAC1 + dRAC2;
-	LogPrintf(" \n FilterPhase2: Team %f, backupteam %f, Proj1 RAC %f, Proj2 RAC %f, Total RAC %f \n", dTeamRequired, dTeamBackupProject, dRAC1, dRAC2, dTotalRAC);
-	if (dTotalRAC < 10)
+		CPerfTimer timerPhase(GetPerfTimer("filterfile_phase", "Download"));
+		StreamDCCProjects(vProjects, DCC_DOWNLOAD_TIMEOUT);
+	}
+	if (!project1.fSuccess)
 	{
-		sError = "Total DC credit less than the project minimum.  Unable to calculate magnitudes.";
+		sError = "DCC download failed: " + project1.sError;
+		LogPrintf(" \n FilterFile::%s \n", sError);
 		return false;
 	}
 
-	dTotalRAC += 100; // Ensure magnitude never exceeds 1000 due to rounding errors.
-
-	// Emit the BiblePay DCC Leaderboard file, and then stamp it with the Biblepay hash
-	// Leaderboard file format:  Biblepay-Public-Key-Compressed, DCC-CPID, DCC-Magnitude <rowdelimiter>
-	int iTries = 0;
-	// Adding a more robust contract creator loop, just in case magnitude exceeds 1000 due to rounding errors, this gives the sanctuary a second chance to make it correct.
-	double dGlobalMagnitudeFactor = 1;  
-	double dTotalRosetta = 0;
-	double dTotalWCG = 0;
-	int iRows = 0;
-	double dTotalMagnitude = 0;
-	std::string sDCC = "";
-	/* Assess Magnitude Levels */
-	while(true)
-	{
-		iTries++;
-		if (iTries > 70) break;
-
-		std::string sUser = "";
-		sDCC = "";
-		double dBackupProjectFactor = cdbl(GetSporkValue("project2factor"), 2);
-		double dDRMode = cdbl(GetSporkValue("dr"), 0);
-		std::string sTeamBlacklist = GetSporkValue("teamblacklist");
-		dTotalMagnitude = 0;
-		dTotalRosetta = 0;
-		dTotalWCG = 0;
-		iRows = 0;
-		
-		// ********************************************************************   Phase 3: Assemble Magnitudes   **********************************************************************************
-		double doutWCGTeam = 0;
-		double doutRAHTeam = 0;
-		for (int i = 0; i < (int)vCPIDs.size(); i++)
+	// Phases 1 to 3 work from a snapshot of the weights and DCCs taken here, so the contract can be replayed from the saved input (exec dccreplay)
+	CDCCContractInput input;
+	input.params.nHeight = iNextSuperblock;
+	input.params.dDRMode = dDRMode;
+	input.params.dReqSPM = dReqSPM;
+	input.params.dReqSPR = dReqSPR;
+	input.params.dRACThreshhold = dRACThreshhold;
+	input.params.dTeamRequired = dTeamRequired;
+	input.params.dTeamBackupProject = dTeamBackupProject;
+	input.params.dBackupProjectFactor = cdbl(GetSporkValue("project2factor"), 2);
+	input.params.dNonBiblepayTeamPercentage = cdbl(GetSporkValue("nonbiblepayteampercentage"), 2);
+	input.params.sTeamBlacklist = sTeamBlacklist;
+	for (int i = 0; i < (int)vTaskCPIDs.size(); i++)
+	{
+		if (!vTaskCPIDs[i].empty()) input.vEligibleCPIDs.push_back(vTaskCPIDs[i]);
+	}
+	for (int i = 0; i < (int)vDCCs.size(); i++)
+	{
+		std::string sPreCPID = vDCCs[i].GetCPID(false);
+		boost::to_upper(sPreCPID);
+		if (sPreCPID.empty()) continue;
+		if (!input.mapWeights.count(sPreCPID))
 		{
-			std::string sPreCPID = GetDCCElement(vCPIDs[i], 0, false);
-			double dUnbanked = cdbl(ReadCacheWithMaxAge("Unbanked", sPreCPID, nMaxAge), 0);
-			bool fRequireSig = dUnbanked == 1 ? false : true;
-			std::string sCPID = GetDCCElement(vCPIDs[i], 0, fRequireSig);
-			double dRosettaID = cdbl(GetDCCElement(vCPIDs[i], 3, false), 0);
-			if (!sCPID.empty())
-			{
-				double dUTXOWeight = GetMatureMetric("UTXOWeight", sCPID, nMaxAge, iNextSuperblock);
-				double dTaskWeight = GetMatureMetric("TaskWeight", sCPID, nMaxAge, iNextSuperblock);
-				// If backup project enabled, add additional credit
-				double dWCGRAC = 0;
-				if (dTeamBackupProject > 0) 
-				{
-					// Note that dDR Mode is set to 3 so that we can penalize the user based on the TOTAL UTXO LEVEL BELOW, not once per project (since they fit in ONE UTXO LEVEL SLOT):
-					dWCGRAC = GetRACFromPODCProject(iNextSuperblock, sFiltered2, sCPID, 3, dReqSPM, dReqSPR, dTeamBackupProject, dBackupProjectFactor, dRACThreshhold, sTeamBlacklist, doutWCGTeam);
-				}
-				double dRosettaRAC = GetRACFromPODCProject(iNextSuperblock, sFiltered, sCPID, 3, dReqSPM, dReqSPR, dTeamRequired, 1.0, dRACThreshhold, sTeamBlacklist, doutRAHTeam);
-
-				dTotalRosetta += dRosettaRAC;
-				dTotalWCG += dWCGRAC;
-
-				double dModifiedCredit = GetResearcherCredit(dDRMode, dRosettaRAC + dWCGRAC, dUTXOWeight, dTaskWeight, dUnbanked, dTotalRAC, dReqSPM, dReqSPR, dRACThreshhold, 1);
-				// R ANDREW : BIBLEPAY : We include any CPID with adj. credit > 0 or RAC > 100 so that the user can see this record in the superblock view report (IE they have 0 UTXO WEIGHT and want to diagnose the problem).  We filter out adjusted RAC of zero (zero mag reward) with < 100 RAC (decaying long gone boincers) for a succinct superblock contract.
-				if (dModifiedCredit > 0 || (dRosettaRAC + dWCGRAC > 9))
-				{
-					std::string BPK = GetDCCPublicKey(sCPID, fRequireSig);
-					double dMagnitude = (dModifiedCredit / dTotalRAC) * 999 * dGlobalMagnitudeFactor;
-					double dUTXO = GetUTXOLevel(dUTXOWeight, dTotalRAC, dRosettaRAC + dWCGRAC, dReqSPM, dReqSPR, dRACThreshhold);
-					if (!BPK.empty())
-					{
-						std::string sRow = BPK + "," + sCPID + "," + RoundToString(dMagnitude, 3) + "," 
-							+ RoundToString(dRosettaID, 0) + "," + RoundToString(doutRAHTeam, 0) 
-							+ "," + RoundToString(dUTXOWeight, 0) + "," + RoundToString(dTaskWeight, 0) 
-							+ "," + RoundToString(dTotalRAC, 0) + "," 
-							+ RoundToString(dUnbanked, 0) + "," + RoundToString(dUTXO, 2) + "," + RoundToString(dRosettaRAC, 0) + "," 
-							+ RoundToString(dModifiedCredit, 0) + "," + RoundToString(iNextSuperblock, 0) + ","
-							+ RoundToString(dWCGRAC, 0) + "," + RoundToString(doutWCGTeam, 0) + "\n<ROW>";
-						sDCC += sRow;
-						dTotalMagnitude += dMagnitude;
-						iRows++;
-					}
-					else
-					{
-						if (fDebugMaster) LogPrintf(" Non-Included DCC CPID %s , RosettaRAC %f, WCGRAC %f, UTXO Weight %f, Task Weight %f, DRMode %f, RacThreshhold %f, TotalRAC %f \n",
-							sCPID.c_str(), dRosettaRAC, dWCGRAC, dUTXOWeight, dTaskWeight, dDRMode, dRACThreshhold, dTotalRAC);
-					}
-				}
-				else
-				{
-					if (fDebugMaster) LogPrintf(" Non-Included CPID %s , RosettaRAC %f, WCGRAC %f, UTXO Weight %f, Task Weight %f, DRMode %f, RacThreshhold %f, TotalRAC %f \n",
-						sCPID.c_str(), dRosettaRAC, dWCGRAC, dUTXOWeight, dTaskWeight, dDRMode, dRACThreshhold, dTotalRAC);
-				}
-				sUser = "";
-			}
+			CDCCResearcherWeights& weights = input.mapWeights[sPreCPID];
+			weights.dUTXOWeight = GetMatureMetric("UTXOWeight", sPreCPID, nMaxAge, iNextSuperblock);
+			weights.dTaskWeight = GetMatureMetric("TaskWeight", sPreCPID, nMaxAge, iNextSuperblock);
+			weights.dUnbanked = cdbl(ReadCacheWithMaxAge("Unbanked", sPreCPID, nMaxAge), 0);
 		}
-		if (dTotalMagnitude < 1000) break;
-		// Magnitude exceeded 1000, adjust the global factor:
-		dGlobalMagnitudeFactor -= .02;
-		if (fDebugMaster) LogPrintf("\n FilterFile::AssessMagnitudeLevels, Attempt #%f, GlobalMagnitudeFactor %f, Current Magnitude %f  TotalRosetta %f, Total WCG %f \n", iTries, dGlobalMagnitudeFactor, dTotalMagnitude, dTotalRosetta, dTotalWCG);
+		bool fRequireSig = input.mapWeights[sPreCPID].dUnbanked == 1 ? false : true;
+		CDCCContractResearcher researcher;
+		researcher.sCPID = vDCCs[i].GetCPID(fRequireSig);
+		if (researcher.sCPID.empty()) continue;
+		researcher.sPublicKey = GetDCCPublicKey(researcher.sCPID, fRequireSig);
+		researcher.dRosettaID = vDCCs[i].dRosettaID;
+		input.vResearchers.push_back(researcher);
+	}
+	input.vProject1.swap(project1.researchers.vRecords);
+	std::string sInputFile = GetSANDirectory2() + "dccinputs";
+	if (project2.fSuccess)
+	{
+		input.vProject2.swap(project2.researchers.vRecords);
+	}
+	else
+	{
+		// Without a fresh backup project export, keep assessing the records filtered by the last run (as the old filtered2 file did)
+		CDCCContractInput lastInput;
+		std::string sReadError;
+		if (ReadDCCContractInput(sInputFile, lastInput, sReadError))
+		{
+			input.vProject2.swap(lastInput.vProject2);
+			LogPrintf(" \n FilterFile::Backup project export missing, reusing %d records from the last run. \n", (int)input.vProject2.size());
+		}
+	}
+	if (!WriteDCCContractInput(sInputFile, input)) LogPrintf(" \n FilterFile::Unable to save the contract input. \n");
+
+	//  Phase II : Normalize the file for Biblepay (this process asseses the magnitude of each BiblePay Researcher relative to one another, with 100 being the leader, 0 being a researcher with no activity)
+	//  We measure users by RAC - the BOINC Decay function: expavg_credit.  This is the half-life of the users cobblestone emission over a one month period.
+	CDCCContract contract;
+	bool fComputed = false;
+	{
+		CPerfTimer timerPhase(GetPerfTimer("filterfile_phase", "Contract"));
+		fComputed = ComputeDCCContract(input, contract, GetNumCores());
+	}
+	LogPrintf(" \n FilterPhase2: Team %f, backupteam %f, Proj1 RAC %f, Proj2 RAC %f, Total RAC %f \n", dTeamRequired, dTeamBackupProject, contract.dProject1RAC, contract.dProject2RAC, 
+		contract.dProject1RAC + contract.dProject2RAC);
+	if (!fComputed)
+	{
+		sError = contract.sError;
+		return false;
 	}
-	/* End of Assess Magnitude Levels */
+	std::string sDCC = contract.sContract;
 
     // Phase 3: Create the Daily Magnitude Contract and hash it
 	FILE *outMagFile = fopen(sDailyMagnitudeFile.c_str(),"w");
@@ -5832,7 +5858,7 @@ bool FilterFile(int iBufferSize, int iNextSuperblock, std::string& sError)
 	// Persist the contract in memory for verification
     WriteCache("dcc", "contract", sDCC, GetAdjustedTime());
 	WriteCache("dcc", "contract_hash", uhash.GetHex(), GetAdjustedTime());
-	LogPrintf("\n Created Contract with %f rows, Total Magnitude %f \n", (double)iRows, dTotalMagnitude);
+	LogPrintf("\n Created Contract with %f rows, Total Magnitude %f, %d attempts, %dms \n", (double)contract.nRows, contract.dTotalMagnitude, contract.nTries, contract.nElapsedMillis);
     return true;
 }
 
@@ -5875,26 +5901,23 @@ uint256 GetDCPAMHash(std::string sAddresses, std::string sAmounts)
 int GetLastDCSuperblockWithPayment(int nChainHeight)
 {
 	const Consensus::Params& consensusParams = Params().GetConsensus();
-	int iNextSuperblock = 0;  
-	for (int b = nChainHeight; b > 1; b--)
+	const CSuperblockCalendar& calendar = GetDCCSuperblockCalendar();
+	for (int b = calendar.GetPrevious(nChainHeight); b > consensusParams.nDCCSuperblockStartBlock && b > 1; b = calendar.GetPrevious(b - 1))
 	{
-		int iLastSuperblock = GetLastDCSuperblockHeight(b+1, iNextSuperblock);
-		if (iLastSuperblock == b)
+		int iLastSuperblock = b;
+		CBlockIndex* pindex = FindBlockByHeight(b);
+		CBlock block;
+		double nTotalBlock = 0;
+		if (ReadBlockFromDisk(block, pindex, consensusParams, "GetLastDCSuperblockWithPayments")) 
 		{
-			CBlockIndex* pindex = FindBlockByHeight(b);
-			CBlock block;
-			double nTotalBlock = 0;
-			if (ReadBlockFromDisk(block, pindex, consensusParams, "GetLastDCSuperblockWithPayments")) 
-			{
-				  double nBudget = CSuperblock::GetPaymentsLimit(iLastSuperblock) / COIN;
-				  nTotalBlock=0;
-				  for (unsigned int i = 1; i < block.vtx[0].vout.size(); i++)
-				  {
-						double dAmount = block.vtx[0].vout[i].nValue/COIN;
-						nTotalBlock += dAmount;
-				  }
+			  double nBudget = CSuperblock::GetPaymentsLimit(iLastSuperblock) / COIN;
+			  nTotalBlock=0;
+			  for (unsigned int i = 1; i < block.vtx[0].vout.size(); i++)
+			  {
+					double dAmount = block.vtx[0].vout[i].nValue/COIN;
+					nTotalBlock += dAmount;
+			  }
    				  if (nTotalBlock > (nBudget * .50) && nBudget > 0) return b;
-			}
 		}
 	}
 	return 0;
@@ -6250,36 +6273,8 @@ bool VerifyCPIDSignature(std::string sFullSig, bool bRequireEndToEndVerification
 
 bool CheckStakeSignature(std::string sBitcoinAddress, std::string sSignature, std::string strMessage, std::string& strError)
 {
-	CBitcoinAddress addr2(sBitcoinAddress);
-	if (!addr2.IsValid()) 
-	{
-		strError = "Invalid address";
-		return false;
-	}
-	CKeyID keyID2;
-	if (!addr2.GetKeyID(keyID2)) 
-	{
-		strError = "Address does not refer to key";
-		return false;
-	}
-	bool fInvalid = false;
-	vector<unsigned char> vchSig2 = DecodeBase64(sSignature.c_str(), &fInvalid);
-	if (fInvalid)
-	{
-		strError = "Malformed base64 encoding";
-		return false;
-	}
-	CHashWriter ss2(SER_GETHASH, 0);
-	ss2 << strMessageMagic;
-	ss2 << strMessage;
-	CPubKey pubkey2;
-    if (!pubkey2.RecoverCompact(ss2.GetHash(), vchSig2)) 
-	{
-		strError = "Unable to recover public key.";
-		return false;
-	}
-	bool fSuccess = (pubkey2.GetID() == keyID2);
-	return fSuccess;
+	// Cached, so the signatures verified ahead of time on the message signature queue are not recovered again
+	return CheckMessageSignature(sBitcoinAddress, sSignature, strMessage, strError);
 }
 
 bool IsStakeSigned(std::string sXML)
@@ -6326,6 +6321,8 @@ int VerifySanctuarySignatures(std::string sSignatureData)
 
 std::string VerifyManyWorkUnits(std::string sProjectId, std::string sTaskIds)
 {
+	static CPerfStat& statRoundTrip = GetPerfTimer("verifytasks_roundtrip");
+	CPerfTimer timer(statRoundTrip);
  	std::string sProjectURL = "http://" + GetSporkValue(sProjectId);
 	std::string sRestfulURL = "rosetta/result_status.php?ids=" + sTaskIds;
 	std::string sResponse = BiblepayHTTPSPost(true, 0, "", "", "", sProjectURL, sRestfulURL, 443, "", 15, 275000, 2);
@@ -6468,10 +6465,8 @@ bool SubmitDistributedComputingTrigger(std::string sHex, std::string& gobjecthas
 
 std::string GetSporkValue(std::string sKey)
 {
-	boost::to_upper(sKey);
-    const std::string key = "SPORK;" + sKey;
-    const std::string& value = mvApplicationCache[key];
-	return value;
+	// Loops should hold a CSporkHandle instead, this resolves the key on every call
+	return CSporkHandle(sKey).GetString();
 }
 
 std::string GetBoincAuthenticator(std::string sProjectID, std::string sProjectEmail, std::string sPasswordHash)
@@ -6691,19 +6686,19 @@ std::string SerializeSanctuaryQuorumTrigger(int nEventBlockHeight, std::string s
 }
 
 
-double VerifyTasks(std::string sCPID, std::string sTasks)
+/** Task ids verified per result_status request, the most one researcher can submit */
+static const int PODC_TASKS_PER_REQUEST = 255;
+/** result_status requests in flight at once while the sanctuaries verify every researcher */
+static const int PODC_VERIFY_THREADS = 4;
+
+static double ScoreTasks(std::string sCPID, std::string sTasks, const boost::unordered_map<double, std::string>& mapSentTimes)
 {
-	if (sTasks.empty()) return 0;
-	double dCounted = 0;
-	double dVerified = 0;
-	std::string sTaskIds = GetListOfData(sTasks, ",", "=", 0, 255);
-	std::string sTimestamps = GetListOfData(sTasks, ",", "=", 1, 255);
-	std::string sResults = VerifyManyWorkUnits("project1", sTaskIds);
+	std::string sTaskIds = GetListOfData(sTasks, ",", "=", 0, PODC_TASKS_PER_REQUEST);
+	std::string sTimestamps = GetListOfData(sTasks, ",", "=", 1, PODC_TASKS_PER_REQUEST);
 	std::vector<std::string> vPODC = Split(sTaskIds.c_str(), ",");
 	std::vector<std::string> vTimes = Split(sTimestamps.c_str(), ",");
-	std::string sDebug = sResults;
-	if (sDebug.length() > 2500) sDebug = sDebug.substr(0, 2499);
-	if (fDebugMaster) LogPrint("podc", "\n\n VerifyTasks CPID %s, taskids %s, stamps %s, output %s \n\n\n", sCPID.c_str(), sTaskIds.c_str(), sTimestamps.c_str(), sDebug.c_str());
+	double dCounted = 0;
+	double dVerified = 0;
 	for (int i = 0; i < (int)vPODC.size() && i < (int)vTimes.size(); i++)
 	{
 		double dTask = cdbl(vPODC[i], 0);
@@ -6711,25 +6706,109 @@ double VerifyTasks(std::string sCPID, std::string sTasks)
 		dCounted++;
 		if (dTask > 0 && dTime > 0)
 		{
-			double dXMLTime = cdbl(GetWUElement(sResults, "<result>", dTask, "id", "sent_time"), 0);
+			boost::unordered_map<double, std::string>::const_iterator it = mapSentTimes.find(dTask);
+			double dXMLTime = it == mapSentTimes.end() ? 0 : cdbl(it->second, 0);
 			if (dXMLTime > 0 && dXMLTime == dTime) dVerified++;
 		}
-		if (dCounted > 255) break;
+		if (dCounted > PODC_TASKS_PER_REQUEST) break;
 	}
 	if (dCounted < 1) return 0;
 	double dSource = (dVerified / dCounted) * 60000;
 	double dSnapped = GetCPIDUTXOWeight(dSource);
-	if (fDebugMaster) LogPrint("podc", "\n VerifyTasks::Tasks %f  Verified %f   Source %f  Snapped %f  ", dCounted, dVerified, dSource, dSnapped);
+	if (fDebugMaster) LogPrint("podc", "\n VerifyTasks::CPID %s Tasks %f  Verified %f   Source %f  Snapped %f  ", sCPID, dCounted, dVerified, dSource, dSnapped);
 	return dSnapped;
 }
 
+double VerifyTasks(std::string sCPID, std::string sTasks)
+{
+	if (sTasks.empty()) return 0;
+	std::string sTaskIds = GetListOfData(sTasks, ",", "=", 0, PODC_TASKS_PER_REQUEST);
+	std::string sResults = VerifyManyWorkUnits("project1", sTaskIds);
+	std::string sDebug = sResults;
+	if (sDebug.length() > 2500) sDebug = sDebug.substr(0, 2499);
+	if (fDebugMaster) LogPrint("podc", "\n\n VerifyTasks CPID %s, taskids %s, output %s \n\n\n", sCPID.c_str(), sTaskIds.c_str(), sDebug.c_str());
+	boost::unordered_map<double, std::string> mapSentTimes;
+	GetWUElements(sResults, "<result>", "id", "sent_time", mapSentTimes);
+	return ScoreTasks(sCPID, sTasks, mapSentTimes);
+}
+
+/** The task ids of one or more researchers checked with one result_status request */
+struct CTaskVerifyBatch
+{
+	std::string sTaskIds;
+	int nTasks;
+	boost::unordered_map<double, std::string> mapSentTimes;
+	CTaskVerifyBatch() : nTasks(0) {}
+};
+
+static void VerifyTaskBatches(std::vector<CTaskVerifyBatch>* pvBatches, size_t* pnNext, boost::mutex* pmutex)
+{
+	RenameThread("biblepay-podc");
+	while (true)
+	{
+		CTaskVerifyBatch* pbatch = NULL;
+		{
+			boost::lock_guard<boost::mutex> lock(*pmutex);
+			if (*pnNext >= pvBatches->size()) return;
+			pbatch = &(*pvBatches)[(*pnNext)++];
+		}
+		try
+		{
+			std::string sResults = VerifyManyWorkUnits("project1", pbatch->sTaskIds);
+			// One retry, so a dropped connection does not cost every researcher in the batch their task weight
+			if (sResults.find("<results>") == std::string::npos) sResults = VerifyManyWorkUnits("project1", pbatch->sTaskIds);
+			GetWUElements(sResults, "<result>", "id", "sent_time", pbatch->mapSentTimes);
+		}
+		catch (const std::exception& e)
+		{
+			pbatch->mapSentTimes.clear();
+			LogPrintf("VerifyTaskBatches -- %s\n", e.what());
+		}
+	}
+}
+
+void VerifyTasksBatch(const std::vector<std::string>& vCPIDs, const std::vector<std::string>& vTaskLists, std::vector<double>& vWeights)
+{
+	// Researchers' task ids are packed into as few requests as fit, each response is parsed once, and a few requests are in flight at a time.
+	// A researcher's tasks always sit in a single request and are scored only against that response, so the weights match VerifyTasks.
+	int64_t nStart = GetTimeMillis();
+	std::vector<CTaskVerifyBatch> vBatches;
+	std::vector<int> vBatchOf(vCPIDs.size(), -1);
+	for (int i = 0; i < (int)vCPIDs.size(); i++)
+	{
+		if (vTaskLists[i].empty()) continue;
+		std::string sTaskIds = GetListOfData(vTaskLists[i], ",", "=", 0, PODC_TASKS_PER_REQUEST);
+		if (sTaskIds.empty()) continue;
+		int nTasks = (int)Split(sTaskIds.c_str(), ",").size();
+		if (vBatches.empty() || vBatches.back().nTasks + nTasks > PODC_TASKS_PER_REQUEST) vBatches.push_back(CTaskVerifyBatch());
+		CTaskVerifyBatch& batch = vBatches.back();
+		batch.sTaskIds += (batch.sTaskIds.empty() ? "" : ",") + sTaskIds;
+		batch.nTasks += nTasks;
+		vBatchOf[i] = vBatches.size() - 1;
+	}
+
+	size_t nNext = 0;
+	boost::mutex mutex;
+	boost::thread_group threadGroup;
+	for (int i = 0; i < PODC_VERIFY_THREADS && i < (int)vBatches.size(); i++)
+		threadGroup.create_thread(boost::bind(&VerifyTaskBatches, &vBatches, &nNext, &mutex));
+	threadGroup.join_all();
+
+	boost::unordered_map<double, std::string> mapNone;
+	vWeights.assign(vCPIDs.size(), 0);
+	for (int i = 0; i < (int)vCPIDs.size(); i++)
+	{
+		if (vTaskLists[i].empty()) continue;
+		vWeights[i] = ScoreTasks(vCPIDs[i], vTaskLists[i], vBatchOf[i] < 0 ? mapNone : vBatches[vBatchOf[i]].mapSentTimes);
+	}
+	LogPrintf("VerifyTasksBatch -- %d researchers, %d requests, %dms\n", vCPIDs.size(), vBatches.size(), GetTimeMillis() - nStart);
+}
+
 
 
 double GetSporkDouble(std::string sName, double nDefault)
 {
-	double dSetting = cdbl(GetSporkValue(sName), 2);
-	if (dSetting == 0) return nDefault;
-	return dSetting;
+	return CSporkHandle(sName).GetDouble(nDefault);
 }
 
 
@@ -6750,138 +6829,39 @@ std::string AssociateDCAccount(std::string sProjectId, std::string sBoincEmail,
 }
 
 
-double GetTeamPercentage(double dUserTeam, double dProjectTeam, std::string sTeamBlacklist, double dNonBiblepayTeamPercentage)
-{
-	// Return a reward percentage for a given team 
-	// First, if blacklists are enabled, if user team is in blacklist, reject the users RAC
-	if (!sTeamBlacklist.empty())
-	{
-		std::vector<std::string> vTeams = Split(sTeamBlacklist.c_str(), ";");
-		for (int i = 0; i < (int)vTeams.size(); i++)
-		{
-			double dBlacklistedTeam = cdbl(vTeams[i], 0);
-			if (dBlacklistedTeam != 0 && dUserTeam != 0 && dBlacklistedTeam == dUserTeam)
-			{
-				return 0;
-			}
-		}
-	}
-	if (dProjectTeam == 0) return 1;
-	// Next, if BiblePay team is required, verify the team matches
-	return (dUserTeam == dProjectTeam) ? 1 : dNonBiblepayTeamPercentage;
-}
-
-
 std::vector<std::string> GetListOfDCCS(std::string sSearch, bool fRequireSig)
 {
 	// Return a list of Distributed Computing Participants - Rob A. - Biblepay - 1-29-2018
-	std::string sType = "DCC";
-	std::string sOut = "";
-	boost::to_upper(sSearch);
-    for(map<string,string>::iterator ii=mvApplicationCache.begin(); ii!=mvApplicationCache.end(); ++ii) 
-    {
-		std::string sKey = (*ii).first;
-	   	if (sKey.length() > sType.length())
-		{
-			if (sKey.substr(0,sType.length())==sType)
-			{
-				std::string sPrimaryKey = sKey.substr(sType.length() + 1, sKey.length() - sType.length());
-				std::string sValue = mvApplicationCache[(*ii).first];
-				std::string sCPID = GetDCCElement(sValue, 0, fRequireSig);
-				std::string sAddress = GetDCCElement(sValue, 2, fRequireSig);
-				boost::to_upper(sAddress);
-				boost::to_upper(sCPID);
-				if (!sSearch.empty()) if (sSearch == sCPID || sSearch == sAddress)
-				{
-					sOut += sValue + "<ROW>";
-				}
-				if (sSearch.empty() && !sCPID.empty()) sOut += sValue + "<ROW>";
-			}
-		}
+	std::vector<CDCCRegistry::Entry> vDCCs = GetDCCRegistry().Find(sSearch, fRequireSig);
+	std::vector<std::string> vCPID;
+	for (int i = 0; i < (int)vDCCs.size(); i++)
+	{
+		vCPID.push_back(vDCCs[i].sValue);
 	}
-	std::vector<std::string> vCPID = Split(sOut.c_str(), "<ROW>");
 	return vCPID;
 }
 
 
-double GetSumOfXMLColumnFromXMLFile(std::string sFileName, std::string sObjectName, std::string sElementName, double dReqSPM, double dReqSPR, double dTeamRequired, std::string sConcatCPIDs, 
-	double dRACThreshhold, std::string sTeamBlacklist, int iNextSuperblock)
-{
-	boost::filesystem::path pathIn(sFileName);
-    std::ifstream streamIn;
-    streamIn.open(pathIn.string().c_str());
-	if (!streamIn) return 0;
-	double dTotal = 0;
-	std::string sLine = "";
-	std::string sBuffer = "";
-	double dDRMode = cdbl(GetSporkValue("dr"), 0);
-	double dNonBiblepayTeamPercentage = cdbl(GetSporkValue("nonbiblepayteampercentage"), 2);
-	//int64_t nMaxAge = (int64_t)GetSporkDouble("podcmaximumchatterage", (60 * 60 * 24));
-	
-    while(std::getline(streamIn, sLine))
-    {
-		sBuffer += sLine;
-	}
-	streamIn.close();
-   	std::vector<std::string> vRows = Split(sBuffer.c_str(), sObjectName);
-	for (int i = 0; i < (int)vRows.size(); i++)
-	{
-		std::string sData = vRows[i];
-		double dTeam = cdbl(ExtractXML(sData,"<teamid>","</teamid>"), 0);
-		double dUTXOWeight = cdbl(ExtractXML(sData,"<utxoweight>","</utxoweight>"), 0);
-		double dTaskWeight = cdbl(ExtractXML(sData,"<taskweight>","</taskweight>"), 0);
-		double dUnbanked = cdbl(ExtractXML(sData,"<unbanked>","</unbanked>"), 0);
-		std::string sCPID = ExtractXML(sData,"<cpid>","</cpid>");
-		boost::to_upper(sCPID);
-		if (Contains(sConcatCPIDs, sCPID))
-		{
-			double dTeamPercentage = GetTeamPercentage(dTeam, dTeamRequired, sTeamBlacklist, dNonBiblepayTeamPercentage);
-			if (dTeamPercentage > 0)
-			{
-				std::string sValue = ExtractXML(sData, "<" + sElementName + ">","</" + sElementName + ">");
-				double dAvgCredit = cdbl(sValue,2);
-				double dModifiedCredit = GetResearcherCredit(dDRMode, dAvgCredit, dUTXOWeight, dTaskWeight, dUnbanked, 0, dReqSPM, dReqSPR, dRACThreshhold, dTeamPercentage);
-				dTotal += dModifiedCredit;
-				if (fDebugMaster && false) LogPrintf(" Adding CPID %s, Team %f, modifiedrac %f from RAC %f  with nonbbptp %f   DRMode %f,  Grand Total %f \n", 
-					sCPID.c_str(), dTeam, dModifiedCredit, dAvgCredit, dNonBiblepayTeamPercentage, dDRMode, dTotal);
-			}
-		}
-    }
-	return dTotal;
-}
-
-
 std::string GetCPIDByRosettaID(double dRosettaID)
 {
-	std::vector<std::string> vCPIDs = GetListOfDCCS("", false);
-	if (vCPIDs.size() > 0)
-	{
-		for (int i=0; i < (int)vCPIDs.size(); i++)
-		{
-			std::string sCPID = GetDCCElement(vCPIDs[i], 0, false);
-			double dInternalRosettaId = cdbl(GetDCCElement(vCPIDs[i], 3, false),0);
-			if (dInternalRosettaId == dRosettaID) return sCPID;
-		}
-	}
-	return "";
+	CDCCRegistry::Entry dcc;
+	if (!GetDCCRegistry().GetByRosettaID(dRosettaID, dcc)) return "";
+	return dcc.GetCPID(false);
 }
 
 
 std::string GetCPIDByAddress(std::string sAddress, int iOffset)
 {
-	std::vector<std::string> vCPIDs = GetListOfDCCS(sAddress, true);
+	std::vector<CDCCRegistry::Entry> vDCCs = GetDCCRegistry().Find(sAddress, true);
 	int nFound = 0;
-	if (vCPIDs.size() > 0)
+	for (int i = 0; i < (int)vDCCs.size(); i++)
 	{
-		for (int i=0; i < (int)vCPIDs.size(); i++)
+		std::string sCPID = vDCCs[i].GetElement(0, false);
+		std::string sInternalAddress = vDCCs[i].GetElement(1, false);
+		if (sAddress == sInternalAddress) 
 		{
-			std::string sCPID = GetDCCElement(vCPIDs[i], 0, false);
-			std::string sInternalAddress = GetDCCElement(vCPIDs[i], 1, false);
-			if (sAddress == sInternalAddress) 
-			{
-				nFound++;
-				if (nFound > iOffset) return sCPID;
-			}
+			nFound++;
+			if (nFound > iOffset) return sCPID;
 		}
 	}
 	return "";
@@ -7304,33 +7284,13 @@ bool SubmitProposalToNetwork(uint256 txidFee, int64_t nStartTime, std::string sH
 
 int GetNextSuperblock()
 {
-	int nLastSuperblock, nNextSuperblock;
     // Get current block height
     int nBlockHeight = 0;
     {
         LOCK(cs_main);
         nBlockHeight = (int)chainActive.Height();
     }
-
-    // Get chain parameters
-    int nSuperblockStartBlock = Params().GetConsensus().nSuperblockStartBlock;
-    int nSuperblockCycle = Params().GetConsensus().nSuperblockCycle;
-
-    // Get first superblock
-    int nFirstSuperblockOffset = (nSuperblockCycle - nSuperblockStartBlock % nSuperblockCycle) % nSuperblockCycle;
-    int nFirstSuperblock = nSuperblockStartBlock + nFirstSuperblockOffset;
-
-    if(nBlockHeight < nFirstSuperblock)
-	{
-        nLastSuperblock = 0;
-        nNextSuperblock = nFirstSuperblock;
-    }
-	else 
-	{
-        nLastSuperblock = nBlockHeight - nBlockHeight % nSuperblockCycle;
-        nNextSuperblock = nLastSuperblock + nSuperblockCycle;
-    }
-	return nNextSuperblock;
+	return GetGovernanceSuperblockCalendar().GetNext(nBlockHeight);
 }
 
 int64_t GetFileSize(std::string sPath)
@@ -7501,6 +7461,31 @@ std::string GetJSONFromIPFS(std::string sHash, std::string& sError)
 	return GetDataFromIPFS(sURL, sError);
 }
 
+static std::string FetchBusinessObject(const std::string& sHash, std::string& sError)
+{
+	return GetJSONFromIPFS(sHash, sError);
+}
+
+static bool AddBusinessObjectIndexes(CIPFSObjectCache& cache)
+{
+	// The fields exec bosearch and the accounting totals look up
+	cache.AddIndex("contact", "email");
+	cache.AddIndex("revenue", "bbp_amount");
+	cache.AddIndex("revenue", "btc_raised");
+	cache.AddIndex("revenue", "btc_price");
+	cache.AddIndex("revenue", "amount");
+	cache.AddIndex("expense", "amount");
+	return true;
+}
+
+CIPFSObjectCache& GetBusinessObjectCache()
+{
+	static CIPFSObjectCache cache(GetDataDir() / "ipfsobjects", false, &FetchBusinessObject);
+	static bool fIndexes = AddBusinessObjectIndexes(cache);
+	(void)fIndexes;
+	return cache;
+}
+
 std::string ReadAllText(std::string sPath)
 {
 	boost::filesystem::path pathIn(sPath);
@@ -7529,8 +7514,8 @@ UniValue GetBusinessObject(std::string sType, std::string sPrimaryKey, std::stri
 		sError = "Object not found";
 		return o;
 	}
-	std::string sJson = GetJSONFromIPFS(sIPFSHash, sError);
-	//LogPrintf(" json %s ",sJson.c_str());
+	std::string sJson;
+	GetBusinessObjectCache().GetJSON(sIPFSHash, sJson, sError);
 
 	if (!sError.empty()) return o;
 	try  
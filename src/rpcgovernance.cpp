@@ -16,6 +16,7 @@
 #include "masternodeconfig.h"
 #include "masternodeman.h"
 #include "rpcserver.h"
+#include "superblock-calendar.h"
 #include "util.h"
 #include "utilmoneystr.h"
 #include <boost/lexical_cast.hpp>
@@ -962,21 +963,9 @@ UniValue getgovernanceinfo(const UniValue& params, bool fHelp)
         nBlockHeight = (int)chainActive.Height();
     }
 
-    // Get chain parameters
-    int nSuperblockStartBlock = Params().GetConsensus().nSuperblockStartBlock;
-    int nSuperblockCycle = Params().GetConsensus().nSuperblockCycle;
-
-    // Get first superblock
-    int nFirstSuperblockOffset = (nSuperblockCycle - nSuperblockStartBlock % nSuperblockCycle) % nSuperblockCycle;
-    int nFirstSuperblock = nSuperblockStartBlock + nFirstSuperblockOffset;
-
-    if(nBlockHeight < nFirstSuperblock){
-        nLastSuperblock = 0;
-        nNextSuperblock = nFirstSuperblock;
-    } else {
-        nLastSuperblock = nBlockHeight - nBlockHeight % nSuperblockCycle;
-        nNextSuperblock = nLastSuperblock + nSuperblockCycle;
-    }
+    const CSuperblockCalendar& calendar = GetGovernanceSuperblockCalendar();
+    nLastSuperblock = calendar.GetPrevious(nBlockHeight);
+    nNextSuperblock = calendar.GetNext(nBlockHeight);
 
     UniValue obj(UniValue::VOBJ);
     obj.push_back(Pair("governanceminquorum", Params().GetConsensus().nGovernanceMinQuorum));
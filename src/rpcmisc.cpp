@@ -10,6 +10,7 @@
 #include "main.h"
 #include "net.h"
 #include "netbase.h"
+#include "perfstats.h"
 #include "rpcserver.h"
 #include "timedata.h"
 #include "txmempool.h"
@@ -143,6 +144,73 @@ UniValue debug(const UniValue& params, bool fHelp)
     return "Debug mode: " + (fDebug ? strMode : "off");
 }
 
+UniValue getperfstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 0)
+        throw runtime_error(
+            "getperfstats\n"
+            "\nReturns the counters and timers of the BiblePay specific work since startup: prayer memorization,\n"
+            "message signature checks, BibleHash, PODC task verification, the daily DCC contract and block reads.\n"
+            "Stats recorded per caller (such as the ReadBlockFromDisk context) are listed by caller.\n"
+            "With -rest the same stats are served in Prometheus text format at /rest/perfstats.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"counter\": n,            (numeric) Number of events\n"
+            "  \"timer\": {               (json object) A timed operation\n"
+            "    \"count\": n,            (numeric) Number of calls\n"
+            "    \"total_ms\": x.xxx,     (numeric) Time spent in the calls in milliseconds\n"
+            "    \"avg_ms\": x.xxx,       (numeric) Average latency in milliseconds\n"
+            "    \"max_ms\": x.xxx,       (numeric) Highest latency in milliseconds\n"
+            "    \"latency\": {           (json object) Number of calls per latency bucket\n"
+            "      \"<10us\": n, \"<100us\": n, \"<1ms\": n, \"<10ms\": n, \"<100ms\": n, \"<1s\": n, \"<10s\": n, \">=10s\": n\n"
+            "    }\n"
+            "  },\n"
+            "  \"timer by caller\": {     (json object) The counter or timer of each caller\n"
+            "    \"caller\": { ... }, ...\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getperfstats", "")
+            + HelpExampleRpc("getperfstats", "")
+        );
+
+    static const char* const vBucketNames[PERF_LATENCY_BUCKETS] = { "<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", "<10s", ">=10s" };
+
+    std::vector<CPerfStatSnapshot> vStats = GetPerfStatSnapshots();
+    UniValue ret(UniValue::VOBJ);
+    UniValue byLabel(UniValue::VOBJ);
+    for (unsigned int i = 0; i < vStats.size(); i++)
+    {
+        const CPerfStatSnapshot& stat = vStats[i];
+        UniValue value((uint64_t)stat.nCount);
+        if (stat.fTimer)
+        {
+            value = UniValue(UniValue::VOBJ);
+            value.push_back(Pair("count", (uint64_t)stat.nCount));
+            value.push_back(Pair("total_ms", stat.nTotalMicros / 1000.0));
+            value.push_back(Pair("avg_ms", stat.nCount ? stat.nTotalMicros / 1000.0 / stat.nCount : 0.0));
+            value.push_back(Pair("max_ms", stat.nMaxMicros / 1000.0));
+            UniValue latency(UniValue::VOBJ);
+            for (int j = 0; j < PERF_LATENCY_BUCKETS; j++)
+                latency.push_back(Pair(vBucketNames[j], (uint64_t)stat.vBuckets[j]));
+            value.push_back(Pair("latency", latency));
+        }
+        if (stat.sLabel.empty())
+        {
+            ret.push_back(Pair(stat.sName, value));
+            continue;
+        }
+        // The stats come ordered by name, so the callers of one name are adjacent
+        byLabel.push_back(Pair(stat.sLabel, value));
+        if (i + 1 == vStats.size() || vStats[i + 1].sName != stat.sName)
+        {
+            ret.push_back(Pair(stat.sName, byLabel));
+            byLabel = UniValue(UniValue::VOBJ);
+        }
+    }
+    return ret;
+}
+
 UniValue mnsync(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -569,6 +637,56 @@ bool heightSort(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
     return a.second.blockHeight < b.second.blockHeight;
 }
 
+/**
+ * Read the "limit" and "cursor" paging options.  Returns false if the caller
+ * did not ask for paging; paging works on one address at a time.
+ */
+template<typename Key>
+static bool getPagingFromParams(const UniValue& params, const std::vector<std::pair<uint160, int> > &addresses,
+                                size_t &limit, Key &cursor, bool &hasCursor)
+{
+    if (!params[0].isObject())
+        return false;
+
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (limitValue.isNull() && cursorValue.isNull())
+        return false;
+
+    if (addresses.size() != 1) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Paging is only supported for a single address");
+    }
+    if (!limitValue.isNum() || limitValue.get_int() < 1) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be a positive number");
+    }
+    limit = limitValue.get_int();
+
+    hasCursor = !cursorValue.isNull();
+    if (hasCursor) {
+        CDataStream ssCursor(ParseHexV(cursorValue, "cursor"), SER_DISK, CLIENT_VERSION);
+        try {
+            ssCursor >> cursor;
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Cursor decode failed");
+        }
+        if (cursor.type != (unsigned int)addresses[0].second || cursor.hashBytes != addresses[0].first) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor does not belong to this address");
+        }
+    }
+    return true;
+}
+
+/** Cursor of the next page, or null after the last page */
+template<typename Key>
+static UniValue getPagingCursor(const Key &next)
+{
+    if (next.hashBytes.IsNull())
+        return NullUniValue;
+    CDataStream ssCursor(SER_DISK, CLIENT_VERSION);
+    ssCursor << next;
+    return HexStr(ssCursor.begin(), ssCursor.end());
+}
+
 bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
                    std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> b) {
     return a.second.time < b.second.time;
@@ -658,6 +776,8 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "      \"address\"  (string) The base58check encoded address\n"
             "      ,...\n"
             "    ]\n"
+            "  \"limit\" (number, optional) Return at most this many outputs of a single address\n"
+            "  \"cursor\" (string, optional) Continue after the previous page\n"
             "}\n"
             "\nResult\n"
             "[\n"
@@ -670,6 +790,7 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "    \"satoshis\"  (number) The number of satoshis of the output\n"
             "  }\n"
             "]\n"
+            "\nWith a limit the result is {\"utxos\": [...], \"cursor\": \"...\"} in index order; the cursor is null on the last page.\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
@@ -683,13 +804,24 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
 
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
+    size_t limit = 0;
+    CAddressUnspentKey cursor, next;
+    bool hasCursor = false;
+    bool paged = getPagingFromParams(params, addresses, limit, cursor, hasCursor);
+
+    if (paged) {
+        if (!GetAddressUnspentPage(addresses[0].first, addresses[0].second, hasCursor ? &cursor : NULL, limit, unspentOutputs, next)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-    }
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        }
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+        std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    }
 
     UniValue result(UniValue::VARR);
 
@@ -709,6 +841,13 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         result.push_back(output);
     }
 
+    if (paged) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("utxos", result));
+        page.push_back(Pair("cursor", getPagingCursor(next)));
+        return page;
+    }
+
     return result;
 }
 
@@ -727,6 +866,8 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many deltas of a single address\n"
+            "  \"cursor\" (string, optional) Continue after the previous page\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -738,6 +879,7 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             "    \"address\"  (string) The base58check encoded address\n"
             "  }\n"
             "]\n"
+            "\nWith a limit the result is {\"deltas\": [...], \"cursor\": \"...\"}; the cursor is null on the last page.\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
@@ -766,14 +908,25 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    size_t limit = 0;
+    CAddressIndexKey cursor, next;
+    bool hasCursor = false;
+    bool paged = getPagingFromParams(params, addresses, limit, cursor, hasCursor);
+
+    if (paged) {
+        if (!GetAddressIndexPage(addresses[0].first, addresses[0].second, start, end, hasCursor ? &cursor : NULL, limit, addressIndex, next)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (start > 0 && end > 0) {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+            } else {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
             }
         }
     }
@@ -796,6 +949,13 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         result.push_back(delta);
     }
 
+    if (paged) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("deltas", result));
+        page.push_back(Pair("cursor", getPagingCursor(next)));
+        return page;
+    }
+
     return result;
 }
 
@@ -817,6 +977,7 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
             "{\n"
             "  \"balance\"  (string) The current balance in satoshis\n"
             "  \"received\"  (string) The total number of satoshis received (including change)\n"
+            "  \"deltas\"  (number) The number of address index entries\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
@@ -829,27 +990,23 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    // The totals are kept up to date as blocks connect and disconnect, one read per address
+    CAddressBalanceValue total;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+        CAddressBalanceValue balance;
+        if (!GetAddressBalance((*it).first, (*it).second, balance)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-    }
-
-    CAmount balance = 0;
-    CAmount received = 0;
-
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
-        }
-        balance += it->second;
+        total.balance += balance.balance;
+        total.received += balance.received;
+        total.deltas += balance.deltas;
     }
 
     UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("balance", balance));
-    result.push_back(Pair("received", received));
+    result.push_back(Pair("balance", total.balance));
+    result.push_back(Pair("received", total.received));
+    result.push_back(Pair("deltas", total.deltas));
 
     return result;
 
@@ -870,12 +1027,16 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Read at most this many index entries of a single address\n"
+            "  \"cursor\" (string, optional) Continue after the previous page\n"
             "}\n"
             "\nResult:\n"
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nWith a limit the result is {\"txids\": [...], \"cursor\": \"...\"}; the cursor is null on the last page.\n"
+            "A transaction with several entries can end one page and start the next.\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
@@ -900,14 +1061,25 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    size_t limit = 0;
+    CAddressIndexKey cursor, next;
+    bool hasCursor = false;
+    bool paged = getPagingFromParams(params, addresses, limit, cursor, hasCursor);
+
+    if (paged) {
+        if (!GetAddressIndexPage(addresses[0].first, addresses[0].second, start, end, hasCursor ? &cursor : NULL, limit, addressIndex, next)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (start > 0 && end > 0) {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+            } else {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
             }
         }
     }
@@ -934,6 +1106,13 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
         }
     }
 
+    if (paged) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("txids", result));
+        page.push_back(Pair("cursor", getPagingCursor(next)));
+        return page;
+    }
+
     return result;
 
 }
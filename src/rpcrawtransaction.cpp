@@ -974,7 +974,7 @@ UniValue sendrawtransaction(const UniValue& params, bool fHelp)
     } else if (fHaveChain) {
         throw JSONRPCError(RPC_TRANSACTION_ALREADY_IN_CHAIN, "transaction already in block chain");
     }
-    if (fInstantSend && !instantsend.ProcessTxLockRequest(tx)) {
+    if (fInstantSend && !instantsend.ProcessTxLockRequest(MakeTxLockRequestRef(tx))) {
         throw JSONRPCError(RPC_TRANSACTION_ERROR, "Not a valid InstantSend transaction, see debug.log for more info");
     }
     RelayTransaction(tx);
@@ -39,6 +39,64 @@ static std::vector<RPCTimerInterface*> timerInterfaces;
  * @note Can be changed to std::unique_ptr when C++11 */
 static std::map<std::string, boost::shared_ptr<RPCTimerBase> > deadlineTimers;
 
+/** Latency buckets reported by getrpcstats: <1ms, <10ms, <100ms, <1s, <10s, >=10s */
+static const int RPC_LATENCY_BUCKETS = 6;
+
+struct CRPCMethodStats
+{
+    uint64_t nCalls;
+    uint64_t nErrors;
+    int64_t nTotalMicros;
+    int64_t nMaxMicros;
+    uint64_t vBuckets[RPC_LATENCY_BUCKETS];
+
+    CRPCMethodStats() : nCalls(0), nErrors(0), nTotalMicros(0), nMaxMicros(0)
+    {
+        for (int i = 0; i < RPC_LATENCY_BUCKETS; i++)
+            vBuckets[i] = 0;
+    }
+};
+
+static CCriticalSection cs_rpcStats;
+static std::map<std::string, CRPCMethodStats> mapRPCStats;
+
+static void RecordRPCStats(const std::string& strName, int64_t nMicros, bool fError)
+{
+    int nBucket = 0;
+    for (int64_t nLimit = 1000; nBucket < RPC_LATENCY_BUCKETS - 1 && nMicros >= nLimit; nLimit *= 10)
+        nBucket++;
+
+    LOCK(cs_rpcStats);
+    CRPCMethodStats& stats = mapRPCStats[strName];
+    stats.nCalls++;
+    if (fError)
+        stats.nErrors++;
+    stats.nTotalMicros += nMicros;
+    stats.nMaxMicros = std::max(stats.nMaxMicros, nMicros);
+    stats.vBuckets[nBucket]++;
+}
+
+static bool IsLongRunningExec(const std::string& strCommand)
+{
+    static const char* const vLongRunning[] = {
+        "podcupdate", "datalist", "utxoreport", "contributions", "sendmanyxml", "dcc", "testdcc", "listdccs",
+        "getboinctasks", "getboincinfo", "wcgrac", "totalrac", "rosettadiagnostics", "attachrosetta",
+        "podcvotingreport", "governancevotingreport", "leaderboard", "search", "reconsiderblocks",
+        "ipfsget", "ipfsgetrange", "ipfsadd", "ipfspin", "ipfslist", "ipfsquality"
+    };
+    for (unsigned int i = 0; i < sizeof(vLongRunning) / sizeof(vLongRunning[0]); i++)
+    {
+        if (strCommand == vLongRunning[i])
+            return true;
+    }
+    return false;
+}
+
+bool IsLongRunningRPC(const std::string& strMethod, const UniValue& params)
+{
+    return strMethod == "exec" && params.size() > 0 && params[0].isStr() && IsLongRunningExec(params[0].get_str());
+}
+
 static struct CRPCSignals
 {
     boost::signals2::signal<void ()> Started;
@@ -250,15 +308,62 @@ UniValue stop(const UniValue& params, bool fHelp)
     return "Biblepay Core server stopping";
 }
 
+UniValue getrpcstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 0)
+        throw runtime_error(
+            "getrpcstats\n"
+            "\nReturns call counts and latency histograms of the RPC methods called since startup.\n"
+            "Long running exec subcommands are listed separately as \"exec <command>\".\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"method\": {\n"
+            "    \"calls\": n,          (numeric) Number of calls\n"
+            "    \"errors\": n,         (numeric) Number of calls that returned an error\n"
+            "    \"avg_ms\": x.xxx,     (numeric) Average latency in milliseconds\n"
+            "    \"max_ms\": x.xxx,     (numeric) Highest latency in milliseconds\n"
+            "    \"latency\": {         (json object) Number of calls per latency bucket\n"
+            "      \"<1ms\": n, \"<10ms\": n, \"<100ms\": n, \"<1s\": n, \"<10s\": n, \">=10s\": n\n"
+            "    }\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcstats", "")
+            + HelpExampleRpc("getrpcstats", "")
+        );
+
+    static const char* const vBucketNames[RPC_LATENCY_BUCKETS] = { "<1ms", "<10ms", "<100ms", "<1s", "<10s", ">=10s" };
+
+    UniValue ret(UniValue::VOBJ);
+    LOCK(cs_rpcStats);
+    for (std::map<std::string, CRPCMethodStats>::const_iterator it = mapRPCStats.begin(); it != mapRPCStats.end(); ++it)
+    {
+        const CRPCMethodStats& stats = it->second;
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("calls", (uint64_t)stats.nCalls));
+        obj.push_back(Pair("errors", (uint64_t)stats.nErrors));
+        obj.push_back(Pair("avg_ms", stats.nCalls ? stats.nTotalMicros / 1000.0 / stats.nCalls : 0.0));
+        obj.push_back(Pair("max_ms", stats.nMaxMicros / 1000.0));
+        UniValue latency(UniValue::VOBJ);
+        for (int i = 0; i < RPC_LATENCY_BUCKETS; i++)
+            latency.push_back(Pair(vBucketNames[i], (uint64_t)stats.vBuckets[i]));
+        obj.push_back(Pair("latency", latency));
+        ret.push_back(Pair(it->first, obj));
+    }
+    return ret;
+}
+
 /**
  * Call Table
  */
 static const CRPCCommand vRPCCommands[] =
-{ //  category              name                      actor (function)         okSafeMode
-  //  --------------------- ------------------------  -----------------------  ----------
+{ //  category              name                      actor (function)         okSafeMode threadSafe streamActor
+  //  --------------------- ------------------------  -----------------------  ---------- ---------- -----------
     /* Overall control/query calls */
     { "control",            "getinfo",                &getinfo,                true  }, /* uses wallet if enabled */
     { "control",            "debug",                  &debug,                  true  },
+    { "control",            "getrpcstats",            &getrpcstats,            true,  true  },
+    { "control",            "getperfstats",           &getperfstats,           true,  true  },
     { "control",            "help",                   &help,                   true  },
     { "control",            "stop",                   &stop,                   true  },
 
@@ -277,23 +382,24 @@ static const CRPCCommand vRPCCommands[] =
 
     /* Block chain and UTXO */
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
-    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
-    { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
-    { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
-    { "blockchain",         "getblockhash",           &getblockhash,           true  },
-    { "blockchain",         "getblockheader",         &getblockheader,         true  },
-    { "blockchain",         "getblockheaders",        &getblockheaders,        true  },
+    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  true  },
+    { "blockchain",         "getblockcount",          &getblockcount,          true,  true  },
+    { "blockchain",         "getblock",               &getblock,               true,  true,  &getblock_stream },
+    { "blockchain",         "getblockhashes",         &getblockhashes,         true,  true  },
+    { "blockchain",         "getblockhash",           &getblockhash,           true,  true  },
+    { "blockchain",         "getblockheader",         &getblockheader,         true,  true  },
+    { "blockchain",         "getblockheaders",        &getblockheaders,        true,  true  },
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
-    { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
+    { "blockchain",         "getdifficulty",          &getdifficulty,          true,  true  },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
-    { "blockchain",         "gettxout",               &gettxout,               true  },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          true,  false, &getrawmempool_stream },
+    { "blockchain",         "gettxout",               &gettxout,               true,  true  },
     { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
     { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "getdbstats",             &getdbstats,             true,  true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
-    { "blockchain",         "getspentinfo",           &getspentinfo,           false },
+    { "blockchain",         "getspentinfo",           &getspentinfo,           false, true  },
 
     /* Mining */
     { "mining",             "getblocktemplate",       &getblocktemplate,       true  },
@@ -309,9 +415,9 @@ static const CRPCCommand vRPCCommands[] =
 
     /* Raw transactions */
     { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true  },
-    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true  },
-    { "rawtransactions",    "decodescript",           &decodescript,           true  },
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true  },
+    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true,  true  },
+    { "rawtransactions",    "decodescript",           &decodescript,           true,  true  },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true,  true  },
     { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false },
     { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false }, /* uses wallet if enabled */
 #ifdef ENABLE_WALLET
@@ -319,16 +425,16 @@ static const CRPCCommand vRPCCommands[] =
 #endif
 
     /* Address index */
-    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true  },
-    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false },
-    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false },
-    { "addressindex",       "getaddresstxids",        &getaddresstxids,        false },
-    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false },
+    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true,  true  },
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false, true  },
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false, true  },
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        false, true  },
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false, true  },
 
     /* Utility functions */
     { "util",               "createmultisig",         &createmultisig,         true  },
-    { "util",               "validateaddress",        &validateaddress,        true  }, /* uses wallet if enabled */
-    { "util",               "verifymessage",          &verifymessage,          true  },
+    { "util",               "validateaddress",        &validateaddress,        true,  true  }, /* uses wallet if enabled */
+    { "util",               "verifymessage",          &verifymessage,          true,  true  },
     { "util",               "estimatefee",            &estimatefee,            true  },
     { "util",               "estimatepriority",       &estimatepriority,       true  },
     { "util",               "estimatesmartfee",       &estimatesmartfee,       true  },
@@ -354,7 +460,7 @@ static const CRPCCommand vRPCCommands[] =
     { "biblepay",               "spork",                  &spork,                  true  },
     { "biblepay",               "getpoolinfo",            &getpoolinfo,            true  },
 	{ "biblepay",               "exec",                   &exec,                   true  },
-	{ "biblepay",               "showblock",              &showblock,              true  },
+	{ "biblepay",               "showblock",              &showblock,              true,  true  },
 #ifdef ENABLE_WALLET
     { "biblepay",               "privatesend",            &privatesend,            false },
 
@@ -377,6 +483,7 @@ static const CRPCCommand vRPCCommands[] =
     { "wallet",             "gettransaction",         &gettransaction,         false },
     { "wallet",             "abandontransaction",     &abandontransaction,     false },
     { "wallet",             "getunconfirmedbalance",  &getunconfirmedbalance,  false },
+    { "wallet",             "verifywalletbalances",   &verifywalletbalances,   false },
     { "wallet",             "getwalletinfo",          &getwalletinfo,          false },
     { "wallet",             "importprivkey",          &importprivkey,          true  },
     { "wallet",             "importwallet",           &importwallet,           true  },
@@ -390,7 +497,7 @@ static const CRPCCommand vRPCCommands[] =
     { "wallet",             "listreceivedbyaccount",  &listreceivedbyaccount,  false },
     { "wallet",             "listreceivedbyaddress",  &listreceivedbyaddress,  false },
     { "wallet",             "listsinceblock",         &listsinceblock,         false },
-    { "wallet",             "listtransactions",       &listtransactions,       false },
+    { "wallet",             "listtransactions",       &listtransactions,       false, false, &listtransactions_stream },
     { "wallet",             "listunspent",            &listunspent,            false },
     { "wallet",             "lockunspent",            &lockunspent,            true  },
     { "wallet",             "move",                   &movecmd,                false },
@@ -528,11 +635,78 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
+static bool IsThreadSafeRequest(const UniValue& req)
+{
+    if (!req.isObject())
+        return false;
+    const UniValue& valMethod = find_value(req, "method");
+    if (!valMethod.isStr())
+        return false;
+    const CRPCCommand *pcmd = tableRPC[valMethod.get_str()];
+    return pcmd && pcmd->threadSafe;
+}
+
+/** A run of thread safe batch elements, handed out one element at a time */
+struct CRPCBatchRun
+{
+    const UniValue* pvReq;
+    std::vector<UniValue>* pvRet;
+    CCriticalSection cs;
+    unsigned int nNext;
+    unsigned int nEnd;
+};
+
+static void JSONRPCExecBatchRun(CRPCBatchRun* prun)
+{
+    while (true)
+    {
+        unsigned int reqIdx;
+        {
+            LOCK(prun->cs);
+            if (prun->nNext >= prun->nEnd)
+                return;
+            reqIdx = prun->nNext++;
+        }
+        (*prun->pvRet)[reqIdx] = JSONRPCExecOne((*prun->pvReq)[reqIdx]);
+    }
+}
+
 std::string JSONRPCExecBatch(const UniValue& vReq)
 {
+    std::vector<UniValue> vRet(vReq.size());
+    unsigned int nThreads = std::max((int)GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS), 1);
+    unsigned int reqIdx = 0;
+    while (reqIdx < vReq.size())
+    {
+        // Consecutive thread safe elements run in parallel; anything else runs
+        // alone, so the batch still observes the effects of earlier elements
+        unsigned int nEnd = reqIdx;
+        while (nEnd < vReq.size() && IsThreadSafeRequest(vReq[nEnd]))
+            nEnd++;
+        if (nEnd - reqIdx < 2 || nThreads < 2)
+        {
+            nEnd = std::max(nEnd, reqIdx + 1);
+            for (; reqIdx < nEnd; reqIdx++)
+                vRet[reqIdx] = JSONRPCExecOne(vReq[reqIdx]);
+            continue;
+        }
+
+        CRPCBatchRun run;
+        run.pvReq = &vReq;
+        run.pvRet = &vRet;
+        run.nNext = reqIdx;
+        run.nEnd = nEnd;
+        boost::thread_group threadGroup;
+        for (unsigned int i = 1; i < std::min(nThreads, nEnd - reqIdx); i++)
+            threadGroup.create_thread(boost::bind(&JSONRPCExecBatchRun, &run));
+        JSONRPCExecBatchRun(&run);
+        threadGroup.join_all();
+        reqIdx = nEnd;
+    }
+
     UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    for (reqIdx = 0; reqIdx < vRet.size(); reqIdx++)
+        ret.push_back(vRet[reqIdx]);
 
     return ret.write() + "\n";
 }
@@ -553,19 +727,68 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
 
     g_rpcSignals.PreCommand(*pcmd);
 
+    // Long running exec subcommands get their own latency entry
+    std::string strStatsName = strMethod;
+    if (IsLongRunningRPC(strMethod, params))
+        strStatsName += " " + params[0].get_str();
+
+    int64_t nStart = GetTimeMicros();
     try
     {
         // Execute
-        return pcmd->actor(params, false);
+        UniValue result = pcmd->actor(params, false);
+        RecordRPCStats(strStatsName, GetTimeMicros() - nStart, false);
+        return result;
+    }
+    catch (const UniValue& objError)
+    {
+        RecordRPCStats(strStatsName, GetTimeMicros() - nStart, true);
+        throw;
     }
     catch (const std::exception& e)
     {
+        RecordRPCStats(strStatsName, GetTimeMicros() - nStart, true);
         throw JSONRPCError(RPC_MISC_ERROR, e.what());
     }
 
     g_rpcSignals.PostCommand(*pcmd);
 }
 
+bool CRPCTable::executeStream(const std::string &strMethod, const UniValue &params, CJSONStreamWriter& writer) const
+{
+    const CRPCCommand *pcmd = tableRPC[strMethod];
+    if (!pcmd || !pcmd->streamActor)
+        return false;
+
+    // Return immediately if in warmup
+    {
+        LOCK(cs_rpcWarmup);
+        if (fRPCInWarmup)
+            throw JSONRPCError(RPC_IN_WARMUP, rpcWarmupStatus);
+    }
+
+    g_rpcSignals.PreCommand(*pcmd);
+
+    int64_t nStart = GetTimeMicros();
+    try
+    {
+        // Execute
+        pcmd->streamActor(params, writer);
+        RecordRPCStats(strMethod, GetTimeMicros() - nStart, false);
+        return true;
+    }
+    catch (const UniValue& objError)
+    {
+        RecordRPCStats(strMethod, GetTimeMicros() - nStart, true);
+        throw;
+    }
+    catch (const std::exception& e)
+    {
+        RecordRPCStats(strMethod, GetTimeMicros() - nStart, true);
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+}
+
 std::vector<std::string> CRPCTable::listCommands() const
 {
     std::vector<std::string> commandList;
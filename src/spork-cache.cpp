@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "spork-cache.h"
+
+#include "podc.h"
+#include "util.h"
+
+#include <boost/algorithm/string/case_conv.hpp>
+
+void CSporkValueCache::Set(const std::string& sKey, const std::string& sValue)
+{
+    Slot slot;
+    slot.sValue = sValue;
+    try
+    {
+        slot.dValue = cdbl(sValue, 2);
+    }
+    catch(...)
+    {
+        // cdbl keeps digits, '.' and '-' only; a value such as "1.2.3" cannot be cast
+        slot.dValue = 0;
+    }
+    if (!sValue.empty()) slot.vList = Split(sValue.c_str(), ";");
+
+    {
+        LOCK(cs);
+        Slot& existing = mapSlots[sKey];
+        if (existing.sValue == sValue) return;
+        existing = slot;
+    }
+    LogPrint("spork", "CSporkValueCache::Set -- %s=%s\n", sKey, sValue);
+    NotifySporkChanged(sKey, sValue);
+}
+
+const CSporkValueCache::Slot* CSporkValueCache::Resolve(const std::string& sKey)
+{
+    std::string sUpperKey = sKey;
+    boost::to_upper(sUpperKey);
+    LOCK(cs);
+    // std::map never moves its elements, so the address stays valid
+    return &mapSlots[sUpperKey];
+}
+
+std::string CSporkValueCache::GetString(const Slot* pslot) const
+{
+    LOCK(cs);
+    return pslot->sValue;
+}
+
+double CSporkValueCache::GetDouble(const Slot* pslot, double nDefault) const
+{
+    LOCK(cs);
+    return pslot->dValue == 0 ? nDefault : pslot->dValue;
+}
+
+std::vector<std::string> CSporkValueCache::GetList(const Slot* pslot) const
+{
+    LOCK(cs);
+    return pslot->vList;
+}
+
+CSporkValueCache& GetSporkValueCache()
+{
+    // function level static so handles declared at namespace scope in other files can resolve safely
+    static CSporkValueCache sporkValueCache;
+    return sporkValueCache;
+}
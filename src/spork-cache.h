@@ -0,0 +1,71 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SPORK_CACHE_H
+#define SPORK_CACHE_H
+
+#include "sync.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/signals2/signal.hpp>
+
+/**
+ * Typed view of the signed SPORK messages memorized from the chain.
+ *
+ * The application cache stores sporks as raw strings under "SPORK;<KEY>", so
+ * every read used to upper case the key, build the cache key and run cdbl on
+ * the value.  Here a spork is parsed once, when it is memorized, into a slot
+ * holding its string, numeric and ';' separated list forms.  Slots are never
+ * removed, so a CSporkHandle can resolve its slot once and read it afterwards
+ * without any string work.
+ */
+class CSporkValueCache
+{
+public:
+    struct Slot
+    {
+        std::string sValue;
+        double dValue;                     // cdbl(sValue, 2), 0 if it does not parse
+        std::vector<std::string> vList;    // sValue split on ';'
+        Slot() : dValue(0) {}
+    };
+
+    /** Called with the spork key and its new value after a spork changed */
+    boost::signals2::signal<void (const std::string& sKey, const std::string& sValue)> NotifySporkChanged;
+
+    /** Store a memorized spork; sKey is the key exactly as it is stored in the application cache */
+    void Set(const std::string& sKey, const std::string& sValue);
+    /** Slot for a spork key (upper cased), created empty if the spork has not been seen yet */
+    const Slot* Resolve(const std::string& sKey);
+
+    std::string GetString(const Slot* pslot) const;
+    /** Same semantics as GetSporkDouble: nDefault when the spork is missing or zero */
+    double GetDouble(const Slot* pslot, double nDefault) const;
+    std::vector<std::string> GetList(const Slot* pslot) const;
+
+private:
+    mutable CCriticalSection cs;
+    std::map<std::string, Slot> mapSlots;
+};
+
+CSporkValueCache& GetSporkValueCache();
+
+/** Pre-resolved spork for hot paths, usually declared as a function level static */
+class CSporkHandle
+{
+public:
+    explicit CSporkHandle(const std::string& sKey) : pslot(GetSporkValueCache().Resolve(sKey)) {}
+
+    std::string GetString() const { return GetSporkValueCache().GetString(pslot); }
+    double GetDouble(double nDefault) const { return GetSporkValueCache().GetDouble(pslot, nDefault); }
+    std::vector<std::string> GetList() const { return GetSporkValueCache().GetList(pslot); }
+
+private:
+    const CSporkValueCache::Slot* pslot;
+};
+
+#endif // SPORK_CACHE_H
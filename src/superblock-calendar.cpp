@@ -0,0 +1,169 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "superblock-calendar.h"
+
+#include "chainparams.h"
+#include "main.h"
+#include "sync.h"
+
+#include <algorithm>
+#include <map>
+
+void CSuperblockCalendar::AddSegment(int nStartHeight, int nCycle, int nOffset)
+{
+    assert(nStartHeight >= 0);
+    assert(vSegments.empty() || nStartHeight > vSegments.back().nStartHeight);
+    assert(nCycle >= 0);
+    assert(nCycle == 0 || (nOffset >= 0 && nOffset < nCycle));
+
+    Segment seg;
+    seg.nStartHeight = nStartHeight;
+    seg.nCycle = nCycle;
+    seg.nOffset = nCycle == 0 ? 0 : nOffset;
+    seg.nFirst = seg.nLast = seg.nLastBefore = seg.nFirstFrom = 0;
+    vSegments.push_back(seg);
+    Recalculate();
+}
+
+int CSuperblockCalendar::FirstAtOrAfter(const Segment& seg, int nHeight) const
+{
+    return nHeight + (seg.nOffset - nHeight % seg.nCycle + seg.nCycle) % seg.nCycle;
+}
+
+int CSuperblockCalendar::LastAtOrBefore(const Segment& seg, int nHeight) const
+{
+    return nHeight - (nHeight % seg.nCycle - seg.nOffset + seg.nCycle) % seg.nCycle;
+}
+
+void CSuperblockCalendar::Recalculate()
+{
+    int nSegments = (int)vSegments.size();
+    for (int i = 0; i < nSegments; i++)
+    {
+        Segment& seg = vSegments[i];
+        bool fBounded = i + 1 < nSegments;
+        int nEnd = fBounded ? vSegments[i + 1].nStartHeight - 1 : 0;
+        seg.nFirst = 0;
+        seg.nLast = 0;
+        if (seg.nCycle > 0)
+        {
+            seg.nFirst = FirstAtOrAfter(seg, seg.nStartHeight);
+            if (fBounded && seg.nFirst > nEnd) seg.nFirst = 0;
+            if (fBounded && seg.nFirst > 0) seg.nLast = LastAtOrBefore(seg, nEnd);
+        }
+        seg.nLastBefore = i == 0 ? 0 : (vSegments[i - 1].nLast > 0 ? vSegments[i - 1].nLast : vSegments[i - 1].nLastBefore);
+    }
+    for (int i = nSegments - 1; i >= 0; i--)
+    {
+        Segment& seg = vSegments[i];
+        seg.nFirstFrom = seg.nFirst > 0 ? seg.nFirst : (i + 1 < nSegments ? vSegments[i + 1].nFirstFrom : 0);
+    }
+}
+
+int CSuperblockCalendar::FindSegment(int nHeight) const
+{
+    int nLow = 0;
+    int nHigh = (int)vSegments.size();
+    // First segment starting above nHeight; the one before it contains nHeight
+    while (nLow < nHigh)
+    {
+        int nMid = (nLow + nHigh) / 2;
+        if (vSegments[nMid].nStartHeight <= nHeight)
+            nLow = nMid + 1;
+        else
+            nHigh = nMid;
+    }
+    return nLow - 1;
+}
+
+bool CSuperblockCalendar::IsSuperblock(int nHeight) const
+{
+    int i = FindSegment(nHeight);
+    if (i < 0) return false;
+    const Segment& seg = vSegments[i];
+    return seg.nCycle > 0 && (nHeight % seg.nCycle) == seg.nOffset;
+}
+
+int CSuperblockCalendar::GetPrevious(int nHeight) const
+{
+    int i = FindSegment(nHeight);
+    if (i < 0) return 0;
+    const Segment& seg = vSegments[i];
+    if (seg.nCycle > 0)
+    {
+        int nCandidate = LastAtOrBefore(seg, nHeight);
+        if (nCandidate >= seg.nStartHeight) return nCandidate;
+    }
+    return seg.nLastBefore;
+}
+
+int CSuperblockCalendar::GetNext(int nHeight) const
+{
+    if (vSegments.empty()) return 0;
+    int i = FindSegment(nHeight + 1);
+    if (i < 0) return vSegments[0].nFirstFrom;
+    const Segment& seg = vSegments[i];
+    bool fBounded = i + 1 < (int)vSegments.size();
+    if (seg.nCycle > 0)
+    {
+        int nCandidate = FirstAtOrAfter(seg, nHeight + 1);
+        if (!fBounded || nCandidate < vSegments[i + 1].nStartHeight) return nCandidate;
+    }
+    return fBounded ? vSegments[i + 1].nFirstFrom : 0;
+}
+
+CSuperblockCalendar CSuperblockCalendar::BuildDCC(const Consensus::Params& params, bool fProdChain, bool fEnabled)
+{
+    CSuperblockCalendar calendar;
+    if (!fEnabled) return calendar;
+
+    int nStart = params.nDCCSuperblockStartBlock;
+    int nCycle = params.nDCCSuperblockCycle;
+    int nCutover = fProdChain ? F13000_CUTOVER_HEIGHT_PROD : F13000_CUTOVER_HEIGHT_TESTNET;
+    // Cascading superblocks: up to the F13000 cutover DC superblocks land on multiples of the cycle,
+    // after it they land 10 blocks later so they no longer collide with governance superblocks
+    if (nStart <= nCutover)
+        calendar.AddSegment(nStart, nCycle, 0);
+    if (nCycle > 10)
+        calendar.AddSegment(std::max(nStart, nCutover + 1), nCycle, 10);
+    else
+        calendar.AddSegment(std::max(nStart, nCutover + 1), 0, 0);
+    return calendar;
+}
+
+CSuperblockCalendar CSuperblockCalendar::BuildGovernance(const Consensus::Params& params)
+{
+    CSuperblockCalendar calendar;
+    calendar.AddSegment(params.nSuperblockStartBlock, params.nSuperblockCycle, 0);
+    return calendar;
+}
+
+namespace {
+    // Calendars are never erased so references handed out remain valid if the chain params are switched (unit tests)
+    CCriticalSection cs_calendars;
+    std::map<std::pair<const Consensus::Params*, int>, CSuperblockCalendar> mapDCCCalendars;
+    std::map<const Consensus::Params*, CSuperblockCalendar> mapGovernanceCalendars;
+}
+
+const CSuperblockCalendar& GetDCCSuperblockCalendar()
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    std::pair<const Consensus::Params*, int> key(&params, (fProd ? 1 : 0) | (fDistributedComputingEnabled ? 2 : 0));
+    LOCK(cs_calendars);
+    std::map<std::pair<const Consensus::Params*, int>, CSuperblockCalendar>::iterator it = mapDCCCalendars.find(key);
+    if (it == mapDCCCalendars.end())
+        it = mapDCCCalendars.insert(std::make_pair(key, CSuperblockCalendar::BuildDCC(params, fProd, fDistributedComputingEnabled))).first;
+    return it->second;
+}
+
+const CSuperblockCalendar& GetGovernanceSuperblockCalendar()
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    LOCK(cs_calendars);
+    std::map<const Consensus::Params*, CSuperblockCalendar>::iterator it = mapGovernanceCalendars.find(&params);
+    if (it == mapGovernanceCalendars.end())
+        it = mapGovernanceCalendars.insert(std::make_pair(&params, CSuperblockCalendar::BuildGovernance(params))).first;
+    return it->second;
+}
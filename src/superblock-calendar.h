@@ -0,0 +1,72 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SUPERBLOCK_CALENDAR_H
+#define SUPERBLOCK_CALENDAR_H
+
+#include <vector>
+
+namespace Consensus { struct Params; }
+
+/**
+ * Superblock schedule built from consensus parameters and cutover heights.
+ *
+ * The schedule is a sorted list of segments; each segment starts at a height
+ * and places a superblock on every height where (nHeight % nCycle) == nOffset
+ * until the next segment begins.  Lookups are a binary search over the
+ * segments, so answering is/previous/next does not depend on the cycle length
+ * or on how far away the neighbouring superblock is.
+ */
+class CSuperblockCalendar
+{
+public:
+    struct Segment
+    {
+        int nStartHeight;
+        int nCycle;            // 0 when the segment holds no superblocks
+        int nOffset;
+        int nFirst;            // first superblock inside this segment, or 0
+        int nLast;             // last superblock inside this segment, or 0 (also 0 for the open-ended last segment)
+        int nLastBefore;       // last superblock in any earlier segment, or 0
+        int nFirstFrom;        // first superblock in this or any later segment, or 0
+    };
+
+    CSuperblockCalendar() {}
+
+    /** Append a segment; segments must be added in strictly increasing start height order */
+    void AddSegment(int nStartHeight, int nCycle, int nOffset);
+
+    bool IsSuperblock(int nHeight) const;
+    /** Highest superblock height <= nHeight, or 0 if there is none */
+    int GetPrevious(int nHeight) const;
+    /** Lowest superblock height > nHeight, or 0 if there is none */
+    int GetNext(int nHeight) const;
+
+    bool IsEmpty() const { return vSegments.empty(); }
+    const std::vector<Segment>& GetSegments() const { return vSegments; }
+
+    /** Daily distributed computing superblocks, including the F13000 modulo change */
+    static CSuperblockCalendar BuildDCC(const Consensus::Params& params, bool fProdChain, bool fEnabled);
+    /** Governance (budget) superblocks */
+    static CSuperblockCalendar BuildGovernance(const Consensus::Params& params);
+
+private:
+    std::vector<Segment> vSegments;
+
+    /** Index of the segment containing nHeight, or -1 if nHeight precedes the calendar */
+    int FindSegment(int nHeight) const;
+    int FirstAtOrAfter(const Segment& seg, int nHeight) const;
+    int LastAtOrBefore(const Segment& seg, int nHeight) const;
+    void Recalculate();
+};
+
+/**
+ * Calendars for the currently selected chain parameters.  They are built once
+ * per (params, fProd, fDistributedComputingEnabled) combination and the returned
+ * references stay valid for the life of the process.
+ */
+const CSuperblockCalendar& GetDCCSuperblockCalendar();
+const CSuperblockCalendar& GetGovernanceSuperblockCalendar();
+
+#endif // SUPERBLOCK_CALENDAR_H
@@ -0,0 +1,72 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "main.h"
+#include "txdb.h"
+
+#include "test/test_biblepay.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(addressindex_tests, BasicTestingSetup)
+
+static std::pair<CAddressIndexKey, CAmount> IndexEntry(const uint160& hashBytes, int nHeight, int n, CAmount nValue)
+{
+    uint256 txid = ArithToUint256(arith_uint256(nHeight * 100 + n + 1));
+    return std::make_pair(CAddressIndexKey(1, hashBytes, nHeight, 0, txid, n, nValue < 0), nValue);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_balances_and_paging)
+{
+    CBlockTreeDB db(1 << 20, true, true);
+    uint160 hashAddress = uint160(std::vector<unsigned char>(20, 1));
+    uint160 hashOther = uint160(std::vector<unsigned char>(20, 2));
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > block1, block2;
+    block1.push_back(IndexEntry(hashAddress, 1, 0, 5000));
+    block1.push_back(IndexEntry(hashAddress, 1, 1, 3000));
+    block1.push_back(IndexEntry(hashOther, 1, 2, 700));
+    block2.push_back(IndexEntry(hashAddress, 2, 0, -5000));
+    block2.push_back(IndexEntry(hashAddress, 2, 1, 1000));
+    BOOST_CHECK(db.WriteAddressIndex(block1));
+    BOOST_CHECK(db.WriteAddressIndex(block2));
+    // Replaying a block after an unclean shutdown must not count it twice
+    BOOST_CHECK(db.WriteAddressIndex(block2));
+
+    CAddressBalanceValue balance;
+    BOOST_CHECK(db.ReadAddressBalance(hashAddress, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 4000);
+    BOOST_CHECK_EQUAL(balance.received, 9000);
+    BOOST_CHECK_EQUAL(balance.deltas, 4);
+
+    // Pages of two entries walk the address in index order and stop at its last entry
+    std::vector<std::pair<CAddressIndexKey, CAmount> > page;
+    CAddressIndexKey next;
+    BOOST_CHECK(db.ReadAddressIndexPage(hashAddress, 1, 0, 0, NULL, 2, page, next));
+    BOOST_CHECK_EQUAL(page.size(), 2);
+    BOOST_CHECK_EQUAL(next.blockHeight, 2);
+    CAddressIndexKey cursor = next;
+    BOOST_CHECK(db.ReadAddressIndexPage(hashAddress, 1, 0, 0, &cursor, 2, page, next));
+    BOOST_CHECK_EQUAL(page.size(), 4);
+    BOOST_CHECK_EQUAL(page[3].second, 1000);
+    BOOST_CHECK(next.hashBytes.IsNull());
+
+    BOOST_CHECK(db.EraseAddressIndex(block2));
+    BOOST_CHECK(db.ReadAddressBalance(hashAddress, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 8000);
+    BOOST_CHECK_EQUAL(balance.received, 8000);
+    BOOST_CHECK_EQUAL(balance.deltas, 2);
+
+    // Rebuilding from the entries gives the same totals
+    BOOST_CHECK(db.RebuildAddressBalances());
+    CAddressBalanceValue other;
+    BOOST_CHECK(db.ReadAddressBalance(hashAddress, 1, balance));
+    BOOST_CHECK(db.ReadAddressBalance(hashOther, 1, other));
+    BOOST_CHECK_EQUAL(balance.balance, 8000);
+    BOOST_CHECK_EQUAL(other.balance, 700);
+    BOOST_CHECK_EQUAL(other.deltas, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "dbwrapper.h"
+#include "main.h"
+#include "txdb.h"
 #include "uint256.h"
 #include "random.h"
 #include "test/test_biblepay.h"
@@ -324,4 +326,67 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
 
 
 
+BOOST_AUTO_TEST_CASE(dbwrapper_profiles_and_stats)
+{
+    mapMultiArgs["-dbtune"].push_back("unittest:bloombits=0");
+    mapMultiArgs["-dbtune"].push_back("unittest:blocksize=32768");
+    mapMultiArgs["-dbtune"].push_back("chainstate:bloombits=20");
+    mapMultiArgs["-dbtune"].push_back("unittest:nosuchsetting=1");
+
+    path ph = temp_directory_path() / unique_path();
+    {
+        CDBWrapper dbw(ph, (1 << 20), true, false, false, CDBProfile("unittest", 4096, true, 10, 64, 25));
+        BOOST_CHECK(dbw.Write(std::make_pair('x', 1), GetRandHash()));
+
+        std::vector<CDBStats> vStats = GetDBStats();
+        bool fFound = false;
+        BOOST_FOREACH(const CDBStats& stats, vStats) {
+            if (stats.profile.strName != "unittest")
+                continue;
+            fFound = true;
+            // Only the overrides naming this profile apply
+            BOOST_CHECK_EQUAL(stats.profile.nBloomBits, 0);
+            BOOST_CHECK_EQUAL(stats.profile.nBlockSize, 32768);
+            BOOST_CHECK(stats.profile.fCompression);
+            BOOST_CHECK_EQUAL(stats.nCacheSize, (1 << 20));
+            BOOST_CHECK(!stats.strLevelDBStats.empty());
+        }
+        BOOST_CHECK(fFound);
+    }
+
+    // Closed databases are no longer reported
+    std::vector<CDBStats> vStats = GetDBStats();
+    BOOST_FOREACH(const CDBStats& stats, vStats) {
+        BOOST_CHECK(stats.profile.strName != "unittest");
+    }
+    mapMultiArgs.erase("-dbtune");
+}
+
+static uint64_t GetLastSync(const std::string& strProfile)
+{
+    uint64_t nLastSync = 0;
+    std::vector<CDBStats> vStats = GetDBStats();
+    BOOST_FOREACH(const CDBStats& stats, vStats) {
+        if (stats.profile.strName == strProfile)
+            nLastSync = std::max(nLastSync, stats.nLastSync);
+    }
+    return nLastSync;
+}
+
+BOOST_FIXTURE_TEST_CASE(blocktree_syncs_index_db_first, TestingSetup)
+{
+    CBlockTreeDB blocktree(1 << 20, true, false, 1 << 20);
+    BOOST_CHECK(blocktree.HasSeparateIndexDB());
+    std::vector<std::pair<uint256, CDiskTxPos> > vPos;
+    vPos.push_back(std::make_pair(GetRandHash(), CDiskTxPos(CDiskBlockPos(0, 8), 80)));
+    BOOST_CHECK(blocktree.WriteTxIndex(vPos));
+    uint64_t nBefore = std::max(GetLastSync("blockindex"), GetLastSync("indexes"));
+
+    // The unsynced index entries are made durable before the block index names their blocks
+    BOOST_CHECK(blocktree.WriteBatchSync(std::vector<std::pair<int, const CBlockFileInfo*> >(), 0, std::vector<const CBlockIndex*>()));
+    uint64_t nIndexes = GetLastSync("indexes");
+    BOOST_CHECK(nIndexes > nBefore);
+    BOOST_CHECK(GetLastSync("blockindex") > nIndexes);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
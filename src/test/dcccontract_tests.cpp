@@ -0,0 +1,346 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "dcccontract.h"
+
+#include "hash.h"
+#include "podc.h"
+#include "random.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+
+#include "test/httpstandin.h"
+#include "test/test_biblepay.h"
+
+#include <fstream>
+#include <stdio.h>
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+static const double DCC_TEST_TEAM = 15044;
+static const double DCC_TEST_TEAM2 = 30191;
+static const double DCC_TEST_BLACKLISTED = 666;
+
+static std::string GetTestCPID(int i)
+{
+    return strprintf("%032x", i * 7919 + 17);
+}
+
+/** Run a user export through the researcher filter, as the download streams do */
+static std::vector<CDCCResearcherFilter::Record> FilterExport(int nUsers, int nProject, const std::set<std::string>& setCPIDs)
+{
+    CDCCResearcherFilter filter(setCPIDs);
+    filter.ProcessLine("<users>");
+    for (int i = 0; i < nUsers; i++) {
+        // Users of the first project appear once more with a second host, so some CPIDs have two records
+        int nUser = i % (nUsers - nUsers / 10);
+        // Some researchers are in only one of the projects
+        if (nUser % (nProject == 1 ? 7 : 5) == 4) continue;
+        double dTeam = nUser % 4 == 0 ? 0 : (nUser % 4 == 1 ? (nProject == 1 ? DCC_TEST_TEAM : DCC_TEST_TEAM2) : (nUser % 4 == 2 ? 12 : DCC_TEST_BLACKLISTED));
+        filter.ProcessLine("<user>");
+        filter.ProcessLine(" <id>" + itostr(i) + "</id>");
+        filter.ProcessLine(" <name>user " + itostr(i) + "</name>");
+        filter.ProcessLine(" <total_credit>" + itostr(i * 10) + "</total_credit>");
+        filter.ProcessLine(strprintf(" <expavg_credit>%d.%06d</expavg_credit>", (nUser * 37 + nProject) % 5000, (nUser * 104729) % 1000000));
+        filter.ProcessLine(" <expavg_time>1530000000.1</expavg_time>");
+        // Project exports carry the CPID in either case
+        std::string sCPID = GetTestCPID(nUser);
+        if (nUser % 2) boost::to_upper(sCPID);
+        filter.ProcessLine(" <cpid>" + sCPID + "</cpid>");
+        filter.ProcessLine(" <url>http://example.com/" + itostr(i) + "</url>");
+        filter.ProcessLine(" <teamid>" + RoundToString(dTeam, 0) + "</teamid>");
+        filter.ProcessLine("</user>");
+    }
+    filter.ProcessLine("</users>");
+    filter.Finish();
+    return filter.vRecords;
+}
+
+static CDCCContractInput MakeInput(int nResearchers, int nUsers)
+{
+    CDCCContractInput input;
+    input.params.nHeight = 33440;
+    input.params.dReqSPM = 500;
+    input.params.dTeamRequired = DCC_TEST_TEAM;
+    input.params.dTeamBackupProject = DCC_TEST_TEAM2;
+    input.params.dBackupProjectFactor = 0.65;
+    input.params.dNonBiblepayTeamPercentage = 0.30;
+    input.params.sTeamBlacklist = RoundToString(DCC_TEST_BLACKLISTED, 0) + ";1";
+    std::set<std::string> setCPIDs;
+    for (int i = 0; i < nResearchers; i++) {
+        std::string sCPID = GetTestCPID(i);
+        boost::to_upper(sCPID);
+        setCPIDs.insert(sCPID);
+        CDCCResearcherWeights& weights = input.mapWeights[sCPID];
+        weights.dUTXOWeight = (i % 9) * 1250.5;
+        weights.dTaskWeight = i % 6 == 0 ? 0 : 100 - (i % 3) * 12.5;
+        weights.dUnbanked = i % 11 == 0 ? 1 : 0;
+        if (i % 13 == 5) continue; // A DCC whose signature did not verify
+        if (i % 3 != 2) input.vEligibleCPIDs.push_back(GetTestCPID(i));
+        CDCCContractResearcher researcher;
+        researcher.sCPID = GetTestCPID(i);
+        researcher.sPublicKey = i % 17 == 3 ? "" : strprintf("B%033x", i);
+        researcher.dRosettaID = 1000 + i;
+        input.vResearchers.push_back(researcher);
+    }
+    input.vProject1 = FilterExport(nUsers, 1, setCPIDs);
+    input.vProject2 = FilterExport(nUsers / 2, 2, setCPIDs);
+    return input;
+}
+
+/**
+ * The contract as the quorum computed it before ComputeDCCContract: the
+ * records written to the filtered files, the files read back for the project
+ * totals, and read once more for every researcher.
+ */
+static bool LegacyFilterPhase1(const CDCCContractInput& input, const std::vector<CDCCResearcherFilter::Record>& vRecords, std::string sTargetPath)
+{
+    FILE *outFile = fopen(sTargetPath.c_str(), "w");
+    if (!outFile) return false;
+    std::string sOutData = "";
+    for (int i = 0; i < (int)vRecords.size(); i++)
+    {
+        std::string sCpid = vRecords[i].sCPID;
+        const CDCCResearcherWeights& weights = input.mapWeights.find(sCpid)->second;
+        std::string sExtra = "<utxoweight>" + RoundToString(weights.dUTXOWeight, 0)
+            + "</utxoweight>\r\n<taskweight>"
+            + RoundToString(weights.dTaskWeight, 0) + "</taskweight><unbanked>" + RoundToString(weights.dUnbanked, 0) + "</unbanked>\r\n";
+        std::string sData = FilterBoincData(vRecords[i].sBuffer, "<user>","</user>", sExtra);
+        sOutData += sData;
+    }
+    fputs(sOutData.c_str(), outFile);
+    fclose(outFile);
+    return true;
+}
+
+static double LegacyGetRACFromPODCProject(const CDCCContractInput& input, std::string sFileName, std::string sResearcherCPID, double dTeamRequired,
+    double dProjectFactor, double& out_Team)
+{
+    const CDCCContractParams& params = input.params;
+    std::ifstream streamFiltered;
+    streamFiltered.open(sFileName.c_str());
+    if (!streamFiltered) return 0;
+    std::string sUser = "";
+    std::string sKey = sResearcherCPID;
+    boost::to_upper(sKey);
+    const CDCCResearcherWeights& weights = input.mapWeights.find(sKey)->second;
+    double dTotalFound = 0;
+    boost::to_upper(sResearcherCPID);
+    std::string line = "";
+    while(std::getline(streamFiltered, line))
+    {
+        sUser += line;
+        if (Contains(line, "</user>"))
+        {
+            std::string sCPID = ExtractXML(sUser, "<cpid>", "</cpid>");
+            boost::to_upper(sCPID);
+            if (sCPID == sResearcherCPID)
+            {
+                double dAvgCredit = cdbl(ExtractXML(sUser, "<expavg_credit>", "</expavg_credit>"), 4);
+                double dTeam = cdbl(ExtractXML(sUser, "<teamid>", "</teamid>"), 0);
+                out_Team = dTeam;
+                double dPercent = GetTeamPercentage(dTeam, dTeamRequired, params.sTeamBlacklist, params.dNonBiblepayTeamPercentage);
+                double dModifiedCredit = GetResearcherCredit(3, dAvgCredit, weights.dUTXOWeight, weights.dTaskWeight, weights.dUnbanked, 0, params.dReqSPM, params.dReqSPR, params.dRACThreshhold, dPercent) * dProjectFactor;
+                dTotalFound += dModifiedCredit;
+            }
+            sUser = "";
+        }
+    }
+    return dTotalFound;
+}
+
+static double LegacyGetSumOfXMLColumnFromXMLFile(const CDCCContractInput& input, std::string sFileName, double dTeamRequired, std::string sConcatCPIDs)
+{
+    const CDCCContractParams& params = input.params;
+    std::ifstream streamIn;
+    streamIn.open(sFileName.c_str());
+    if (!streamIn) return 0;
+    double dTotal = 0;
+    std::string sLine = "";
+    std::string sBuffer = "";
+    while(std::getline(streamIn, sLine))
+    {
+        sBuffer += sLine;
+    }
+    std::vector<std::string> vRows = Split(sBuffer.c_str(), "<user>");
+    for (int i = 0; i < (int)vRows.size(); i++)
+    {
+        std::string sData = vRows[i];
+        double dTeam = cdbl(ExtractXML(sData,"<teamid>","</teamid>"), 0);
+        double dUTXOWeight = cdbl(ExtractXML(sData,"<utxoweight>","</utxoweight>"), 0);
+        double dTaskWeight = cdbl(ExtractXML(sData,"<taskweight>","</taskweight>"), 0);
+        double dUnbanked = cdbl(ExtractXML(sData,"<unbanked>","</unbanked>"), 0);
+        std::string sCPID = ExtractXML(sData,"<cpid>","</cpid>");
+        boost::to_upper(sCPID);
+        if (Contains(sConcatCPIDs, sCPID))
+        {
+            double dTeamPercentage = GetTeamPercentage(dTeam, dTeamRequired, params.sTeamBlacklist, params.dNonBiblepayTeamPercentage);
+            if (dTeamPercentage > 0)
+            {
+                double dAvgCredit = cdbl(ExtractXML(sData, "<expavg_credit>", "</expavg_credit>"), 2);
+                double dModifiedCredit = GetResearcherCredit(params.dDRMode, dAvgCredit, dUTXOWeight, dTaskWeight, dUnbanked, 0, params.dReqSPM, params.dReqSPR, params.dRACThreshhold, dTeamPercentage);
+                dTotal += dModifiedCredit;
+            }
+        }
+    }
+    return dTotal;
+}
+
+static std::string LegacyContract(const CDCCContractInput& input, int& iTries)
+{
+    const CDCCContractParams& params = input.params;
+    std::string sFiltered = GetTestPath("filtered1");
+    std::string sFiltered2 = GetTestPath("filtered2");
+    std::string sConcatCPIDs = "";
+    for (int i = 0; i < (int)input.vEligibleCPIDs.size(); i++) sConcatCPIDs += input.vEligibleCPIDs[i] + ",";
+    boost::to_upper(sConcatCPIDs);
+    LegacyFilterPhase1(input, input.vProject1, sFiltered);
+    LegacyFilterPhase1(input, input.vProject2, sFiltered2);
+    double dRAC1 = LegacyGetSumOfXMLColumnFromXMLFile(input, sFiltered, params.dTeamRequired, sConcatCPIDs);
+    double dRAC2 = LegacyGetSumOfXMLColumnFromXMLFile(input, sFiltered2, params.dTeamBackupProject, sConcatCPIDs);
+    double dTotalRAC = dRAC1 + dRAC2;
+    std::string sDCC = "";
+    iTries = 0;
+    if (dTotalRAC >= 10)
+    {
+        dTotalRAC += 100;
+        double dGlobalMagnitudeFactor = 1;
+        while(true)
+        {
+            iTries++;
+            if (iTries > 70) break;
+            sDCC = "";
+            double dTotalMagnitude = 0;
+            double doutWCGTeam = 0;
+            double doutRAHTeam = 0;
+            for (int i = 0; i < (int)input.vResearchers.size(); i++)
+            {
+                std::string sCPID = input.vResearchers[i].sCPID;
+                std::string sKey = sCPID;
+                boost::to_upper(sKey);
+                const CDCCResearcherWeights& weights = input.mapWeights.find(sKey)->second;
+                double dWCGRAC = 0;
+                if (params.dTeamBackupProject > 0)
+                    dWCGRAC = LegacyGetRACFromPODCProject(input, sFiltered2, sCPID, params.dTeamBackupProject, params.dBackupProjectFactor, doutWCGTeam);
+                double dRosettaRAC = LegacyGetRACFromPODCProject(input, sFiltered, sCPID, params.dTeamRequired, 1.0, doutRAHTeam);
+                double dModifiedCredit = GetResearcherCredit(params.dDRMode, dRosettaRAC + dWCGRAC, weights.dUTXOWeight, weights.dTaskWeight, weights.dUnbanked, dTotalRAC, params.dReqSPM, params.dReqSPR, params.dRACThreshhold, 1);
+                if (dModifiedCredit > 0 || (dRosettaRAC + dWCGRAC > 9))
+                {
+                    std::string BPK = input.vResearchers[i].sPublicKey;
+                    double dMagnitude = (dModifiedCredit / dTotalRAC) * 999 * dGlobalMagnitudeFactor;
+                    double dUTXO = GetUTXOLevel(weights.dUTXOWeight, dTotalRAC, dRosettaRAC + dWCGRAC, params.dReqSPM, params.dReqSPR, params.dRACThreshhold);
+                    if (!BPK.empty())
+                    {
+                        std::string sRow = BPK + "," + sCPID + "," + RoundToString(dMagnitude, 3) + ","
+                            + RoundToString(input.vResearchers[i].dRosettaID, 0) + "," + RoundToString(doutRAHTeam, 0)
+                            + "," + RoundToString(weights.dUTXOWeight, 0) + "," + RoundToString(weights.dTaskWeight, 0)
+                            + "," + RoundToString(dTotalRAC, 0) + ","
+                            + RoundToString(weights.dUnbanked, 0) + "," + RoundToString(dUTXO, 2) + "," + RoundToString(dRosettaRAC, 0) + ","
+                            + RoundToString(dModifiedCredit, 0) + "," + RoundToString(params.nHeight, 0) + ","
+                            + RoundToString(dWCGRAC, 0) + "," + RoundToString(doutWCGTeam, 0) + "\n<ROW>";
+                        sDCC += sRow;
+                        dTotalMagnitude += dMagnitude;
+                    }
+                }
+            }
+            if (dTotalMagnitude < 1000) break;
+            dGlobalMagnitudeFactor -= .02;
+        }
+    }
+    boost::filesystem::remove(sFiltered);
+    boost::filesystem::remove(sFiltered2);
+    return sDCC;
+}
+
+static void CheckSameAsLegacy(const CDCCContractInput& input)
+{
+    int nLegacyTries = 0;
+    std::string sLegacy = LegacyContract(input, nLegacyTries);
+    BOOST_REQUIRE(!sLegacy.empty());
+    uint256 hashLegacy = Hash(sLegacy.begin(), sLegacy.end());
+    int nThreads[] = {1, 3, 8};
+    for (int i = 0; i < 3; i++) {
+        CDCCContract contract;
+        BOOST_CHECK(ComputeDCCContract(input, contract, nThreads[i]));
+        BOOST_CHECK_EQUAL(Hash(contract.sContract.begin(), contract.sContract.end()).GetHex(), hashLegacy.GetHex());
+        BOOST_CHECK(contract.sContract == sLegacy);
+        BOOST_CHECK_EQUAL(contract.nTries, std::min(nLegacyTries, DCC_CONTRACT_MAX_TRIES));
+        double dTotalMagnitude = 0;
+        BOOST_CHECK_EQUAL(contract.nRows, GetCPIDCount(contract.sContract, dTotalMagnitude));
+    }
+}
+
+BOOST_FIXTURE_TEST_SUITE(dcccontract_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(dcccontract_matches_filtered_files)
+{
+    CDCCContractInput input = MakeInput(150, 1200);
+    BOOST_REQUIRE(input.vProject1.size() > 100);
+    BOOST_REQUIRE(input.vProject2.size() > 50);
+    CheckSameAsLegacy(input);
+
+    // Every DR mode, and stake-per-RAC with a RAC threshhold
+    for (int nMode = 0; nMode <= 3; nMode++) {
+        input.params.dDRMode = nMode;
+        CheckSameAsLegacy(input);
+    }
+    input.params.dDRMode = 0;
+    input.params.dReqSPM = 0;
+    input.params.dReqSPR = 25;
+    input.params.dRACThreshhold = 100;
+    CheckSameAsLegacy(input);
+
+    // Without a backup project team, the second project counts towards the total RAC only
+    input.params.dTeamBackupProject = 0;
+    CheckSameAsLegacy(input);
+}
+
+BOOST_AUTO_TEST_CASE(dcccontract_lowers_magnitudes)
+{
+    // The backup project weighs more in the magnitudes than in the total RAC, so the first attempts add up to over 1000
+    CDCCContractInput input = MakeInput(100, 800);
+    input.params.dDRMode = 3;
+    input.params.dBackupProjectFactor = 3;
+    CDCCContract contract;
+    BOOST_CHECK(ComputeDCCContract(input, contract, 4));
+    BOOST_CHECK(contract.nTries > 1);
+    BOOST_CHECK(contract.dTotalMagnitude < 1000);
+    BOOST_CHECK(contract.dGlobalMagnitudeFactor < 1);
+    CheckSameAsLegacy(input);
+
+    // No credit at all
+    input.vProject1.clear();
+    input.vProject2.clear();
+    BOOST_CHECK(!ComputeDCCContract(input, contract, 4));
+    BOOST_CHECK(!contract.sError.empty());
+    BOOST_CHECK(contract.sContract.empty());
+}
+
+BOOST_AUTO_TEST_CASE(dcccontract_replay)
+{
+    CDCCContractInput input = MakeInput(100, 800);
+    CDCCContract contract;
+    BOOST_REQUIRE(ComputeDCCContract(input, contract, 2));
+
+    std::string sPath = GetTestPath("dccinputs");
+    BOOST_REQUIRE(WriteDCCContractInput(sPath, input));
+    CDCCContractInput replayed;
+    std::string sError;
+    BOOST_REQUIRE(ReadDCCContractInput(sPath, replayed, sError));
+    CDCCContract contractReplayed;
+    BOOST_CHECK(ComputeDCCContract(replayed, contractReplayed, 5));
+    BOOST_CHECK(contractReplayed.sContract == contract.sContract);
+
+    // A truncated capture is refused rather than replayed short
+    boost::filesystem::resize_file(sPath, boost::filesystem::file_size(sPath) / 2);
+    BOOST_CHECK(!ReadDCCContractInput(sPath, replayed, sError));
+    BOOST_CHECK(!sError.empty());
+    boost::filesystem::remove(sPath);
+    BOOST_CHECK(!ReadDCCContractInput(sPath, replayed, sError));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
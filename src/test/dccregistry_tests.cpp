@@ -0,0 +1,166 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "dccregistry.h"
+
+#include "base58.h"
+#include "hash.h"
+#include "key.h"
+#include "main.h"
+#include "podc.h"
+#include "utilstrencodings.h"
+
+#include "test/test_biblepay.h"
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/test/unit_test.hpp>
+
+void WriteCache(std::string sSection, std::string sKey, std::string sValue, int64_t locktime, bool IgnoreCase=true);
+void ClearCache(std::string sSection);
+void DeleteCache(std::string section, std::string keyname);
+std::string GetDCCElement(std::string sData, int iElement, bool fCheckSignature);
+std::vector<std::string> GetListOfDCCS(std::string sSearch, bool fRequireSig);
+std::string GetCPIDByRosettaID(double dRosettaID);
+
+static std::string GetAddress(const CKey& key)
+{
+    return CBitcoinAddress(key.GetPubKey().GetID()).ToString();
+}
+
+/** A DCC as AdvertiseDistributedComputingKey sends it; fGoodSig false signs a different message */
+static std::string MakeDCC(const CKey& key, const std::string& sCPID, int nUserId, bool fGoodSig, const std::string& sUnbanked)
+{
+    std::string sMessage = sCPID + ";" + HexStr(sCPID.begin(), sCPID.end()).substr(0, 16) + ";" + GetAddress(key) + ";" + itostr(nUserId);
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << strMessageMagic;
+    ss << (fGoodSig ? sMessage : sMessage + "1");
+    std::vector<unsigned char> vchSig;
+    key.SignCompact(ss.GetHash(), vchSig);
+    std::string sDCC = sMessage + ";" + EncodeBase64(&vchSig[0], vchSig.size());
+    if (!sUnbanked.empty()) sDCC += ";" + sUnbanked;
+    return sDCC;
+}
+
+// The walk over the application cache that GetListOfDCCS did before the registry
+static std::vector<std::string> LegacyListOfDCCS(std::string sSearch, bool fRequireSig)
+{
+    std::string sOut = "";
+    boost::to_upper(sSearch);
+    for (std::map<std::string, std::string>::iterator ii = mvApplicationCache.begin(); ii != mvApplicationCache.end(); ++ii)
+    {
+        std::string sKey = ii->first;
+        if (sKey.length() > 3 && sKey.substr(0, 3) == "DCC")
+        {
+            std::string sValue = ii->second;
+            std::string sCPID = GetDCCElement(sValue, 0, fRequireSig);
+            std::string sAddress = GetDCCElement(sValue, 2, fRequireSig);
+            boost::to_upper(sAddress);
+            boost::to_upper(sCPID);
+            if (!sSearch.empty()) if (sSearch == sCPID || sSearch == sAddress) sOut += sValue + "<ROW>";
+            if (sSearch.empty() && !sCPID.empty()) sOut += sValue + "<ROW>";
+        }
+    }
+    std::vector<std::string> vCPIDs = Split(sOut.c_str(), "<ROW>");
+    // Split leaves an empty string after the last <ROW>; the registry does not list it
+    vCPIDs.pop_back();
+    return vCPIDs;
+}
+
+static std::string LegacyCPIDByRosettaID(double dRosettaID)
+{
+    std::vector<std::string> vCPIDs = LegacyListOfDCCS("", false);
+    for (int i = 0; i < (int)vCPIDs.size(); i++)
+    {
+        if (cdbl(GetDCCElement(vCPIDs[i], 3, false), 0) == dRosettaID) return GetDCCElement(vCPIDs[i], 0, false);
+    }
+    return "";
+}
+
+static void CheckSameAsLegacy(const std::vector<std::string>& vSearches)
+{
+    for (int nSig = 0; nSig < 2; nSig++)
+    {
+        bool fRequireSig = nSig == 1;
+        for (int i = 0; i < (int)vSearches.size(); i++)
+        {
+            std::vector<std::string> vExpected = LegacyListOfDCCS(vSearches[i], fRequireSig);
+            std::vector<std::string> vActual = GetListOfDCCS(vSearches[i], fRequireSig);
+            BOOST_CHECK_MESSAGE(vActual == vExpected, "search '" + vSearches[i] + "' sig " + itostr(nSig));
+        }
+    }
+    std::vector<CDCCRegistry::Entry> vDCCs = GetDCCRegistry().GetList(false);
+    for (int i = 0; i < (int)vDCCs.size(); i++)
+    {
+        for (int iElement = 0; iElement < 7; iElement++)
+        {
+            BOOST_CHECK_EQUAL(vDCCs[i].GetElement(iElement, false), GetDCCElement(vDCCs[i].sValue, iElement, false));
+            BOOST_CHECK_EQUAL(vDCCs[i].GetElement(iElement, true), GetDCCElement(vDCCs[i].sValue, iElement, true));
+        }
+        BOOST_CHECK_EQUAL(GetCPIDByRosettaID(vDCCs[i].dRosettaID), LegacyCPIDByRosettaID(vDCCs[i].dRosettaID));
+    }
+    BOOST_CHECK_EQUAL(GetCPIDByRosettaID(999999), "");
+}
+
+BOOST_FIXTURE_TEST_SUITE(dccregistry_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(dccregistry_matches_application_cache)
+{
+    ClearCache("DCC");
+    std::vector<CKey> vKeys(4);
+    for (int i = 0; i < (int)vKeys.size(); i++)
+        vKeys[i].MakeNewKey(true);
+
+    std::vector<std::string> vSearches;
+    vSearches.push_back("");
+    for (int i = 0; i < 12; i++)
+    {
+        std::string sCPID = strprintf("%032x", i * 7919 + 17);
+        // Mixed case CPIDs, keys shared by several CPIDs, Rosetta IDs shared by two DCCs
+        if (i % 3 == 1) boost::to_upper(sCPID);
+        const CKey& key = vKeys[i % vKeys.size()];
+        std::string sDCC = MakeDCC(key, sCPID, 1000 + i / 2, i != 5, i == 7 ? "1" : "");
+        WriteCache("DCC", sCPID, sDCC, 1000 + i);
+        vSearches.push_back(sCPID);
+        vSearches.push_back(GetAddress(key));
+    }
+    // Too few elements to be a DCC, and the contract kept in the same section
+    WriteCache("DCC", "MALFORMED", "abc;def;" + GetAddress(vKeys[0]), 1100);
+    WriteCache("dcc", "contract", "CPID,MAGNITUDE<ROW>", 1101);
+    vSearches.push_back("MALFORMED");
+    vSearches.push_back("nobody");
+
+    BOOST_CHECK_EQUAL(GetDCCRegistry().GetList(false).size(), 12U);
+    BOOST_CHECK_EQUAL(GetDCCRegistry().GetList(true).size(), 11U);
+    CheckSameAsLegacy(vSearches);
+
+    CDCCRegistry::Entry dcc;
+    BOOST_REQUIRE(GetDCCRegistry().GetByKey(strprintf("%032X", 7 * 7919 + 17), dcc));
+    BOOST_CHECK_EQUAL(dcc.dUnbanked, 1);
+    BOOST_CHECK_EQUAL(dcc.dRosettaID, 1003);
+    BOOST_CHECK(dcc.fSigned);
+    BOOST_CHECK_EQUAL(dcc.nTime, 1007);
+    BOOST_REQUIRE(GetDCCRegistry().GetByKey(strprintf("%032X", 5 * 7919 + 17), dcc));
+    BOOST_CHECK(!dcc.fSigned);
+    BOOST_CHECK_EQUAL(dcc.GetCPID(true), "");
+
+    // Re-associating a CPID with another key moves it between the address indexes
+    std::string sMoved = strprintf("%032x", 17);
+    WriteCache("DCC", sMoved, MakeDCC(vKeys[1], sMoved, 1000, true, ""), 2000);
+    BOOST_CHECK_EQUAL(GetDCCRegistry().Find(GetAddress(vKeys[0]), false).size(), 2U);
+    BOOST_CHECK_EQUAL(GetDCCRegistry().Find(GetAddress(vKeys[1]), false).size(), 4U);
+    CheckSameAsLegacy(vSearches);
+
+    // Blanked and deleted cache entries drop out of the registry as well
+    WriteCache("DCC", sMoved, "", 2001);
+    DeleteCache("DCC", strprintf("%032X", 7919 + 17));
+    BOOST_CHECK_EQUAL(GetDCCRegistry().GetList(false).size(), 10U);
+    CheckSameAsLegacy(vSearches);
+
+    ClearCache("DCC");
+    BOOST_CHECK_EQUAL(GetDCCRegistry().Size(), 0U);
+    BOOST_CHECK(GetListOfDCCS("", false).empty());
+    BOOST_CHECK_EQUAL(GetCPIDByRosettaID(1000), "");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
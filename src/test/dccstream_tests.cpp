@@ -0,0 +1,283 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "dccstream.h"
+
+#include "podc.h"
+#include "random.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include "test/httpstandin.h"
+#include "test/test_biblepay.h"
+
+#include <fstream>
+#include <string.h>
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <zlib.h>
+
+// Users in the export the local HTTP stand-in serves; about 27MB expanded
+static const int DCC_STANDIN_USERS = 100000;
+static const double DCC_TEST_TEAM = 15044;
+
+static std::string GetTestCPID(int i)
+{
+    return strprintf("%032x", i);
+}
+
+static bool IsTestResearcher(int i)
+{
+    return i % 5000 == 1;
+}
+
+/** Rows of a BOINC user export, the same layout the projects publish */
+static std::string MakeExportUsers(int nBegin, int nEnd, int nUsers)
+{
+    std::string sOut = nBegin == 0 ? "<users>\n" : "";
+    for (int i = nBegin; i < nEnd; i++) {
+        sOut += "<user>\n"
+            " <id>" + RoundToString(i, 0) + "</id>\n"
+            " <name>user " + RoundToString(i, 0) + "</name>\n"
+            " <country>None</country>\n"
+            " <create_time>1500000000</create_time>\n"
+            " <total_credit>" + RoundToString(i * 10, 0) + "</total_credit>\n"
+            " <expavg_credit>" + RoundToString(i % 1000, 0) + ".5</expavg_credit>\n"
+            " <expavg_time>1530000000.1</expavg_time>\n"
+            " <cpid>" + GetTestCPID(i) + "</cpid>\n"
+            " <url>http://example.com/" + RoundToString(i, 0) + "</url>\n"
+            " <teamid>" + (i % 3 == 0 ? RoundToString(DCC_TEST_TEAM, 0) : "0") + "</teamid>\n"
+            "</user>\n";
+    }
+    if (nEnd == nUsers) sOut += "</users>\n";
+    return sOut;
+}
+
+class CTestGzipWriter
+{
+public:
+    CTestGzipWriter()
+    {
+        memset(&strm, 0, sizeof(strm));
+        deflateInit2(&strm, 1, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    }
+    ~CTestGzipWriter() { deflateEnd(&strm); }
+
+    /** Compress sIn and return the compressed bytes produced so far */
+    std::string Write(const std::string& sIn, bool fFinish)
+    {
+        std::string sOut;
+        char buf[65536];
+        strm.next_in = (Bytef*)sIn.data();
+        strm.avail_in = sIn.size();
+        int ret;
+        do {
+            strm.next_out = (Bytef*)buf;
+            strm.avail_out = sizeof(buf);
+            ret = deflate(&strm, fFinish ? Z_FINISH : Z_NO_FLUSH);
+            sOut.append(buf, sizeof(buf) - strm.avail_out);
+        } while (strm.avail_out == 0 || (fFinish && ret != Z_STREAM_END));
+        return sOut;
+    }
+
+private:
+    z_stream strm;
+};
+
+static std::string Gzip(const std::string& sIn)
+{
+    CTestGzipWriter writer;
+    return writer.Write(sIn, true);
+}
+
+static int CountLines(const std::string& sPath)
+{
+    std::ifstream streamIn(sPath.c_str());
+    std::string line;
+    int nLines = 0;
+    while (std::getline(streamIn, line))
+        nLines++;
+    return nLines;
+}
+
+struct DCCStreamTestingSetup : public BasicTestingSetup
+{
+    boost::filesystem::path pathTemp;
+    std::set<std::string> setCPIDs;
+
+    DCCStreamTestingSetup()
+    {
+        pathTemp = GetTempPath() / strprintf("test_biblepay_dcc_%lu_%i", (unsigned long)GetTime(), (int)(GetRand(100000)));
+        boost::filesystem::create_directories(pathTemp);
+        for (int i = 0; i < DCC_STANDIN_USERS; i++) {
+            if (!IsTestResearcher(i)) continue;
+            std::string sCPID = GetTestCPID(i);
+            boost::to_upper(sCPID);
+            setCPIDs.insert(sCPID);
+        }
+    }
+    ~DCCStreamTestingSetup()
+    {
+        boost::filesystem::remove_all(pathTemp);
+    }
+    std::string TempFile(const std::string& sName) { return (pathTemp / sName).string(); }
+};
+
+/**
+ * Stands in for the project stats servers; the export is generated and
+ * deflated while it is being sent.
+ */
+class CDCCStandinServer : public CHTTPStandinServer
+{
+public:
+    ~CDCCStandinServer()
+    {
+        Stop();
+    }
+
+private:
+    bool Respond(SOCKET hSocket, const std::string& sPath, const std::string& sHeaders, const std::string& sBody)
+    {
+        if (sPath == "/redirect/user.gz") {
+            SendAll(hSocket, "HTTP/1.1 302 Found\r\nLocation: /rosetta/stats/user.gz\r\nContent-Length: 0\r\n\r\n");
+        } else if (sPath == "/rosetta/stats/user.gz" || sPath == "/boinc/stats/user.gz") {
+            SendAll(hSocket, "HTTP/1.1 200 OK\r\nContent-Type: application/x-gzip\r\nConnection: close\r\n\r\n");
+            CTestGzipWriter writer;
+            for (int i = 0; i < DCC_STANDIN_USERS; i += 1000) {
+                int nEnd = std::min(i + 1000, DCC_STANDIN_USERS);
+                if (!SendAll(hSocket, writer.Write(MakeExportUsers(i, nEnd, DCC_STANDIN_USERS), nEnd == DCC_STANDIN_USERS)))
+                    break;
+            }
+        } else {
+            SendAll(hSocket, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+        }
+        // One request per connection, the download streams do not keep them alive
+        return false;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(dccstream_tests, DCCStreamTestingSetup)
+
+BOOST_AUTO_TEST_CASE(dccstream_inflate_and_filter)
+{
+    const int nUsers = 20000;
+    std::string sExport = MakeExportUsers(0, nUsers, nUsers);
+    std::string sGzip = Gzip(sExport);
+    int nResearchers = 0;
+    int nTeam = 0;
+    for (int i = 0; i < nUsers; i++) {
+        if (IsTestResearcher(i)) nResearchers++;
+        if (i % 3 == 0) nTeam++;
+    }
+
+    // The result must not depend on how the body is split into reads
+    size_t vChunks[] = {1, 7, 4096, sGzip.size()};
+    for (unsigned int c = 0; c < sizeof(vChunks) / sizeof(vChunks[0]); c++) {
+        CDCCResearcherFilter researchers(setCPIDs);
+        CDCCTeamFilter team(TempFile("team"), DCC_TEST_TEAM);
+        std::vector<CDCCLineSink*> vSinks;
+        vSinks.push_back(&researchers);
+        vSinks.push_back(&team);
+        CGzipLineReader reader(vSinks);
+        for (size_t nPos = 0; nPos < sGzip.size(); nPos += vChunks[c])
+            BOOST_CHECK(reader.Write(sGzip.data() + nPos, std::min(vChunks[c], sGzip.size() - nPos)));
+        BOOST_CHECK(reader.Finish());
+        BOOST_CHECK(team.Commit());
+        BOOST_CHECK_EQUAL(reader.GetInflatedBytes(), sExport.size());
+        BOOST_CHECK_EQUAL(reader.GetLines(), (uint64_t)(nUsers * 12 + 2));
+        BOOST_CHECK_EQUAL(researchers.vRecords.size(), nResearchers);
+        BOOST_CHECK_EQUAL(team.nRows, nTeam);
+
+        // Each record carries the researcher's <user> element for FilterBoincData
+        CDCCResearcherFilter::Record& record = researchers.vRecords[0];
+        BOOST_CHECK_EQUAL(record.sCPID, "00000000000000000000000000000001");
+        std::string sUser = FilterBoincData(record.sBuffer, "<user>", "</user>", "");
+        BOOST_CHECK_EQUAL(cdbl(ExtractXML(sUser, "<expavg_credit>", "</expavg_credit>"), 2), 1.5);
+        BOOST_CHECK(Contains(sUser, "<teamid>0</teamid>"));
+        BOOST_CHECK(!Contains(sUser, "<id>0</id>"));
+    }
+    BOOST_CHECK_EQUAL(CountLines(TempFile("team")), nTeam);
+
+    // Concatenated gzip members are one stream, trailing padding is ignored
+    {
+        CDCCResearcherFilter researchers(setCPIDs);
+        std::vector<CDCCLineSink*> vSinks(1, &researchers);
+        CGzipLineReader reader(vSinks);
+        std::string sTwice = sGzip + sGzip + std::string(16, '\0');
+        BOOST_CHECK(reader.Write(sTwice.data(), sTwice.size()));
+        BOOST_CHECK(reader.Finish());
+        BOOST_CHECK_EQUAL(reader.GetInflatedBytes(), 2 * sExport.size());
+        BOOST_CHECK_EQUAL(researchers.vRecords.size(), 2 * nResearchers);
+    }
+
+    // Truncated and corrupt streams fail
+    {
+        std::vector<CDCCLineSink*> vSinks;
+        CGzipLineReader reader(vSinks);
+        BOOST_CHECK(reader.Write(sGzip.data(), sGzip.size() / 2));
+        BOOST_CHECK(!reader.Finish());
+        BOOST_CHECK_EQUAL(reader.GetError(), "truncated gzip stream");
+    }
+    {
+        std::vector<CDCCLineSink*> vSinks;
+        CGzipLineReader reader(vSinks);
+        BOOST_CHECK(!reader.Write(sExport.data(), 4096));
+        BOOST_CHECK(!reader.Finish());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dccstream_http_standin)
+{
+    CDCCStandinServer server;
+    BOOST_REQUIRE(server.nPort > 0);
+
+    uint64_t nExpanded = 0;
+    int nTeam = 0;
+    for (int i = 0; i < DCC_STANDIN_USERS; i += 1000) {
+        nExpanded += MakeExportUsers(i, std::min(i + 1000, DCC_STANDIN_USERS), DCC_STANDIN_USERS).size();
+        for (int j = i; j < std::min(i + 1000, DCC_STANDIN_USERS); j++)
+            if (j % 3 == 0) nTeam++;
+    }
+
+    // Both projects stream at the same time, the first through a redirect
+    CDCCProjectStream project1(server.URL("/redirect/user.gz"), setCPIDs, TempFile("team1"), DCC_TEST_TEAM);
+    CDCCProjectStream project2(server.URL("/boinc/stats/user.gz"), setCPIDs, TempFile("team2"), 0);
+    std::vector<CDCCProjectStream*> vProjects;
+    vProjects.push_back(&project1);
+    vProjects.push_back(&project2);
+    StreamDCCProjects(vProjects, 600);
+
+    BOOST_CHECK_MESSAGE(project1.fSuccess, project1.sError);
+    BOOST_CHECK_MESSAGE(project2.fSuccess, project2.sError);
+    BOOST_CHECK_EQUAL(project1.nInflatedBytes, nExpanded);
+    BOOST_CHECK_EQUAL(project2.nInflatedBytes, nExpanded);
+    BOOST_CHECK_EQUAL(project1.researchers.vRecords.size(), setCPIDs.size());
+    BOOST_CHECK_EQUAL(project2.researchers.vRecords.size(), setCPIDs.size());
+    BOOST_CHECK_EQUAL(project1.team.nRows, nTeam);
+    BOOST_CHECK_EQUAL(project2.team.nRows, DCC_STANDIN_USERS - nTeam);
+    // Only the filtered output is written
+    BOOST_CHECK(boost::filesystem::file_size(TempFile("team1")) < nExpanded / 10);
+
+    // A failed download leaves the previous team file alone
+    {
+        CDCCProjectStream project(server.URL("/missing/user.gz"), setCPIDs, TempFile("team1"), DCC_TEST_TEAM);
+        std::vector<CDCCProjectStream*> vFailed(1, &project);
+        StreamDCCProjects(vFailed, 60);
+        BOOST_CHECK(!project.fSuccess);
+    }
+    BOOST_CHECK_EQUAL(CountLines(TempFile("team1")), nTeam);
+    BOOST_CHECK(!boost::filesystem::exists(TempFile("team1") + ".new"));
+
+    std::string sError;
+    std::vector<CDCCLineSink*> vSinks;
+    CGzipLineReader reader(vSinks);
+    BOOST_CHECK(!StreamHTTPBody(server.URL("/missing/user.gz"), reader, 60, sError));
+    BOOST_CHECK_EQUAL(sError, "HTTP status 404 from " + server.URL("/missing/user.gz"));
+    BOOST_CHECK(!StreamHTTPBody("ftp://127.0.0.1/user.gz", reader, 60, sError));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,270 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "httpclient.h"
+
+#include "util.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+
+#include "test/httpstandin.h"
+#include "test/test_biblepay.h"
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+/**
+ * Keep-alive server answering by path, in the ways the pool, BOINC and IPFS
+ * servers do: framed by Content-Length or chunked, or unframed with an end
+ * marker and the connection left open.
+ */
+class CHTTPClientStandin : public CHTTPStandinServer
+{
+public:
+    CHTTPClientStandin() : nSilent(0) {}
+
+    ~CHTTPClientStandin()
+    {
+        Stop();
+    }
+
+    CHTTPClientRequest MakeRequest(const std::string& sPath) const
+    {
+        CHTTPClientRequest request;
+        request.sHost = "127.0.0.1";
+        request.nPort = nPort;
+        request.sPath = sPath;
+        request.nTimeoutMillis = 10000;
+        return request;
+    }
+
+    int GetSilent()
+    {
+        LOCK(cs);
+        return nSilent;
+    }
+
+private:
+    CCriticalSection cs;
+    int nSilent;
+
+    /** Answer one request; false closes the connection */
+    bool Respond(SOCKET hSocket, const std::string& sPath, const std::string& sHeaders, const std::string& sBody)
+    {
+        if (sPath.compare(0, 5, "/len/") == 0) {
+            std::string sOut(atoi(sPath.substr(5)), 'x');
+            return SendAll(hSocket, "HTTP/1.1 200 OK\r\nContent-Length: " + itostr(sOut.size()) + "\r\n\r\n" + sOut);
+        } else if (sPath == "/chunked") {
+            return SendAll(hSocket, "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                "6;ext=1\r\nhello \r\n5\r\nworld\r\n0\r\nX-Trailer: 1\r\n\r\n");
+        } else if (sPath == "/echo") {
+            std::string sAction = sHeaders.substr(sHeaders.find("Action: ") + 8);
+            sAction = sAction.substr(0, sAction.find("\r\n"));
+            std::string sOut = "<ACTION>" + sAction + "</ACTION><BODY>" + sBody + "</BODY>";
+            return SendAll(hSocket, "HTTP/1.1 200 OK\r\nContent-Length: " + itostr(sOut.size()) + "\r\n\r\n" + sOut);
+        } else if (sPath == "/marker") {
+            // Old pool pages: no length, and the connection stays open
+            SendAll(hSocket, "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n\r\n<RESPONSE>ok</RESPONSE><END>");
+            MilliSleep(200);
+            SendAll(hSocket, "junk after the marker");
+            return false;
+        } else if (sPath == "/closeafter") {
+            SendAll(hSocket, "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok");
+            return false;
+        } else if (sPath == "/drop") {
+            // Looks reusable, but the server drops it right after
+            SendAll(hSocket, "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\ndrop");
+            return false;
+        } else if (sPath == "/silent") {
+            // Closes without an answer, as a server does that times out an idle connection
+            LOCK(cs);
+            nSilent++;
+            return false;
+        } else if (sPath == "/slow") {
+            MilliSleep(1500);
+            SendAll(hSocket, "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+            return false;
+        }
+        return SendAll(hSocket, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+    }
+};
+
+static bool AppendBody(std::string* psBody, const char* pch, size_t nSize)
+{
+    psBody->append(pch, nSize);
+    return true;
+}
+
+BOOST_FIXTURE_TEST_SUITE(httpclient_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(httpclient_seturl)
+{
+    CHTTPClientRequest request;
+    BOOST_CHECK(request.SetURL("https://pool.biblepay.org/Action.aspx?x=1"));
+    BOOST_CHECK(request.fTLS);
+    BOOST_CHECK_EQUAL(request.sHost, "pool.biblepay.org");
+    BOOST_CHECK_EQUAL(request.nPort, 443);
+    BOOST_CHECK_EQUAL(request.sPath, "/Action.aspx?x=1");
+    BOOST_CHECK(request.SetURL("http://127.0.0.1:8080"));
+    BOOST_CHECK(!request.fTLS);
+    BOOST_CHECK_EQUAL(request.nPort, 8080);
+    BOOST_CHECK_EQUAL(request.sPath, "/");
+    BOOST_CHECK(!request.SetURL("ftp://example.com/"));
+    BOOST_CHECK(!request.SetURL("http://:80/"));
+}
+
+BOOST_AUTO_TEST_CASE(httpclient_keepalive)
+{
+    CHTTPClientStandin server;
+    BOOST_REQUIRE(server.nPort > 0);
+    CHTTPClient client;
+
+    for (int i = 0; i < 3; i++) {
+        CHTTPClientResponse response;
+        BOOST_CHECK(client.Request(server.MakeRequest("/len/100"), response));
+        BOOST_CHECK_EQUAL(response.nStatus, 200);
+        BOOST_CHECK_EQUAL(response.sBody, std::string(100, 'x'));
+        BOOST_CHECK_EQUAL(response.fReused, i > 0);
+    }
+    BOOST_CHECK_EQUAL(server.GetConnections(), 1);
+    BOOST_CHECK_EQUAL(client.GetIdleCount(), 1U);
+
+    // Chunked bodies after an interim response, and POSTs, on the same connection
+    CHTTPClientResponse response;
+    BOOST_CHECK(client.Request(server.MakeRequest("/chunked"), response));
+    BOOST_CHECK_EQUAL(response.sBody, "hello world");
+    CHTTPClientRequest post = server.MakeRequest("/echo");
+    post.sMethod = "POST";
+    post.sBody = "<data>1</data>";
+    post.mapHeaders["Action"] = "PostSpeed";
+    CHTTPClientResponse echo;
+    BOOST_CHECK(client.Request(post, echo));
+    BOOST_CHECK_EQUAL(echo.sBody, "<ACTION>PostSpeed</ACTION><BODY><data>1</data></BODY>");
+    BOOST_CHECK_EQUAL(server.GetConnections(), 1);
+
+    CHTTPClient::Stats stats = client.GetStats();
+    BOOST_CHECK_EQUAL(stats.nRequests, 5U);
+    BOOST_CHECK_EQUAL(stats.nConnects, 1U);
+    BOOST_CHECK_EQUAL(stats.nReused, 4U);
+    BOOST_CHECK_EQUAL(stats.nFailures, 0U);
+
+    // A connection the server dropped while idle is not reused
+    CHTTPClientResponse drop;
+    BOOST_CHECK(client.Request(server.MakeRequest("/drop"), drop));
+    MilliSleep(100);
+    CHTTPClientResponse after;
+    BOOST_CHECK(client.Request(server.MakeRequest("/len/1"), after));
+    BOOST_CHECK_EQUAL(after.sBody, "x");
+    BOOST_CHECK(!after.fReused);
+    BOOST_CHECK_EQUAL(server.GetConnections(), 2);
+
+    // A request that gets no answer on a pooled connection is sent again on a new one, unless it is a POST
+    CHTTPClientRequest silent = server.MakeRequest("/silent");
+    silent.sMethod = "POST";
+    CHTTPClientResponse silentPost;
+    BOOST_CHECK(!client.Request(silent, silentPost));
+    BOOST_CHECK(silentPost.fReused);
+    BOOST_CHECK_EQUAL(server.GetSilent(), 1);
+    BOOST_CHECK(client.Request(server.MakeRequest("/len/1"), after));
+    silent.sMethod = "GET";
+    CHTTPClientResponse silentGet;
+    BOOST_CHECK(!client.Request(silent, silentGet));
+    BOOST_CHECK(!silentGet.fReused);
+    BOOST_CHECK_EQUAL(server.GetSilent(), 3);
+
+    client.CloseIdle();
+    BOOST_CHECK_EQUAL(client.GetIdleCount(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(httpclient_end_markers_and_limits)
+{
+    CHTTPClientStandin server;
+    BOOST_REQUIRE(server.nPort > 0);
+    CHTTPClient client;
+
+    CHTTPClientRequest request = server.MakeRequest("/marker");
+    request.vEndMarkers.push_back("<END>");
+    CHTTPClientResponse response;
+    int64_t nStart = GetSteadyTimeMillis();
+    BOOST_CHECK(client.Request(request, response));
+    BOOST_CHECK(GetSteadyTimeMillis() - nStart < 1000);
+    BOOST_CHECK_EQUAL(response.sBody, "<RESPONSE>ok</RESPONSE><END>");
+    BOOST_CHECK_EQUAL(client.GetIdleCount(), 0U);
+
+    // The body is cut at the limit and the connection dropped
+    CHTTPClientRequest limited = server.MakeRequest("/len/5000");
+    limited.nMaxBodySize = 1000;
+    CHTTPClientResponse truncated;
+    BOOST_CHECK(client.Request(limited, truncated));
+    BOOST_CHECK_EQUAL(truncated.sBody.size(), 1000U);
+    BOOST_CHECK_EQUAL(client.GetIdleCount(), 0U);
+
+    // Streamed bodies go to the callback; error statuses are still collected
+    std::string sStreamed;
+    CHTTPClientRequest streamed = server.MakeRequest("/len/70000");
+    streamed.fnBody = boost::bind(&AppendBody, &sStreamed, _1, _2);
+    CHTTPClientResponse streamedResponse;
+    BOOST_CHECK(client.Request(streamed, streamedResponse));
+    BOOST_CHECK_EQUAL(sStreamed.size(), 70000U);
+    BOOST_CHECK(streamedResponse.sBody.empty());
+    CHTTPClientRequest missing = server.MakeRequest("/missing");
+    missing.fnBody = streamed.fnBody;
+    CHTTPClientResponse missingResponse;
+    BOOST_CHECK(client.Request(missing, missingResponse));
+    BOOST_CHECK_EQUAL(missingResponse.nStatus, 404);
+    BOOST_CHECK_EQUAL(sStreamed.size(), 70000U);
+}
+
+BOOST_AUTO_TEST_CASE(httpclient_pipelined)
+{
+    CHTTPClientStandin server;
+    BOOST_REQUIRE(server.nPort > 0);
+    CHTTPClient client;
+
+    std::vector<CHTTPClientRequest> vRequests;
+    for (int i = 1; i <= 4; i++)
+        vRequests.push_back(server.MakeRequest("/len/" + itostr(i)));
+    vRequests.push_back(server.MakeRequest("/chunked"));
+    std::vector<CHTTPClientResponse> vResponses;
+    BOOST_CHECK(client.RequestPipelined(vRequests, vResponses));
+    BOOST_REQUIRE_EQUAL(vResponses.size(), 5U);
+    for (int i = 0; i < 4; i++)
+        BOOST_CHECK_EQUAL(vResponses[i].sBody, std::string(i + 1, 'x'));
+    BOOST_CHECK_EQUAL(vResponses[4].sBody, "hello world");
+    BOOST_CHECK_EQUAL(server.GetConnections(), 1);
+
+    // The server closing part way through: the rest go out on a new connection
+    vRequests[1] = server.MakeRequest("/closeafter");
+    BOOST_CHECK(client.RequestPipelined(vRequests, vResponses));
+    BOOST_CHECK_EQUAL(vResponses[1].sBody, "ok");
+    BOOST_CHECK_EQUAL(vResponses[3].sBody, "xxxx");
+    BOOST_CHECK_EQUAL(vResponses[4].sBody, "hello world");
+    BOOST_CHECK_EQUAL(server.GetConnections(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(httpclient_timeout)
+{
+    CHTTPClientStandin server;
+    BOOST_REQUIRE(server.nPort > 0);
+    CHTTPClient client;
+
+    CHTTPClientRequest request = server.MakeRequest("/slow");
+    request.nTimeoutMillis = 300;
+    CHTTPClientResponse response;
+    int64_t nStart = GetSteadyTimeMillis();
+    BOOST_CHECK(!client.Request(request, response));
+    BOOST_CHECK(GetSteadyTimeMillis() - nStart < 1000);
+    BOOST_CHECK_EQUAL(response.sError, "timed out");
+    BOOST_CHECK_EQUAL(client.GetStats().nFailures, 1U);
+
+    // Nothing listening
+    CHTTPClientRequest refused = server.MakeRequest("/len/1");
+    refused.nPort = 1;
+    CHTTPClientResponse refusedResponse;
+    BOOST_CHECK(!client.Request(refused, refusedResponse));
+    BOOST_CHECK(!refusedResponse.sError.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
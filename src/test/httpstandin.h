@@ -0,0 +1,159 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TEST_HTTPSTANDIN_H
+#define TEST_HTTPSTANDIN_H
+
+#include "compat.h"
+#include "netbase.h"
+#include "random.h"
+#include "sync.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+
+#include <string.h>
+#include <string>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+/** A path under the temp directory that no other test run uses */
+static inline std::string GetTestPath(const std::string& sName)
+{
+    return (GetTempPath() / strprintf("test_biblepay_%s_%lu_%i", sName, (unsigned long)GetTime(), (int)GetRand(100000))).string();
+}
+
+/**
+ * HTTP/1.1 server on 127.0.0.1 standing in for the pool, BOINC and IPFS
+ * servers.  Each connection gets its own thread, which reads one request
+ * (head and Content-Length body) after the other and hands it to Respond.
+ * Derived classes call Stop in their destructor, before their own members
+ * go away.
+ */
+class CHTTPStandinServer
+{
+public:
+    int nPort;
+
+    CHTTPStandinServer() : nPort(0), nConnections(0)
+    {
+        hListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        if (bind(hListen, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+            listen(hListen, 16) == SOCKET_ERROR ||
+            getsockname(hListen, (struct sockaddr*)&addr, &len) == SOCKET_ERROR)
+            return;
+        nPort = ntohs(addr.sin_port);
+        acceptThread = boost::thread(boost::bind(&CHTTPStandinServer::AcceptLoop, this));
+    }
+
+    virtual ~CHTTPStandinServer()
+    {
+        Stop();
+    }
+
+    std::string URL(const std::string& sPath) const { return "http://127.0.0.1:" + itostr(nPort) + sPath; }
+
+    int GetConnections()
+    {
+        LOCK(cs);
+        return nConnections;
+    }
+
+protected:
+    /** Stop accepting and wait for the connections to close; safe to call twice */
+    void Stop()
+    {
+        if (hListen != INVALID_SOCKET) {
+            // Shutting the listening socket down ends the accept loop
+#ifndef WIN32
+            shutdown(hListen, SHUT_RDWR);
+#endif
+            CloseSocket(hListen);
+        }
+        if (acceptThread.joinable()) acceptThread.join();
+        threads.join_all();
+    }
+
+    static bool SendAll(SOCKET hSocket, const char* pch, size_t nSize)
+    {
+        while (nSize > 0) {
+            int n = send(hSocket, pch, nSize, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            pch += n;
+            nSize -= n;
+        }
+        return true;
+    }
+
+    static bool SendAll(SOCKET hSocket, const std::string& s)
+    {
+        return SendAll(hSocket, s.data(), s.size());
+    }
+
+    /** Answer one request; false closes the connection */
+    virtual bool Respond(SOCKET hSocket, const std::string& sPath, const std::string& sHeaders, const std::string& sBody) = 0;
+
+private:
+    SOCKET hListen;
+    boost::thread acceptThread;
+    boost::thread_group threads;
+    CCriticalSection cs;
+    int nConnections;
+
+    void AcceptLoop()
+    {
+        while (true) {
+            SOCKET hSocket = accept(hListen, NULL, NULL);
+            if (hSocket == INVALID_SOCKET) return;
+            {
+                LOCK(cs);
+                nConnections++;
+            }
+            threads.create_thread(boost::bind(&CHTTPStandinServer::Serve, this, hSocket));
+        }
+    }
+
+    void Serve(SOCKET hSocket)
+    {
+        std::string sPending;
+        char buf[4096];
+        while (true) {
+            size_t nEnd;
+            bool fClosed = false;
+            while ((nEnd = sPending.find("\r\n\r\n")) == std::string::npos && !fClosed) {
+                int n = recv(hSocket, buf, sizeof(buf), 0);
+                if (n <= 0) fClosed = true;
+                else sPending.append(buf, n);
+            }
+            if (fClosed) break;
+            std::string sHeaders = sPending.substr(0, nEnd + 2);
+            sPending.erase(0, nEnd + 4);
+            size_t nLength = 0;
+            size_t nPos = sHeaders.find("Content-Length: ");
+            if (nPos != std::string::npos) nLength = atoi(sHeaders.substr(nPos + 16, sHeaders.find("\r\n", nPos) - nPos - 16));
+            while (sPending.size() < nLength && !fClosed) {
+                int n = recv(hSocket, buf, sizeof(buf), 0);
+                if (n <= 0) fClosed = true;
+                else sPending.append(buf, n);
+            }
+            if (fClosed) break;
+            std::string sBody = sPending.substr(0, nLength);
+            sPending.erase(0, nLength);
+            size_t nPathStart = sHeaders.find(' ') + 1;
+            std::string sPath = sHeaders.substr(nPathStart, sHeaders.find(' ', nPathStart) - nPathStart);
+            if (!Respond(hSocket, sPath, sHeaders, sBody)) break;
+        }
+        CloseSocket(hSocket);
+    }
+};
+
+#endif // TEST_HTTPSTANDIN_H
@@ -0,0 +1,188 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ipfscache.h"
+
+#include "random.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+
+#include "test/test_biblepay.h"
+
+#include <atomic>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+/** Stands in for the IPFS gateway: serves mapContent and counts the requests */
+struct CIPFSStandin
+{
+    std::map<std::string, std::string> mapContent;
+    int nRequests;
+
+    CIPFSStandin() : nRequests(0) {}
+
+    std::string Fetch(const std::string& sHash, std::string& sError)
+    {
+        nRequests++;
+        std::map<std::string, std::string>::const_iterator it = mapContent.find(sHash);
+        if (it == mapContent.end()) {
+            sError = "IPFS Download error.";
+            return "";
+        }
+        return it->second;
+    }
+
+    std::string Add(const std::string& sJson)
+    {
+        std::string sHash = "Qm" + itostr(mapContent.size());
+        mapContent[sHash] = sJson;
+        return sHash;
+    }
+};
+
+/** Gateway that, while fetching, checks another thread can still read the cache */
+struct CIPFSLockCheck : public CIPFSStandin
+{
+    CIPFSObjectCache* pcache;
+    bool fReadDuringFetch;
+    std::atomic<int> nReads;
+    boost::thread_group readers;
+
+    CIPFSLockCheck() : pcache(NULL), fReadDuringFetch(true), nReads(0) {}
+
+    void Read()
+    {
+        std::vector<CBusinessObject> vObjects;
+        pcache->GetObjects("expense", vObjects);
+        nReads++;
+    }
+
+    std::string FetchChecked(const std::string& sHash, std::string& sError)
+    {
+        // The readers are joined after Sync returns, so a lock held across the fetch fails the check instead of hanging
+        int nBefore = nReads;
+        readers.create_thread(boost::bind(&CIPFSLockCheck::Read, this));
+        for (int i = 0; i < 500 && nReads == nBefore; i++)
+            MilliSleep(10);
+        if (nReads == nBefore) fReadDuringFetch = false;
+        return Fetch(sHash, sError);
+    }
+};
+
+static std::string Revenue(const std::string& sAmount, const std::string& sEmail, bool fDeleted = false)
+{
+    return "{\"objecttype\":\"revenue\",\"amount\":\"" + sAmount + "\",\"email\":\"" + sEmail + "\",\"deleted\":\"" + (fDeleted ? "1" : "0") + "\"}";
+}
+
+BOOST_FIXTURE_TEST_SUITE(ipfscache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(ipfscache_store_is_persistent)
+{
+    boost::filesystem::path path = GetTempPath() / strprintf("test_biblepay_ipfs_%lu_%i", (unsigned long)GetTime(), (int)(GetRand(100000)));
+    CIPFSStandin ipfs;
+    std::string sHash = ipfs.Add(Revenue("1.50", "a@b.c"));
+    std::string sJson;
+    std::string sError;
+    {
+        CIPFSObjectCache cache(path, false, boost::bind(&CIPFSStandin::Fetch, &ipfs, _1, _2));
+        BOOST_CHECK(cache.GetJSON(sHash, sJson, sError));
+        BOOST_CHECK(cache.GetJSON(sHash, sJson, sError));
+        BOOST_CHECK_EQUAL(ipfs.nRequests, 1);
+
+        // A failed fetch is not retried straight away, and never stored
+        BOOST_CHECK(!cache.GetJSON("QmMissing", sJson, sError));
+        BOOST_CHECK(!cache.GetJSON("QmMissing", sJson, sError));
+        BOOST_CHECK_EQUAL(ipfs.nRequests, 2);
+        ipfs.mapContent["QmHtml"] = "<html>gateway timeout</html>";
+        sError = "";
+        BOOST_CHECK(!cache.GetJSON("QmHtml", sJson, sError));
+        BOOST_CHECK(!sError.empty());
+    }
+    // Content named by a hash never changes, so a restart keeps what was fetched
+    CIPFSObjectCache cache(path, false, boost::bind(&CIPFSStandin::Fetch, &ipfs, _1, _2));
+    sError = "";
+    BOOST_CHECK(cache.GetJSON(sHash, sJson, sError));
+    BOOST_CHECK_EQUAL(sJson, Revenue("1.50", "a@b.c"));
+    BOOST_CHECK_EQUAL(ipfs.nRequests, 3);
+    boost::filesystem::remove_all(path);
+}
+
+BOOST_AUTO_TEST_CASE(ipfscache_indexes)
+{
+    CIPFSStandin ipfs;
+    CIPFSObjectCache cache(GetTempPath() / "ipfscache_memory", true, boost::bind(&CIPFSStandin::Fetch, &ipfs, _1, _2));
+    cache.AddIndex("revenue", "amount");
+    cache.AddIndex("revenue", "email");
+
+    std::map<std::string, std::string> mapCurrent;
+    mapCurrent["K1"] = ipfs.Add(Revenue("10.10", "One@example.com"));
+    mapCurrent["K2"] = ipfs.Add(Revenue("20.20", "two@example.com"));
+    mapCurrent["K3"] = ipfs.Add(Revenue("30.30", "two@example.com"));
+    mapCurrent["K4"] = ipfs.Add(Revenue("1000", "gone@example.com", true));
+    mapCurrent["K5"] = "";
+    cache.Sync("REVENUE", mapCurrent);
+    BOOST_CHECK_EQUAL(ipfs.nRequests, 4);
+
+    std::vector<CBusinessObject> vObjects;
+    cache.GetObjects("revenue", vObjects);
+    BOOST_REQUIRE_EQUAL(vObjects.size(), 3U);
+    BOOST_CHECK_EQUAL(vObjects[0].sPrimaryKey, "K1");
+    BOOST_CHECK_EQUAL(vObjects[2].o["amount"].getValStr(), "30.30");
+
+    int nRows = 0;
+    BOOST_CHECK_EQUAL(cache.GetTotal("revenue", "amount", nRows), 60.6);
+    BOOST_CHECK_EQUAL(nRows, 3);
+    CBusinessObject object;
+    BOOST_CHECK(cache.FindByField("revenue", "email", "ONE@EXAMPLE.COM", object));
+    BOOST_CHECK_EQUAL(object.sPrimaryKey, "K1");
+    BOOST_CHECK(cache.FindByField("revenue", "email", "two@example.com", object));
+    BOOST_CHECK_EQUAL(object.sPrimaryKey, "K2");
+    BOOST_CHECK(!cache.FindByField("revenue", "email", "gone@example.com", object));
+
+    // Fields without an index give the same answers by scanning
+    BOOST_CHECK(cache.FindByField("revenue", "objecttype", "REVENUE", object));
+    BOOST_CHECK_EQUAL(object.sPrimaryKey, "K1");
+    BOOST_CHECK_EQUAL(cache.GetTotal("revenue", "email", nRows), 0);
+
+    // Syncing again costs no requests; an updated or removed key is reindexed
+    cache.Sync("revenue", mapCurrent);
+    BOOST_CHECK_EQUAL(ipfs.nRequests, 4);
+    mapCurrent["K2"] = ipfs.Add(Revenue("2.02", "new@example.com"));
+    mapCurrent.erase("K3");
+    cache.Sync("revenue", mapCurrent);
+    BOOST_CHECK_EQUAL(ipfs.nRequests, 5);
+    BOOST_CHECK_EQUAL(cache.GetTotal("revenue", "amount", nRows), 12.12);
+    BOOST_CHECK_EQUAL(nRows, 2);
+    BOOST_CHECK(!cache.FindByField("revenue", "email", "two@example.com", object));
+    BOOST_CHECK(cache.FindByField("revenue", "email", "new@example.com", object));
+    BOOST_CHECK_EQUAL(object.sHash, mapCurrent["K2"]);
+
+    // An index declared late covers the objects already loaded
+    cache.AddIndex("revenue", "objecttype");
+    BOOST_CHECK(cache.FindByField("revenue", "objecttype", "revenue", object));
+    BOOST_CHECK_EQUAL(object.sPrimaryKey, "K1");
+}
+
+BOOST_AUTO_TEST_CASE(ipfscache_sync_fetches_unlocked)
+{
+    CIPFSLockCheck ipfs;
+    CIPFSObjectCache cache(GetTempPath() / "ipfscache_memory", true, boost::bind(&CIPFSLockCheck::FetchChecked, &ipfs, _1, _2));
+    ipfs.pcache = &cache;
+    std::map<std::string, std::string> mapCurrent;
+    mapCurrent["K1"] = ipfs.Add(Revenue("1", "a@example.com"));
+    mapCurrent["K2"] = ipfs.Add(Revenue("2", "b@example.com"));
+    cache.Sync("revenue", mapCurrent);
+    ipfs.readers.join_all();
+    BOOST_CHECK_EQUAL(ipfs.nRequests, 2);
+    BOOST_CHECK(ipfs.fReadDuringFetch);
+    int nRows = 0;
+    BOOST_CHECK_EQUAL(cache.GetTotal("revenue", "amount", nRows), 3);
+    BOOST_CHECK_EQUAL(nRows, 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,208 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ipfsdownload.h"
+
+#include "httpclient.h"
+#include "random.h"
+#include "sync.h"
+#include "util.h"
+#include "utilstrencodings.h"
+
+#include "test/httpstandin.h"
+#include "test/test_biblepay.h"
+
+#include <fstream>
+#include <stdio.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+/**
+ * IPFS gateway serving one document: /ipfs/ranged and /files/ranged answer
+ * Range requests, /ipfs/plain ignores them.  While nCutsLeft is above zero, range replies
+ * stop halfway through and the connection is dropped.
+ */
+class CIPFSGatewayStandin : public CHTTPStandinServer
+{
+public:
+    std::string sContent;
+
+    explicit CIPFSGatewayStandin(size_t nSize) : nCutsLeft(0), nRangeRequests(0)
+    {
+        for (size_t i = 0; i < nSize; i++)
+            sContent += (char)(insecure_rand() & 0xff);
+    }
+
+    ~CIPFSGatewayStandin()
+    {
+        // The shared client pools its connections; the serving threads end when they close
+        GetHTTPClient().CloseIdle();
+        Stop();
+    }
+
+    void SetCuts(int nCuts)
+    {
+        LOCK(cs);
+        nCutsLeft = nCuts;
+    }
+
+    int GetRangeRequests()
+    {
+        LOCK(cs);
+        return nRangeRequests;
+    }
+
+private:
+    CCriticalSection cs;
+    int nCutsLeft;
+    int nRangeRequests;
+
+    /** Answer one request; false closes the connection */
+    bool Respond(SOCKET hSocket, const std::string& sPath, const std::string& sHeaders, const std::string& sBody)
+    {
+        size_t nRange = sHeaders.find("Range: bytes=");
+        bool fRanged = sPath == "/ipfs/ranged" || sPath == "/files/ranged";
+        if (sPath == "/ipfs/plain" || (fRanged && nRange == std::string::npos)) {
+            std::string sHead = "HTTP/1.1 200 OK\r\nContent-Length: " + itostr(sContent.size()) + "\r\n\r\n";
+            return SendAll(hSocket, sHead) && SendAll(hSocket, sContent.data(), sContent.size());
+        }
+        if (!fRanged) {
+            std::string sHead = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+            return SendAll(hSocket, sHead);
+        }
+        unsigned long long nFirst = 0, nLast = 0;
+        sscanf(sHeaders.c_str() + nRange, "Range: bytes=%llu-%llu", &nFirst, &nLast);
+        nLast = std::min(nLast, (unsigned long long)sContent.size() - 1);
+        size_t nLength = nLast - nFirst + 1;
+        bool fCut = false;
+        {
+            LOCK(cs);
+            nRangeRequests++;
+            if (nLength > 1 && nCutsLeft > 0) {
+                nCutsLeft--;
+                fCut = true;
+            }
+        }
+        std::string sHead = strprintf("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes %d-%d/%d\r\nContent-Length: %d\r\n\r\n",
+            nFirst, nLast, sContent.size(), nLength);
+        if (!SendAll(hSocket, sHead)) return false;
+        if (fCut) {
+            SendAll(hSocket, sContent.data() + nFirst, nLength / 2);
+            return false;
+        }
+        return SendAll(hSocket, sContent.data() + nFirst, nLength);
+    }
+};
+
+static std::string ReadFile(const std::string& sPath)
+{
+    std::ifstream streamIn(sPath.c_str(), std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(streamIn)), std::istreambuf_iterator<char>());
+}
+
+BOOST_FIXTURE_TEST_SUITE(ipfsdownload_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(ipfsdownload_ranges)
+{
+    CIPFSGatewayStandin gateway(1500 * 1000);
+    BOOST_REQUIRE(gateway.nPort != 0);
+    std::string sPath = GetTestPath("ipfs_ranges");
+
+    // Split four ways, one request per range after the probe
+    CIPFSDownload download(gateway.URL("/ipfs/ranged"), sPath, 10000);
+    download.nExpectedSize = gateway.sContent.size();
+    BOOST_CHECK_EQUAL(DownloadIPFSFile(download), IPFS_DOWNLOAD_OK);
+    BOOST_CHECK_EQUAL(download.nRangesUsed, IPFS_DOWNLOAD_RANGES);
+    BOOST_CHECK_EQUAL(gateway.GetRangeRequests(), IPFS_DOWNLOAD_RANGES + 1);
+    BOOST_CHECK_EQUAL(download.nTransferred, gateway.sContent.size());
+    BOOST_CHECK(ReadFile(sPath) == gateway.sContent);
+    BOOST_CHECK(!boost::filesystem::exists(GetIPFSProgressPath(sPath)));
+
+    // A dropped connection is picked up where it stopped, within the same call
+    gateway.SetCuts(2);
+    CIPFSDownload retried(gateway.URL("/ipfs/ranged"), sPath, 10000);
+    BOOST_CHECK_EQUAL(DownloadIPFSFile(retried), IPFS_DOWNLOAD_OK);
+    BOOST_CHECK_EQUAL(retried.nTransferred, gateway.sContent.size());
+    BOOST_CHECK(ReadFile(sPath) == gateway.sContent);
+
+    // A gateway without range support sends the whole file with the probe
+    CIPFSDownload plain(gateway.URL("/ipfs/plain"), sPath, 10000);
+    BOOST_CHECK_EQUAL(DownloadIPFSFile(plain), IPFS_DOWNLOAD_OK);
+    BOOST_CHECK_EQUAL(plain.nRangesUsed, 1);
+    BOOST_CHECK(ReadFile(sPath) == gateway.sContent);
+
+    // The size recorded on chain has to match before anything is fetched
+    CIPFSDownload mismatch(gateway.URL("/ipfs/ranged"), sPath, 10000);
+    mismatch.nExpectedSize = gateway.sContent.size() + 1;
+    BOOST_CHECK_EQUAL(DownloadIPFSFile(mismatch), IPFS_DOWNLOAD_SIZE_MISMATCH);
+    BOOST_CHECK_EQUAL(mismatch.nTransferred, 0U);
+
+    // A gateway ignoring Range is checked against the recorded size before its reply is written
+    CIPFSDownload plainMismatch(gateway.URL("/ipfs/plain"), sPath, 10000);
+    plainMismatch.nExpectedSize = gateway.sContent.size() - 1;
+    BOOST_CHECK_EQUAL(DownloadIPFSFile(plainMismatch), IPFS_DOWNLOAD_SIZE_MISMATCH);
+    BOOST_CHECK_EQUAL(plainMismatch.nTransferred, 0U);
+    BOOST_CHECK(ReadFile(sPath).empty());
+
+    CIPFSDownload missing(gateway.URL("/ipfs/missing"), sPath, 10000);
+    BOOST_CHECK_EQUAL(DownloadIPFSFile(missing), IPFS_DOWNLOAD_FAILED);
+    boost::filesystem::remove(sPath);
+}
+
+BOOST_AUTO_TEST_CASE(ipfsdownload_resume)
+{
+    CIPFSGatewayStandin gateway(1500 * 1000);
+    BOOST_REQUIRE(gateway.nPort != 0);
+    std::string sPath = GetTestPath("ipfs_resume");
+
+    // Every attempt of every range is cut short, so the call gives up part way
+    gateway.SetCuts(1000);
+    CIPFSDownload first(gateway.URL("/ipfs/ranged"), sPath, 10000);
+    BOOST_CHECK_EQUAL(DownloadIPFSFile(first), IPFS_DOWNLOAD_FAILED);
+    BOOST_CHECK(!first.sError.empty());
+    BOOST_CHECK(first.nTransferred > 0 && first.nTransferred < gateway.sContent.size());
+    BOOST_CHECK(boost::filesystem::exists(GetIPFSProgressPath(sPath)));
+
+    // The next call fetches only what is missing
+    gateway.SetCuts(0);
+    CIPFSDownload second(gateway.URL("/ipfs/ranged"), sPath, 10000);
+    BOOST_CHECK_EQUAL(DownloadIPFSFile(second), IPFS_DOWNLOAD_OK);
+    BOOST_CHECK_EQUAL(second.nResumed, first.nTransferred);
+    BOOST_CHECK_EQUAL(second.nResumed + second.nTransferred, gateway.sContent.size());
+    BOOST_CHECK(ReadFile(sPath) == gateway.sContent);
+    BOOST_CHECK(!boost::filesystem::exists(GetIPFSProgressPath(sPath)));
+
+    // Without a validator, a file that is not addressed by its hash may have changed and is fetched again
+    gateway.SetCuts(1000);
+    CIPFSDownload unnamed(gateway.URL("/files/ranged"), sPath, 10000);
+    BOOST_CHECK_EQUAL(DownloadIPFSFile(unnamed), IPFS_DOWNLOAD_FAILED);
+    BOOST_CHECK(unnamed.nTransferred > 0);
+    gateway.SetCuts(0);
+    CIPFSDownload unnamedAgain(gateway.URL("/files/ranged"), sPath, 10000);
+    BOOST_CHECK_EQUAL(DownloadIPFSFile(unnamedAgain), IPFS_DOWNLOAD_OK);
+    BOOST_CHECK_EQUAL(unnamedAgain.nResumed, 0U);
+    BOOST_CHECK_EQUAL(unnamedAgain.nTransferred, gateway.sContent.size());
+    BOOST_CHECK(ReadFile(sPath) == gateway.sContent);
+
+    // Nor is a download resumed from another URL
+    gateway.SetCuts(1000);
+    CIPFSDownload other(gateway.URL("/ipfs/ranged"), sPath, 10000);
+    BOOST_CHECK_EQUAL(DownloadIPFSFile(other), IPFS_DOWNLOAD_FAILED);
+    gateway.SetCuts(0);
+    CIPFSDownload otherAgain(gateway.URL("/files/ranged"), sPath, 10000);
+    BOOST_CHECK_EQUAL(DownloadIPFSFile(otherAgain), IPFS_DOWNLOAD_OK);
+    BOOST_CHECK_EQUAL(otherAgain.nResumed, 0U);
+    BOOST_CHECK(ReadFile(sPath) == gateway.sContent);
+
+    // A single range, as ipfsgetrange asks for; a gateway that ignores Range is cut to size
+    std::string sError;
+    BOOST_CHECK_EQUAL(DownloadIPFSRange(gateway.URL("/ipfs/ranged"), sPath, 0, 1024, 10000, sError), IPFS_DOWNLOAD_OK);
+    BOOST_CHECK(ReadFile(sPath) == gateway.sContent.substr(0, 1025));
+    BOOST_CHECK_EQUAL(DownloadIPFSRange(gateway.URL("/ipfs/plain"), sPath, 0, 1024, 10000, sError), IPFS_DOWNLOAD_OK);
+    BOOST_CHECK(ReadFile(sPath) == gateway.sContent.substr(0, 1025));
+    boost::filesystem::remove(sPath);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
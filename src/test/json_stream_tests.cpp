@@ -0,0 +1,118 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "json-stream.h"
+#include "rpcserver.h"
+#include "utilstrencodings.h"
+
+#include "test/test_biblepay.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <univalue.h>
+
+BOOST_FIXTURE_TEST_SUITE(json_stream_tests, BasicTestingSetup)
+
+struct ChunkRecorder
+{
+    std::vector<std::string>* pvChunks;
+    void operator()(const std::string& strChunk) const { pvChunks->push_back(strChunk); }
+};
+
+BOOST_AUTO_TEST_CASE(json_stream_matches_univalue)
+{
+    UniValue tx(UniValue::VOBJ);
+    tx.push_back(Pair("txid", "00ff"));
+    tx.push_back(Pair("fee", ValueFromAmount(12345)));
+    tx.push_back(Pair("prayer", "Line \"one\"\n\ttwo \\ three"));
+    tx.push_back(Pair("depends", UniValue(UniValue::VARR)));
+    UniValue txs(UniValue::VARR);
+    for (int i = 0; i < 50; i++)
+        txs.push_back(tx);
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("hash", "abcdef"));
+    result.push_back(Pair("confirmations", -1));
+    result.push_back(Pair("tx", txs));
+    result.push_back(Pair("empty", UniValue(UniValue::VOBJ)));
+    result.push_back(Pair("satisfiesbiblehash", true));
+    result.push_back(Pair("nextblockhash", NullUniValue));
+
+    // A tiny chunk size forces a flush after nearly every token
+    std::vector<std::string> vChunks;
+    ChunkRecorder recorder;
+    recorder.pvChunks = &vChunks;
+    CJSONStreamWriter writer(recorder, 16);
+    writer.Value(result);
+    writer.Flush();
+
+    std::string strStreamed;
+    for (unsigned int i = 0; i < vChunks.size(); i++) {
+        BOOST_CHECK(!vChunks[i].empty());
+        strStreamed += vChunks[i];
+    }
+    BOOST_CHECK(vChunks.size() > 1);
+    BOOST_CHECK(writer.HasFlushed());
+    BOOST_CHECK_EQUAL(strStreamed, result.write());
+}
+
+BOOST_AUTO_TEST_CASE(json_stream_members)
+{
+    std::vector<std::string> vChunks;
+    ChunkRecorder recorder;
+    recorder.pvChunks = &vChunks;
+    CJSONStreamWriter writer(recorder);
+
+    // Built the way a streamed JSON-RPC reply is
+    writer.BeginObject();
+    writer.Key("result");
+    writer.BeginArray();
+    writer.Value(UniValue(1));
+    writer.Value(UniValue("two"));
+    writer.EndArray();
+    writer.Pair("error", NullUniValue);
+    writer.Pair("id", UniValue(7));
+    writer.EndObject();
+
+    // Nothing reaches the sink until a chunk fills up or Flush is called
+    BOOST_CHECK(!writer.HasFlushed());
+    BOOST_CHECK(vChunks.empty());
+
+    UniValue result(UniValue::VARR);
+    result.push_back(1);
+    result.push_back("two");
+    BOOST_CHECK_EQUAL(writer.GetBuffer() + "\n", JSONRPCReply(result, NullUniValue, UniValue(7)));
+}
+
+BOOST_AUTO_TEST_CASE(json_stream_string_parts)
+{
+    std::vector<std::string> vChunks;
+    ChunkRecorder recorder;
+    recorder.pvChunks = &vChunks;
+    CJSONStreamWriter writer(recorder, 16);
+
+    std::string strHex;
+    writer.BeginArray();
+    writer.BeginString();
+    for (int i = 0; i < 20; i++) {
+        std::string strPart = HexStr(std::string(i, (char)i));
+        strHex += strPart;
+        writer.StringPart(strPart);
+    }
+    writer.EndString();
+    writer.Value(UniValue("tail"));
+    writer.EndArray();
+    writer.Flush();
+
+    std::string strStreamed;
+    for (unsigned int i = 0; i < vChunks.size(); i++)
+        strStreamed += vChunks[i];
+    BOOST_CHECK(vChunks.size() > 1);
+
+    UniValue result(UniValue::VARR);
+    result.push_back(strHex);
+    result.push_back("tail");
+    BOOST_CHECK_EQUAL(strStreamed, result.write());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
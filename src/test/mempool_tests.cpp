@@ -113,6 +113,59 @@ void CheckSort(CTxMemPool &pool, std::vector<std::string> &sortedOrder)
     }
 }
 
+BOOST_AUTO_TEST_CASE(MempoolRemoveForBlockChainTest)
+{
+    // A block confirming the first half of an unconfirmed chain must leave
+    // correct descendant state behind for the second half
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    entry.Fee(1000LL);
+
+    const int nChain = 10;
+    std::vector<CMutableTransaction> vChain(nChain);
+    for (int i = 0; i < nChain; i++)
+    {
+        vChain[i].vin.resize(1);
+        vChain[i].vin[0].scriptSig = CScript() << OP_11;
+        if (i > 0)
+            vChain[i].vin[0].prevout = COutPoint(vChain[i - 1].GetHash(), 0);
+        vChain[i].vout.resize(2);
+        vChain[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        vChain[i].vout[0].nValue = 10 * COIN;
+        vChain[i].vout[1].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        vChain[i].vout[1].nValue = COIN;
+        pool.addUnchecked(vChain[i].GetHash(), entry.FromTx(vChain[i], &pool));
+    }
+    // A payout hanging off the chain that is not in the block
+    CMutableTransaction txSide;
+    txSide.vin.resize(1);
+    txSide.vin[0].scriptSig = CScript() << OP_11;
+    txSide.vin[0].prevout = COutPoint(vChain[2].GetHash(), 1);
+    txSide.vout.resize(1);
+    txSide.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txSide.vout[0].nValue = COIN;
+    pool.addUnchecked(txSide.GetHash(), entry.FromTx(txSide, &pool));
+    BOOST_CHECK_EQUAL(pool.size(), nChain + 1);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(vChain[0].GetHash())->GetCountWithDescendants(), nChain + 1);
+
+    std::vector<CTransaction> vtx;
+    for (int i = 0; i < nChain / 2; i++)
+        vtx.push_back(vChain[i]);
+    std::list<CTransaction> conflicts;
+    pool.removeForBlock(vtx, 1, conflicts);
+
+    BOOST_CHECK(conflicts.empty());
+    BOOST_CHECK_EQUAL(pool.size(), nChain / 2 + 1);
+    CTxMemPool::txiter it = pool.mapTx.find(vChain[nChain / 2].GetHash());
+    BOOST_CHECK(pool.GetMemPoolParents(it).empty());
+    BOOST_CHECK_EQUAL(it->GetCountWithDescendants(), nChain / 2);
+    BOOST_CHECK_EQUAL(it->GetSizeWithDescendants(), (nChain / 2) * it->GetTxSize());
+    BOOST_CHECK_EQUAL(it->GetModFeesWithDescendants(), (nChain / 2) * 1000LL);
+    it = pool.mapTx.find(txSide.GetHash());
+    BOOST_CHECK(pool.GetMemPoolParents(it).empty());
+    BOOST_CHECK_EQUAL(it->GetCountWithDescendants(), 1);
+}
+
 BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
 {
     CTxMemPool pool(CFeeRate(0));
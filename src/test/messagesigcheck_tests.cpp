@@ -0,0 +1,101 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "messagesigcheck.h"
+
+#include "base58.h"
+#include "checkqueue.h"
+#include "hash.h"
+#include "key.h"
+#include "main.h"
+#include "utilstrencodings.h"
+
+#include "test/test_biblepay.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+static std::string SignMessage(const CKey& key, const std::string& sMessage)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << strMessageMagic;
+    ss << sMessage;
+    std::vector<unsigned char> vchSig;
+    key.SignCompact(ss.GetHash(), vchSig);
+    return EncodeBase64(&vchSig[0], vchSig.size());
+}
+
+static void RunQueue(CCheckQueue<CMessageSigCheck>* pqueue)
+{
+    pqueue->Thread();
+}
+
+BOOST_FIXTURE_TEST_SUITE(messagesigcheck_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(messagesigcheck_cached_results)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CKey other;
+    other.MakeNewKey(true);
+    std::string sAddress = CBitcoinAddress(key.GetPubKey().GetID()).ToString();
+    std::string sMessage = "abc;0123456789abcdef;" + sAddress;
+    std::string sSignature = SignMessage(key, sMessage);
+
+    std::string sError;
+    // The second check of each is answered from the cache for a valid signature only
+    for (int i = 0; i < 2; i++)
+    {
+        BOOST_CHECK(CheckMessageSignature(sAddress, sSignature, sMessage, sError));
+        BOOST_CHECK(!CheckMessageSignature(sAddress, sSignature, sMessage + "1", sError));
+        BOOST_CHECK(!CheckMessageSignature(sAddress, SignMessage(other, sMessage), sMessage, sError));
+    }
+
+    BOOST_CHECK(!CheckMessageSignature("notanaddress", sSignature, sMessage, sError));
+    BOOST_CHECK_EQUAL(sError, "Invalid address");
+    BOOST_CHECK(!CheckMessageSignature(sAddress, "AAA=A", sMessage, sError));
+    BOOST_CHECK_EQUAL(sError, "Malformed base64 encoding");
+    BOOST_CHECK(!CheckMessageSignature(sAddress, "", sMessage, sError));
+    BOOST_CHECK_EQUAL(sError, "Unable to recover public key.");
+}
+
+BOOST_AUTO_TEST_CASE(messagesigcheck_queue_checks_all)
+{
+    std::vector<CKey> vKeys(8);
+    for (int i = 0; i < (int)vKeys.size(); i++)
+        vKeys[i].MakeNewKey(true);
+
+    // Bad signatures in between must not stop the rest of the batch from being checked
+    std::vector<CMessageSigCheck> vChecks;
+    std::vector<std::string> vAddresses, vSignatures, vMessages;
+    for (int i = 0; i < 200; i++)
+    {
+        const CKey& key = vKeys[i % vKeys.size()];
+        vAddresses.push_back(CBitcoinAddress(key.GetPubKey().GetID()).ToString());
+        vMessages.push_back("<MT>PRAYER</MT><MV>" + itostr(i) + "</MV>");
+        vSignatures.push_back(i % 7 == 3 ? SignMessage(key, "other") : SignMessage(key, vMessages.back()));
+        vChecks.push_back(CMessageSigCheck(vAddresses.back(), vSignatures.back(), vMessages.back()));
+    }
+
+    CCheckQueue<CMessageSigCheck> queue(8);
+    boost::thread_group threadGroup;
+    for (int i = 0; i < 3; i++)
+        threadGroup.create_thread(boost::bind(&RunQueue, &queue));
+    {
+        CCheckQueueControl<CMessageSigCheck> control(&queue);
+        control.Add(vChecks);
+        BOOST_CHECK(control.Wait());
+    }
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    for (int i = 0; i < (int)vMessages.size(); i++)
+    {
+        std::string sError;
+        BOOST_CHECK_EQUAL(CheckMessageSignature(vAddresses[i], vSignatures[i], vMessages[i], sError), i % 7 != 3);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,104 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "perfstats.h"
+
+#include "test/test_biblepay.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+static void AddMany(CPerfStat* pcounter, CPerfStat* ptimer, int nTimes)
+{
+    for (int i = 0; i < nTimes; i++)
+    {
+        pcounter->Add();
+        ptimer->AddSample(i % 3 == 0 ? 5 : 2000);
+    }
+}
+
+static bool FindSnapshot(const std::string& sName, const std::string& sLabel, CPerfStatSnapshot& snapshot)
+{
+    std::vector<CPerfStatSnapshot> vStats = GetPerfStatSnapshots();
+    for (int i = 0; i < (int)vStats.size(); i++)
+    {
+        if (vStats[i].sName != sName || vStats[i].sLabel != sLabel) continue;
+        snapshot = vStats[i];
+        return true;
+    }
+    return false;
+}
+
+BOOST_FIXTURE_TEST_SUITE(perfstats_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(perfstats_threads_add_up)
+{
+    CPerfStat& counter = GetPerfCounter("test_events");
+    CPerfStat& timer = GetPerfTimer("test_calls", "Caller");
+    BOOST_CHECK_EQUAL(&counter, &GetPerfCounter("test_events"));
+    BOOST_CHECK(&timer != &GetPerfTimer("test_calls", "Other"));
+
+    // More threads than slots, so some of them share one
+    boost::thread_group threadGroup;
+    for (int i = 0; i < PERF_THREAD_SLOTS + 4; i++)
+        threadGroup.create_thread(boost::bind(&AddMany, &counter, &timer, 3000));
+    threadGroup.join_all();
+    timer.AddSample(12000000);
+    timer.AddSample(-5);
+
+    const uint64_t nSamples = (PERF_THREAD_SLOTS + 4) * 3000;
+    CPerfStatSnapshot snapshot;
+    BOOST_REQUIRE(FindSnapshot("test_events", "", snapshot));
+    BOOST_CHECK(!snapshot.fTimer);
+    BOOST_CHECK_EQUAL(snapshot.nCount, nSamples);
+
+    BOOST_REQUIRE(FindSnapshot("test_calls", "Caller", snapshot));
+    BOOST_CHECK(snapshot.fTimer);
+    BOOST_CHECK_EQUAL(snapshot.nCount, nSamples + 2);
+    BOOST_CHECK_EQUAL(snapshot.vBuckets[0], nSamples / 3 + 1);
+    BOOST_CHECK_EQUAL(snapshot.vBuckets[3], nSamples * 2 / 3);
+    BOOST_CHECK_EQUAL(snapshot.vBuckets[PERF_LATENCY_BUCKETS - 1], 1U);
+    BOOST_CHECK_EQUAL(snapshot.nTotalMicros, nSamples / 3 * 5 + nSamples * 2 / 3 * 2000 + 12000000);
+    BOOST_CHECK_EQUAL(snapshot.nMaxMicros, 12000000U);
+
+    BOOST_REQUIRE(FindSnapshot("test_calls", "Other", snapshot));
+    BOOST_CHECK_EQUAL(snapshot.nCount, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(perfstats_prometheus_format)
+{
+    GetPerfCounter("test_prom_events").Add(7);
+    CPerfStat& timerA = GetPerfTimer("test_prom_calls", "A");
+    CPerfStat& timerB = GetPerfTimer("test_prom_calls", "B");
+    timerA.AddSample(50);
+    timerA.AddSample(500000);
+    timerB.AddSample(3);
+
+    std::string sText = FormatPerfStatsPrometheus();
+    BOOST_CHECK(sText.find("# TYPE biblepay_test_prom_events_total counter\nbiblepay_test_prom_events_total 7\n") != std::string::npos);
+    // One TYPE line for the callers of a timer, and cumulative buckets per caller
+    size_t nType = sText.find("# TYPE biblepay_test_prom_calls_seconds histogram\n");
+    BOOST_CHECK(nType != std::string::npos);
+    BOOST_CHECK(sText.find("# TYPE biblepay_test_prom_calls_seconds histogram\n", nType + 1) == std::string::npos);
+    BOOST_CHECK(sText.find("biblepay_test_prom_calls_seconds_bucket{context=\"A\",le=\"1e-05\"} 0\n") != std::string::npos);
+    BOOST_CHECK(sText.find("biblepay_test_prom_calls_seconds_bucket{context=\"A\",le=\"0.0001\"} 1\n") != std::string::npos);
+    BOOST_CHECK(sText.find("biblepay_test_prom_calls_seconds_bucket{context=\"A\",le=\"1\"} 2\n") != std::string::npos);
+    BOOST_CHECK(sText.find("biblepay_test_prom_calls_seconds_bucket{context=\"A\",le=\"+Inf\"} 2\n") != std::string::npos);
+    BOOST_CHECK(sText.find("biblepay_test_prom_calls_seconds_sum{context=\"A\"} 0.500050\n") != std::string::npos);
+    BOOST_CHECK(sText.find("biblepay_test_prom_calls_seconds_count{context=\"A\"} 2\n") != std::string::npos);
+    BOOST_CHECK(sText.find("biblepay_test_prom_calls_seconds_bucket{context=\"B\",le=\"1e-05\"} 1\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(perfstats_prometheus_escapes_context)
+{
+    CPerfStat& counter = GetPerfCounter("test_prom_escaped", "a\\b \"c\"\nd");
+    counter.Add();
+    BOOST_CHECK_EQUAL((uintptr_t)&counter % PERF_CACHE_LINE, 0U);
+
+    std::string sText = FormatPerfStatsPrometheus();
+    BOOST_CHECK(sText.find("biblepay_test_prom_escaped_total{context=\"a\\\\b \\\"c\\\"\\nd\"} 1\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,91 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "podc.h"
+
+#include "random.h"
+#include "utilstrencodings.h"
+
+#include "test/test_biblepay.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(podc_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(podc_wu_elements_match_lookup)
+{
+    // A result_status.php reply as the sanctuaries receive it, headers included
+    std::string sResults = "HTTP/1.1 200 OK\r\nContent-Type: text/xml\r\n\r\n<results>\n<error>ID 976055122</error>\n";
+    for (int i = 0; i < 300; i++) {
+        sResults += "<result>\n<id>" + itostr(975000000 + i) + "</id>\n<create_time>1519055586</create_time>\n";
+        if (i % 7 != 0) sResults += "<sent_time>" + itostr(1519056000 + i) + "</sent_time>\n";
+        sResults += "<received_time>1519151181</received_time>\n</result>\n";
+    }
+    // A repeated id keeps the first sent_time, as the linear lookup does
+    sResults += "<result>\n<id>975000001</id>\n<sent_time>1</sent_time>\n</result>\n</results>\n";
+
+    boost::unordered_map<double, std::string> mapSentTimes;
+    GetWUElements(sResults, "<result>", "id", "sent_time", mapSentTimes);
+    for (int i = -1; i < 301; i++) {
+        double dTask = 975000000 + i;
+        boost::unordered_map<double, std::string>::const_iterator it = mapSentTimes.find(dTask);
+        std::string sFound = it == mapSentTimes.end() ? "" : it->second;
+        BOOST_CHECK_EQUAL(sFound, GetWUElement(sResults, "<result>", dTask, "id", "sent_time"));
+    }
+    BOOST_CHECK_EQUAL(mapSentTimes[975000001], "1519056001");
+    BOOST_CHECK_EQUAL(mapSentTimes[975000007], "");
+
+    boost::unordered_map<double, std::string> mapEmpty;
+    GetWUElements("", "<result>", "id", "sent_time", mapEmpty);
+    BOOST_CHECK(mapEmpty.find(975000001) == mapEmpty.end());
+}
+
+BOOST_AUTO_TEST_CASE(podc_extract_xml_fields_match_extractxml)
+{
+    XMLTagList vTags = GetXMLTagList("MT,MK,MV,MS,NONCE,cpidsig,PODC_TASKS,a,ab");
+    // Tags ExtractXML finds by plain substring search
+    vTags.push_back(std::make_pair("cpid:", ";"));
+    vTags.push_back(std::make_pair("", "</MT>"));
+    vTags.push_back(std::make_pair("<LONGERTAG>", "<L"));
+    // The end is looked for from 3 bytes past the start, so the '<' inside this start tag is not its end
+    vTags.push_back(std::make_pair("<a<", "<"));
+
+    std::vector<std::string> vMessages;
+    vMessages.push_back("");
+    vMessages.push_back("<MT>PRAYER</MT><MK>Healing (2/18/2018)</MK><MV>Please pray for my family</MV><NONCE>1519056000</NONCE><MS>sig</MS>");
+    vMessages.push_back("<MT>CPIDTASKS</MT><MK>cpid:abc;1</MK><MV>975000001=1519056001,975000002=1519056002</MV><cpidsig>abc;hash;BAddr;sig</cpidsig><PODC_TASKS>975000001=1</PODC_TASKS>");
+    // Nested and repeated tags, an end tag ahead of its start, missing ends, tags cut off at the end
+    vMessages.push_back("</MT><MT><MV><MT>inner</MT></MV></MT><MK>one</MK><MK>two</MK><MS>open<NONCE>x</NONCE");
+    vMessages.push_back("<a><ab>1</ab></a><a></a><ab></a></ab><LONGERTAG>text<LONGERTAG><L");
+    vMessages.push_back("<MT></MT><MK/><MV>< MV></MV><cpidsig");
+    vMessages.push_back("<a></a>");
+    vMessages.push_back("<ab</ab>");
+    vMessages.push_back("<a<x<y");
+    // Random soup of the tags' pieces
+    for (int i = 0; i < 300; i++) {
+        std::string sMessage;
+        int nPieces = insecure_rand() % 30;
+        for (int j = 0; j < nPieces; j++) {
+            const std::pair<std::string, std::string>& tag = vTags[insecure_rand() % vTags.size()];
+            switch (insecure_rand() % 4) {
+            case 0: sMessage += tag.first; break;
+            case 1: sMessage += tag.second; break;
+            case 2: sMessage += "<"; break;
+            default: sMessage += itostr(insecure_rand() % 1000);
+            }
+        }
+        vMessages.push_back(sMessage);
+    }
+
+    for (int i = 0; i < (int)vMessages.size(); i++) {
+        std::vector<std::string> vFields = ExtractXMLFields(vMessages[i], vTags);
+        BOOST_REQUIRE_EQUAL(vFields.size(), vTags.size());
+        for (int j = 0; j < (int)vTags.size(); j++)
+            BOOST_CHECK_MESSAGE(vFields[j] == ExtractXML(vMessages[i], vTags[j].first, vTags[j].second), "message " + vMessages[i] + " tag " + vTags[j].first);
+    }
+    BOOST_CHECK_EQUAL(ExtractXMLFields(vMessages[1], vTags)[2], "Please pray for my family");
+    BOOST_CHECK(ExtractXMLFields(vMessages[1], XMLTagList()).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
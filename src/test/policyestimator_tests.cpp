@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "policy/fees.h"
+#include "streams.h"
 #include "txmempool.h"
 #include "uint256.h"
 #include "util.h"
@@ -207,4 +208,55 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     }
 }
 
+BOOST_AUTO_TEST_CASE(BlockPolicyEstimatesPersist)
+{
+    CBlockPolicyEstimator estimator(CFeeRate(1000));
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_1;
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 0LL;
+
+    // Every block confirms the 10 transactions that entered just before it
+    for (unsigned int nHeight = 1; nHeight <= 300; nHeight++) {
+        std::vector<CTxMemPoolEntry> entries;
+        for (int j = 0; j < 10; j++) {
+            tx.vin[0].prevout.n = 100 * nHeight + j;
+            entries.push_back(CTxMemPoolEntry(tx, 10000 * (j + 1), 0, 0, nHeight - 1, true, 0, false, 1, LockPoints()));
+            estimator.processTransaction(entries.back(), true);
+        }
+        estimator.processBlock(nHeight, entries, true);
+        for (unsigned int i = 0; i < entries.size(); i++)
+            estimator.removeTx(entries[i].GetTx().GetHash());
+    }
+    BOOST_CHECK(estimator.estimateFee(1).GetFeePerK() > 0);
+
+    // The lazily decayed averages are written out as the actual averages
+    boost::filesystem::path path = GetTempPath() / strprintf("fee_estimates_test_%lu", (unsigned long)GetTime());
+    {
+        CAutoFile fileout(fopen(path.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_REQUIRE(!fileout.IsNull());
+        estimator.Write(fileout);
+    }
+    CBlockPolicyEstimator estimatorRead(CFeeRate(1000));
+    {
+        CAutoFile filein(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+        BOOST_REQUIRE(!filein.IsNull());
+        estimatorRead.Read(filein);
+    }
+    boost::filesystem::remove(path);
+    BOOST_CHECK_EQUAL(estimatorRead.GetBestSeenHeight(), 300U);
+    for (int i = 1; i <= 10; i++)
+        BOOST_CHECK(estimator.estimateFee(i) == estimatorRead.estimateFee(i));
+
+    // and both keep decaying the same way afterwards
+    std::vector<CTxMemPoolEntry> empty;
+    for (unsigned int nHeight = 301; nHeight <= 400; nHeight++) {
+        estimator.processBlock(nHeight, empty, true);
+        estimatorRead.processBlock(nHeight, empty, true);
+    }
+    for (int i = 1; i <= 10; i++)
+        BOOST_CHECK(estimator.estimateFee(i) == estimatorRead.estimateFee(i));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -307,4 +307,47 @@ BOOST_AUTO_TEST_CASE(rpc_ban)
     BOOST_CHECK_EQUAL(adr.get_str(), "2001:4d48:ac57:400:cacf:e9ff:fe1d:9c63/128");
 }
 
+BOOST_AUTO_TEST_CASE(rpc_batch_and_stats)
+{
+    if (RPCIsInWarmup(NULL))
+        SetRPCWarmupFinished();
+
+    // decodescript is thread safe, getmempoolinfo is not; replies keep request order
+    UniValue vReq(UniValue::VARR);
+    for (int i = 0; i < 6; i++) {
+        UniValue req(UniValue::VOBJ);
+        req.push_back(Pair("id", i));
+        if (i == 3) {
+            req.push_back(Pair("method", "getmempoolinfo"));
+            req.push_back(Pair("params", UniValue(UniValue::VARR)));
+        } else {
+            req.push_back(Pair("method", "decodescript"));
+            req.push_back(Pair("params", ParseNonRFCJSONValue("[\"51\"]")));
+        }
+        vReq.push_back(req);
+    }
+    UniValue vRet = ParseNonRFCJSONValue(JSONRPCExecBatch(vReq));
+    BOOST_CHECK_EQUAL(vRet.size(), 6);
+    for (int i = 0; i < 6; i++) {
+        BOOST_CHECK_EQUAL(find_value(vRet[i], "id").get_int(), i);
+        BOOST_CHECK(find_value(vRet[i], "error").isNull());
+    }
+    BOOST_CHECK_EQUAL(find_value(find_value(vRet[0], "result"), "asm").get_str(), "1");
+
+    UniValue stats = tableRPC.execute("getrpcstats", UniValue(UniValue::VARR));
+    BOOST_CHECK(find_value(find_value(stats, "decodescript"), "calls").get_int64() >= 5);
+    BOOST_CHECK_EQUAL(find_value(find_value(stats, "decodescript"), "errors").get_int64(), 0);
+    BOOST_CHECK(find_value(find_value(stats, "getmempoolinfo"), "calls").get_int64() >= 1);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_long_running_exec)
+{
+    // Only the slow exec subcommands are passed on to the -rpcexecthreads threads
+    BOOST_CHECK(IsLongRunningRPC("exec", ParseNonRFCJSONValue("[\"podcupdate\"]")));
+    BOOST_CHECK(IsLongRunningRPC("exec", ParseNonRFCJSONValue("[\"ipfsget\", \"hash\"]")));
+    BOOST_CHECK(!IsLongRunningRPC("exec", ParseNonRFCJSONValue("[\"health\"]")));
+    BOOST_CHECK(!IsLongRunningRPC("exec", UniValue(UniValue::VARR)));
+    BOOST_CHECK(!IsLongRunningRPC("getblockcount", ParseNonRFCJSONValue("[\"podcupdate\"]")));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
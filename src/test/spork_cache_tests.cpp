@@ -0,0 +1,78 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "podc.h"
+#include "spork-cache.h"
+
+#include "test/test_biblepay.h"
+
+#include <boost/test/unit_test.hpp>
+
+void WriteCache(std::string sSection, std::string sKey, std::string sValue, int64_t locktime, bool IgnoreCase=true);
+void ClearCache(std::string sSection);
+std::string GetSporkValue(std::string sKey);
+double GetSporkDouble(std::string sName, double nDefault);
+
+BOOST_FIXTURE_TEST_SUITE(spork_cache_tests, BasicTestingSetup)
+
+struct SporkChangeRecorder
+{
+    std::vector<std::string>* pvChanged;
+    void operator()(const std::string& sKey, const std::string& sValue) const { pvChanged->push_back(sKey + "=" + sValue); }
+};
+
+BOOST_AUTO_TEST_CASE(spork_cache_follows_application_cache)
+{
+    CSporkHandle hSpork("unittestspork");
+    BOOST_CHECK_EQUAL(hSpork.GetString(), "");
+    BOOST_CHECK_EQUAL(hSpork.GetDouble(7), 7);
+
+    WriteCache("spork", "unittestspork", "12.5", 1);
+    BOOST_CHECK_EQUAL(hSpork.GetString(), "12.5");
+    BOOST_CHECK_EQUAL(hSpork.GetDouble(7), 12.5);
+    BOOST_CHECK_EQUAL(GetSporkValue("UnitTestSpork"), "12.5");
+    BOOST_CHECK_EQUAL(GetSporkDouble("unittestspork", 7), 12.5);
+    BOOST_CHECK_EQUAL(GetSporkDouble("unittestspork", 7), cdbl(mvApplicationCache["SPORK;UNITTESTSPORK"], 2));
+
+    WriteCache("SPORK", "UNITTESTSPORK", "0", 2);
+    BOOST_CHECK_EQUAL(hSpork.GetDouble(7), 7);
+
+    WriteCache("SPORK", "UNITTESTSPORK", "1;2;3", 3);
+    std::vector<std::string> vList = hSpork.GetList();
+    BOOST_CHECK_EQUAL(vList.size(), 3);
+    BOOST_CHECK_EQUAL(vList[2], "3");
+
+    // Not a spork
+    WriteCache("PRAYER", "UNITTESTSPORK", "5", 4);
+    BOOST_CHECK_EQUAL(hSpork.GetString(), "1;2;3");
+
+    ClearCache("SPORK");
+    BOOST_CHECK_EQUAL(hSpork.GetString(), "");
+    BOOST_CHECK(hSpork.GetList().empty());
+}
+
+BOOST_AUTO_TEST_CASE(spork_cache_notifications)
+{
+    std::vector<std::string> vChanged;
+    CSporkValueCache cache;
+    SporkChangeRecorder recorder;
+    recorder.pvChanged = &vChanged;
+    boost::signals2::connection conn = cache.NotifySporkChanged.connect(recorder);
+
+    const CSporkValueCache::Slot* pslot = cache.Resolve("podsmode");
+    cache.Set("PODSMODE", "1");
+    cache.Set("PODSMODE", "1");
+    cache.Set("PODSMODE", "bad.value.1");
+    conn.disconnect();
+
+    // Repeating a value is not a change
+    BOOST_CHECK_EQUAL(vChanged.size(), 2);
+    BOOST_CHECK_EQUAL(vChanged[0], "PODSMODE=1");
+    BOOST_CHECK_EQUAL(cache.GetString(pslot), "bad.value.1");
+    // Values cdbl cannot cast fall back to the default
+    BOOST_CHECK_EQUAL(cache.GetDouble(pslot, 3), 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,147 @@
+// Copyright (c) 2017-2018 The Biblepay Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "governance-classes.h"
+#include "main.h"
+#include "superblock-calendar.h"
+
+#include "test/test_biblepay.h"
+
+#include <boost/test/unit_test.hpp>
+
+int GetLastDCSuperblockHeight(int nCurrentHeight, int& nNextSuperblock);
+
+BOOST_FIXTURE_TEST_SUITE(superblock_calendar_tests, BasicTestingSetup)
+
+// The schedule as it was defined before the calendar existed
+static bool ReferenceIsDCCSuperblock(const Consensus::Params& params, bool fProdChain, int nHeight)
+{
+    if ((nHeight > F13000_CUTOVER_HEIGHT_PROD && fProdChain) || (nHeight > F13000_CUTOVER_HEIGHT_TESTNET && !fProdChain))
+        return nHeight >= params.nDCCSuperblockStartBlock && ((nHeight % params.nDCCSuperblockCycle) == 10);
+    return nHeight >= params.nDCCSuperblockStartBlock && ((nHeight % params.nDCCSuperblockCycle) == 0);
+}
+
+// The height-by-height walk GetLastDCSuperblockHeight used to perform
+static int ReferenceLastDCSuperblockHeight(const Consensus::Params& params, bool fProdChain, int nCurrentHeight, int& nNextSuperblock)
+{
+    int nLastSuperblock = 0;
+    int nSuperblockStartBlock = params.nDCCSuperblockStartBlock;
+    int nHeight = nCurrentHeight;
+    for (; nHeight > nSuperblockStartBlock; nHeight--)
+    {
+        if (ReferenceIsDCCSuperblock(params, fProdChain, nHeight))
+        {
+            nLastSuperblock = nHeight;
+            break;
+        }
+    }
+    nHeight++;
+    for (; nHeight > nSuperblockStartBlock; nHeight++)
+    {
+        if (ReferenceIsDCCSuperblock(params, fProdChain, nHeight))
+        {
+            nNextSuperblock = nHeight;
+            break;
+        }
+    }
+    return nLastSuperblock;
+}
+
+static void CheckAgainstReference(const std::string& strNetwork, bool fProdChain)
+{
+    SelectParams(strNetwork);
+    const Consensus::Params& params = Params().GetConsensus();
+    bool fOldProd = fProd;
+    bool fOldDC = fDistributedComputingEnabled;
+    fProd = fProdChain;
+    fDistributedComputingEnabled = true;
+
+    int nCutover = fProdChain ? F13000_CUTOVER_HEIGHT_PROD : F13000_CUTOVER_HEIGHT_TESTNET;
+    int nMaxHeight = std::max(nCutover, params.nDCCSuperblockStartBlock) + 20 * params.nDCCSuperblockCycle;
+    for (int nHeight = 0; nHeight <= nMaxHeight; nHeight++)
+    {
+        BOOST_CHECK_EQUAL(CSuperblock::IsDCCSuperblock(nHeight), ReferenceIsDCCSuperblock(params, fProdChain, nHeight));
+
+        int nNextExpected = -1;
+        int nNextActual = -1;
+        int nLastExpected = ReferenceLastDCSuperblockHeight(params, fProdChain, nHeight, nNextExpected);
+        int nLastActual = GetLastDCSuperblockHeight(nHeight, nNextActual);
+        BOOST_CHECK_EQUAL(nLastActual, nLastExpected);
+        BOOST_CHECK_EQUAL(nNextActual, nNextExpected);
+
+        bool fGovernance = nHeight >= params.nSuperblockStartBlock && (nHeight % params.nSuperblockCycle) == 0;
+        BOOST_CHECK_EQUAL(CSuperblock::IsValidBlockHeight(nHeight), fGovernance);
+    }
+
+    fProd = fOldProd;
+    fDistributedComputingEnabled = fOldDC;
+    SelectParams(CBaseChainParams::MAIN);
+}
+
+BOOST_AUTO_TEST_CASE(calendar_segments)
+{
+    CSuperblockCalendar calendar;
+    BOOST_CHECK(calendar.IsEmpty());
+    BOOST_CHECK(!calendar.IsSuperblock(100));
+    BOOST_CHECK_EQUAL(calendar.GetPrevious(100), 0);
+    BOOST_CHECK_EQUAL(calendar.GetNext(100), 0);
+
+    calendar.AddSegment(100, 10, 0);    // 100, 110, ... 150
+    calendar.AddSegment(151, 0, 0);     // no superblocks
+    calendar.AddSegment(200, 25, 10);   // 210, 235, ...
+
+    BOOST_CHECK(!calendar.IsSuperblock(90));
+    BOOST_CHECK(calendar.IsSuperblock(100));
+    BOOST_CHECK(calendar.IsSuperblock(150));
+    BOOST_CHECK(!calendar.IsSuperblock(160));
+    BOOST_CHECK(!calendar.IsSuperblock(200));
+    BOOST_CHECK(calendar.IsSuperblock(210));
+
+    BOOST_CHECK_EQUAL(calendar.GetPrevious(99), 0);
+    BOOST_CHECK_EQUAL(calendar.GetPrevious(100), 100);
+    BOOST_CHECK_EQUAL(calendar.GetPrevious(209), 150);
+    BOOST_CHECK_EQUAL(calendar.GetPrevious(234), 210);
+
+    BOOST_CHECK_EQUAL(calendar.GetNext(0), 100);
+    BOOST_CHECK_EQUAL(calendar.GetNext(100), 110);
+    BOOST_CHECK_EQUAL(calendar.GetNext(150), 210);
+    BOOST_CHECK_EQUAL(calendar.GetNext(210), 235);
+
+    // Exhaustive cross check of previous/next against IsSuperblock
+    int nPrevious = 0;
+    for (int nHeight = 0; nHeight < 1000; nHeight++)
+    {
+        if (calendar.IsSuperblock(nHeight)) nPrevious = nHeight;
+        BOOST_CHECK_EQUAL(calendar.GetPrevious(nHeight), nPrevious);
+        int nNext = nHeight + 1;
+        while (!calendar.IsSuperblock(nNext)) nNext++;
+        BOOST_CHECK_EQUAL(calendar.GetNext(nHeight), nNext);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(calendar_disabled)
+{
+    CSuperblockCalendar calendar = CSuperblockCalendar::BuildDCC(Params().GetConsensus(), true, false);
+    BOOST_CHECK(calendar.IsEmpty());
+    BOOST_CHECK_EQUAL(calendar.GetNext(F13000_CUTOVER_HEIGHT_PROD), 0);
+}
+
+BOOST_AUTO_TEST_CASE(calendar_matches_height_walk_main)
+{
+    CheckAgainstReference(CBaseChainParams::MAIN, true);
+}
+
+BOOST_AUTO_TEST_CASE(calendar_matches_height_walk_testnet)
+{
+    CheckAgainstReference(CBaseChainParams::TESTNET, false);
+}
+
+BOOST_AUTO_TEST_CASE(calendar_matches_height_walk_regtest)
+{
+    CheckAgainstReference(CBaseChainParams::REGTEST, true);
+    CheckAgainstReference(CBaseChainParams::REGTEST, false);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
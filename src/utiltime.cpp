@@ -12,6 +12,7 @@
 #include "tinyformat.h"
 #include "utiltime.h"
 
+#include <boost/chrono/chrono.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/thread.hpp>
 
@@ -57,6 +58,11 @@ int64_t GetLogTimeMicros()
     return GetTimeMicros();
 }
 
+int64_t GetSteadyTimeMillis()
+{
+    return boost::chrono::duration_cast<boost::chrono::milliseconds>(boost::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 void MilliSleep(int64_t n)
 {
 
@@ -13,6 +13,8 @@ int64_t GetTime();
 int64_t GetTimeMillis();
 int64_t GetTimeMicros();
 int64_t GetLogTimeMicros();
+/** Milliseconds on a clock that never jumps with the system time, for measuring timeouts */
+int64_t GetSteadyTimeMillis();
 void SetMockTime(int64_t nMockTimeIn);
 void MilliSleep(int64_t n);
 
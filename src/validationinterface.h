@@ -9,9 +9,16 @@
 #include <boost/signals2/signal.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <stdint.h>
+#include <string>
+#include <vector>
+
 class CBlock;
 struct CBlockLocator;
 class CBlockIndex;
+class CGovernanceObject;
+class CGovernanceVote;
+class COutPoint;
 class CReserveScript;
 class CTransaction;
 class CValidationInterface;
@@ -41,6 +48,11 @@ protected:
     virtual void BlockChecked(const CBlock&, const CValidationState&) {}
     virtual void GetScriptForMining(boost::shared_ptr<CReserveScript>&) {};
     virtual void ResetRequestCount(const uint256 &hash) {};
+    virtual void BlockConnected(const CBlock &block, const CBlockIndex *pindex) {}
+    virtual void NotifyMessage(const std::string &sType, const std::string &sKey, const std::string &sValue, int64_t nTime) {}
+    virtual void NotifyGovernanceObject(const CGovernanceObject &govobj) {}
+    virtual void NotifyGovernanceVote(const CGovernanceVote &vote) {}
+    virtual void NotifyMasternodeListDiff(const std::vector<COutPoint> &vAdded, const std::vector<COutPoint> &vRemoved) {}
     friend void ::RegisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
@@ -67,6 +79,16 @@ struct CMainSignals {
     boost::signals2::signal<void (boost::shared_ptr<CReserveScript>&)> ScriptForMining;
     /** Notifies listeners that a block has been successfully mined */
     boost::signals2::signal<void (const uint256 &)> BlockFound;
+    /** Notifies listeners of a block connected to the active chain, while the block is still in memory */
+    boost::signals2::signal<void (const CBlock &, const CBlockIndex *)> BlockConnected;
+    /** Notifies listeners of a new or changed chain message (PRAYER, DCC, SPORK, ...) once prayers are memorized */
+    boost::signals2::signal<void (const std::string &, const std::string &, const std::string &, int64_t)> NotifyMessage;
+    /** Notifies listeners of a governance object accepted into memory */
+    boost::signals2::signal<void (const CGovernanceObject &)> NotifyGovernanceObject;
+    /** Notifies listeners of an accepted governance vote */
+    boost::signals2::signal<void (const CGovernanceVote &)> NotifyGovernanceVote;
+    /** Notifies listeners of masternodes added to or removed from the list (by collateral outpoint) */
+    boost::signals2::signal<void (const std::vector<COutPoint> &, const std::vector<COutPoint> &)> NotifyMasternodeListDiff;
 };
 
 CMainSignals& GetMainSignals();
@@ -9,6 +9,7 @@
 #include "chain.h"
 #include "core_io.h"
 #include "init.h"
+#include "json-stream.h"
 #include "main.h"
 #include "net.h"
 #include "netbase.h"
@@ -938,6 +939,63 @@ UniValue getunconfirmedbalance(const UniValue &params, bool fHelp)
     return ValueFromAmount(pwalletMain->GetUnconfirmedBalance());
 }
 
+static UniValue WalletBalancesToJSON(const CWalletBalances& balances)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("balance",                   ValueFromAmount(balances.nBalance)));
+    obj.push_back(Pair("unlocked_balance",          ValueFromAmount(balances.nUnlocked)));
+    obj.push_back(Pair("unconfirmed_balance",       ValueFromAmount(balances.nUnconfirmed)));
+    obj.push_back(Pair("immature_balance",          ValueFromAmount(balances.nImmature)));
+    obj.push_back(Pair("watchonly_balance",         ValueFromAmount(balances.nWatchOnly)));
+    obj.push_back(Pair("unconfirmed_watchonly",     ValueFromAmount(balances.nUnconfirmedWatchOnly)));
+    obj.push_back(Pair("immature_watchonly",        ValueFromAmount(balances.nImmatureWatchOnly)));
+    obj.push_back(Pair("anonymized_balance",        ValueFromAmount(balances.nAnonymized)));
+    obj.push_back(Pair("normalized_anonymized",     ValueFromAmount(balances.nNormalizedAnonymized)));
+    obj.push_back(Pair("denominated_confirmed",     ValueFromAmount(balances.nDenominatedConfirmed)));
+    obj.push_back(Pair("denominated_unconfirmed",   ValueFromAmount(balances.nDenominatedUnconfirmed)));
+    obj.push_back(Pair("average_anonymized_rounds", balances.GetAverageAnonymizedRounds()));
+    UniValue colored(UniValue::VOBJ);
+    for (std::map<std::string, CAmount>::const_iterator it = balances.mapColored.begin(); it != balances.mapColored.end(); ++it)
+        colored.push_back(Pair(it->first, ValueFromAmount(it->second)));
+    obj.push_back(Pair("colored_balances",          colored));
+    return obj;
+}
+
+UniValue verifywalletbalances(const UniValue &params, bool fHelp)
+{
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
+
+    if (fHelp || params.size() > 0)
+        throw runtime_error(
+                "verifywalletbalances\n"
+                "Recomputes all wallet balances with a full scan of the wallet, without any cached\n"
+                "credits, and compares them with the balance ledger used by getbalance, getwalletinfo\n"
+                "and the GUI.\n"
+                "\nResult:\n"
+                "{\n"
+                "  \"consistent\": true|false,  (boolean) whether the cached balances match the full scan\n"
+                "  \"cached\": {...},           (object) the cached balances\n"
+                "  \"computed\": {...}          (object) the balances from the full scan\n"
+                "}\n"
+                "\nExamples:\n"
+                + HelpExampleCli("verifywalletbalances", "")
+                + HelpExampleRpc("verifywalletbalances", "")
+        );
+
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+
+    CWalletBalances cached = pwalletMain->GetBalances();
+    // Recomputed from scratch, without the per transaction credit caches the ledger is built from
+    CWalletBalances computed = pwalletMain->ComputeBalances(false);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("consistent", cached == computed));
+    obj.push_back(Pair("cached",     WalletBalancesToJSON(cached)));
+    obj.push_back(Pair("computed",   WalletBalancesToJSON(computed)));
+    return obj;
+}
+
 
 UniValue movecmd(const UniValue& params, bool fHelp)
 {
@@ -1573,6 +1631,38 @@ void AcentryToJSON(const CAccountingEntry& acentry, const string& strAccount, Un
     }
 }
 
+static void ParseListTransactionsParams(const UniValue& params, string& strAccount, int& nCount, int& nFrom, isminefilter& filter)
+{
+    strAccount = "*";
+    if (params.size() > 0)
+        strAccount = params[0].get_str();
+    nCount = 10;
+    if (params.size() > 1)
+        nCount = params[1].get_int();
+    nFrom = 0;
+    if (params.size() > 2)
+        nFrom = params[2].get_int();
+    filter = ISMINE_SPENDABLE;
+    if(params.size() > 3)
+        if(params[3].get_bool())
+            filter = filter | ISMINE_WATCH_ONLY;
+
+    if (nCount < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
+    if (nFrom < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative from");
+}
+
+static void ListTransactionItem(const CWallet::TxPair& item, const string& strAccount, const isminefilter& filter, UniValue& ret)
+{
+    CWalletTx *const pwtx = item.first;
+    if (pwtx != 0)
+        ListTransactions(*pwtx, strAccount, 0, true, ret, filter);
+    CAccountingEntry *const pacentry = item.second;
+    if (pacentry != 0)
+        AcentryToJSON(*pacentry, strAccount, ret);
+}
+
 UniValue listtransactions(const UniValue& params, bool fHelp)
 {
     if (!EnsureWalletIsAvailable(fHelp))
@@ -1641,24 +1731,11 @@ UniValue listtransactions(const UniValue& params, bool fHelp)
 
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
-    string strAccount = "*";
-    if (params.size() > 0)
-        strAccount = params[0].get_str();
-    int nCount = 10;
-    if (params.size() > 1)
-        nCount = params[1].get_int();
-    int nFrom = 0;
-    if (params.size() > 2)
-        nFrom = params[2].get_int();
-    isminefilter filter = ISMINE_SPENDABLE;
-    if(params.size() > 3)
-        if(params[3].get_bool())
-            filter = filter | ISMINE_WATCH_ONLY;
-
-    if (nCount < 0)
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
-    if (nFrom < 0)
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative from");
+    string strAccount;
+    int nCount;
+    int nFrom;
+    isminefilter filter;
+    ParseListTransactionsParams(params, strAccount, nCount, nFrom, filter);
 
     UniValue ret(UniValue::VARR);
 
@@ -1667,12 +1744,7 @@ UniValue listtransactions(const UniValue& params, bool fHelp)
     // iterate backwards until we have nCount items to return:
     for (CWallet::TxItems::const_reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
     {
-        CWalletTx *const pwtx = (*it).second.first;
-        if (pwtx != 0)
-            ListTransactions(*pwtx, strAccount, 0, true, ret, filter);
-        CAccountingEntry *const pacentry = (*it).second.second;
-        if (pacentry != 0)
-            AcentryToJSON(*pacentry, strAccount, ret);
+        ListTransactionItem((*it).second, strAccount, filter, ret);
 
         if ((int)ret.size() >= (nCount+nFrom)) break;
     }
@@ -1702,6 +1774,70 @@ UniValue listtransactions(const UniValue& params, bool fHelp)
     return ret;
 }
 
+void listtransactions_stream(const UniValue& params, CJSONStreamWriter& writer)
+{
+    if (!EnsureWalletIsAvailable(false))
+    {
+        writer.Value(NullUniValue);
+        return;
+    }
+
+    string strAccount;
+    int nCount;
+    int nFrom;
+    isminefilter filter;
+    ParseListTransactionsParams(params, strAccount, nCount, nFrom, filter);
+
+    // Same output as listtransactions.  Only the wanted entries are taken,
+    // under the locks, and they are written to the client after the locks
+    // are released, so a slow client does not hold up validation or the
+    // wallet.  The first pass only counts the entries of each wallet item,
+    // newest first, the second lists the items again oldest first and keeps
+    // the wanted range.
+    std::vector<UniValue> vEntries;
+    {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+
+        const CWallet::TxItems & txOrdered = pwalletMain->wtxOrdered;
+        std::vector<std::pair<CWallet::TxItems::const_reverse_iterator, int> > vItems;
+        int nEntries = 0;
+        for (CWallet::TxItems::const_reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
+        {
+            if (nEntries >= (nCount+nFrom)) break;
+            UniValue entries(UniValue::VARR);
+            ListTransactionItem((*it).second, strAccount, filter, entries);
+            if (entries.size() > 0)
+                vItems.push_back(std::make_pair(it, (int)entries.size()));
+            nEntries += entries.size();
+        }
+        if (nFrom > nEntries)
+            nFrom = nEntries;
+        if ((nFrom + nCount) > nEntries)
+            nCount = nEntries - nFrom;
+
+        vEntries.reserve(nCount);
+        int nOffset = nEntries;
+        for (int i = (int)vItems.size() - 1; i >= 0; i--)
+        {
+            nOffset -= vItems[i].second;
+            if (nOffset >= nFrom + nCount || nOffset + vItems[i].second <= nFrom)
+                continue;
+            UniValue entries(UniValue::VARR);
+            ListTransactionItem((*vItems[i].first).second, strAccount, filter, entries);
+            for (int j = (int)entries.size() - 1; j >= 0; j--)
+            {
+                if (nOffset + j >= nFrom && nOffset + j < nFrom + nCount)
+                    vEntries.push_back(entries[j]);
+            }
+        }
+    }
+
+    writer.BeginArray();
+    for (unsigned int i = 0; i < vEntries.size(); i++)
+        writer.Value(vEntries[i]);
+    writer.EndArray();
+}
+
 UniValue listaccounts(const UniValue& params, bool fHelp)
 {
     if (!EnsureWalletIsAvailable(fHelp))
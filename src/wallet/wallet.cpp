@@ -685,6 +685,7 @@ void CWallet::MarkDirty()
 
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
+    fBalancesCached = false;
 }
 
 bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletDB* pwalletdb)
@@ -805,6 +806,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
 
         // Break debit/credit balance caches:
         wtx.MarkDirty();
+        MarkBalancesDirty(wtx);
 
         // Notify UI of new or updated transaction
         NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
@@ -911,6 +913,7 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             wtx.nIndex = -1;
             wtx.setAbandoned();
             wtx.MarkDirty();
+            MarkBalancesDirty(wtx);
             wtx.WriteToDisk(&walletdb);
             NotifyTransactionChanged(this, wtx.GetHash(), CT_UPDATED);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them abandoned too
@@ -976,6 +979,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             wtx.nIndex = -1;
             wtx.hashBlock = hashBlock;
             wtx.MarkDirty();
+            MarkBalancesDirty(wtx);
             wtx.WriteToDisk(&walletdb);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them conflicted too
             TxSpends::const_iterator iter = mapTxSpends.lower_bound(COutPoint(now, 0));
@@ -1014,6 +1018,7 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
         if (mapWallet.count(txin.prevout.hash))
             mapWallet[txin.prevout.hash].MarkDirty();
     }
+    MarkBalancesDirty(tx);
 
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
@@ -1481,7 +1486,7 @@ bool CWalletTx::RelayWalletTransaction(std::string strCommand)
             /* uint256 hash = GetHash(); */
             if(strCommand == NetMsgType::TXLOCKREQUEST) 
 			{
-                instantsend.ProcessTxLockRequest(((CTxLockRequest)*this));
+                instantsend.ProcessTxLockRequest(MakeTxLockRequestRef(*this));
             }
             RelayTransaction((CTransaction)*this);
             return true;
@@ -1599,10 +1604,9 @@ CAmount CWalletTx::GetAvailableCredit(bool fUseCache, std::string sColor) const
         if (!pwallet->IsSpent(hashTx, i))
         {
             const CTxOut &txout = vout[i];
-			CComplexTransaction cct(txout);
 			if (!sColor.empty())
 			{
-				if (cct.Color==sColor) nCredit += pwallet->GetCredit(txout, ISMINE_SPENDABLE);
+				if (GetOutputColor(i)==sColor) nCredit += pwallet->GetCredit(txout, ISMINE_SPENDABLE);
 			}
 			else
 			{
@@ -1621,6 +1625,23 @@ CAmount CWalletTx::GetAvailableCredit(bool fUseCache, std::string sColor) const
 	return nCredit;
 }
 
+const std::string& CWalletTx::GetOutputColor(unsigned int n) const
+{
+    if (!fOutputColorsCached)
+    {
+        // Outputs never change, so the colors are parsed once and survive MarkDirty
+        vOutputColorsCached.assign(vout.size(), "");
+        for (unsigned int i = 0; i < vout.size(); i++)
+        {
+            if (vout[i].sTxOutMessage.empty()) continue;
+            CComplexTransaction cct(vout[i]);
+            vOutputColorsCached[i] = cct.Color;
+        }
+        fOutputColorsCached = true;
+    }
+    return vOutputColorsCached[n];
+}
+
 CAmount CWalletTx::GetImmatureWatchOnlyCredit(const bool& fUseCache) const
 {
     if (IsCoinBase() && GetBlocksToMaturity() > 0 && IsInMainChain())
@@ -1858,48 +1879,165 @@ void CWallet::ResendWalletTransactions(int64_t nBestBlockTime)
  */
 
 
-CAmount CWallet::GetBalance() const
+void CWallet::MarkBalancesDirty(const CTransaction& tx)
 {
-    CAmount nTotal = 0;
+    AssertLockHeld(cs_wallet);
+    setTxBalancesDirty.insert(tx.GetHash());
+    // Spending an output, or no longer spending it, changes the share of the spent transaction
+    BOOST_FOREACH(const CTxIn& txin, tx.vin)
     {
-        LOCK2(cs_main, cs_wallet);
+        if (mapWallet.count(txin.prevout.hash))
+            setTxBalancesDirty.insert(txin.prevout.hash);
+    }
+}
+
+void CWallet::UpdateBalances() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    const CBlockIndex* pindexTip = chainActive.Tip();
+    unsigned int nMempoolUpdates = mempool.GetTransactionsUpdated();
+    bool fTipChanged = pindexBalancesCached != pindexTip;
+    bool fReorganized = fTipChanged && (pindexBalancesCached == NULL || !chainActive.Contains(pindexBalancesCached));
+    if (!fBalancesCached || fReorganized || nPrivateSendRoundsBalancesCached != nPrivateSendRounds)
+    {
+        walletBalancesCached = CWalletBalances();
+        mapTxBalances.clear();
+        setTxBalancesUnsettled.clear();
+        setTxBalancesDirty.clear();
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+            setTxBalancesDirty.insert((*it).first);
+        fBalancesCached = true;
+        nPrivateSendRoundsBalancesCached = nPrivateSendRounds;
+    }
+    else if (setTxBalancesDirty.empty() && !fTipChanged && nMempoolUpdatesBalancesCached == nMempoolUpdates)
+        return;
+
+    // Trust of unconfirmed transactions also depends on their wallet parents, so these
+    // are recomputed along with anything else that changed
+    setTxBalancesDirty.insert(setTxBalancesUnsettled.begin(), setTxBalancesUnsettled.end());
+    pindexBalancesCached = pindexTip;
+    nMempoolUpdatesBalancesCached = nMempoolUpdates;
+
+    BOOST_FOREACH(const uint256& hash, setTxBalancesDirty)
+    {
+        std::map<uint256, CWalletBalances>::iterator itBalances = mapTxBalances.find(hash);
+        if (itBalances != mapTxBalances.end())
         {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableCredit(true,"");
+            walletBalancesCached.Add((*itBalances).second, -1);
+            mapTxBalances.erase(itBalances);
         }
+        setTxBalancesUnsettled.erase(hash);
+
+        map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(hash);
+        if (mi == mapWallet.end())
+            continue;
+        const CWalletTx& wtx = (*mi).second;
+        CWalletBalances balances = GetTxBalances(wtx, true);
+        walletBalancesCached.Add(balances, 1);
+        mapTxBalances.insert(std::make_pair(hash, balances));
+
+        // Past the depths at which trust, the unlocked balance, InstantSend and maturity
+        // look, only the wallet events above can change the share
+        int nDepth = wtx.GetDepthInMainChain(false);
+        if (nDepth <= (wtx.IsCoinBase() ? COINBASE_MATURITY + 1 : 6))
+            setTxBalancesUnsettled.insert(hash);
     }
+    setTxBalancesDirty.clear();
+}
 
-    return nTotal;
+CWalletBalances CWallet::GetBalances() const
+{
+    LOCK2(cs_main, cs_wallet);
+    UpdateBalances();
+    return walletBalancesCached;
 }
 
+CWalletBalances CWallet::GetTxBalances(const CWalletTx& wtx, bool fUseCache) const
+{
+    CWalletBalances balances;
+    bool fTrusted = wtx.IsTrusted();
+    int nDepth = wtx.GetDepthInMainChain();
 
-CAmount CWallet::GetUnlockedBalance() const
+    if (fTrusted)
+    {
+        CAmount nAmount = wtx.GetAvailableCredit(fUseCache,"");
+        balances.nBalance += nAmount;
+        // 1-22-2018 :: Ensure Depth in Main Chain is Honored
+        bool fLocked = (nAmount == (SANCTUARY_COLLATERAL * COIN));
+        if (!fLocked && nDepth > 5)
+            balances.nUnlocked += nAmount;
+        balances.nWatchOnly += wtx.GetAvailableWatchOnlyCredit(fUseCache);
+
+        // Per color, the same outputs GetAvailableCredit(false, sColor) counts
+        if (!(wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0))
+        {
+            uint256 hash = wtx.GetHash();
+            for (unsigned int i = 0; i < wtx.vout.size(); i++)
+            {
+                const std::string& sColor = wtx.GetOutputColor(i);
+                if (sColor.empty() || IsSpent(hash, i))
+                    continue;
+                CAmount nCredit = GetCredit(wtx.vout[i], ISMINE_SPENDABLE);
+                if (nCredit != 0)
+                    balances.mapColored[sColor] += nCredit;
+            }
+        }
+    }
+    else if (nDepth == 0 && wtx.InMempool())
+    {
+        balances.nUnconfirmed += wtx.GetAvailableCredit(false,"");
+        balances.nUnconfirmedWatchOnly += wtx.GetAvailableWatchOnlyCredit(fUseCache);
+    }
+    balances.nImmature += wtx.GetImmatureCredit(fUseCache);
+    balances.nImmatureWatchOnly += wtx.GetImmatureWatchOnlyCredit(fUseCache);
+
+    if (fLiteMode) return balances;
+
+    if (fTrusted)
+        balances.nAnonymized += wtx.GetAnonymizedCredit(fUseCache);
+    balances.nDenominatedConfirmed += wtx.GetDenominatedCredit(false, fUseCache);
+    balances.nDenominatedUnconfirmed += wtx.GetDenominatedCredit(true, fUseCache);
+
+    // Note: rounds are calculated including unconfirmed,
+    // that's ok as long as we use them for informational purposes only
+    uint256 hash = wtx.GetHash();
+    for (unsigned int i = 0; i < wtx.vout.size(); i++) {
+
+        CTxIn txin = CTxIn(hash, i);
+
+        if(IsSpent(hash, i) || IsMine(wtx.vout[i]) != ISMINE_SPENDABLE || !IsDenominated(txin)) continue;
+
+        int nRounds = GetInputPrivateSendRounds(txin);
+        balances.nTotalAnonymizedRounds += nRounds;
+        balances.nDenominatedOutputs++;
+        if (nDepth < 0) continue;
+        balances.nNormalizedAnonymized += wtx.vout[i].nValue * nRounds / nPrivateSendRounds;
+    }
+    return balances;
+}
+
+CWalletBalances CWallet::ComputeBalances(bool fUseCache) const
 {
-	CAmount nTotal = 0;
+    CWalletBalances balances;
     {
         LOCK2(cs_main, cs_wallet);
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-			{
-                CAmount nAmount = pcoin->GetAvailableCredit(true,"");
-				// 1-22-2018 :: Ensure Depth in Main Chain is Honored
-				int nCoinDepth = pcoin->GetDepthInMainChain();
-                bool fLocked = (nAmount == (SANCTUARY_COLLATERAL * COIN));
-				if (!fLocked)
-				{
-					if (nCoinDepth > 5) 
-					{
-						nTotal += nAmount;
-					}
-				}
-			}
-        }
+            balances.Add(GetTxBalances((*it).second, fUseCache), 1);
     }
-    return nTotal;
+    return balances;
+}
+
+CAmount CWallet::GetBalance() const
+{
+    return GetBalances().nBalance;
+}
+
+
+CAmount CWallet::GetUnlockedBalance() const
+{
+    return GetBalances().nUnlocked;
 }
 
 
@@ -1928,19 +2066,7 @@ CAmount CWallet::GetAnonymizedBalance() const
 {
     if(fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAnonymizedCredit();
-        }
-    }
-
-    return nTotal;
+    return GetBalances().nAnonymized;
 }
 
 		
@@ -1956,8 +2082,7 @@ CAmount CWallet::Get401Debit(const CTxIn &txin, const isminefilter& filter) cons
             if (txin.prevout.n < prev.vout.size())
                 if (IsMine(prev.vout[txin.prevout.n]) & filter)
 				{
-					CComplexTransaction cct(prev.vout[txin.prevout.n]);
-					bool b401k = (cct.Color=="401");
+					bool b401k = (prev.GetOutputColor(txin.prevout.n)=="401");
 					if (b401k) return prev.vout[txin.prevout.n].nValue;
 				}
         }
@@ -1979,43 +2104,15 @@ std::string GetCoinColor(CTransaction c)
 
 CAmount CWallet::GetRetirementBalance() const
 {
-	isminefilter filter = ISMINE_SPENDABLE;
-	CAmount nTotalDebit = 0;
-	CAmount nTotalCredit = 0;
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-     		CAmount nDebit = 0;
+	return GetColoredBalance("401");
+}
 
-			for (unsigned int i = 0; i < pcoin->vin.size(); i++) 
-			{
-				const CTxIn& txin = pcoin->vin[i];
-				nDebit += Get401Debit(txin,filter);
-			}
-        
-			CAmount nCredit2 = 0;
-			for (unsigned int i = 0; i < pcoin->vout.size(); i++) 
-			{
-				const CTxOut& txout = pcoin->vout[i];
-				bool isMine = IsMine(txout);
-				CComplexTransaction cct(txout);
-				bool b401k = (cct.Color=="401");
-				if (pcoin->IsTrusted() && isMine && b401k)
-				{
-					nCredit2 += txout.nValue;
-				}
-			}
-		    if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableCredit(false,"401");
-			nTotalDebit += nDebit;
-			nTotalCredit += nCredit2;
-		}
-	}
- 	// LogPrintf(" Total Debit %f, Total Credit %f, Total %f  ",(double)nTotalDebit/COIN, (double)nTotalCredit/COIN, (double)nTotal/COIN);
-    return nTotal;
+CAmount CWallet::GetColoredBalance(const std::string& sColor) const
+{
+    LOCK2(cs_main, cs_wallet);
+    UpdateBalances();
+    std::map<std::string, CAmount>::const_iterator it = walletBalancesCached.mapColored.find(sColor);
+    return it != walletBalancesCached.mapColored.end() ? it->second : 0;
 }
 
 // Note: calculated including unconfirmed,
@@ -2024,33 +2121,7 @@ double CWallet::GetAverageAnonymizedRounds() const
 {
     if(fLiteMode) return 0;
 
-    double fTotal = 0;
-    double fCount = 0;
-
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-
-            uint256 hash = (*it).first;
-
-            for (unsigned int i = 0; i < pcoin->vout.size(); i++) {
-
-                CTxIn vin = CTxIn(hash, i);
-
-                if(IsSpent(hash, i) || IsMine(pcoin->vout[i]) != ISMINE_SPENDABLE || !IsDenominated(vin)) continue;
-
-                int rounds = GetInputPrivateSendRounds(vin);
-                fTotal += (float)rounds;
-                fCount += 1;
-            }
-        }
-    }
-
-    if(fCount == 0) return 0;
-
-    return fTotal/fCount;
+    return GetBalances().GetAverageAnonymizedRounds();
 }
 
 // Note: calculated including unconfirmed,
@@ -2059,30 +2130,7 @@ CAmount CWallet::GetNormalizedAnonymizedBalance() const
 {
     if(fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-
-            uint256 hash = (*it).first;
-
-            for (unsigned int i = 0; i < pcoin->vout.size(); i++) {
-
-                CTxIn txin = CTxIn(hash, i);
-
-                if(IsSpent(hash, i) || IsMine(pcoin->vout[i]) != ISMINE_SPENDABLE || !IsDenominated(txin)) continue;
-                if (pcoin->GetDepthInMainChain() < 0) continue;
-
-                int nRounds = GetInputPrivateSendRounds(txin);
-                nTotal += pcoin->vout[i].nValue * nRounds / nPrivateSendRounds;
-            }
-        }
-    }
-
-    return nTotal;
+    return GetBalances().nNormalizedAnonymized;
 }
 
 CAmount CWallet::GetNeedsToBeAnonymizedBalance(CAmount nMinBalance) const
@@ -2113,92 +2161,33 @@ CAmount CWallet::GetDenominatedBalance(bool unconfirmed) const
 {
     if(fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-
-            nTotal += pcoin->GetDenominatedCredit(unconfirmed);
-        }
-    }
-
-    return nTotal;
+    CWalletBalances balances = GetBalances();
+    return unconfirmed ? balances.nDenominatedUnconfirmed : balances.nDenominatedConfirmed;
 }
 
 CAmount CWallet::GetUnconfirmedBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableCredit(false,"");
-        }
-    }
-    return nTotal;
+    return GetBalances().nUnconfirmed;
 }
 
 CAmount CWallet::GetImmatureBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nImmature;
 }
 
 CAmount CWallet::GetWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
-        }
-    }
-
-    return nTotal;
+    return GetBalances().nWatchOnly;
 }
 
 CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nUnconfirmedWatchOnly;
 }
 
 CAmount CWallet::GetImmatureWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nImmatureWatchOnly;
 }
 
 void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const CCoinControl *coinControl, 
@@ -2237,10 +2226,10 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
             for (unsigned int i = 0; i < pcoin->vout.size(); i++) 
 			{
                 bool found = false;
-				CComplexTransaction cct(pcoin->vout[i]);
-				if (cct.Color=="401" && nCoinType != ONLY_RETIREMENT_COINS) continue;
+				const std::string& sColor = pcoin->GetOutputColor(i);
+				if (sColor=="401" && nCoinType != ONLY_RETIREMENT_COINS) continue;
 
-				if (nCoinType == ONLY_RETIREMENT_COINS && cct.Color=="401")
+				if (nCoinType == ONLY_RETIREMENT_COINS && sColor=="401")
 				{
 					found = true;
 				}
@@ -3982,6 +3971,8 @@ bool CWallet::UpdatedTransaction(const uint256 &hashTx)
         // Only notify UI if this transaction is in this wallet
         map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(hashTx);
         if (mi != mapWallet.end()){
+            // e.g. an InstantSend lock changes the depth the balances see
+            setTxBalancesDirty.insert(hashTx);
             NotifyTransactionChanged(this, hashTx, CT_UPDATED);
             return true;
         }
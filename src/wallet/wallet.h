@@ -113,6 +113,74 @@ struct CompactTallyItem
     }
 };
 
+/** All wallet balances; also the share of them contributed by one wallet transaction */
+struct CWalletBalances
+{
+    CAmount nBalance;
+    CAmount nUnlocked;
+    CAmount nUnconfirmed;
+    CAmount nImmature;
+    CAmount nWatchOnly;
+    CAmount nUnconfirmedWatchOnly;
+    CAmount nImmatureWatchOnly;
+    CAmount nAnonymized;
+    CAmount nNormalizedAnonymized;
+    CAmount nDenominatedConfirmed;
+    CAmount nDenominatedUnconfirmed;
+    int64_t nTotalAnonymizedRounds;
+    int64_t nDenominatedOutputs;
+    //! spendable balance of each output color, colors without a balance are left out
+    std::map<std::string, CAmount> mapColored;
+
+    CWalletBalances() :
+        nBalance(0), nUnlocked(0), nUnconfirmed(0), nImmature(0),
+        nWatchOnly(0), nUnconfirmedWatchOnly(0), nImmatureWatchOnly(0),
+        nAnonymized(0), nNormalizedAnonymized(0),
+        nDenominatedConfirmed(0), nDenominatedUnconfirmed(0),
+        nTotalAnonymizedRounds(0), nDenominatedOutputs(0) {}
+
+    double GetAverageAnonymizedRounds() const
+    {
+        return nDenominatedOutputs > 0 ? (double)nTotalAnonymizedRounds / nDenominatedOutputs : 0;
+    }
+
+    //! add (nSign 1) or take away (nSign -1) the balances of b
+    void Add(const CWalletBalances& b, int nSign)
+    {
+        nBalance += nSign * b.nBalance;
+        nUnlocked += nSign * b.nUnlocked;
+        nUnconfirmed += nSign * b.nUnconfirmed;
+        nImmature += nSign * b.nImmature;
+        nWatchOnly += nSign * b.nWatchOnly;
+        nUnconfirmedWatchOnly += nSign * b.nUnconfirmedWatchOnly;
+        nImmatureWatchOnly += nSign * b.nImmatureWatchOnly;
+        nAnonymized += nSign * b.nAnonymized;
+        nNormalizedAnonymized += nSign * b.nNormalizedAnonymized;
+        nDenominatedConfirmed += nSign * b.nDenominatedConfirmed;
+        nDenominatedUnconfirmed += nSign * b.nDenominatedUnconfirmed;
+        nTotalAnonymizedRounds += nSign * b.nTotalAnonymizedRounds;
+        nDenominatedOutputs += nSign * b.nDenominatedOutputs;
+        for (std::map<std::string, CAmount>::const_iterator it = b.mapColored.begin(); it != b.mapColored.end(); ++it)
+        {
+            CAmount& nColored = mapColored[it->first];
+            nColored += nSign * it->second;
+            if (nColored == 0)
+                mapColored.erase(it->first);
+        }
+    }
+
+    bool operator==(const CWalletBalances& b) const
+    {
+        return nBalance == b.nBalance && nUnlocked == b.nUnlocked && nUnconfirmed == b.nUnconfirmed &&
+               nImmature == b.nImmature && nWatchOnly == b.nWatchOnly &&
+               nUnconfirmedWatchOnly == b.nUnconfirmedWatchOnly && nImmatureWatchOnly == b.nImmatureWatchOnly &&
+               nAnonymized == b.nAnonymized && nNormalizedAnonymized == b.nNormalizedAnonymized &&
+               nDenominatedConfirmed == b.nDenominatedConfirmed && nDenominatedUnconfirmed == b.nDenominatedUnconfirmed &&
+               nTotalAnonymizedRounds == b.nTotalAnonymizedRounds && nDenominatedOutputs == b.nDenominatedOutputs &&
+               mapColored == b.mapColored;
+    }
+};
+
 /** A key pool entry */
 class CKeyPool
 {
@@ -288,6 +356,8 @@ public:
     mutable bool fImmatureWatchCreditCached;
     mutable bool fAvailableWatchCreditCached;
     mutable bool fChangeCached;
+    mutable bool fOutputColorsCached;
+    mutable std::vector<std::string> vOutputColorsCached;
     mutable CAmount nDebitCached;
     mutable CAmount nCreditCached;
     mutable CAmount nImmatureCreditCached;
@@ -343,6 +413,8 @@ public:
         fImmatureWatchCreditCached = false;
         fAvailableWatchCreditCached = false;
         fChangeCached = false;
+        fOutputColorsCached = false;
+        vOutputColorsCached.clear();
         nDebitCached = 0;
         nCreditCached = 0;
         nImmatureCreditCached = 0;
@@ -431,6 +503,8 @@ public:
     CAmount GetCredit(const isminefilter& filter) const;
     CAmount GetImmatureCredit(bool fUseCache=true) const;
     CAmount GetAvailableCredit(bool fUseCache, std::string sColor) const;
+    //! color of an output (e.g. "401"), parsed from its message once per transaction
+    const std::string& GetOutputColor(unsigned int n) const;
     CAmount GetImmatureWatchOnlyCredit(const bool& fUseCache=true) const;
     CAmount GetAvailableWatchOnlyCredit(const bool& fUseCache=true) const;
     CAmount GetChange() const;
@@ -548,6 +622,27 @@ private:
     mutable bool fAnonymizableTallyCachedNonDenom;
     mutable std::vector<CompactTallyItem> vecAnonymizableTallyCachedNonDenom;
 
+    /**
+     * Balance ledger: the balances each wallet transaction contributes, and
+     * their sum. Wallet events mark the transactions they touch dirty, and
+     * only those are recomputed. Transactions whose share still depends on
+     * the chain or the mempool (unconfirmed, conflicted, shallow, immature)
+     * are kept apart and recomputed when the tip or the mempool changed.
+     * fBalancesCached false, a reorganisation or a new PrivateSend rounds
+     * setting rebuild the whole ledger.
+     */
+    mutable bool fBalancesCached;
+    mutable const CBlockIndex* pindexBalancesCached;
+    mutable unsigned int nMempoolUpdatesBalancesCached;
+    mutable int nPrivateSendRoundsBalancesCached;
+    mutable CWalletBalances walletBalancesCached;
+    mutable std::map<uint256, CWalletBalances> mapTxBalances;
+    mutable std::set<uint256> setTxBalancesDirty;
+    mutable std::set<uint256> setTxBalancesUnsettled;
+    void MarkBalancesDirty(const CTransaction& tx);
+    void UpdateBalances() const;
+    CWalletBalances GetTxBalances(const CWalletTx& wtx, bool fUseCache) const;
+
     /**
      * Used to keep track of spent outpoints, and
      * detect and report conflicts (double-spends or
@@ -618,6 +713,14 @@ public:
         fAnonymizableTallyCachedNonDenom = false;
         vecAnonymizableTallyCached.clear();
         vecAnonymizableTallyCachedNonDenom.clear();
+        fBalancesCached = false;
+        pindexBalancesCached = NULL;
+        nMempoolUpdatesBalancesCached = 0;
+        nPrivateSendRoundsBalancesCached = 0;
+        walletBalancesCached = CWalletBalances();
+        mapTxBalances.clear();
+        setTxBalancesDirty.clear();
+        setTxBalancesUnsettled.clear();
     }
 
     std::map<uint256, CWalletTx> mapWallet;
@@ -744,12 +847,17 @@ public:
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime);
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime);
+    //! balances from the ledger, updated for the transactions that changed since the last call
+    CWalletBalances GetBalances() const;
+    //! full scan of mapWallet, bypassing the ledger and, without fUseCache, the per transaction credit caches
+    CWalletBalances ComputeBalances(bool fUseCache = true) const;
     CAmount GetBalance() const;
 	CAmount GetUnlockedBalance() const;
     CAmount GetUnconfirmedBalance() const;
     CAmount GetImmatureBalance() const;
     CAmount GetWatchOnlyBalance() const;
 	CAmount GetRetirementBalance() const;
+	CAmount GetColoredBalance(const std::string& sColor) const;
 	CAmount Get401Debit(const CTxIn &txin, const isminefilter& filter) const;
     CAmount GetUnconfirmedWatchOnlyBalance() const;
     CAmount GetImmatureWatchOnlyBalance() const;
@@ -25,3 +25,28 @@ bool CZMQAbstractNotifier::NotifyTransactionLock(const CTransaction &/*transacti
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyBlockConnected(const CBlock &/*block*/, const CBlockIndex * /*pindex*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyMessage(const std::string &/*sType*/, const std::string &/*sKey*/, const std::string &/*sValue*/, int64_t /*nTime*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyGovernanceObject(const CGovernanceObject &/*govobj*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyGovernanceVote(const CGovernanceVote &/*vote*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyMasternodeListDiff(const std::vector<COutPoint> &/*vAdded*/, const std::vector<COutPoint> &/*vRemoved*/)
+{
+    return true;
+}
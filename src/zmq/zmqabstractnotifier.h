@@ -7,7 +7,11 @@
 
 #include "zmqconfig.h"
 
+#include <vector>
+
 class CBlockIndex;
+class CGovernanceObject;
+class CGovernanceVote;
 class CZMQAbstractNotifier;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
@@ -35,6 +39,11 @@ public:
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
     virtual bool NotifyTransactionLock(const CTransaction &transaction);
+    virtual bool NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex);
+    virtual bool NotifyMessage(const std::string &sType, const std::string &sKey, const std::string &sValue, int64_t nTime);
+    virtual bool NotifyGovernanceObject(const CGovernanceObject &govobj);
+    virtual bool NotifyGovernanceVote(const CGovernanceVote &vote);
+    virtual bool NotifyMasternodeListDiff(const std::vector<COutPoint> &vAdded, const std::vector<COutPoint> &vRemoved);
 
 protected:
     void *psocket;
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
+#include "sync.h"
 #include "validationinterface.h"
 #include <string>
 #include <map>
@@ -27,11 +28,20 @@ protected:
     void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
     void UpdatedBlockTip(const CBlockIndex *pindex);
     void NotifyTransactionLock(const CTransaction &tx);
+    void BlockConnected(const CBlock &block, const CBlockIndex *pindex);
+    void NotifyMessage(const std::string &sType, const std::string &sKey, const std::string &sValue, int64_t nTime);
+    void NotifyGovernanceObject(const CGovernanceObject &govobj);
+    void NotifyGovernanceVote(const CGovernanceVote &vote);
+    void NotifyMasternodeListDiff(const std::vector<COutPoint> &vAdded, const std::vector<COutPoint> &vRemoved);
 
 private:
     CZMQNotificationInterface();
 
     void *pcontext;
+    // The signals come from several threads, and notifiers bound to one
+    // address share a zmq socket, which is not thread safe: every send and
+    // every change of the list is made under this lock
+    CCriticalSection cs_notifiers;
     std::list<CZMQAbstractNotifier*> notifiers;
 };
 
@@ -4,9 +4,15 @@
 
 #include "chainparams.h"
 #include "zmqpublishnotifier.h"
+#include "governance-object.h"
+#include "governance-vote.h"
 #include "main.h"
+#include "streams.h"
+#include "superblock-calendar.h"
 #include "util.h"
 
+#include <boost/algorithm/string/predicate.hpp>
+
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
 static const char *MSG_HASHBLOCK  = "hashblock";
@@ -15,6 +21,13 @@ static const char *MSG_HASHTXLOCK = "hashtxlock";
 static const char *MSG_RAWBLOCK   = "rawblock";
 static const char *MSG_RAWTX      = "rawtx";
 static const char *MSG_RAWTXLOCK = "rawtxlock";
+static const char *MSG_RAWPRAYER  = "rawprayer";
+static const char *MSG_DCC        = "dcc";
+static const char *MSG_PUBSPORK   = "spork";
+static const char *MSG_GOBJECT    = "gobject";
+static const char *MSG_GOVVOTE    = "govvote";
+static const char *MSG_SUPERBLOCK = "superblock";
+static const char *MSG_MNLISTDIFF = "mnlistdiff";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -56,6 +69,59 @@ static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
     return 0;
 }
 
+// Internal function to send one copied message part
+static int zmq_send_copy(void *sock, const void* data, size_t size, int flags)
+{
+    zmq_msg_t msg;
+
+    int rc = zmq_msg_init_size(&msg, size);
+    if (rc != 0)
+    {
+        zmqError("Unable to initialize ZMQ msg");
+        return -1;
+    }
+    memcpy(zmq_msg_data(&msg), data, size);
+
+    rc = zmq_msg_send(&msg, sock, flags);
+    zmq_msg_close(&msg);
+    if (rc == -1)
+    {
+        zmqError("Unable to send ZMQ msg");
+        return -1;
+    }
+    return 0;
+}
+
+// Free function for zero-copy message parts, hint is the stream owning the bytes
+static void zmq_free_stream(void * /*data*/, void *hint)
+{
+    delete static_cast<CDataStream*>(hint);
+}
+
+// Internal function to send one message part without copying it; zmq owns pstream afterwards
+static int zmq_send_stream(void *sock, CDataStream *pstream, int flags)
+{
+    zmq_msg_t msg;
+
+    int rc = zmq_msg_init_data(&msg, pstream->empty() ? NULL : &(*pstream)[0], pstream->size(), zmq_free_stream, pstream);
+    if (rc != 0)
+    {
+        zmqError("Unable to initialize ZMQ msg");
+        delete pstream;
+        return -1;
+    }
+
+    rc = zmq_msg_send(&msg, sock, flags);
+    // closing releases the stream through zmq_free_stream if the message was not sent
+    zmq_msg_close(&msg);
+    if (rc == -1)
+    {
+        zmqError("Unable to send ZMQ msg");
+        return -1;
+    }
+    return 0;
+}
+
 bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
 {
     assert(!psocket);
@@ -142,7 +208,30 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
     return true;
 }
 
-bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQAbstractPublishNotifier::SendMessage(const char *command, CDataStream *pstream)
+{
+    assert(psocket);
+
+    /* command and sequence number are small enough to copy, the data part is sent in place */
+    unsigned char msgseq[sizeof(uint32_t)];
+    WriteLE32(&msgseq[0], nSequence);
+    if (zmq_send_copy(psocket, command, strlen(command), ZMQ_SNDMORE) == -1)
+    {
+        delete pstream;
+        return false;
+    }
+    if (zmq_send_stream(psocket, pstream, ZMQ_SNDMORE) == -1)
+        return false;
+    if (zmq_send_copy(psocket, msgseq, sizeof(uint32_t), 0) == -1)
+        return false;
+
+    /* increment memory only sequence number after sending */
+    nSequence++;
+
+    return true;
+}
+
+bool CZMQPublishHashBlockNotifier::NotifyBlockConnected(const CBlock &/*block*/, const CBlockIndex *pindex)
 {
     uint256 hash = pindex->GetBlockHash();
     LogPrint("zmq", "zmq: Publish hashblock %s\n", hash.GetHex());
@@ -172,25 +261,15 @@ bool CZMQPublishHashTransactionLockNotifier::NotifyTransactionLock(const CTransa
     return SendMessage(MSG_HASHTXLOCK, data, 32);
 }
 
-bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishRawBlockNotifier::NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex)
 {
     LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams, "CZMQPUBLISHRAWBLOCKNOTIFIER"))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
-    }
-
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    // The block is still in memory here, so there is no need to read it back from disk
+    CDataStream *pss = new CDataStream(SER_NETWORK, PROTOCOL_VERSION);
+    pss->reserve(::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    *pss << block;
+    return SendMessage(MSG_RAWBLOCK, pss);
 }
 
 bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
@@ -210,3 +289,58 @@ bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransac
     ss << transaction;
     return SendMessage(MSG_RAWTXLOCK, &(*ss.begin()), ss.size());
 }
+
+CZMQPublishRawPrayerNotifier::CZMQPublishRawPrayerNotifier() : CZMQPublishMessageNotifier("PRAYER", MSG_RAWPRAYER) { }
+
+CZMQPublishDCCNotifier::CZMQPublishDCCNotifier() : CZMQPublishMessageNotifier("DCC", MSG_DCC) { }
+
+CZMQPublishSporkNotifier::CZMQPublishSporkNotifier() : CZMQPublishMessageNotifier("SPORK", MSG_PUBSPORK) { }
+
+bool CZMQPublishMessageNotifier::NotifyMessage(const std::string &sType, const std::string &sKey, const std::string &sValue, int64_t nTime)
+{
+    if (!boost::iequals(sType, pszMessageType))
+        return true;
+
+    LogPrint("zmq", "zmq: Publish %s %s\n", pszCommand, sKey);
+    CDataStream *pss = new CDataStream(SER_NETWORK, PROTOCOL_VERSION);
+    *pss << sKey << sValue << nTime;
+    return SendMessage(pszCommand, pss);
+}
+
+bool CZMQPublishGovernanceObjectNotifier::NotifyGovernanceObject(const CGovernanceObject &govobj)
+{
+    LogPrint("zmq", "zmq: Publish gobject %s\n", govobj.GetHash().GetHex());
+    CDataStream *pss = new CDataStream(SER_NETWORK, PROTOCOL_VERSION);
+    *pss << govobj;
+    return SendMessage(MSG_GOBJECT, pss);
+}
+
+bool CZMQPublishGovernanceVoteNotifier::NotifyGovernanceVote(const CGovernanceVote &vote)
+{
+    LogPrint("zmq", "zmq: Publish govvote %s\n", vote.GetHash().GetHex());
+    CDataStream *pss = new CDataStream(SER_NETWORK, PROTOCOL_VERSION);
+    *pss << vote;
+    return SendMessage(MSG_GOVVOTE, pss);
+}
+
+bool CZMQPublishSuperblockNotifier::NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex)
+{
+    bool fDCC = GetDCCSuperblockCalendar().IsSuperblock(pindex->nHeight);
+    bool fGovernance = GetGovernanceSuperblockCalendar().IsSuperblock(pindex->nHeight);
+    if ((!fDCC && !fGovernance) || block.vtx.empty())
+        return true;
+
+    LogPrint("zmq", "zmq: Publish superblock %d %s\n", pindex->nHeight, pindex->GetBlockHash().GetHex());
+    // height, block hash, superblock kinds and the coinbase payments
+    CDataStream *pss = new CDataStream(SER_NETWORK, PROTOCOL_VERSION);
+    *pss << pindex->nHeight << pindex->GetBlockHash() << fDCC << fGovernance << block.vtx[0].vout;
+    return SendMessage(MSG_SUPERBLOCK, pss);
+}
+
+bool CZMQPublishMasternodeListDiffNotifier::NotifyMasternodeListDiff(const std::vector<COutPoint> &vAdded, const std::vector<COutPoint> &vRemoved)
+{
+    LogPrint("zmq", "zmq: Publish mnlistdiff +%u -%u\n", vAdded.size(), vRemoved.size());
+    CDataStream *pss = new CDataStream(SER_NETWORK, PROTOCOL_VERSION);
+    *pss << vAdded << vRemoved;
+    return SendMessage(MSG_MNLISTDIFF, pss);
+}
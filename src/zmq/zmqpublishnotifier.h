@@ -8,13 +8,15 @@
 #include "zmqabstractnotifier.h"
 
 class CBlockIndex;
+class CDataStream;
 
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
 private:
-    uint32_t nSequence; // upcounting per message sequence number
+    uint32_t nSequence; // upcounting per topic sequence number, each notifier publishes one topic
 
 public:
+    CZMQAbstractPublishNotifier() : nSequence(0) { }
 
     /* send zmq multipart message
        parts:
@@ -24,6 +26,10 @@ public:
     */
     bool SendMessage(const char *command, const void* data, size_t size);
 
+    /* same message, but the data part is handed to zmq without a copy;
+       takes ownership of pstream, which zmq frees once it has been sent */
+    bool SendMessage(const char *command, CDataStream *pstream);
+
     bool Initialize(void *pcontext);
     void Shutdown();
 };
@@ -31,7 +37,7 @@ public:
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex);
 };
 
 class CZMQPublishHashTransactionNotifier : public CZMQAbstractPublishNotifier
@@ -49,7 +55,7 @@ public:
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex);
 };
 
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
@@ -64,4 +70,59 @@ public:
     bool NotifyTransactionLock(const CTransaction &transaction);
 };
 
+/** Publishes the chain messages of one type (PRAYER, DCC, SPORK) as they are memorized */
+class CZMQPublishMessageNotifier : public CZMQAbstractPublishNotifier
+{
+private:
+    const char *pszMessageType;
+    const char *pszCommand;
+
+public:
+    CZMQPublishMessageNotifier(const char *pszMessageTypeIn, const char *pszCommandIn) : pszMessageType(pszMessageTypeIn), pszCommand(pszCommandIn) { }
+
+    bool NotifyMessage(const std::string &sType, const std::string &sKey, const std::string &sValue, int64_t nTime);
+};
+
+class CZMQPublishRawPrayerNotifier : public CZMQPublishMessageNotifier
+{
+public:
+    CZMQPublishRawPrayerNotifier();
+};
+
+class CZMQPublishDCCNotifier : public CZMQPublishMessageNotifier
+{
+public:
+    CZMQPublishDCCNotifier();
+};
+
+class CZMQPublishSporkNotifier : public CZMQPublishMessageNotifier
+{
+public:
+    CZMQPublishSporkNotifier();
+};
+
+class CZMQPublishGovernanceObjectNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyGovernanceObject(const CGovernanceObject &govobj);
+};
+
+class CZMQPublishGovernanceVoteNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyGovernanceVote(const CGovernanceVote &vote);
+};
+
+class CZMQPublishSuperblockNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockConnected(const CBlock &block, const CBlockIndex *pindex);
+};
+
+class CZMQPublishMasternodeListDiffNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyMasternodeListDiff(const std::vector<COutPoint> &vAdded, const std::vector<COutPoint> &vRemoved);
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H